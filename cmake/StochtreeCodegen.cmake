@@ -0,0 +1,38 @@
+# Helpers for compiling forests translated to C++ by the stochtree_codegen tool
+# (see include/stochtree/codegen.h for the interface of the generated code).
+#
+# stochtree_add_compiled_model(<target> MODEL <model.json> [FOREST <label>] [SAMPLES <i> <j> ...])
+#
+# Adds a custom command that runs stochtree_codegen on <model.json> and a shared library
+# <target> built from the generated source, exporting `predict(const double* row, double* out)`.
+# The source is regenerated whenever the model file changes.
+function(stochtree_add_compiled_model target)
+  cmake_parse_arguments(ARG "" "MODEL;FOREST" "SAMPLES" ${ARGN})
+  if(NOT ARG_MODEL)
+    message(FATAL_ERROR "stochtree_add_compiled_model: MODEL is required")
+  endif()
+  if(NOT TARGET stochtree_codegen)
+    message(FATAL_ERROR "stochtree_add_compiled_model: the stochtree_codegen target is not defined (set BUILD_CODEGEN=ON)")
+  endif()
+  get_filename_component(model_path "${ARG_MODEL}" ABSOLUTE)
+  set(generated_source "${CMAKE_CURRENT_BINARY_DIR}/${target}.cpp")
+
+  set(codegen_args "${model_path}" "${generated_source}")
+  if(ARG_FOREST)
+    list(APPEND codegen_args --forest "${ARG_FOREST}")
+  endif()
+  if(ARG_SAMPLES)
+    string(REPLACE ";" "," sample_list "${ARG_SAMPLES}")
+    list(APPEND codegen_args --samples "${sample_list}")
+  endif()
+
+  add_custom_command(
+    OUTPUT "${generated_source}"
+    COMMAND stochtree_codegen ${codegen_args}
+    DEPENDS stochtree_codegen "${model_path}"
+    COMMENT "Generating C++ source for forest model ${ARG_MODEL}"
+    VERBATIM
+  )
+  add_library(${target} SHARED "${generated_source}")
+  set_target_properties(${target} PROPERTIES CXX_VISIBILITY_PRESET hidden)
+endfunction()
@@ -0,0 +1,131 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Importer of Arrow record batches, exchanged through the Arrow C data interface, into a ForestDataset.
+ */
+#ifndef STOCHTREE_ARROW_DATASET_H_
+#define STOCHTREE_ARROW_DATASET_H_
+
+#include <stochtree/data.h>
+#include <stochtree/meta.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Structs of the Arrow C data interface (https://arrow.apache.org/docs/format/CDataInterface.html), which is a stable
+// ABI, so no Arrow library is needed. The guard is the one required by the specification, so that these definitions
+// coexist with those of Arrow, nanoarrow and others.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace StochTree {
+
+/*! \brief Options of an `ArrowDatasetImporter` */
+struct ArrowDatasetConfig {
+  /*! \brief Column of the outcome (-1 if the record batch has no outcome) */
+  int outcome_column = -1;
+  /*! \brief Column of the variance weights (-1 if the record batch has no weights) */
+  int weight_column = -1;
+  /*! \brief Columns of the leaf regression basis (empty if the record batch has no basis) */
+  std::vector<int> basis_columns;
+  /*! \brief Columns of the covariates, or empty to use every column that is not an outcome, weight or basis column */
+  std::vector<int> covariate_columns;
+  /*! \brief Whether to store the covariates in single precision (see `ForestDataset::AddCovariates`) */
+  bool single_precision = false;
+  /*! \brief Whether to borrow the Arrow buffers of the covariates and basis when their layout allows it, rather than copying them */
+  bool borrow = true;
+  /*! \brief Number of threads used to convert the columns (values <= 0 use all available hardware threads) */
+  int num_threads = 1;
+};
+
+/*!
+ * \brief Load an Arrow record batch (a struct array, exchanged through the Arrow C data interface) into a `ForestDataset`,
+ *        without converting it to an R or numpy matrix first.
+ *
+ *        Columns may be booleans, signed or unsigned integers, floats or doubles, or dictionary-encoded. Dictionary-encoded
+ *        columns become categorical covariates whose category codes are the dictionary indices (unordered, unless the
+ *        dictionary is flagged as ordered), boolean columns become ordered categorical covariates and all other columns
+ *        numeric covariates. Null values become NaN, which trees send to the default child of a split.
+ *
+ *        Covariates (or basis columns) of the same floating point type, without nulls, whose buffers happen to be laid out as
+ *        one column-major matrix (e.g. a record batch exported from a Fortran-ordered array) are borrowed rather than copied.
+ *        All other columns are converted, in parallel, into a buffer that the dataset borrows and retains.
+ */
+class ArrowDatasetImporter {
+ public:
+  explicit ArrowDatasetImporter(ArrowDatasetConfig const& config) : config_(config) {}
+  ~ArrowDatasetImporter() {}
+
+  /*!
+   * \brief Load a record batch into `dataset`, replacing its covariates (and its basis and variance weights, if configured).
+   *
+   *        Following the C data interface, the importer takes ownership of `array`, which is moved out (and marked released),
+   *        and releases it once it is no longer needed: at the end of `Import` if every column was copied, or when the last
+   *        dataset borrowing its buffers is destroyed otherwise. `schema` is only read, and remains owned by the caller.
+   * \param array Struct array holding one child array per column
+   * \param schema Schema of `array`, with format `+s`
+   * \param dataset Dataset into which the data is loaded
+   */
+  void Import(struct ArrowArray* array, struct ArrowSchema const* schema, ForestDataset& dataset);
+
+  /*! \brief Type of each covariate */
+  std::vector<FeatureType>& FeatureTypes() {return feature_types_;}
+  /*! \brief Values of the outcome column (empty if there is none) */
+  std::vector<double>& Outcome() {return outcome_;}
+  /*! \brief Names of the covariate columns */
+  std::vector<std::string>& CovariateNames() {return covariate_names_;}
+  /*! \brief Dictionary values of (dictionary-encoded) covariate `covariate_num` as strings, indexed by category code */
+  std::vector<std::string>& CategoryLabels(int covariate_num) {return category_labels_[covariate_num];}
+
+ private:
+  ArrowDatasetConfig config_;
+  std::vector<FeatureType> feature_types_;
+  std::vector<double> outcome_;
+  std::vector<std::string> covariate_names_;
+  std::vector<std::vector<std::string>> category_labels_;
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_ARROW_DATASET_H_
@@ -0,0 +1,80 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Binary columnar file format for a ForestDataset, which is memory-mapped (rather than parsed or copied) when loaded.
+ */
+#ifndef STOCHTREE_BINARY_DATASET_H_
+#define STOCHTREE_BINARY_DATASET_H_
+
+#include <stochtree/data.h>
+#include <stochtree/meta.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace StochTree {
+
+/*! \brief Magic bytes at the start of a binary dataset file */
+static constexpr char kBinaryDatasetMagic[8] = {'S', 'T', 'C', 'H', 'D', 'A', 'T', 'A'};
+/*! \brief Current version of the binary dataset format */
+static constexpr std::uint32_t kBinaryDatasetVersion = 1;
+/*! \brief Alignment (in bytes) of every block of a binary dataset file */
+static constexpr std::uint64_t kBinaryDatasetAlignment = 64;
+
+/*!
+ * \brief Fixed-size header of a binary dataset file.
+ *
+ *        The header is followed by the blocks listed below, each starting at a multiple of `kBinaryDatasetAlignment` bytes
+ *        (an offset of 0 means that the block is absent). All values are stored in the byte order of the machine that wrote
+ *        the file, which is recorded in `byte_order` so that files written on a machine of a different byte order are rejected.
+ *        - covariates: `num_covariates` columns of `num_rows` values, each value stored in `covariate_bytes` bytes (float or double)
+ *        - basis: `num_basis` columns of `num_rows` values, each value stored in `basis_bytes` bytes (float or double)
+ *        - variance weights: `num_rows` doubles
+ *        - feature types: `num_covariates` int32 `FeatureType` values
+ *        - presort index: `num_covariates` columns of `num_rows` int32 observation indices (see `ForestDataset::AddPresortIndex`)
+ */
+struct BinaryDatasetHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::int64_t num_rows;
+  std::int32_t num_covariates;
+  std::int32_t num_basis;
+  std::int32_t covariate_bytes;
+  std::int32_t basis_bytes;
+  std::uint64_t covariate_offset;
+  std::uint64_t basis_offset;
+  std::uint64_t var_weights_offset;
+  std::uint64_t feature_types_offset;
+  std::uint64_t presort_offset;
+};
+
+/*!
+ * \brief Write the covariates, basis and variance weights of `dataset` and the types of its features to a binary dataset file.
+ *        Covariates and basis are written at their stored precision, and sparse covariates are written densely.
+ * \param dataset Dataset to write
+ * \param feature_types Type of each covariate
+ * \param filename Name of the file to write
+ * \param include_presort Whether to sort every feature and store the sort indices, so that samplers run on the loaded
+ *        dataset skip the initial sort
+ */
+void SaveBinaryDataset(ForestDataset& dataset, std::vector<FeatureType> const& feature_types, std::string const& filename, bool include_presort = false);
+
+/*!
+ * \brief Load a binary dataset file written by `SaveBinaryDataset` into `dataset`.
+ *
+ *        The file is memory-mapped read-only through `VirtualFileReader::MapReadOnly` and the covariates, basis and presort index
+ *        are borrowed from the mapping, which the dataset (and any copy of it) keeps alive. Many processes can therefore map the
+ *        same file and share its pages without parsing or copying it. Readers that cannot map files read the whole file into memory
+ *        instead. Variance weights are copied.
+ * \param filename Name of the file to load
+ * \param dataset Dataset into which the data is loaded
+ * \param feature_types Overwritten with the type of each covariate
+ */
+void LoadBinaryDataset(std::string const& filename, ForestDataset& dataset, std::vector<FeatureType>& feature_types);
+
+} // namespace StochTree
+
+#endif // STOCHTREE_BINARY_DATASET_H_
@@ -0,0 +1,126 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Dictionaries of the levels of categorical features, learned from training data and applied (in parallel)
+ * to new data, which replace the ordinal / one-hot preprocessing of data frames in R and Python.
+ */
+#ifndef STOCHTREE_CATEGORY_ENCODER_H_
+#define STOCHTREE_CATEGORY_ENCODER_H_
+
+#include <stochtree/meta.h>
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace StochTree {
+
+/*!
+ * \brief Dictionary of the levels of one categorical feature, which maps every level to a dense 0-based code.
+ *
+ *        Levels are either strings or integers (passed as doubles, e.g. R integer vectors or numpy arrays of integer codes).
+ *        A learned dictionary holds the sorted unique levels of the training data (strings sorted bytewise, as in the C locale),
+ *        so that codes match the default levels of an R `factor` and the categories of a scikit-learn encoder.
+ *
+ *        When values are encoded, missing values (null strings or NaN) are coded NaN and levels that were not seen during
+ *        fitting are coded `NumLevels()`, one past the last level. Fitting and encoding give the same results for any number of threads.
+ */
+class CategoryDictionary {
+ public:
+  CategoryDictionary() {}
+  ~CategoryDictionary() {}
+
+  /*!
+   * \brief Learn the levels of a string feature, replacing any previous levels
+   * \param values Pointers to the (null-terminated) value of each observation, or null for missing values
+   * \param num_values Number of observations
+   * \param num_threads Number of threads (values <= 0 use all available hardware threads)
+   */
+  void FitStrings(char const* const* values, data_size_t num_values, int num_threads = 1);
+  /*!
+   * \brief Learn the levels of an integer feature, replacing any previous levels
+   * \param values Integer value of each observation, or NaN for missing values
+   * \param num_values Number of observations
+   * \param num_threads Number of threads (values <= 0 use all available hardware threads)
+   */
+  void FitIntegers(double const* values, data_size_t num_values, int num_threads = 1);
+  /*! \brief Use `levels` (in the order given) as the levels of a string feature */
+  void SetStringLevels(std::vector<std::string> const& levels);
+  /*! \brief Use `levels` (in the order given) as the levels of an integer feature */
+  void SetIntegerLevels(std::vector<std::int64_t> const& levels);
+
+  /*!
+   * \brief Write the code of each value of a string feature to `output[i * output_stride]`
+   * \param values Pointers to the (null-terminated) value of each observation, or null for missing values
+   * \param num_values Number of observations
+   * \param output Buffer of at least `(num_values - 1) * output_stride + 1` codes
+   * \param output_stride Distance between the codes of consecutive observations (1 for a column of a column-major matrix)
+   * \param num_threads Number of threads (values <= 0 use all available hardware threads)
+   */
+  void EncodeStrings(char const* const* values, data_size_t num_values, double* output, std::int64_t output_stride = 1, int num_threads = 1) const;
+  /*! \brief Write the code of each value of an integer feature to `output[i * output_stride]` (see `EncodeStrings`) */
+  void EncodeIntegers(double const* values, data_size_t num_values, double* output, std::int64_t output_stride = 1, int num_threads = 1) const;
+  /*!
+   * \brief Expand codes produced by `EncodeStrings` or `EncodeIntegers` into a column-major `num_values` by `NumLevels() + 1` matrix
+   *        of indicators, whose last column flags unseen levels. Missing values have no indicator set.
+   */
+  void OneHot(double const* codes, data_size_t num_values, double* output, int num_threads = 1) const;
+
+  /*! \brief Code of a single string value */
+  double Code(char const* value) const;
+  /*! \brief Code of a single integer value */
+  double Code(double value) const;
+
+  bool IsStringFeature() const {return is_string_;}
+  int NumLevels() const {return is_string_ ? static_cast<int>(string_levels_.size()) : static_cast<int>(integer_levels_.size());}
+  std::vector<std::string>& StringLevels() {return string_levels_;}
+  std::vector<std::int64_t>& IntegerLevels() {return integer_levels_;}
+
+  nlohmann::json to_json();
+  void from_json(const nlohmann::json& dictionary_json);
+
+ private:
+  void BuildIndex();
+  bool is_string_{true};
+  std::vector<std::string> string_levels_;
+  std::vector<std::int64_t> integer_levels_;
+  std::unordered_map<std::string, int> string_index_;
+  std::unordered_map<std::int64_t, int> integer_index_;
+};
+
+/*!
+ * \brief Category dictionaries of the categorical features of a model, which are saved in (and restored from) the model's JSON
+ *        so that new data is encoded exactly as the training data was.
+ */
+class CategoryEncoder {
+ public:
+  CategoryEncoder() {}
+  ~CategoryEncoder() {}
+
+  /*!
+   * \brief Add an (empty) dictionary for a categorical feature and return its index
+   * \param feature_type `kOrderedCategorical` (encoded as codes) or `kUnorderedCategorical` (usually one-hot encoded)
+   * \param feature_name Name of the feature, e.g. the name of its data frame column
+   */
+  int AddFeature(FeatureType feature_type, std::string const& feature_name = "");
+  int NumFeatures() const {return static_cast<int>(dictionaries_.size());}
+  CategoryDictionary& GetDictionary(int feature_num) {return dictionaries_.at(feature_num);}
+  FeatureType GetFeatureType(int feature_num) const {return feature_types_.at(feature_num);}
+  std::string const& GetFeatureName(int feature_num) const {return feature_names_.at(feature_num);}
+  void Reset() {dictionaries_.clear(); feature_types_.clear(); feature_names_.clear();}
+
+  nlohmann::json to_json();
+  void from_json(const nlohmann::json& encoder_json);
+
+ private:
+  std::vector<CategoryDictionary> dictionaries_;
+  std::vector<FeatureType> feature_types_;
+  std::vector<std::string> feature_names_;
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_CATEGORY_ENCODER_H_
@@ -0,0 +1,138 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Packed encoding of the categories routed left by a categorical split, with constant-time,
+ * allocation-free membership tests.
+ */
+#ifndef STOCHTREE_CATEGORY_SET_H_
+#define STOCHTREE_CATEGORY_SET_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace StochTree {
+
+/*! \brief Header word of an encoded category set stored as a bitset */
+static constexpr std::uint64_t kCategoryBitset = 0;
+/*! \brief Header word of an encoded category set stored as an open-addressing hash table */
+static constexpr std::uint64_t kCategoryHashSet = 1;
+/*! \brief Category sets whose largest category is at most this value are always encoded as bitsets */
+static constexpr std::uint32_t kCategoryBitsetMaxCategory = 4095;
+
+/*!
+ * \brief Convert the value of a categorical feature into a category index.
+ *        A valid (integer) category must be exactly representable as a double and fit into
+ *        uint32_t; negative, missing and out-of-range values do not match any category.
+ * \param fvalue Value of the feature
+ * \param category Category index (truncated towards zero), set only if the value is valid
+ */
+inline bool CategoryIndex(double fvalue, std::uint32_t& category) {
+  static const double max_representable_int
+      = std::min(static_cast<double>(std::numeric_limits<std::uint32_t>::max()),
+          static_cast<double>(std::uint64_t(1) << std::numeric_limits<double>::digits));
+  if (!(fvalue >= 0) || fvalue > max_representable_int) return false;
+  category = static_cast<std::uint32_t>(fvalue);
+  return true;
+}
+
+/*! \brief Slot of `category` in a hash table with `mask + 1` (a power of two) slots */
+inline std::uint64_t CategoryHashSlot(std::uint32_t category, std::uint64_t mask) {
+  std::uint64_t hash = static_cast<std::uint64_t>(category) * 0x9e3779b97f4a7c15ULL;
+  return (hash ^ (hash >> 32)) & mask;
+}
+
+/*!
+ * \brief Append the encoding of a list of categories to `output`.
+ *
+ *        The encoding starts with a header word. Sets of small categories, or dense sets of large ones,
+ *        are stored as a bitset (`kCategoryBitset`) with bit `c % 64` of word `c / 64` set for category `c`.
+ *        Sparse sets of large categories are stored as a hash table (`kCategoryHashSet`) with linear
+ *        probing, holding `c + 1` for each category `c` and 0 in empty slots, at most half full.
+ * \param category_begin Pointer to the first category in the list
+ * \param category_end Pointer one past the last category in the list
+ * \param output Vector to which the encoded set is appended
+ */
+inline void EncodeCategorySet(std::uint32_t const* category_begin, std::uint32_t const* category_end, std::vector<std::uint64_t>& output) {
+  std::uint64_t num_categories = category_end - category_begin;
+  std::uint32_t max_category = num_categories > 0 ? *std::max_element(category_begin, category_end) : 0;
+  std::uint64_t num_bitset_words = num_categories > 0 ? static_cast<std::uint64_t>(max_category) / 64 + 1 : 0;
+  std::uint64_t num_hash_slots = 2;
+  while (num_hash_slots < 2 * num_categories) num_hash_slots *= 2;
+  std::size_t header = output.size();
+  if (max_category <= kCategoryBitsetMaxCategory || num_bitset_words <= num_hash_slots) {
+    output.push_back(kCategoryBitset);
+    output.resize(header + 1 + num_bitset_words, 0);
+    std::uint64_t* words = output.data() + header + 1;
+    for (std::uint32_t const* it = category_begin; it != category_end; ++it) {
+      words[*it / 64] |= std::uint64_t(1) << (*it % 64);
+    }
+  } else {
+    output.push_back(kCategoryHashSet);
+    output.resize(header + 1 + num_hash_slots, 0);
+    std::uint64_t* slots = output.data() + header + 1;
+    std::uint64_t mask = num_hash_slots - 1;
+    for (std::uint32_t const* it = category_begin; it != category_end; ++it) {
+      std::uint64_t value = static_cast<std::uint64_t>(*it) + 1;
+      std::uint64_t slot = CategoryHashSlot(*it, mask);
+      while (slots[slot] != 0 && slots[slot] != value) slot = (slot + 1) & mask;
+      slots[slot] = value;
+    }
+  }
+}
+
+/*! \brief Same as above, for a vector of categories */
+inline void EncodeCategorySet(std::vector<std::uint32_t> const& category_list, std::vector<std::uint64_t>& output) {
+  EncodeCategorySet(category_list.data(), category_list.data() + category_list.size(), output);
+}
+
+/*!
+ * \brief Non-owning view of a category set encoded by `EncodeCategorySet`, whose membership
+ *        tests run in constant (expected) time without allocating memory
+ */
+class CategorySetView {
+ public:
+  CategorySetView() {}
+  /*!
+   * \brief View the encoded set stored in `[begin, end)`. An empty range is treated as an empty set.
+   */
+  CategorySetView(std::uint64_t const* begin, std::uint64_t const* end) {
+    if (end > begin) {
+      hashed_ = (*begin == kCategoryHashSet);
+      data_ = begin + 1;
+      size_ = end - begin - 1;
+    }
+  }
+
+  /*! \brief Whether `category` belongs to the set */
+  bool Contains(std::uint32_t category) const {
+    if (!hashed_) {
+      std::uint64_t word = category / 64;
+      return word < size_ && ((data_[word] >> (category % 64)) & 1);
+    }
+    std::uint64_t mask = size_ - 1;
+    std::uint64_t value = static_cast<std::uint64_t>(category) + 1;
+    for (std::uint64_t slot = CategoryHashSlot(category, mask); data_[slot] != 0; slot = (slot + 1) & mask) {
+      if (data_[slot] == value) return true;
+    }
+    return false;
+  }
+
+  /*! \brief Whether the category encoded by the feature value `fvalue` belongs to the set (see `CategoryIndex`) */
+  bool Contains(double fvalue) const {
+    std::uint32_t category;
+    return CategoryIndex(fvalue, category) && Contains(category);
+  }
+
+ private:
+  std::uint64_t const* data_{nullptr};
+  std::uint64_t size_{0};
+  bool hashed_{false};
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_CATEGORY_SET_H_
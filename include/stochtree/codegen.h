@@ -0,0 +1,52 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Ahead-of-time translation of sampled forests into standalone C++ source code.
+ */
+#ifndef STOCHTREE_CODEGEN_H_
+#define STOCHTREE_CODEGEN_H_
+
+#include <stochtree/container.h>
+#include <stochtree/ensemble.h>
+#include <stochtree/tree.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace StochTree {
+
+/*!
+ * \brief Write the forest samples of `forest_container` as a self-contained C++ translation unit.
+ *
+ *        Each tree is emitted as nested if/else blocks built from `Tree::SplitIndex`, `Tree::Threshold`,
+ *        `Tree::CategoryList` and `Tree::LeafValue`, so compiled models do no interpretation at
+ *        prediction time. The generated source depends only on the C++ standard library and exports
+ *        the C functions
+ *
+ *        - `void predict(const double* row, double* out)`: raw leaf values of one observation, with
+ *          dimension `k` of (selected) sample `j` stored in `out[j*d + k]`, where `d` is the output dimension.
+ *          For leaf-constant forests this is the usual prediction; for leaf regression forests it must
+ *          be multiplied by the basis, as with `ForestContainer::PredictRaw`.
+ *        - `int stochtree_model_num_features(void)`: minimum number of covariates `row` must hold
+ *        - `int stochtree_model_num_samples(void)`: number of forest samples written
+ *        - `int stochtree_model_output_dimension(void)`: output dimension `d`
+ *
+ *        Missing values are routed to the default (left) child and trees are summed in order, so
+ *        compiled predictions are bit-identical to `ForestContainer::PredictRaw`.
+ * \param forest_container Container of sampled forests
+ * \param sample_indices (0-indexed) forest samples to write, in output order. An empty vector writes every sample.
+ * \param output Stream to which the source is written
+ */
+void GenerateForestSource(ForestContainer& forest_container, std::vector<int> const& sample_indices, std::ostream& output);
+
+/*! \brief Return the source produced by `GenerateForestSource` as a string */
+std::string GenerateForestSource(ForestContainer& forest_container, std::vector<int> const& sample_indices);
+
+/*! \brief Write the source produced by `GenerateForestSource` to `filename` */
+void GenerateForestSourceFile(ForestContainer& forest_container, std::vector<int> const& sample_indices, std::string filename);
+
+} // namespace StochTree
+
+#endif // STOCHTREE_CODEGEN_H_
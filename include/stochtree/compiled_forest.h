@@ -0,0 +1,118 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Immutable, flattened representation of a ForestContainer used for fast batch prediction.
+ */
+#ifndef STOCHTREE_COMPILED_FOREST_H_
+#define STOCHTREE_COMPILED_FOREST_H_
+
+#include <stochtree/category_set.h>
+#include <stochtree/container.h>
+#include <stochtree/data.h>
+#include <stochtree/log.h>
+#include <stochtree/tree.h>
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace StochTree {
+
+/*!
+ * \brief Read-only copy of every tree in a `ForestContainer`, packed into contiguous node arrays.
+ *
+ *        Each `Tree` in a `ForestContainer` owns its own set of node vectors, so predicting
+ *        a row visits many small heap blocks per tree. A `CompiledForestContainer` instead
+ *        stores the nodes of all trees of all samples in a handful of flat arrays. Within a tree,
+ *        nodes are laid out breadth-first starting at the root, deleted nodes are dropped and
+ *        the two children of a split node are adjacent, so only the left child offset is stored.
+ *
+ *        The compiled container is a snapshot: changes made to the source `ForestContainer` after
+ *        construction are not reflected. Predictions are bit-identical to those of the source container.
+ */
+class CompiledForestContainer {
+ public:
+  /*!
+   * \brief Compile every forest sample stored in `forest_container`
+   * \param forest_container Container of sampled forests
+   */
+  explicit CompiledForestContainer(ForestContainer& forest_container);
+  ~CompiledForestContainer() {}
+
+  /*! \brief Same output layout as `ForestContainer::Predict` */
+  std::vector<double> Predict(ForestDataset& dataset, int num_threads = 1);
+  /*! \brief Same output layout as `ForestContainer::PredictRaw` */
+  std::vector<double> PredictRaw(ForestDataset& dataset, int num_threads = 1);
+  /*! \brief Same output layout as `ForestContainer::PredictRawSingleForest` */
+  std::vector<double> PredictRawSingleForest(ForestDataset& dataset, int forest_num);
+  /*! \brief Same output layout and threading behavior as `ForestContainer::PredictInplace` */
+  void PredictInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads = 1);
+  /*! \brief Same output layout and threading behavior as `ForestContainer::PredictRawInplace` */
+  void PredictRawInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads = 1);
+
+  inline int32_t NumSamples() {return num_samples_;}
+  inline int32_t NumTrees(int forest_num) {return forest_begin_[forest_num + 1] - forest_begin_[forest_num];}
+  inline int32_t OutputDimension() {return output_dimension_;}
+  inline bool IsLeafConstant() {return is_leaf_constant_;}
+  /*! \brief Total number of (non-deleted) nodes across all trees of all samples */
+  inline int64_t NumNodes() {return static_cast<int64_t>(node_type_.size());}
+
+ private:
+  /*!
+   * \brief Return the index (into the flattened node arrays) of the leaf that `row` of `covariates` falls into
+   * \param tree_num Index of the tree across all samples, i.e. `forest_begin_[forest_num] + j` for tree `j`
+   */
+  template <typename Scalar>
+  inline int32_t EvaluateTree(int32_t tree_num, DataMatrixMapT<Scalar>& covariates, data_size_t row) const {
+    int32_t node_id = tree_root_[tree_num];
+    while (node_type_[node_id] != TreeNodeType::kLeafNode) {
+      double const fvalue = covariates(row, split_index_[node_id]);
+      bool go_left;
+      if (node_type_[node_id] == TreeNodeType::kCategoricalSplitNode) {
+        go_left = std::isnan(fvalue) || CategorySetView(category_set_.data() + category_begin_[node_id],
+                                                        category_set_.data() + category_end_[node_id]).Contains(fvalue);
+      } else {
+        // Equivalent to `fvalue <= threshold`, except that missing values go to the (default) left child
+        go_left = !(fvalue > threshold_[node_id]);
+      }
+      node_id = left_child_[node_id] + (go_left ? 0 : 1);
+    }
+    return node_id;
+  }
+
+  void CompileTree(Tree* tree);
+  void PredictRowsInplace(ForestDataset& dataset, std::vector<double>& output, int forest_num,
+                          data_size_t row_begin, data_size_t row_end, data_size_t offset);
+  void PredictRawRowsInplace(ForestDataset& dataset, std::vector<double>& output, int forest_num,
+                             data_size_t row_begin, data_size_t row_end, data_size_t offset);
+
+  /*! \brief Node type of every node */
+  std::vector<TreeNodeType> node_type_;
+  /*! \brief Split feature of split nodes; for leaves, offset of the node's leaf values in `leaf_values_` */
+  std::vector<int32_t> split_index_;
+  /*! \brief Numeric split threshold (unused for leaves and categorical splits) */
+  std::vector<double> threshold_;
+  /*! \brief Index of the left child of split nodes (the right child is stored immediately after it) */
+  std::vector<int32_t> left_child_;
+  /*! \brief Range of `category_set_` encoding the categories routed left by a categorical split node (see category_set.h) */
+  std::vector<int64_t> category_begin_;
+  std::vector<int64_t> category_end_;
+  std::vector<std::uint64_t> category_set_;
+  /*! \brief Leaf parameters, `output_dimension_` consecutive values per leaf */
+  std::vector<double> leaf_values_;
+  /*! \brief Index of the root node of every tree, with trees of all samples stored consecutively */
+  std::vector<int32_t> tree_root_;
+  /*! \brief Index into `tree_root_` of the first tree of every forest sample (length `num_samples_ + 1`) */
+  std::vector<int32_t> forest_begin_;
+  int num_samples_;
+  int output_dimension_;
+  bool is_leaf_constant_;
+  /*! \brief Number of rows predicted for a single forest sample as one unit of (possibly threaded) work */
+  static constexpr data_size_t kPredictRowBlockSize = 4096;
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_COMPILED_FOREST_H_
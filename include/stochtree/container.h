@@ -9,17 +9,33 @@
 #include <stochtree/data.h>
 #include <stochtree/ensemble.h>
 #include <nlohmann/json.hpp>
+#include <stochtree/quickscorer.h>
 #include <stochtree/tree.h>
 
 #include <algorithm>
 #include <deque>
 #include <fstream>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <unordered_map>
 
 namespace StochTree {
 
+/*! \brief Algorithm used to evaluate the forests of a `ForestContainer` during prediction */
+enum class ForestPredictEngine {
+  /*! \brief Route each observation from the root of every tree to a leaf */
+  kTreeTraversal = 0,
+  /*! \brief Bitvector evaluation via `QuickScorerEnsemble`; forests it cannot evaluate fall back to tree traversal */
+  kQuickScorer = 1,
+  /*! 
+   * \brief Group the trees at each position of the forest by structure (see `Tree::StructureHash`) and 
+   *        route observations once per distinct structure, sharing the leaf assignments with every 
+   *        forest sample in the group. Effective for MCMC samples, which mostly differ in leaf values only.
+   */
+  kStructureMemoized = 2
+};
+
 class ForestContainer {
  public:
   ForestContainer(int num_trees, int output_dimension = 1, bool is_leaf_constant = true);
@@ -30,11 +46,75 @@ class ForestContainer {
   void InitializeRoot(std::vector<double>& leaf_vector);
   void AddSamples(int num_samples);
   void CopyFromPreviousSample(int new_sample_id, int previous_sample_id);
-  std::vector<double> Predict(ForestDataset& dataset);
-  std::vector<double> PredictRaw(ForestDataset& dataset);
-  std::vector<double> PredictRaw(ForestDataset& dataset, int forest_num);
+  std::vector<double> Predict(ForestDataset& dataset, int num_threads = 1, ForestPredictEngine engine = ForestPredictEngine::kTreeTraversal);
+  /*! \brief Raw leaf values of every forest sample, with the layout, threading and `engine` of `PredictRawInplace` */
+  std::vector<double> PredictRaw(ForestDataset& dataset, int num_threads = 1, ForestPredictEngine engine = ForestPredictEngine::kTreeTraversal);
+  /*! \brief Raw leaf values of forest sample `forest_num`, storing dimension `k` for observation `i` in `output[i*d + k]` */
+  std::vector<double> PredictRawSingleForest(ForestDataset& dataset, int forest_num);
+  /*!
+   * \brief Predict every forest sample on every observation of `dataset`, storing the 
+   *        prediction of sample `j` for observation `i` in `output[j*n + i]`.
+   *        Work is split into blocks of rows for each sample and spread over `num_threads` 
+   *        threads (values <= 0 use all available hardware threads). Every output element 
+   *        is computed exactly as in the single-threaded case, so results are bit-identical 
+   *        regardless of the number of threads. `engine` selects the evaluation algorithm, 
+   *        and all engines produce bit-identical results. Sparse covariates are always 
+   *        evaluated with `ForestPredictEngine::kTreeTraversal`. The `QuickScorerEnsemble` of each 
+   *        forest sample is built on its first `kQuickScorer` prediction and reused until the sample 
+   *        changes (through `GetEnsemble`, `SetLeafValue` / `SetLeafVector`, `CopyFromPreviousSample`, 
+   *        `InitializeRoot`, `Reset` or `from_json`).
+   */
+  void PredictInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads = 1, 
+                      ForestPredictEngine engine = ForestPredictEngine::kTreeTraversal);
+  /*!
+   * \brief Predict raw leaf values of every forest sample on every observation of `dataset`, 
+   *        storing dimension `k` of sample `j` for observation `i` in `output[j*n*d + i*d + k]`, 
+   *        where `d` is the output dimension. Threading and `engine` behave as in `PredictInplace`.
+   */
+  void PredictRawInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads = 1, 
+                         ForestPredictEngine engine = ForestPredictEngine::kTreeTraversal);
+  /*!
+   * \brief Predict every forest sample on `num_rows` observations stored contiguously in row-major order,
+   *        storing the prediction of sample `j` for row `i` in `output[j*num_rows + i]`. Runs on the calling
+   *        thread and performs no heap allocation, for low-latency scoring of single rows or micro-batches.
+   *        Results are bit-identical to `PredictInplace` on the same data.
+   * \param covariates Row-major covariates, with row `i` starting at `covariates[i*num_covariates]`
+   * \param basis Row-major leaf regression basis with `OutputDimension()` columns (may be null for leaf-constant forests)
+   * \param num_rows Number of observations
+   * \param num_covariates Number of covariates (row stride of `covariates`)
+   * \param output Buffer of at least `num_rows * NumSamples()` elements
+   */
+  void PredictInplace(double const* covariates, double const* basis, data_size_t num_rows, int num_covariates, double* output);
+  /*!
+   * \brief Raw leaf values of every forest sample on `num_rows` row-major observations, storing dimension `k`
+   *        of sample `j` for row `i` in `output[j*num_rows*d + i*d + k]`. Performs no heap allocation.
+   */
+  void PredictRawInplace(double const* covariates, data_size_t num_rows, int num_covariates, double* output);
+  /*!
+   * \brief Summarize the posterior predictive distribution of every observation of `dataset` 
+   *        without storing an `n x num_samples` matrix of predictions.
+   *
+   *        Forest samples are visited one at a time for each block of rows, updating running 
+   *        (Welford) means and variances and a P-squared quantile estimator per observation and 
+   *        quantile, so memory use is O(n) in the number of samples summarized.
+   * \param dataset Data used for prediction
+   * \param sample_indices (0-indexed) forest samples to summarize, e.g. after discarding burn-in. 
+   *        An empty vector summarizes every sample.
+   * \param quantile_probs Probabilities of the quantiles to estimate (each in [0, 1])
+   * \param mean_output Posterior mean of each observation (resized to n)
+   * \param variance_output Posterior (sample) variance of each observation (resized to n, 0 if only one sample is summarized)
+   * \param quantile_output Estimated quantile `j` of observation `i` is stored in `quantile_output[j*n + i]` (resized to n*q)
+   * \param num_threads Number of threads (values <= 0 use all available hardware threads)
+   */
+  void PredictSummary(ForestDataset& dataset, std::vector<int>& sample_indices, std::vector<double>& quantile_probs, 
+                      std::vector<double>& mean_output, std::vector<double>& variance_output, 
+                      std::vector<double>& quantile_output, int num_threads = 1);
   
-  inline TreeEnsemble* GetEnsemble(int i) {return forests_[i].get();}
+  /*! 
+   * \brief Forest sample `i`, which may be modified: its cached `QuickScorerEnsemble` is discarded, so the pointer 
+   *        must not be used to modify the forest after a later `kQuickScorer` prediction
+   */
+  inline TreeEnsemble* GetEnsemble(int i) {InvalidateQuickScorer(i); return forests_[i].get();}
   inline int32_t NumSamples() {return num_samples_;}
   inline int32_t NumTrees() {return num_trees_;}  
   inline int32_t NumTrees(int ensemble_num) {return forests_[ensemble_num]->NumTrees();}
@@ -44,8 +124,8 @@ class ForestContainer {
   inline bool IsLeafConstant() {return is_leaf_constant_;}
   inline bool IsLeafConstant(int ensemble_num) {return forests_[ensemble_num]->IsLeafConstant();}
   inline bool AllRoots(int ensemble_num) {return forests_[ensemble_num]->AllRoots();}
-  inline void SetLeafValue(int ensemble_num, double leaf_value) {forests_[ensemble_num]->SetLeafValue(leaf_value);}
-  inline void SetLeafVector(int ensemble_num, std::vector<double>& leaf_vector) {forests_[ensemble_num]->SetLeafVector(leaf_vector);}
+  inline void SetLeafValue(int ensemble_num, double leaf_value) {GetEnsemble(ensemble_num)->SetLeafValue(leaf_value);}
+  inline void SetLeafVector(int ensemble_num, std::vector<double>& leaf_vector) {GetEnsemble(ensemble_num)->SetLeafVector(leaf_vector);}
   inline void IncrementSampleCount() {num_samples_++;}
 
   void SaveToJsonFile(std::string filename) {
@@ -68,6 +148,7 @@ class ForestContainer {
     output_dimension_ = 0;
     is_leaf_constant_ = 0;
     initialized_ = false;
+    InvalidateQuickScorers();
   }
 
   /*! \brief Save to JSON */
@@ -76,12 +157,43 @@ class ForestContainer {
   void from_json(const nlohmann::json& forest_container_json);
 
  private:
+  /*! 
+   * \brief `QuickScorerEnsemble` of every forest sample it supports (other entries are null), compiling those of 
+   *        samples that were added or changed since they were last built
+   */
+  std::vector<QuickScorerEnsemble*> BuildQuickScorers(int num_threads);
+  /*! \brief Discard the cached `QuickScorerEnsemble` of forest sample `i` */
+  void InvalidateQuickScorer(int i) {
+    if (i < static_cast<int>(quick_scorers_current_.size())) {
+      quick_scorers_current_[i] = 0;
+      quick_scorers_[i].reset();
+    }
+  }
+  /*! \brief Discard every cached `QuickScorerEnsemble` */
+  void InvalidateQuickScorers() {
+    quick_scorers_.clear();
+    quick_scorers_current_.clear();
+  }
+  /*!
+   * \brief Group forest samples by the structure of each of their trees. Entry `t` lists the groups of 
+   *        samples (in increasing order) whose tree `t` has the same structure, in order of first appearance.
+   */
+  std::vector<std::vector<std::vector<int>>> GroupTreeStructures(int num_threads);
+  /*! \brief `PredictInplace` / `PredictRawInplace` (when `raw` is true) using `ForestPredictEngine::kStructureMemoized` */
+  void PredictStructureMemoized(ForestDataset& dataset, std::vector<double>& output, int num_threads, bool raw);
+
   std::vector<std::unique_ptr<TreeEnsemble>> forests_;
   int num_samples_;
   int num_trees_;
   int output_dimension_;
   bool is_leaf_constant_;
   bool initialized_{false};
+  /*! \brief Cached `QuickScorerEnsemble` of each forest sample (null if unsupported), whether it is up to date, and a lock for building them */
+  std::vector<std::unique_ptr<QuickScorerEnsemble>> quick_scorers_;
+  std::vector<char> quick_scorers_current_;
+  std::mutex quick_scorers_mutex_;
+  /*! \brief Number of rows predicted for a single forest sample as one unit of (possibly threaded) work */
+  static constexpr data_size_t kPredictRowBlockSize = 4096;
 };
 } // namespace StochTree
 
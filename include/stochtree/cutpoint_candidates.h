@@ -55,17 +55,34 @@ class FeatureCutpointGrid {
 
   ~FeatureCutpointGrid() {}
 
-  /*! \brief Calculate strides */
-  void CalculateStrides(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types);
+  /*! 
+   * \brief Calculate strides. Unordered categorical features of a sparse tracker need the sum of the residuals in the node, 
+   *        which can be supplied through `node_residual_sum` (and is otherwise computed from the node's observations).
+   */
+  template <typename CovariateMatrix>
+  void CalculateStrides(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types, 
+                        double const* node_residual_sum = nullptr);
 
   /*! \brief Split numeric / ordered categorical feature and update sort indices */
-  void CalculateStridesNumeric(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+  template <typename CovariateMatrix>
+  void CalculateStridesNumeric(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
 
   /*! \brief Split numeric / ordered categorical feature and update sort indices */
-  void CalculateStridesOrderedCategorical(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+  template <typename CovariateMatrix>
+  void CalculateStridesOrderedCategorical(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
 
   /*! \brief Split unordered categorical feature and update sort indices */
-  void CalculateStridesUnorderedCategorical(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+  template <typename CovariateMatrix>
+  void CalculateStridesUnorderedCategorical(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+
+  /*! \brief Calculate strides of any feature type from bin codes, using bin upper bounds as cutpoint values */
+  void CalculateStridesBinned(BinnedColumnMatrix const& binned_covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, data_size_t node_begin, data_size_t node_end, int32_t feature_index, FeatureType feature_type);
+
+  /*! 
+   * \brief Calculate strides of any feature type from the nonzero entries of a sparse feature, treating its zeros as a single run 
+   *        of observations. Strides only end where the feature value changes, so they match the strides of the dense feature.
+   */
+  void CalculateStridesSparse(Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, FeatureType feature_type, double node_residual_sum);
 
   /*! \brief Number of potential cutpoints enumerated */
   int32_t NumCutpoints() {return node_stride_begin_.size();}
@@ -102,16 +119,22 @@ class FeatureCutpointGrid {
   int32_t cutpoint_grid_size_;
 
   /*! \brief Full enumeration of numeric cutpoints, checking for duplicate value */
-  void EnumerateNumericCutpointsDeduplication(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index);
+  template <typename CovariateMatrix>
+  void EnumerateNumericCutpointsDeduplication(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index);
+
+  /*! \brief Reorder categorical strides by their average outcome (`bin_sums` divided by stride length), as in Fisher (1958) */
+  void SortStridesByMeanOutcome(std::vector<double>& bin_sums);
 
   /*! \brief Calculation of numeric cutpoints, thinning out to ensure that, at most, cutpoint_grid_size_ cutpoints are considered */
-  void ScanNumericCutpoints(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index);
+  template <typename CovariateMatrix>
+  void ScanNumericCutpoints(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index);
 };
 
 /*! \brief Container class for FeatureCutpointGrid objects stored for every feature in a dataset */
 class CutpointGridContainer {
  public:
-  CutpointGridContainer(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, int cutpoint_grid_size) {
+  template <typename CovariateMatrix>
+  CutpointGridContainer(CovariateMatrix& covariates, Eigen::VectorXd& residuals, int cutpoint_grid_size) {
     num_features_ = covariates.cols();
     feature_cutpoint_grid_.resize(num_features_);
     for (int i = 0; i < num_features_; i++) {
@@ -120,20 +143,54 @@ class CutpointGridContainer {
     cutpoint_grid_size_ = cutpoint_grid_size;
   }
 
+  /*! \brief Cutpoint grids for every covariate of `dataset` */
+  CutpointGridContainer(ForestDataset& dataset, Eigen::VectorXd& residuals, int cutpoint_grid_size) {
+    num_features_ = dataset.NumCovariates();
+    feature_cutpoint_grid_.resize(num_features_);
+    for (int i = 0; i < num_features_; i++) {
+      feature_cutpoint_grid_[i].reset(new FeatureCutpointGrid(cutpoint_grid_size));
+    }
+    cutpoint_grid_size_ = cutpoint_grid_size;
+  }
+
   ~CutpointGridContainer() {}
 
-  void Reset(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, int cutpoint_grid_size) {
+  template <typename CovariateMatrix>
+  void Reset(CovariateMatrix& covariates, Eigen::VectorXd& residuals, int cutpoint_grid_size) {
     num_features_ = covariates.cols();
     feature_cutpoint_grid_.resize(num_features_);
     for (int i = 0; i < num_features_; i++) {
       feature_cutpoint_grid_[i].reset(new FeatureCutpointGrid(cutpoint_grid_size));
     }
     cutpoint_grid_size_ = cutpoint_grid_size;
+    residual_sum_node_id_ = -1;
   }
 
-  /*! \brief Calculate strides */
-  void CalculateStrides(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types) {
-    feature_cutpoint_grid_[feature_index]->CalculateStrides(covariates, residuals, feature_node_sort_tracker, node_id, node_begin, node_end, feature_index, feature_types);
+  /*! 
+   * \brief Calculate strides. The sum of the residuals in the node, which unordered categorical features of a sparse 
+   *        tracker need, is computed once per node, so residuals must not change between calls for the same node.
+   */
+  template <typename CovariateMatrix>
+  void CalculateStrides(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types) {
+    double const* node_residual_sum = nullptr;
+    if (feature_node_sort_tracker->IsSparse() && feature_types[feature_index] == FeatureType::kUnorderedCategorical) {
+      if (residual_sum_node_id_ != node_id) {
+        node_residual_sum_ = 0.0;
+        for (auto it = feature_node_sort_tracker->NodeRowsBegin(node_id); it != feature_node_sort_tracker->NodeRowsEnd(node_id); ++it) {
+          node_residual_sum_ += residuals(*it);
+        }
+        residual_sum_node_id_ = node_id;
+      }
+      node_residual_sum = &node_residual_sum_;
+    }
+    feature_cutpoint_grid_[feature_index]->CalculateStrides(covariates, residuals, feature_node_sort_tracker, node_id, node_begin, node_end, feature_index, feature_types, node_residual_sum);
+  }
+
+  /*! \brief Calculate strides from the covariates of `dataset`, at their stored precision */
+  void CalculateStrides(ForestDataset& dataset, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types) {
+    dataset.VisitCovariates([&](auto& covariates) {
+      CalculateStrides(covariates, residuals, feature_node_sort_tracker, node_id, node_begin, node_end, feature_index, feature_types);
+    });
   }
 
   /*! \brief Max size of cutpoint grid */
@@ -167,6 +224,9 @@ class CutpointGridContainer {
   std::vector<std::unique_ptr<FeatureCutpointGrid>> feature_cutpoint_grid_;
   int num_features_;
   int cutpoint_grid_size_;
+  /*! \brief Sum of the residuals in node `residual_sum_node_id_` (only computed for sparse trackers) */
+  int32_t residual_sum_node_id_{-1};
+  double node_residual_sum_{0.0};
 };
 
 /*! \brief Computing and tracking cutpoints available for a given feature at a given node */
@@ -177,13 +237,13 @@ class NodeCutpointTracker {
   ~NodeCutpointTracker() {}
 
   /*! \brief Calculate strides */
-  void CalculateStrides(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+  void CalculateStrides(DataMatrixMap& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
 
   /*! \brief Split numeric / ordered categorical feature and update sort indices */
-  void CalculateStridesNumeric(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+  void CalculateStridesNumeric(DataMatrixMap& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
 
   /*! \brief Split unordered categorical feature and update sort indices */
-  void CalculateStridesCategorical(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
+  void CalculateStridesCategorical(DataMatrixMap& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, data_size_t node_begin, data_size_t node_end, int32_t feature_index);
 
   /*! \brief Number of potential cutpoints enumerated */
   int32_t NumCutpoints() {return node_stride_begin_.size();}
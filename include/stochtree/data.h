@@ -6,27 +6,132 @@
 #define STOCHTREE_DATA_H_
 
 #include <Eigen/Dense>
+#include <Eigen/SparseCore>
 #include <stochtree/log.h>
 #include <stochtree/meta.h>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <utility>
+#include <vector>
 
 namespace StochTree {
 
-class ColumnMatrix {
+/*! \brief Stride of a `DataMatrixMap`, which can view either column-major or row-major storage */
+using DataMatrixStride = Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>;
+/*! \brief Read-write view of the data held by a `BasicColumnMatrix` (owned or borrowed) with elements of type `Scalar` */
+template <typename Scalar>
+using DataMatrixMapT = Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>, Eigen::Unaligned, DataMatrixStride>;
+/*! \brief View of a double precision `ColumnMatrix` */
+using DataMatrixMap = DataMatrixMapT<double>;
+/*! \brief View of a single precision `FloatColumnMatrix` */
+using FloatDataMatrixMap = DataMatrixMapT<float>;
+
+/*!
+ * \brief Matrix of `Scalar` (double or float) values, either owned in column-major order or borrowed 
+ *        from an external column-major or row-major buffer, and accessed through a `DataMatrixMapT<Scalar>`.
+ */
+template <typename Scalar>
+class BasicColumnMatrix {
  public:
-  ColumnMatrix() {}
-  ColumnMatrix(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major);
-  ~ColumnMatrix() {}
-  double GetElement(data_size_t row_num, int32_t col_num) {return data_(row_num, col_num);}
-  void SetElement(data_size_t row_num, int32_t col_num, double value) {data_(row_num, col_num) = value;}
-  void LoadData(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major);
-  inline data_size_t NumRows() {return data_.rows();}
-  inline int NumCols() {return data_.cols();}
-  inline Eigen::MatrixXd& GetData() {return data_;}
+  using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+  using MapType = DataMatrixMapT<Scalar>;
+  BasicColumnMatrix() {}
+  /*!
+   * \brief Load a matrix stored in `data_ptr` in column-major (R) or row-major (numpy) order.
+   * \param borrow If true, the matrix wraps `data_ptr` without copying it. The caller must keep 
+   *        the buffer alive (and unmodified) for as long as the matrix is in use.
+   */
+  BasicColumnMatrix(Scalar* data_ptr, data_size_t num_row, int num_col, bool is_row_major, bool borrow = false) {
+    if (borrow) {
+      BorrowData(data_ptr, num_row, num_col, is_row_major);
+    } else {
+      LoadData(data_ptr, num_row, num_col, is_row_major);
+    }
+  }
+  BasicColumnMatrix(BasicColumnMatrix const& other) : data_(other.data_), borrowed_ptr_(other.borrowed_ptr_), is_row_major_(other.is_row_major_) {Rebind(other.view_.rows(), other.view_.cols());}
+  BasicColumnMatrix(BasicColumnMatrix&& other) noexcept : data_(std::move(other.data_)), borrowed_ptr_(other.borrowed_ptr_), is_row_major_(other.is_row_major_) {Rebind(other.view_.rows(), other.view_.cols());}
+  BasicColumnMatrix& operator=(BasicColumnMatrix const& other) {
+    data_ = other.data_;
+    borrowed_ptr_ = other.borrowed_ptr_;
+    is_row_major_ = other.is_row_major_;
+    Rebind(other.view_.rows(), other.view_.cols());
+    return *this;
+  }
+  BasicColumnMatrix& operator=(BasicColumnMatrix&& other) noexcept {
+    data_ = std::move(other.data_);
+    borrowed_ptr_ = other.borrowed_ptr_;
+    is_row_major_ = other.is_row_major_;
+    Rebind(other.view_.rows(), other.view_.cols());
+    return *this;
+  }
+  ~BasicColumnMatrix() {}
+  double GetElement(data_size_t row_num, int32_t col_num) {return view_(row_num, col_num);}
+  void SetElement(data_size_t row_num, int32_t col_num, double value) {CHECK(!IsBorrowed()); view_(row_num, col_num) = static_cast<Scalar>(value);}
+  /*! \brief Copy a column-major or row-major matrix into owned storage, converting its elements to `Scalar` */
+  template <typename SourceScalar>
+  void LoadData(SourceScalar const* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
+    if (is_row_major) {
+      // Numpy 2-d arrays are stored in "row major" order
+      LoadData(data_ptr, num_row, num_col, static_cast<std::ptrdiff_t>(num_col), 1);
+    } else {
+      // R matrices are stored in "column major" order
+      LoadData(data_ptr, num_row, num_col, 1, static_cast<std::ptrdiff_t>(num_row));
+    }
+  }
+  /*! 
+   * \brief Copy a matrix whose element `(i, j)` is stored at `data_ptr[i * row_stride + j * col_stride]` (strides in elements, 
+   *        possibly negative) into owned storage, converting its elements from any arithmetic type to `Scalar` in a single pass
+   */
+  template <typename SourceScalar>
+  void LoadData(SourceScalar const* data_ptr, data_size_t num_row, int num_col, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride) {
+    data_.resize(num_row, num_col);
+    borrowed_ptr_ = nullptr;
+    is_row_major_ = false;
+
+    // Copy data from R / Python process memory to Eigen matrix
+    for (int j = 0; j < num_col; ++j) {
+      SourceScalar const* column_ptr = data_ptr + col_stride * j;
+      for (data_size_t i = 0; i < num_row; ++i) {
+        data_(i, j) = static_cast<Scalar>(column_ptr[row_stride * i]);
+      }
+    }
+    Rebind(num_row, num_col);
+  }
+  /*! \brief Wrap a column-major or row-major matrix without copying it (see the `borrow` constructor argument) */
+  void BorrowData(Scalar* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
+    CHECK(data_ptr != nullptr || static_cast<int64_t>(num_row) * num_col == 0);
+    data_.resize(0, 0);
+    borrowed_ptr_ = data_ptr;
+    is_row_major_ = is_row_major;
+    Rebind(num_row, num_col);
+  }
+  inline data_size_t NumRows() {return view_.rows();}
+  inline int NumCols() {return view_.cols();}
+  /*! \brief Whether the matrix views an external buffer rather than owning its data */
+  inline bool IsBorrowed() {return borrowed_ptr_ != nullptr;}
+  inline MapType& GetData() {return view_;}
  private:
-  Eigen::MatrixXd data_;
+  /*! \brief Point `view_` at the owned or borrowed data (`Map` assignment would copy elements instead) */
+  void Rebind(Eigen::Index num_row, Eigen::Index num_col) {
+    if (borrowed_ptr_ == nullptr) {
+      new (&view_) MapType(data_.data(), data_.rows(), data_.cols(), DataMatrixStride(data_.rows(), 1));
+    } else if (is_row_major_) {
+      new (&view_) MapType(borrowed_ptr_, num_row, num_col, DataMatrixStride(1, num_col));
+    } else {
+      new (&view_) MapType(borrowed_ptr_, num_row, num_col, DataMatrixStride(num_row, 1));
+    }
+  }
+  MatrixType data_;
+  Scalar* borrowed_ptr_{nullptr};
+  bool is_row_major_{false};
+  MapType view_{nullptr, 0, 0, DataMatrixStride(0, 1)};
 };
 
+using ColumnMatrix = BasicColumnMatrix<double>;
+using FloatColumnMatrix = BasicColumnMatrix<float>;
+
 class ColumnVector {
  public:
   ColumnVector() {}
@@ -41,18 +146,211 @@ class ColumnVector {
   Eigen::VectorXd data_;
 };
 
+/*!
+ * \brief Sparse covariate matrix in compressed sparse column (CSC) format, as used by R's `dgCMatrix` and 
+ *        `scipy.sparse.csc_matrix`, where entries that are not stored are zero.
+ *
+ *        Elements are read with a binary search over the stored rows of a column, through the same 
+ *        `(row, col)`, `rows()` and `cols()` interface as a `DataMatrixMapT`, so that code templated on the 
+ *        covariate matrix type handles sparse covariates without densifying them. Code that benefits from 
+ *        skipping the zeros can iterate over the stored entries of a column directly.
+ */
+class SparseColumnMatrix {
+ public:
+  using MatrixType = Eigen::SparseMatrix<double, Eigen::ColMajor, int>;
+  SparseColumnMatrix() {}
+  ~SparseColumnMatrix() {}
+  /*!
+   * \brief Copy a CSC matrix with `col_ptr[num_col]` stored entries. The stored entries of column `j` are 
+   *        `values[k]` at row `row_index[k]` for `col_ptr[j] <= k < col_ptr[j+1]`, with strictly increasing rows.
+   */
+  void LoadData(int const* col_ptr, int const* row_index, double const* values, data_size_t num_row, int num_col);
+  inline double operator()(data_size_t row, int col) const {return data_.coeff(row, col);}
+  inline data_size_t rows() const {return data_.rows();}
+  inline int cols() const {return data_.cols();}
+  inline data_size_t NumRows() const {return data_.rows();}
+  inline int NumCols() const {return data_.cols();}
+  /*! \brief Total number of stored entries */
+  inline int64_t NumNonZeros() const {return data_.nonZeros();}
+  /*! \brief Position of the first stored entry of column `col` */
+  inline int ColumnBegin(int col) const {return data_.outerIndexPtr()[col];}
+  /*! \brief One past the position of the last stored entry of column `col` */
+  inline int ColumnEnd(int col) const {return data_.outerIndexPtr()[col + 1];}
+  /*! \brief Row of the stored entry at position `k` */
+  inline data_size_t RowIndex(int k) const {return data_.innerIndexPtr()[k];}
+  /*! \brief Value of the stored entry at position `k` */
+  inline double Value(int k) const {return data_.valuePtr()[k];}
+  inline MatrixType& GetData() {return data_;}
+ private:
+  MatrixType data_;
+};
+
+/*!
+ * \brief Covariates quantized into per-feature bins and stored as bin codes in column-major order, 
+ *        using 1 byte per code when no feature has more than 256 bins and 2 bytes otherwise.
+ *
+ *        Bin `b` of feature `j` holds the values in `(UpperBound(j, b-1), UpperBound(j, b)]`, so that the split 
+ *        `x <= UpperBound(j, b)` sends exactly the rows with codes `<= b` to the left node. Features with at most 
+ *        `max_bins` unique values get one bin per unique value (the binning is "exact"), and the values of other 
+ *        features are divided into bins holding roughly equal numbers of rows.
+ *
+ *        The matrix can also be read through the `(row, col)`, `rows()` and `cols()` interface of a `DataMatrixMapT`, 
+ *        where element `(row, col)` is the upper bound of its bin. Every split at a bin upper bound sends a row to the 
+ *        same side as its raw value would, which lets the samplers run on the codes alone (see `ForestDataset::BinCovariates`).
+ */
+class BinnedColumnMatrix {
+ public:
+  BinnedColumnMatrix() {}
+  ~BinnedColumnMatrix() {}
+  /*!
+   * \brief Bin every column of `covariates`, which must not contain missing values
+   * \param max_bins Maximum number of bins per feature (between 2 and 65536)
+   * \param num_threads Number of threads binning features in parallel (values <= 0 use all available hardware threads)
+   */
+  template <typename Scalar>
+  void LoadData(DataMatrixMapT<Scalar>& covariates, int max_bins, int num_threads = 1);
+  inline data_size_t NumRows() const {return num_rows_;}
+  inline int NumCols() const {return num_cols_;}
+  inline double operator()(data_size_t row, int col) const {return UpperBound(col, BinCode(row, col));}
+  inline data_size_t rows() const {return num_rows_;}
+  inline int cols() const {return num_cols_;}
+  /*! \brief Number of bins of feature `col` */
+  inline int NumBins(int col) const {return static_cast<int>(bin_offsets_[col + 1] - bin_offsets_[col]);}
+  /*! \brief Whether every unique value of feature `col` has its own bin */
+  inline bool IsExact(int col) const {return exact_[col];}
+  /*! \brief Number of bytes used to store each bin code (1 or 2) */
+  inline int BytesPerCode() const {return wide_codes_ ? 2 : 1;}
+  /*! \brief Bin of observation `row` in feature `col` */
+  inline std::uint16_t BinCode(data_size_t row, int col) const {
+    std::size_t offset = static_cast<std::size_t>(col) * num_rows_ + row;
+    return wide_codes_ ? codes_wide_[offset] : codes_[offset];
+  }
+  /*! \brief Largest value of feature `col` in bin `bin`, used as the threshold of splits at this bin */
+  inline double UpperBound(int col, int bin) const {return upper_bounds_[bin_offsets_[col] + bin];}
+  /*!
+   * \brief Determine the bin `bin` of feature `col` such that `x <= threshold` holds for exactly the rows 
+   *        whose codes are `<= bin` (-1 if no row satisfies it). Returns false if the threshold falls strictly 
+   *        inside a bin of an inexact feature, in which case rows must be compared using the raw covariates.
+   */
+  bool SplitBin(int col, double threshold, int& bin) const;
+ private:
+  std::vector<std::uint8_t> codes_;
+  std::vector<std::uint16_t> codes_wide_;
+  std::vector<double> upper_bounds_;
+  std::vector<std::size_t> bin_offsets_;
+  std::vector<bool> exact_;
+  data_size_t num_rows_{0};
+  int num_cols_{0};
+  bool wide_codes_{false};
+};
+
 class ForestDataset {
  public:
   ForestDataset() {}
   ~ForestDataset() {}
-  void AddCovariates(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
-    covariates_ = ColumnMatrix(data_ptr, num_row, num_col, is_row_major);
-    num_observations_ = num_row;
-    num_covariates_ = num_col;
-    has_covariates_ = true;
+  /*!
+   * \brief Add a covariate matrix stored in column-major (R) or row-major (numpy) order.
+   * \param borrow If true, the dataset wraps `data_ptr` without copying it, and the caller 
+   *        (e.g. the host language object holding the array) must keep the buffer alive
+   *        for as long as the dataset is in use.
+   */
+  void AddCovariates(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major, bool borrow = false) {
+    covariates_ = ColumnMatrix(data_ptr, num_row, num_col, is_row_major, borrow);
+    float_covariates_ = FloatColumnMatrix();
+    single_precision_covariates_ = false;
+    ResetCovariateState(num_row, num_col, false);
   }
-  void AddBasis(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
-    basis_ = ColumnMatrix(data_ptr, num_row, num_col, is_row_major);
+  /*!
+   * \brief Add a single precision covariate matrix, which is stored (or borrowed) as float rather than 
+   *        converted to double. Split thresholds, leaf parameters and sufficient statistics remain double.
+   */
+  void AddCovariates(float* data_ptr, data_size_t num_row, int num_col, bool is_row_major, bool borrow = false) {
+    float_covariates_ = FloatColumnMatrix(data_ptr, num_row, num_col, is_row_major, borrow);
+    covariates_ = ColumnMatrix();
+    single_precision_covariates_ = true;
+    ResetCovariateState(num_row, num_col, false);
+  }
+  /*!
+   * \brief Add a covariate matrix of any arithmetic element type (e.g. an integer or boolean array) whose element `(i, j)` is 
+   *        stored at `data_ptr[i * row_stride + j * col_stride]`, so that non-contiguous views are read in place. The matrix is 
+   *        converted to double (or to float, if `single_precision` is true) in a single pass, without an intermediate copy.
+   */
+  template <typename SourceScalar>
+  void AddCovariatesStrided(SourceScalar const* data_ptr, data_size_t num_row, int num_col, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride, 
+                            bool single_precision = false) {
+    if (single_precision) {
+      float_covariates_.LoadData(data_ptr, num_row, num_col, row_stride, col_stride);
+      covariates_ = ColumnMatrix();
+    } else {
+      covariates_.LoadData(data_ptr, num_row, num_col, row_stride, col_stride);
+      float_covariates_ = FloatColumnMatrix();
+    }
+    single_precision_covariates_ = single_precision;
+    ResetCovariateState(num_row, num_col, false);
+  }
+  /*!
+   * \brief Add a sparse covariate matrix in compressed sparse column format (see `SparseColumnMatrix::LoadData`), 
+   *        which is copied without densifying it. Entries that are not stored are zero. Presorting treats the 
+   *        zeros of each feature as a single run, and all other components read elements by binary search. 
+   *        Sparse covariates cannot be binned, and prediction always traverses trees row by row 
+   *        (`ForestPredictEngine::kTreeTraversal`).
+   */
+  void AddSparseCovariates(int const* col_ptr, int const* row_index, double const* values, data_size_t num_row, int num_col) {
+    sparse_covariates_.LoadData(col_ptr, row_index, values, num_row, num_col);
+    covariates_ = ColumnMatrix();
+    float_covariates_ = FloatColumnMatrix();
+    single_precision_covariates_ = false;
+    ResetCovariateState(num_row, num_col, true);
+  }
+  /*!
+   * \brief Quantize the covariates into at most `max_bins` bins per feature (see `BinnedColumnMatrix`). 
+   *        The GFR sampler then presorts, scans and partitions features using the compact bin codes and 
+   *        the MCMC sampler proposes cutpoints at bin boundaries, so that every split threshold is the 
+   *        upper bound of a bin. Unordered categorical features must have at most `max_bins` categories.
+   * \param num_threads Number of threads binning features in parallel (values <= 0 use all available hardware threads)
+   * \param release_covariates If true, the raw covariates (and any row-major copy) are dropped once they are binned, and every 
+   *        reader of the covariates sees the upper bound of each row's bin instead. Trees sampled from the binned covariates 
+   *        only split at bin upper bounds, so grow-from-root and MCMC sampling and prediction on this dataset are unaffected, 
+   *        but splits at other thresholds (e.g. of a forest sampled from other data) are evaluated on the binned values. 
+   *        The dataset can no longer be saved (`SaveBinaryDataset`), copied row-major or used by the compiled prediction kernels.
+   */
+  void BinCovariates(int max_bins, int num_threads = 1, bool release_covariates = false);
+  /*!
+   * \brief Keep a row-major copy of the (dense) covariates, at their stored precision, alongside the column-major matrix. 
+   *        Tree samplers keep scanning the column-major matrix, while prediction (see `VisitPredictionCovariates`) 
+   *        reads the copy, so that evaluating every tree of a row touches a few contiguous cache lines rather than 
+   *        one cache line per split feature. This pays off for wide matrices, at the cost of storing the covariates twice. 
+   *        Nothing is copied if the covariates already view a row-major buffer, and the copy is dropped when the covariates are replaced.
+   */
+  void AddRowMajorCovariates(int num_threads = 1);
+  /*! \brief Add a leaf regression basis, borrowing `data_ptr` without copying if `borrow` is true (see `AddCovariates`) */
+  void AddBasis(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major, bool borrow = false) {
+    basis_ = ColumnMatrix(data_ptr, num_row, num_col, is_row_major, borrow);
+    float_basis_ = FloatColumnMatrix();
+    single_precision_basis_ = false;
+    num_basis_ = num_col;
+    has_basis_ = true;
+  }
+  /*! \brief Add a single precision leaf regression basis (see the single precision `AddCovariates`) */
+  void AddBasis(float* data_ptr, data_size_t num_row, int num_col, bool is_row_major, bool borrow = false) {
+    float_basis_ = FloatColumnMatrix(data_ptr, num_row, num_col, is_row_major, borrow);
+    basis_ = ColumnMatrix();
+    single_precision_basis_ = true;
+    num_basis_ = num_col;
+    has_basis_ = true;
+  }
+  /*! \brief Add a leaf regression basis of any arithmetic element type with arbitrary strides (see `AddCovariatesStrided`) */
+  template <typename SourceScalar>
+  void AddBasisStrided(SourceScalar const* data_ptr, data_size_t num_row, int num_col, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride, 
+                       bool single_precision = false) {
+    if (single_precision) {
+      float_basis_.LoadData(data_ptr, num_row, num_col, row_stride, col_stride);
+      basis_ = ColumnMatrix();
+    } else {
+      basis_.LoadData(data_ptr, num_row, num_col, row_stride, col_stride);
+      float_basis_ = FloatColumnMatrix();
+    }
+    single_precision_basis_ = single_precision;
     num_basis_ = num_col;
     has_basis_ = true;
   }
@@ -60,46 +358,160 @@ class ForestDataset {
     var_weights_ = ColumnVector(data_ptr, num_row);
     has_var_weights_ = true;
   }
+  /*!
+   * \brief Borrow a precomputed presort index of the covariates, stored column-major with column `j` holding the 
+   *        stable argsort of feature `j` (as computed by `FeaturePresortRoot`). `ForestTracker` then copies these indices 
+   *        instead of sorting the covariates. The caller must keep the buffer alive (see `RetainStorage`), and the 
+   *        index is dropped when the covariates are replaced.
+   */
+  void AddPresortIndex(data_size_t const* index_ptr, data_size_t num_row, int num_col) {
+    CHECK(has_covariates_);
+    CHECK_EQ(num_row, num_observations_);
+    CHECK_EQ(num_col, num_covariates_);
+    presort_index_ = index_ptr;
+  }
+  /*! \brief Keep `storage` (e.g. a memory-mapped file holding borrowed data) alive for as long as this dataset or any copy of it */
+  void RetainStorage(std::shared_ptr<void const> storage) {retained_storage_.push_back(std::move(storage));}
   inline bool HasCovariates() {return has_covariates_;}
   inline bool HasBasis() {return has_basis_;}
   inline bool HasVarWeights() {return has_var_weights_;}
+  inline bool HasBinnedCovariates() {return has_binned_covariates_;}
+  /*! \brief Whether the raw covariates were released after binning (see `BinCovariates`) */
+  inline bool HasReleasedCovariates() {return raw_covariates_released_;}
+  inline bool HasPresortIndex() {return presort_index_ != nullptr;}
+  /*! \brief Whether prediction reads the covariates from a contiguous row-major matrix (see `AddRowMajorCovariates`) */
+  inline bool HasRowMajorCovariates() {return has_row_major_covariates_;}
+  /*! \brief Whether the covariates are stored as a `SparseColumnMatrix` */
+  inline bool HasSparseCovariates() {return sparse_covariates_stored_;}
+  /*! \brief Whether the covariates are stored in single precision */
+  inline bool HasSinglePrecisionCovariates() {return single_precision_covariates_;}
+  /*! \brief Whether the basis is stored in single precision */
+  inline bool HasSinglePrecisionBasis() {return single_precision_basis_;}
   inline data_size_t NumObservations() {return num_observations_;}
   inline int NumCovariates() {return num_covariates_;}
   inline int NumBasis() {return num_basis_;}
-  inline double CovariateValue(data_size_t row, int col) {return covariates_.GetElement(row, col);}
-  inline double BasisValue(data_size_t row, int col) {return basis_.GetElement(row, col);}
+  inline double CovariateValue(data_size_t row, int col) {
+    if (sparse_covariates_stored_) return sparse_covariates_(row, col);
+    if (raw_covariates_released_) return binned_covariates_(row, col);
+    return single_precision_covariates_ ? float_covariates_.GetElement(row, col) : covariates_.GetElement(row, col);
+  }
+  inline double BasisValue(data_size_t row, int col) {
+    return single_precision_basis_ ? float_basis_.GetElement(row, col) : basis_.GetElement(row, col);
+  }
   inline double VarWeightValue(data_size_t row) {return var_weights_.GetElement(row);}
-  inline Eigen::MatrixXd& GetCovariates() {return covariates_.GetData();}
-  inline Eigen::MatrixXd& GetBasis() {return basis_.GetData();}
+  /*! \brief Double precision covariates (see `VisitCovariates` for code that also handles single precision) */
+  inline DataMatrixMap& GetCovariates() {CHECK(!single_precision_covariates_ && !sparse_covariates_stored_); return covariates_.GetData();}
+  /*! \brief Double precision basis (see `VisitBasis` for code that also handles single precision) */
+  inline DataMatrixMap& GetBasis() {CHECK(!single_precision_basis_); return basis_.GetData();}
+  inline FloatDataMatrixMap& GetFloatCovariates() {CHECK(single_precision_covariates_); return float_covariates_.GetData();}
+  inline FloatDataMatrixMap& GetFloatBasis() {CHECK(single_precision_basis_); return float_basis_.GetData();}
+  inline SparseColumnMatrix& GetSparseCovariates() {CHECK(sparse_covariates_stored_); return sparse_covariates_;}
+  /*! 
+   * \brief Call `fn` with the covariates as a `DataMatrixMap&`, `FloatDataMatrixMap&` or `SparseColumnMatrix&`, 
+   *        depending on how they are stored, or as a `BinnedColumnMatrix&` if they were released after binning
+   */
+  template <typename Function>
+  decltype(auto) VisitCovariates(Function&& fn) {
+    if (sparse_covariates_stored_) return fn(sparse_covariates_);
+    if (raw_covariates_released_) return fn(binned_covariates_);
+    if (single_precision_covariates_) return fn(float_covariates_.GetData());
+    return fn(covariates_.GetData());
+  }
+  /*! \brief Same as `VisitCovariates`, for code that requires dense covariates (sparse or released covariates are an error) */
+  template <typename Function>
+  decltype(auto) VisitDenseCovariates(Function&& fn) {
+    if (sparse_covariates_stored_) Log::Fatal("This operation requires dense covariates");
+    if (raw_covariates_released_) Log::Fatal("This operation requires the raw covariates, which were released when they were binned");
+    if (single_precision_covariates_) return fn(float_covariates_.GetData());
+    return fn(covariates_.GetData());
+  }
+  /*! 
+   * \brief Same as `VisitCovariates`, for prediction, which visits the row-major copy of the covariates 
+   *        added by `AddRowMajorCovariates` if there is one
+   */
+  template <typename Function>
+  decltype(auto) VisitPredictionCovariates(Function&& fn) {
+    if (row_major_copy_stored_) {
+      if (single_precision_covariates_) return fn(row_major_float_covariates_.GetData());
+      return fn(row_major_covariates_.GetData());
+    }
+    return VisitCovariates(std::forward<Function>(fn));
+  }
+  /*! \brief Same as `VisitPredictionCovariates`, for code that requires dense covariates (sparse or released covariates are an error) */
+  template <typename Function>
+  decltype(auto) VisitDensePredictionCovariates(Function&& fn) {
+    if (row_major_copy_stored_) {
+      if (single_precision_covariates_) return fn(row_major_float_covariates_.GetData());
+      return fn(row_major_covariates_.GetData());
+    }
+    return VisitDenseCovariates(std::forward<Function>(fn));
+  }
+  /*! \brief Call `fn` with the basis as a `DataMatrixMap&` or `FloatDataMatrixMap&`, depending on its precision */
+  template <typename Function>
+  decltype(auto) VisitBasis(Function&& fn) {
+    if (single_precision_basis_) return fn(float_basis_.GetData());
+    return fn(basis_.GetData());
+  }
   inline Eigen::VectorXd& GetVarWeights() {return var_weights_.GetData();}
+  inline BinnedColumnMatrix& GetBinnedCovariates() {return binned_covariates_;}
+  inline data_size_t const* GetPresortIndex() {return presort_index_;}
+  /*! 
+   * \brief Overwrite the basis with new values, which are always copied (a borrowed basis becomes owned) 
+   *        and converted to the precision of the current basis
+   */
   void UpdateBasis(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
     CHECK(has_basis_);
     CHECK_EQ(num_col, num_basis_);
-    // Copy data from R / Python process memory to Eigen matrix
-    double temp_value;
-    for (data_size_t i = 0; i < num_row; ++i) {
-      for (int j = 0; j < num_col; ++j) {
-        if (is_row_major){
-          // Numpy 2-d arrays are stored in "row major" order
-          temp_value = static_cast<double>(*(data_ptr + static_cast<data_size_t>(num_col) * i + j));
-        } else {
-          // R matrices are stored in "column major" order
-          temp_value = static_cast<double>(*(data_ptr + static_cast<data_size_t>(num_row) * j + i));
-        }
-        basis_.SetElement(i, j, temp_value);
-      }
+    // Copy data from R / Python process memory to Eigen matrix, never writing into a borrowed buffer
+    if (single_precision_basis_) {
+      float_basis_.LoadData(data_ptr, num_row, num_col, is_row_major);
+    } else {
+      basis_.LoadData(data_ptr, num_row, num_col, is_row_major);
     }
   }
  private:
+  void ResetCovariateState(data_size_t num_row, int num_col, bool sparse) {
+    if (!sparse) sparse_covariates_ = SparseColumnMatrix();
+    sparse_covariates_stored_ = sparse;
+    num_observations_ = num_row;
+    num_covariates_ = num_col;
+    has_covariates_ = true;
+    binned_covariates_ = BinnedColumnMatrix();
+    has_binned_covariates_ = false;
+    raw_covariates_released_ = false;
+    presort_index_ = nullptr;
+    row_major_covariates_ = ColumnMatrix();
+    row_major_float_covariates_ = FloatColumnMatrix();
+    row_major_storage_.reset();
+    row_major_copy_stored_ = false;
+    has_row_major_covariates_ = false;
+  }
   ColumnMatrix covariates_;
+  FloatColumnMatrix float_covariates_;
+  SparseColumnMatrix sparse_covariates_;
+  /*! \brief Row-major copy of the covariates, borrowing `row_major_storage_` (which copies of the dataset share) */
+  ColumnMatrix row_major_covariates_;
+  FloatColumnMatrix row_major_float_covariates_;
+  std::shared_ptr<void const> row_major_storage_;
   ColumnMatrix basis_;
+  FloatColumnMatrix float_basis_;
   ColumnVector var_weights_;
+  BinnedColumnMatrix binned_covariates_;
+  data_size_t const* presort_index_{nullptr};
+  std::vector<std::shared_ptr<void const>> retained_storage_;
   data_size_t num_observations_{0};
   int num_covariates_{0};
   int num_basis_{0};
   bool has_covariates_{false};
   bool has_basis_{false};
   bool has_var_weights_{false};
+  bool has_binned_covariates_{false};
+  bool raw_covariates_released_{false};
+  bool single_precision_covariates_{false};
+  bool single_precision_basis_{false};
+  bool sparse_covariates_stored_{false};
+  bool row_major_copy_stored_{false};
+  bool has_row_major_covariates_{false};
 };
 
 class RandomEffectsDataset {
@@ -125,7 +537,7 @@ class RandomEffectsDataset {
   inline double BasisValue(data_size_t row, int col) {return basis_.GetElement(row, col);}
   inline double VarWeightValue(data_size_t row) {return var_weights_.GetElement(row);}
   inline int32_t GroupId(data_size_t row) {return group_labels_[row];}
-  inline Eigen::MatrixXd& GetBasis() {return basis_.GetData();}
+  inline DataMatrixMap& GetBasis() {return basis_.GetData();}
   inline Eigen::VectorXd& GetVarWeights() {return var_weights_.GetData();}
   inline std::vector<int32_t>& GetGroupLabels() {return group_labels_;}
  private:
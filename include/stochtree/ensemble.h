@@ -11,6 +11,7 @@
 #define STOCHTREE_ENSEMBLE_H_
 
 #include <stochtree/data.h>
+#include <stochtree/predict_kernel.h>
 #include <stochtree/tree.h>
 #include <nlohmann/json.hpp>
 
@@ -81,61 +82,113 @@ class TreeEnsemble {
 
   inline void PredictInplace(ForestDataset& dataset, std::vector<double> &output, 
                              int tree_begin, int tree_end, data_size_t offset = 0) {
+    PredictRowsInplace(dataset, output, tree_begin, tree_end, 0, dataset.NumObservations(), offset);
+  }
+
+  /*!
+   * \brief Predict the ensemble for observations `row_begin` through `row_end - 1` of a dataset, 
+   *        writing the prediction for row `i` to `output[offset + i]`. Disjoint row ranges 
+   *        write to disjoint parts of `output`, so ranges can be predicted concurrently.
+   */
+  inline void PredictRowsInplace(ForestDataset& dataset, std::vector<double> &output, int tree_begin, int tree_end, 
+                                 data_size_t row_begin, data_size_t row_end, data_size_t offset = 0) {
     if (is_leaf_constant_) {
-      PredictInplace(dataset.GetCovariates(), output, tree_begin, tree_end, offset);
+      dataset.VisitPredictionCovariates([&](auto& covariates) {
+        PredictRowsInplace(covariates, output, tree_begin, tree_end, row_begin, row_end, offset);
+      });
     } else {
       CHECK(dataset.HasBasis());
-      PredictInplace(dataset.GetCovariates(), dataset.GetBasis(), output, tree_begin, tree_end, offset);
+      dataset.VisitPredictionCovariates([&](auto& covariates) {
+        dataset.VisitBasis([&](auto& basis) {
+          PredictRowsInplace(covariates, basis, output, tree_begin, tree_end, row_begin, row_end, offset);
+        });
+      });
     }
   }
 
-  inline void PredictInplace(Eigen::MatrixXd& covariates, Eigen::MatrixXd& basis, std::vector<double> &output, data_size_t offset = 0) {
+  template <typename CovariateMatrix, typename BasisScalar>
+  inline void PredictInplace(CovariateMatrix& covariates, DataMatrixMapT<BasisScalar>& basis, std::vector<double> &output, data_size_t offset = 0) {
     PredictInplace(covariates, basis, output, 0, trees_.size(), offset);
   }
 
-  inline void PredictInplace(Eigen::MatrixXd& covariates, Eigen::MatrixXd& basis, std::vector<double> &output, 
+  template <typename CovariateMatrix, typename BasisScalar>
+  inline void PredictInplace(CovariateMatrix& covariates, DataMatrixMapT<BasisScalar>& basis, std::vector<double> &output, 
                              int tree_begin, int tree_end, data_size_t offset = 0) {
-    double pred;
+    PredictRowsInplace(covariates, basis, output, tree_begin, tree_end, 0, covariates.rows(), offset);
+  }
+
+  template <typename CovariateMatrix, typename BasisScalar>
+  inline void PredictRowsInplace(CovariateMatrix& covariates, DataMatrixMapT<BasisScalar>& basis, std::vector<double> &output, 
+                                 int tree_begin, int tree_end, data_size_t row_begin, data_size_t row_end, data_size_t offset = 0) {
     CHECK_EQ(covariates.rows(), basis.rows());
     CHECK_EQ(output_dimension_, trees_[0]->OutputDimension());
     CHECK_EQ(output_dimension_, basis.cols());
-    data_size_t n = covariates.rows();
-    data_size_t total_output_size = n;
-    if (output.size() < total_output_size + offset) {
+    CHECK_LE(row_end, covariates.rows());
+    if (output.size() < row_end + offset) {
       Log::Fatal("Mismatched size of prediction vector and training data");
     }
-    for (data_size_t i = 0; i < n; i++) {
-      pred = 0.0;
+    // Rows are routed through each tree a block at a time, and each row's prediction 
+    // accumulates trees in the same order as a row-by-row traversal
+    PredictKernel kernel = BestPredictKernel();
+    std::int32_t leaf_ids[kPredictBlockRows];
+    double block_pred[kPredictBlockRows];
+    BasisScalar const* basis_data = basis.data();
+    int64_t const basis_column_stride = basis.outerStride();
+    int64_t const basis_row_stride = basis.innerStride();
+    for (data_size_t block_begin = row_begin; block_begin < row_end; block_begin += kPredictBlockRows) {
+      int block_rows = std::min<data_size_t>(kPredictBlockRows, row_end - block_begin);
+      std::fill(block_pred, block_pred + block_rows, 0.0);
       for (size_t j = tree_begin; j < tree_end; j++) {
         auto &tree = *trees_[j];
-        std::int32_t nidx = EvaluateTree(tree, covariates, i);
-        for (int32_t k = 0; k < output_dimension_; k++) {
-          pred += tree.LeafValue(nidx, k) * basis(i, k);
+        EvaluateTreeBlock(tree, covariates, block_begin, block_rows, leaf_ids, kernel);
+        // Fused basis dot product: the leaf parameters of each row are looked up once per tree
+        for (int r = 0; r < block_rows; r++) {
+          double const* leaf_values = tree.LeafValues(leaf_ids[r]);
+          BasisScalar const* basis_row = basis_data + (block_begin + r) * basis_row_stride;
+          for (int32_t k = 0; k < output_dimension_; k++) {
+            block_pred[r] += leaf_values[k] * basis_row[k * basis_column_stride];
+          }
         }
       }
-      output[i + offset] = pred;
+      for (int r = 0; r < block_rows; r++) {
+        output[block_begin + r + offset] = block_pred[r];
+      }
     }
   }
 
-  inline void PredictInplace(Eigen::MatrixXd& covariates, std::vector<double> &output, data_size_t offset = 0) {
+  template <typename CovariateMatrix>
+  inline void PredictInplace(CovariateMatrix& covariates, std::vector<double> &output, data_size_t offset = 0) {
     PredictInplace(covariates, output, 0, trees_.size(), offset);
   }
 
-  inline void PredictInplace(Eigen::MatrixXd& covariates, std::vector<double> &output, int tree_begin, int tree_end, data_size_t offset = 0) {
-    double pred;
-    data_size_t n = covariates.rows();
-    data_size_t total_output_size = n;
-    if (output.size() < total_output_size + offset) {
+  template <typename CovariateMatrix>
+  inline void PredictInplace(CovariateMatrix& covariates, std::vector<double> &output, int tree_begin, int tree_end, data_size_t offset = 0) {
+    PredictRowsInplace(covariates, output, tree_begin, tree_end, 0, covariates.rows(), offset);
+  }
+
+  template <typename CovariateMatrix>
+  inline void PredictRowsInplace(CovariateMatrix& covariates, std::vector<double> &output, int tree_begin, int tree_end, 
+                                 data_size_t row_begin, data_size_t row_end, data_size_t offset = 0) {
+    CHECK_LE(row_end, covariates.rows());
+    if (output.size() < row_end + offset) {
       Log::Fatal("Mismatched size of prediction vector and training data");
     }
-    for (data_size_t i = 0; i < n; i++) {
-      pred = 0.0;
+    PredictKernel kernel = BestPredictKernel();
+    std::int32_t leaf_ids[kPredictBlockRows];
+    double block_pred[kPredictBlockRows];
+    for (data_size_t block_begin = row_begin; block_begin < row_end; block_begin += kPredictBlockRows) {
+      int block_rows = std::min<data_size_t>(kPredictBlockRows, row_end - block_begin);
+      std::fill(block_pred, block_pred + block_rows, 0.0);
       for (size_t j = tree_begin; j < tree_end; j++) {
         auto &tree = *trees_[j];
-        std::int32_t nidx = EvaluateTree(tree, covariates, i);
-        pred += tree.LeafValue(nidx, 0);
+        EvaluateTreeBlock(tree, covariates, block_begin, block_rows, leaf_ids, kernel);
+        for (int r = 0; r < block_rows; r++) {
+          block_pred[r] += tree.LeafValue(leaf_ids[r], 0);
+        }
+      }
+      for (int r = 0; r < block_rows; r++) {
+        output[block_begin + r + offset] = block_pred[r];
       }
-      output[i + offset] = pred;
     }
   }
 
@@ -145,23 +198,93 @@ class TreeEnsemble {
 
   inline void PredictRawInplace(ForestDataset& dataset, std::vector<double> &output, 
                              int tree_begin, int tree_end, data_size_t offset = 0) {
-    double pred;
-    Eigen::MatrixXd covariates = dataset.GetCovariates();
+    PredictRawRowsInplace(dataset, output, tree_begin, tree_end, 0, dataset.NumObservations(), offset);
+  }
+
+  /*!
+   * \brief Predict raw leaf values for observations `row_begin` through `row_end - 1` of a dataset, 
+   *        writing output dimension `k` of row `i` to `output[offset + i*output_dimension + k]`.
+   */
+  inline void PredictRawRowsInplace(ForestDataset& dataset, std::vector<double> &output, int tree_begin, int tree_end, 
+                                    data_size_t row_begin, data_size_t row_end, data_size_t offset = 0) {
     CHECK_EQ(output_dimension_, trees_[0]->OutputDimension());
-    data_size_t n = covariates.rows();
-    data_size_t total_output_size = n * output_dimension_;
+    CHECK_LE(row_end, dataset.NumObservations());
+    data_size_t total_output_size = row_end * output_dimension_;
     if (output.size() < total_output_size + offset) {
       Log::Fatal("Mismatched size of raw prediction vector and training data");
     }
-    for (data_size_t i = 0; i < n; i++) {
-      for (int32_t k = 0; k < output_dimension_; k++) {
-        pred = 0.0;
+    // Each tree is traversed once per block of rows and its leaf values accumulated into every 
+    // output dimension, which sums trees in the same order for each (row, dimension) pair
+    PredictKernel kernel = BestPredictKernel();
+    std::int32_t leaf_ids[kPredictBlockRows];
+    dataset.VisitPredictionCovariates([&](auto& covariates) {
+      for (data_size_t block_begin = row_begin; block_begin < row_end; block_begin += kPredictBlockRows) {
+        int block_rows = std::min<data_size_t>(kPredictBlockRows, row_end - block_begin);
+        double* block_output = output.data() + block_begin*output_dimension_ + offset;
+        std::fill(block_output, block_output + block_rows*output_dimension_, 0.0);
         for (size_t j = tree_begin; j < tree_end; j++) {
           auto &tree = *trees_[j];
-          int32_t nidx = EvaluateTree(tree, covariates, i);
-          pred += tree.LeafValue(nidx, k);
+          EvaluateTreeBlock(tree, covariates, block_begin, block_rows, leaf_ids, kernel);
+          for (int r = 0; r < block_rows; r++) {
+            double const* leaf_values = tree.LeafValues(leaf_ids[r]);
+            double* row_output = block_output + r*output_dimension_;
+            for (int32_t k = 0; k < output_dimension_; k++) {
+              row_output[k] += leaf_values[k];
+            }
+          }
+        }
+      }
+    });
+  }
+
+  /*!
+   * \brief Predict `num_rows` observations whose covariates are stored contiguously in row-major order,
+   *        writing the prediction for row `i` to `output[i]`. Performs no heap allocation, so it is
+   *        suited to scoring single rows or small batches with low latency.
+   * \param covariates Row-major covariates, with row `i` starting at `covariates[i*num_covariates]`.
+   *        Rows must contain every feature used in a split of the ensemble.
+   * \param basis Row-major leaf regression basis with `OutputDimension()` columns (ignored, and may be null, for leaf-constant ensembles)
+   * \param num_rows Number of observations
+   * \param num_covariates Number of covariates (row stride of `covariates`)
+   * \param output Buffer of at least `num_rows` elements
+   */
+  inline void PredictInplace(double const* covariates, double const* basis, data_size_t num_rows, int num_covariates, double* output) {
+    if (!is_leaf_constant_) CHECK(basis != nullptr);
+    for (data_size_t i = 0; i < num_rows; i++) {
+      double const* row = covariates + static_cast<std::int64_t>(i) * num_covariates;
+      double pred = 0.0;
+      for (int j = 0; j < num_trees_; j++) {
+        Tree const& tree = *trees_[j];
+        std::int32_t leaf_id = EvaluateTree(tree, row);
+        if (is_leaf_constant_) {
+          pred += tree.LeafValue(leaf_id, 0);
+        } else {
+          double const* leaf_values = tree.LeafValues(leaf_id);
+          double const* basis_row = basis + static_cast<std::int64_t>(i) * output_dimension_;
+          for (int32_t k = 0; k < output_dimension_; k++) {
+            pred += leaf_values[k] * basis_row[k];
+          }
+        }
+      }
+      output[i] = pred;
+    }
+  }
+
+  /*!
+   * \brief Raw leaf values of `num_rows` row-major observations (as in `PredictInplace` above), writing
+   *        output dimension `k` of row `i` to `output[i*output_dimension + k]`. Performs no heap allocation.
+   */
+  inline void PredictRawInplace(double const* covariates, data_size_t num_rows, int num_covariates, double* output) {
+    for (data_size_t i = 0; i < num_rows; i++) {
+      double const* row = covariates + static_cast<std::int64_t>(i) * num_covariates;
+      double* row_output = output + static_cast<std::int64_t>(i) * output_dimension_;
+      std::fill(row_output, row_output + output_dimension_, 0.0);
+      for (int j = 0; j < num_trees_; j++) {
+        Tree const& tree = *trees_[j];
+        double const* leaf_values = tree.LeafValues(EvaluateTree(tree, row));
+        for (int32_t k = 0; k < output_dimension_; k++) {
+          row_output[k] += leaf_values[k];
         }
-        output[i*output_dimension_ + k + offset] = pred;
       }
     }
   }
@@ -237,7 +360,7 @@ class TreeEnsemble {
    * \param n Size of dataset
    */
   void PredictLeafIndicesInplace(ForestDataset* dataset, std::vector<int32_t>& output, int num_trees, data_size_t n) {
-    PredictLeafIndicesInplace(dataset->GetCovariates(), output, num_trees, n);
+    dataset->VisitPredictionCovariates([&](auto& covariates) {PredictLeafIndicesInplace(covariates, output, num_trees, n);});
   }
 
   /*!
@@ -287,7 +410,8 @@ class TreeEnsemble {
    * \param num_trees Number of trees in an ensemble
    * \param n Size of dataset
    */
-  void PredictLeafIndicesInplace(Eigen::MatrixXd& covariates, std::vector<int32_t>& output, int num_trees, data_size_t n) {
+  template <typename CovariateMatrix>
+  void PredictLeafIndicesInplace(CovariateMatrix& covariates, std::vector<int32_t>& output, int num_trees, data_size_t n) {
     CHECK_GE(output.size(), num_trees*n);
     int offset = 0;
     int max_leaf = 0;
@@ -300,6 +424,12 @@ class TreeEnsemble {
     }
   }
 
+  /*! \brief Same as above, for covariates stored in a (column-major) `Eigen::MatrixXd` */
+  void PredictLeafIndicesInplace(Eigen::MatrixXd& covariates, std::vector<int32_t>& output, int num_trees, data_size_t n) {
+    DataMatrixMap covariates_map(covariates.data(), covariates.rows(), covariates.cols(), DataMatrixStride(covariates.rows(), 1));
+    PredictLeafIndicesInplace(covariates_map, output, num_trees, n);
+  }
+
   /*!
    * \brief Same as `PredictLeafIndicesInplace` but assumes responsibility for allocating and returning output vector.
    * \param ForestDataset Dataset with which to predict leaf indices from the tree
@@ -286,6 +286,18 @@ struct VirtualFileReader {
    * \return Number of bytes read
    */
   virtual size_t Read(void* buffer, size_t bytes) const = 0;
+  /*!
+   * \brief Map the whole file into memory read-only, if the reader supports it
+   * \param size Set to the size of the file in bytes
+   * \return Pointer to the mapped file, valid until the reader is destroyed, or nullptr if the file cannot 
+   *         be mapped (in which case it must be read with `Read`)
+   */
+  virtual const char* MapReadOnly(size_t* size) { return nullptr; }
+  /*!
+   * \brief Size of the file in bytes, if the reader knows it
+   * \return Size of the file, or 0 if it is unknown
+   */
+  virtual size_t Size() const { return 0; }
   /*!
    * \brief Create appropriate reader for filename
    * \param filename Filename of the data
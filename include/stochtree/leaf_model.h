@@ -51,6 +51,11 @@ class GaussianConstantSuffStat {
     sum_w = lhs.sum_w - rhs.sum_w;
     sum_yw = lhs.sum_yw - rhs.sum_yw;
   }
+  void AddSuffStat(GaussianConstantSuffStat& lhs, GaussianConstantSuffStat& rhs) {
+    n = lhs.n + rhs.n;
+    sum_w = lhs.sum_w + rhs.sum_w;
+    sum_yw = lhs.sum_yw + rhs.sum_yw;
+  }
   bool SampleGreaterThan(data_size_t threshold) {
     return n > threshold;
   }
@@ -117,6 +122,11 @@ class GaussianUnivariateRegressionSuffStat {
     sum_xxw = lhs.sum_xxw - rhs.sum_xxw;
     sum_yxw = lhs.sum_yxw - rhs.sum_yxw;
   }
+  void AddSuffStat(GaussianUnivariateRegressionSuffStat& lhs, GaussianUnivariateRegressionSuffStat& rhs) {
+    n = lhs.n + rhs.n;
+    sum_xxw = lhs.sum_xxw + rhs.sum_xxw;
+    sum_yxw = lhs.sum_yxw + rhs.sum_yxw;
+  }
   bool SampleGreaterThan(data_size_t threshold) {
     return n > threshold;
   }
@@ -167,13 +177,17 @@ class GaussianMultivariateRegressionSuffStat {
   }
   void IncrementSuffStat(ForestDataset& dataset, Eigen::VectorXd& outcome, data_size_t row_idx) {
     n += 1;
-    if (dataset.HasVarWeights()) {
-      XtWX += dataset.GetBasis()(row_idx, Eigen::all).transpose()*dataset.GetBasis()(row_idx, Eigen::all)/dataset.VarWeightValue(row_idx);
-      ytWX += (outcome(row_idx, 0)*(dataset.GetBasis()(row_idx, Eigen::all)))/dataset.VarWeightValue(row_idx);
-    } else {
-      XtWX += dataset.GetBasis()(row_idx, Eigen::all).transpose()*dataset.GetBasis()(row_idx, Eigen::all);
-      ytWX += (outcome(row_idx, 0)*(dataset.GetBasis()(row_idx, Eigen::all)));
-    }
+    dataset.VisitBasis([&](auto& basis) {
+      // Sufficient statistics accumulate in double precision, whatever the storage type of the basis
+      auto x = basis(row_idx, Eigen::all).template cast<double>();
+      if (dataset.HasVarWeights()) {
+        XtWX += x.transpose()*x/dataset.VarWeightValue(row_idx);
+        ytWX += (outcome(row_idx, 0)*x)/dataset.VarWeightValue(row_idx);
+      } else {
+        XtWX += x.transpose()*x;
+        ytWX += (outcome(row_idx, 0)*x);
+      }
+    });
   }
   void ResetSuffStat() {
     n = 0;
@@ -185,6 +199,11 @@ class GaussianMultivariateRegressionSuffStat {
     XtWX = lhs.XtWX - rhs.XtWX;
     ytWX = lhs.ytWX - rhs.ytWX;
   }
+  void AddSuffStat(GaussianMultivariateRegressionSuffStat& lhs, GaussianMultivariateRegressionSuffStat& rhs) {
+    n = lhs.n + rhs.n;
+    XtWX = lhs.XtWX + rhs.XtWX;
+    ytWX = lhs.ytWX + rhs.ytWX;
+  }
   bool SampleGreaterThan(data_size_t threshold) {
     return n > threshold;
   }
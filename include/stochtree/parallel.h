@@ -0,0 +1,221 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Small std::thread-based helpers for splitting independent loops across threads.
+ */
+#ifndef STOCHTREE_PARALLEL_H_
+#define STOCHTREE_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace StochTree {
+
+/*!
+ * \brief Convert a user-supplied thread count into the number of threads to launch.
+ *        Values less than or equal to zero request every available hardware thread.
+ * \param num_threads Requested number of threads
+ */
+inline int ResolveNumThreads(int num_threads) {
+  if (num_threads > 0) return num_threads;
+  int hardware_threads = static_cast<int>(std::thread::hardware_concurrency());
+  return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+/*!
+ * \brief Run `fn(block_begin, block_end)` over consecutive blocks of `[begin, end)`.
+ *
+ *        Blocks are handed out to threads dynamically, but every index is visited exactly
+ *        once and by exactly one call to `fn`, so any loop body that writes to disjoint
+ *        output locations produces results that do not depend on `num_threads`.
+ *        With one thread (or a single block), `fn` runs on the calling thread.
+ *        The first exception thrown by a worker is rethrown on the calling thread.
+ * \param begin First index of the range
+ * \param end One past the last index of the range
+ * \param block_size Number of consecutive indices handed to `fn` at a time
+ * \param num_threads Number of threads (values <= 0 use all available hardware threads)
+ * \param fn Callable with signature `void(int64_t block_begin, int64_t block_end)`
+ */
+template <typename Func>
+void ParallelFor(int64_t begin, int64_t end, int64_t block_size, int num_threads, Func&& fn) {
+  if (end <= begin) return;
+  block_size = std::max<int64_t>(block_size, 1);
+  int64_t num_blocks = (end - begin + block_size - 1) / block_size;
+  int64_t num_workers = std::min<int64_t>(ResolveNumThreads(num_threads), num_blocks);
+  if (num_workers <= 1) {
+    for (int64_t i = begin; i < end; i += block_size) {
+      fn(i, std::min(i + block_size, end));
+    }
+    return;
+  }
+
+  std::atomic<int64_t> next_block{0};
+  std::exception_ptr worker_exception = nullptr;
+  std::mutex exception_mutex;
+  auto worker = [&]() {
+    int64_t block;
+    while ((block = next_block.fetch_add(1)) < num_blocks) {
+      int64_t block_begin = begin + block * block_size;
+      int64_t block_end = std::min(block_begin + block_size, end);
+      try {
+        fn(block_begin, block_end);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(exception_mutex);
+        if (!worker_exception) worker_exception = std::current_exception();
+        // Stop handing out new blocks
+        next_block.store(num_blocks);
+      }
+    }
+  };
+
+  // The calling thread participates as one of the workers
+  std::vector<std::thread> threads;
+  threads.reserve(num_workers - 1);
+  for (int64_t t = 0; t < num_workers - 1; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (worker_exception) std::rethrow_exception(worker_exception);
+}
+
+/*!
+ * \brief Persistent set of worker threads for loops that are run many times, where starting threads on 
+ *        every call (as `ParallelFor` does) would cost more than the loop itself.
+ *
+ *        `ThreadPool::ParallelFor` has the same semantics as the free `ParallelFor`: blocks are handed out 
+ *        dynamically, every index is visited exactly once, the calling thread participates as one of the 
+ *        workers and the first exception thrown by a block is rethrown on the calling thread. Workers sleep 
+ *        between calls. A pool runs one loop at a time, so it must not be shared by concurrently running loops.
+ */
+class ThreadPool {
+ public:
+  /*! \param num_threads Number of threads, including the calling thread (values <= 0 use all available hardware threads) */
+  explicit ThreadPool(int num_threads) {
+    int num_workers = ResolveNumThreads(num_threads) - 1;
+    workers_.reserve(num_workers);
+    for (int t = 0; t < num_workers; t++) {
+      workers_.emplace_back([this]() {WorkerLoop();});
+    }
+  }
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  /*! \brief Number of threads running a loop, including the calling thread */
+  int NumThreads() const {return static_cast<int>(workers_.size()) + 1;}
+
+  /*! \brief Run `fn(block_begin, block_end)` over consecutive blocks of `[begin, end)` (see the free `ParallelFor`) */
+  template <typename Func>
+  void ParallelFor(int64_t begin, int64_t end, int64_t block_size, Func&& fn) {
+    if (end <= begin) return;
+    block_size = std::max<int64_t>(block_size, 1);
+    int64_t num_blocks = (end - begin + block_size - 1) / block_size;
+    if (workers_.empty() || num_blocks <= 1) {
+      for (int64_t i = begin; i < end; i += block_size) {
+        fn(i, std::min(i + block_size, end));
+      }
+      return;
+    }
+
+    std::function<void(int64_t, int64_t)> job = std::ref(fn);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &job;
+      begin_ = begin;
+      end_ = end;
+      block_size_ = block_size;
+      num_blocks_ = num_blocks;
+      next_block_.store(0);
+      exception_ = nullptr;
+      busy_workers_ = static_cast<int>(workers_.size());
+      generation_++;
+    }
+    start_cv_.notify_all();
+    RunBlocks();
+    std::exception_ptr exception;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cv_.wait(lock, [this]() {return busy_workers_ == 0;});
+      job_ = nullptr;
+      exception = exception_;
+      exception_ = nullptr;
+    }
+    if (exception) std::rethrow_exception(exception);
+  }
+
+ private:
+  void WorkerLoop() {
+    std::uint64_t seen_generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_cv_.wait(lock, [&]() {return stop_ || generation_ != seen_generation;});
+        if (stop_) return;
+        seen_generation = generation_;
+      }
+      RunBlocks();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_workers_ == 0) done_cv_.notify_one();
+      }
+    }
+  }
+
+  void RunBlocks() {
+    int64_t block;
+    while ((block = next_block_.fetch_add(1)) < num_blocks_) {
+      int64_t block_begin = begin_ + block * block_size_;
+      int64_t block_end = std::min(block_begin + block_size_, end_);
+      try {
+        (*job_)(block_begin, block_end);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!exception_) exception_ = std::current_exception();
+        // Stop handing out new blocks
+        next_block_.store(num_blocks_);
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  /*! \brief Loop currently being run, and its range (written under `mutex_` before `generation_` is incremented) */
+  std::function<void(int64_t, int64_t)>* job_{nullptr};
+  int64_t begin_{0};
+  int64_t end_{0};
+  int64_t block_size_{1};
+  int64_t num_blocks_{0};
+  std::atomic<int64_t> next_block_{0};
+  std::exception_ptr exception_{nullptr};
+  /*! \brief Number of workers that have not yet finished the current loop */
+  int busy_workers_{0};
+  /*! \brief Incremented for every loop, so that each worker joins each loop exactly once */
+  std::uint64_t generation_{0};
+  bool stop_{false};
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_PARALLEL_H_
@@ -28,13 +28,19 @@
 #include <stochtree/data.h>
 #include <stochtree/ensemble.h>
 #include <stochtree/log.h>
+#include <stochtree/parallel.h>
 #include <stochtree/tree.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <numeric>
 #include <random>
 #include <set>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace StochTree {
@@ -49,17 +55,46 @@ class FeaturePresortRootContainer;
 /*! \brief Wrapper around various data structures for forest sampling algorithms */
 class ForestTracker {
  public:
-  ForestTracker(Eigen::MatrixXd& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations);
+  /*! 
+   * \brief Initialize the tracker for `num_trees` trees on `num_observations` observations. If `binned_covariates` is 
+   *        provided, features are presorted, partitioned and scanned for cutpoints using their bin codes.
+   * \param cache_tree_predictions Whether to store the prediction of every tree for every observation (a `num_observations` 
+   *        by `num_trees` matrix of doubles), from which a tree's contribution is added back to the residual before it is 
+   *        sampled. If false, that contribution is recomputed from the leaf ids of the observations, the leaf values and 
+   *        the current basis. Both give identical results unless the basis is updated without propagating the update to 
+   *        the residual (by adding the forest back under the old basis and subtracting it under the new one), in which 
+   *        case only the cached predictions match what the residual holds.
+   */
+  template <typename CovariateMatrix>
+  ForestTracker(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, 
+                BinnedColumnMatrix const* binned_covariates = nullptr, bool cache_tree_predictions = true);
+  /*! \brief Initialize the tracker for the covariates of `dataset`, using its binned covariates or presort index if it has any */
+  ForestTracker(ForestDataset& dataset, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, 
+                bool cache_tree_predictions = true);
   ~ForestTracker() {}
   void AssignAllSamplesToRoot();
   void AssignAllSamplesToRoot(int32_t tree_num);
   void AssignAllSamplesToConstantPrediction(double value);
   void AssignAllSamplesToConstantPrediction(int32_t tree_num, double value);
-  void ResetRoot(Eigen::MatrixXd& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num);
-  void AddSplit(Eigen::MatrixXd& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted = false);
-  void RemoveSplit(Eigen::MatrixXd& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted = false);
+  template <typename CovariateMatrix>
+  void ResetRoot(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num);
+  template <typename CovariateMatrix>
+  void AddSplit(CovariateMatrix& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted = false);
+  template <typename CovariateMatrix>
+  void RemoveSplit(CovariateMatrix& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted = false);
+  /*! \brief Same as the overloads above, using the covariates of `dataset` at their stored precision */
+  void ResetRoot(ForestDataset& dataset, std::vector<FeatureType>& feature_types, int32_t tree_num);
+  void AddSplit(ForestDataset& dataset, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted = false);
+  void RemoveSplit(ForestDataset& dataset, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted = false);
   double GetTreeSamplePrediction(data_size_t sample_id, int tree_id);
   void SetTreeSamplePrediction(data_size_t sample_id, int tree_id, double value);
+  /*! \brief Whether tree predictions are cached in a `SamplePredMapper` (see the `cache_tree_predictions` constructor argument) */
+  bool CachesTreePredictions() {return sample_pred_mapper_ != nullptr;}
+  /*! 
+   * \brief Whether the predictions of tree `tree_id` have been subtracted from the residual. Always true if predictions are 
+   *        cached (trees that were never subtracted have cached predictions of zero).
+   */
+  bool HasTreeSamplePredictions(int tree_id) {return CachesTreePredictions() || tree_has_predictions_[tree_id];}
   data_size_t GetNodeId(int observation_num, int tree_num);
   data_size_t UnsortedNodeBegin(int tree_id, int node_id);
   data_size_t UnsortedNodeEnd(int tree_id, int node_id);
@@ -71,14 +106,69 @@ class ForestTracker {
   std::vector<data_size_t>::iterator UnsortedNodeEndIterator(int tree_id, int node_id);
   std::vector<data_size_t>::iterator SortedNodeBeginIterator(int node_id, int feature_id);
   std::vector<data_size_t>::iterator SortedNodeEndIterator(int node_id, int feature_id);
+  /*!
+   * \brief Track the leaf membership of a held-out dataset while sampling, so that test set predictions 
+   *        can be recorded after every sampler iteration instead of re-predicting every stored forest afterwards.
+   *
+   *        The held-out observations of each leaf are kept in a node partition, as `UnsortedNodeSampleTracker` does for 
+   *        the training observations, so a grow move only routes the observations of the split leaf, a prune move only 
+   *        merges index ranges and trees rebuilt from root (GFR) are re-routed split by split. If the tracker caches tree 
+   *        predictions, each tree's contribution to the held-out predictions is cached too (an `n_test` by `num_trees` 
+   *        matrix) and recomputed (by `UpdateTestSetTree`) only once the tree has been resampled; otherwise every tree's 
+   *        leaf values are summed over its held-out leaf members when a prediction is recorded. Missing values follow the default (left) child, as in `EvaluateTree`. Every tree must still be 
+   *        a root (i.e. this must be called before the first sampler iteration), and `test_dataset` must outlive the tracker.
+   * \param test_dataset Held-out dataset (with a basis if the forest has leaf regressions)
+   */
+  void AddTestSet(ForestDataset& test_dataset);
+  bool HasTestSet() {return test_dataset_ != nullptr;}
+  /*! \brief Number of observations in the held-out dataset (0 if none was added) */
+  data_size_t NumTestObservations() {return (test_dataset_ == nullptr) ? 0 : test_dataset_->NumObservations();}
+  /*! \brief Held-out observations in each node of each tree (null if no test set was added) */
+  UnsortedNodeSampleTracker* GetTestNodeSampleTracker() {return test_node_sample_tracker_.get();}
+  /*!
+   * \brief Recompute the contribution of tree `tree_num` to the held-out predictions from its leaf values, visiting 
+   *        the held-out observations leaf by leaf. Samplers call this once a tree's leaf parameters have been sampled.
+   *        Does nothing if the tracker does not cache tree predictions.
+   */
+  void UpdateTestSetTree(Tree& tree, int32_t tree_num, bool requires_basis);
+  /*!
+   * \brief Sum the cached tree contributions into a prediction for every held-out observation and append it to 
+   *        `GetTestSetPredictions()`, after updating the contributions of any tree that changed since its last 
+   *        `UpdateTestSetTree`. Results are bit-identical to `TreeEnsemble::PredictInplace`.
+   */
+  void RecordTestSetPrediction(TreeEnsemble& ensemble);
+  /*! \brief Recorded test set predictions; prediction `j` of observation `i` is stored at `[j*n_test + i]` */
+  std::vector<double>& GetTestSetPredictions() {return test_predictions_;}
+  /*! \brief Number of test set predictions recorded so far */
+  int NumTestSetPredictions() {return (NumTestObservations() == 0) ? 0 : test_predictions_.size() / NumTestObservations();}
+  /*! \brief Cached tree predictions, or null if the tracker does not cache them */
   SamplePredMapper* GetSamplePredMapper() {return sample_pred_mapper_.get();}
   SampleNodeMapper* GetSampleNodeMapper() {return sample_node_mapper_.get();}
   UnsortedNodeSampleTracker* GetUnsortedNodeSampleTracker() {return unsorted_node_sample_tracker_.get();}
   SortedNodeSampleTracker* GetSortedNodeSampleTracker() {return sorted_node_sample_tracker_.get();}
+  /*! 
+   * \brief Number of threads used to partition the presorted features after each GFR split (values <= 0 use all 
+   *        available hardware threads). The threads are started here and kept until the thread count changes or 
+   *        the tracker is destroyed. Sampled trees do not depend on the number of threads.
+   */
+  void SetNumThreads(int num_threads);
+  int GetNumThreads() {return num_threads_;}
 
  private:
-  /*! \brief Mapper from observations to predicted values for every tree in a forest */
+  /*! \brief Build the node trackers and presorted feature indices for `covariates` */
+  template <typename CovariateMatrix>
+  void Initialize(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, 
+                  BinnedColumnMatrix const* binned_covariates, data_size_t const* presort_index, bool cache_tree_predictions);
+  /*! \brief Route the held-out observations of `split_node_id` to its new children */
+  void AddTestSetSplit(TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id);
+  /*! \brief Call `term_fn(k, i, value)` with term `k` of tree `tree_num`'s prediction for every held-out observation `i`, leaf by leaf */
+  template <typename TermFn>
+  void VisitTestSetTree(Tree& tree, int32_t tree_num, bool requires_basis, TermFn&& term_fn);
+
+  /*! \brief Mapper from observations to predicted values for every tree in a forest (null if predictions are not cached) */
   std::unique_ptr<SamplePredMapper> sample_pred_mapper_;
+  /*! \brief Whether each tree's predictions have been subtracted from the residual, if predictions are not cached */
+  std::vector<char> tree_has_predictions_;
   /*! \brief Mapper from observations to leaf node indices for every tree in a forest */
   std::unique_ptr<SampleNodeMapper> sample_node_mapper_;
   /*! \brief Data structure tracking / updating observations available in each node for every tree in a forest
@@ -90,10 +180,26 @@ class ForestTracker {
    */
   std::unique_ptr<FeaturePresortRootContainer> presort_container_;
   std::unique_ptr<SortedNodeSampleTracker> sorted_node_sample_tracker_;
+  /*! \brief Held-out dataset (not owned) and the held-out observations in each node of every tree */
+  ForestDataset* test_dataset_{nullptr};
+  std::unique_ptr<UnsortedNodeSampleTracker> test_node_sample_tracker_;
+  /*! 
+   * \brief Contribution of each tree to the held-out predictions (only if tree predictions are cached), with term `k` of the leaf regression of tree `j` for 
+   *        observation `i` stored at `[(j*test_output_dimension_ + k)*n_test + i]`, and whether each tree's contribution 
+   *        is up to date with its leaves
+   */
+  std::vector<double> test_tree_predictions_;
+  std::vector<char> test_tree_current_;
+  int test_output_dimension_{0};
+  /*! \brief Test set predictions recorded after each sampler iteration */
+  std::vector<double> test_predictions_;
   std::vector<FeatureType> feature_types_;
   int num_trees_;
   int num_observations_;
   int num_features_;
+  int num_threads_{1};
+  /*! \brief Threads used by the sorted node tracker (null when running on one thread) */
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 /*! \brief Class storing sample-prediction map for each tree in an ensemble */
@@ -140,70 +246,121 @@ class SamplePredMapper {
 /*! \brief Class storing sample-node map for each tree in an ensemble */
 class SampleNodeMapper {
  public:
-  SampleNodeMapper(int num_trees, data_size_t num_observations) {
+  /*! \brief Largest node id stored in the default 16-bit layout */
+  static constexpr int kMaxNarrowNodeId = std::numeric_limits<std::uint16_t>::max();
+
+  /*!
+   * \brief Map each of `num_observations` observations to a node of each of `num_trees` trees, storing the node ids of 
+   *        each tree contiguously in one buffer. Node ids take 16 bits unless `wide_node_ids` is true or a node id above 
+   *        `kMaxNarrowNodeId` is assigned, in which case the buffer is converted to 32-bit node ids once.
+   */
+  SampleNodeMapper(int num_trees, data_size_t num_observations, bool wide_node_ids = false) {
     num_trees_ = num_trees;
     num_observations_ = num_observations;
-    // Initialize the vector of vectors of leaf indices for each tree
-    tree_observation_indices_.resize(num_trees_);
-    for (int j = 0; j < num_trees_; j++) {
-      tree_observation_indices_[j].resize(num_observations_);
+    wide_node_ids_ = wide_node_ids;
+    if (wide_node_ids_) {
+      wide_node_ids_data_.resize(static_cast<std::size_t>(num_trees_) * num_observations_);
+    } else {
+      narrow_node_ids_data_.resize(static_cast<std::size_t>(num_trees_) * num_observations_);
     }
   }
   
-  SampleNodeMapper(SampleNodeMapper& other){
-    num_trees_ = other.NumTrees();
-    num_observations_ = other.NumObservations();
-    // Initialize the vector of vectors of leaf indices for each tree
-    tree_observation_indices_.resize(num_trees_);
-    for (int j = 0; j < num_trees_; j++) {
-      tree_observation_indices_[j].resize(num_observations_);
-      for (int i = 0; i < num_observations_; i++) {
-        tree_observation_indices_[j][i] = other.GetNodeId(i, j);
-      }
-    }
+  SampleNodeMapper(SampleNodeMapper& other) {
+    num_trees_ = other.num_trees_;
+    num_observations_ = other.num_observations_;
+    wide_node_ids_ = other.wide_node_ids_;
+    narrow_node_ids_data_ = other.narrow_node_ids_data_;
+    wide_node_ids_data_ = other.wide_node_ids_data_;
+  }
+
+  /*! 
+   * \brief Call `fn` with a pointer to the `NumObservations()` node ids of tree `tree_id`, as `std::uint16_t*` or 
+   *        `std::int32_t*` depending on `HasWideNodeIds()`, for loops over every observation of a tree
+   */
+  template <typename Function>
+  decltype(auto) VisitTreeNodeIds(int tree_id, Function&& fn) {
+    std::size_t offset = static_cast<std::size_t>(tree_id) * num_observations_;
+    if (wide_node_ids_) return fn(wide_node_ids_data_.data() + offset);
+    return fn(narrow_node_ids_data_.data() + offset);
   }
 
-  void AddSplit(Eigen::MatrixXd& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id) {
+  template <typename CovariateMatrix>
+  void AddSplit(CovariateMatrix& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id) {
     CHECK_EQ(num_observations_, covariates.rows());
-    // Eigen::MatrixXd X = covariates.GetData();
-    for (int i = 0; i < num_observations_; i++) {
-      if (tree_observation_indices_[tree_id][i] == split_node_id) {
-        auto fvalue = covariates(i, split_feature);
-        if (split.SplitTrue(fvalue)) {
-          tree_observation_indices_[tree_id][i] = left_node_id;
-        } else {
-          tree_observation_indices_[tree_id][i] = right_node_id;
+    CHECK_LT(tree_id, num_trees_);
+    ReserveNodeId(std::max(left_node_id, right_node_id));
+    VisitTreeNodeIds(tree_id, [&](auto* node_ids) {
+      using NodeId = std::remove_pointer_t<decltype(node_ids)>;
+      for (data_size_t i = 0; i < num_observations_; i++) {
+        if (node_ids[i] == split_node_id) {
+          auto fvalue = covariates(i, split_feature);
+          node_ids[i] = static_cast<NodeId>(split.SplitTrue(fvalue) ? left_node_id : right_node_id);
         }
       }
-    }
+    });
   }
 
   inline data_size_t GetNodeId(data_size_t sample_id, int tree_id) {
     CHECK_LT(sample_id, num_observations_);
     CHECK_LT(tree_id, num_trees_);
-    return tree_observation_indices_[tree_id][sample_id];
+    std::size_t offset = static_cast<std::size_t>(tree_id) * num_observations_ + sample_id;
+    return wide_node_ids_ ? wide_node_ids_data_[offset] : narrow_node_ids_data_[offset];
   }
 
   inline void SetNodeId(data_size_t sample_id, int tree_id, int node_id) {
     CHECK_LT(sample_id, num_observations_);
     CHECK_LT(tree_id, num_trees_);
-    tree_observation_indices_[tree_id][sample_id] = node_id;
+    ReserveNodeId(node_id);
+    std::size_t offset = static_cast<std::size_t>(tree_id) * num_observations_ + sample_id;
+    if (wide_node_ids_) {
+      wide_node_ids_data_[offset] = node_id;
+    } else {
+      narrow_node_ids_data_[offset] = static_cast<std::uint16_t>(node_id);
+    }
+  }
+
+  /*! \brief Assign `node_id` to the `num_samples` observations listed in `sample_ids` for tree `tree_id` */
+  void SetNodeIds(int tree_id, data_size_t const* sample_ids, data_size_t num_samples, int node_id) {
+    CHECK_LT(tree_id, num_trees_);
+    ReserveNodeId(node_id);
+    VisitTreeNodeIds(tree_id, [&](auto* node_ids) {
+      using NodeId = std::remove_pointer_t<decltype(node_ids)>;
+      NodeId value = static_cast<NodeId>(node_id);
+      for (data_size_t i = 0; i < num_samples; i++) {
+        node_ids[sample_ids[i]] = value;
+      }
+    });
   }
+
+  /*! \brief Whether node ids are stored in 32 rather than 16 bits */
+  inline bool HasWideNodeIds() {return wide_node_ids_;}
   
   inline int NumTrees() {return num_trees_;}
   
   inline int NumObservations() {return num_observations_;}
 
   inline void AssignAllSamplesToRoot(int tree_id) {
-    for (data_size_t i = 0; i < num_observations_; i++) {
-      tree_observation_indices_[tree_id][i] = 0;
-    }
+    CHECK_LT(tree_id, num_trees_);
+    VisitTreeNodeIds(tree_id, [&](auto* node_ids) {std::fill(node_ids, node_ids + num_observations_, 0);});
   }
 
  private:
-  std::vector<std::vector<int>> tree_observation_indices_;
+  /*! \brief Convert the node ids to 32 bits if `node_id` does not fit in 16 bits */
+  inline void ReserveNodeId(int node_id) {
+    if (!wide_node_ids_ && node_id > kMaxNarrowNodeId) {
+      wide_node_ids_data_.assign(narrow_node_ids_data_.begin(), narrow_node_ids_data_.end());
+      narrow_node_ids_data_.clear();
+      narrow_node_ids_data_.shrink_to_fit();
+      wide_node_ids_ = true;
+    }
+  }
+
+  /*! \brief Node ids stored tree by tree: the node of observation `i` in tree `j` is at `[j*num_observations_ + i]` */
+  std::vector<std::uint16_t> narrow_node_ids_data_;
+  std::vector<std::int32_t> wide_node_ids_data_;
   int num_trees_;
   data_size_t num_observations_;
+  bool wide_node_ids_{false};
 };
 
 /*! \brief Mapping nodes to the indices they contain */
@@ -212,13 +369,26 @@ class FeatureUnsortedPartition {
   FeatureUnsortedPartition(data_size_t n);
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionNode(Eigen::MatrixXd& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split);
+  template <typename CovariateMatrix>
+  void PartitionNode(CovariateMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split);
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionNode(Eigen::MatrixXd& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value);
+  template <typename CovariateMatrix>
+  void PartitionNode(CovariateMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value);
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionNode(Eigen::MatrixXd& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list);
+  template <typename CovariateMatrix>
+  void PartitionNode(CovariateMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list);
+
+  /*! \brief Partition a node, sending the observations for which `split_left(row)` is true to the left node */
+  template <typename SplitLeftFn>
+  void PartitionNodeBy(int node_id, int left_node_id, int right_node_id, SplitLeftFn&& split_left) {
+    auto node_begin = indices_.begin() + node_begin_[node_id];
+    auto node_end = node_begin + node_length_[node_id];
+    auto right_node_begin = std::stable_partition(node_begin, node_end, split_left);
+    data_size_t num_true = std::distance(node_begin, right_node_begin);
+    ExpandNodeTrackingVectors(node_id, left_node_id, right_node_id, node_begin_[node_id], num_true, node_length_[node_id] - num_true);
+  }
 
   /*! \brief Convert a (currently split) node to a leaf */
   void PruneNodeToLeaf(int node_id);
@@ -289,19 +459,28 @@ class UnsortedNodeSampleTracker {
   }
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionTreeNode(Eigen::MatrixXd& covariates, int tree_id, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split) {
+  template <typename CovariateMatrix>
+  void PartitionTreeNode(CovariateMatrix& covariates, int tree_id, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split) {
     return feature_partitions_[tree_id]->PartitionNode(covariates, node_id, left_node_id, right_node_id, feature_split, split);
   }
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionTreeNode(Eigen::MatrixXd& covariates, int tree_id, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value) {
+  template <typename CovariateMatrix>
+  void PartitionTreeNode(CovariateMatrix& covariates, int tree_id, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value) {
     return feature_partitions_[tree_id]->PartitionNode(covariates, node_id, left_node_id, right_node_id, feature_split, split_value);
   }
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionTreeNode(Eigen::MatrixXd& covariates, int tree_id, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list) {
+  template <typename CovariateMatrix>
+  void PartitionTreeNode(CovariateMatrix& covariates, int tree_id, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list) {
     return feature_partitions_[tree_id]->PartitionNode(covariates, node_id, left_node_id, right_node_id, feature_split, category_list);
   }
+
+  /*! \brief Partition a node, sending the observations for which `split_left(row)` is true to the left node */
+  template <typename SplitLeftFn>
+  void PartitionTreeNodeBy(int tree_id, int node_id, int left_node_id, int right_node_id, SplitLeftFn&& split_left) {
+    feature_partitions_[tree_id]->PartitionNodeBy(node_id, left_node_id, right_node_id, std::forward<SplitLeftFn>(split_left));
+  }
   
   /*! \brief Convert a tree to root */
   void ResetTreeToRoot(int tree_id, data_size_t n) {
@@ -436,6 +615,12 @@ class NodeOffsetSize {
 /*! \brief Forward declaration of partition-based presort tracker */
 class FeaturePresortPartition;
 
+/*! \brief Stored (nonzero) entry of a sparse feature, kept with its value so that splits never search the sparse column */
+struct SparseFeatureEntry {
+  data_size_t row;
+  double value;
+};
+
 /*! \brief Data structure for presorting a feature by its values
  * 
  *  This class is intended to be run *once* on a dataset as it 
@@ -444,18 +629,37 @@ class FeaturePresortPartition;
  *  FeaturePresortPartition is intended for use in recursive construction
  *  of new trees, and each new tree's FeaturePresortPartition is initialized 
  *  from a FeaturePresortRoot class so that features are only arg-sorted one time.
+ *
+ *  Features of a sparse covariate matrix store only their nonzero entries in sorted order. The zeros 
+ *  are left implicit, as a single run of observations between the negative and positive values.
  */
 class FeaturePresortRoot {
  friend FeaturePresortPartition; 
  public:
-  FeaturePresortRoot(Eigen::MatrixXd& covariates, int32_t feature_index, FeatureType feature_type) {
+  /*! 
+   * \brief Sort feature `feature_index` of `covariates`, by bin code if `binned_covariates` is provided, or else by copying 
+   *        `presort_indices` (the precomputed `num_obs` sort indices of this feature, see `ForestDataset::AddPresortIndex`) if provided. 
+   *        Presort indices are not used for sparse covariates, whose nonzero entries are sorted directly.
+   */
+  template <typename CovariateMatrix>
+  FeaturePresortRoot(CovariateMatrix& covariates, int32_t feature_index, FeatureType feature_type, BinnedColumnMatrix const* binned_covariates = nullptr, 
+                     data_size_t const* presort_indices = nullptr) {
     feature_index_ = feature_index;
-    ArgsortRoot(covariates);
+    num_obs_ = covariates.rows();
+    binned_covariates_ = binned_covariates;
+    if (binned_covariates_ != nullptr) {
+      ArgsortRootBinned();
+    } else if (presort_indices != nullptr && !std::is_same<CovariateMatrix, SparseColumnMatrix>::value) {
+      CopyPresortIndices(presort_indices, covariates.rows());
+    } else {
+      ArgsortRoot(covariates);
+    }
   }
 
   ~FeaturePresortRoot() {}
 
-  void ArgsortRoot(Eigen::MatrixXd& covariates) {
+  template <typename CovariateMatrix>
+  void ArgsortRoot(CovariateMatrix& covariates) {
     data_size_t num_obs = covariates.rows();
     
     // Make a vector of indices from 0 to num_obs - 1
@@ -471,19 +675,95 @@ class FeaturePresortRoot {
     std::stable_sort(feature_sort_indices_.begin(), feature_sort_indices_.end(), comp_op);
   }
 
+  /*!
+   * \brief Sort the nonzero entries of a sparse feature, leaving its zeros (stored or not) implicit. Entries are stored 
+   *        in increasing row order, so the stable sort breaks ties by row as in the dense case.
+   */
+  void ArgsortRoot(SparseColumnMatrix& covariates) {
+    sparse_ = true;
+    nonzero_entries_.clear();
+    nonzero_entries_.reserve(covariates.ColumnEnd(feature_index_) - covariates.ColumnBegin(feature_index_));
+    for (int k = covariates.ColumnBegin(feature_index_); k < covariates.ColumnEnd(feature_index_); k++) {
+      if (covariates.Value(k) != 0.0) nonzero_entries_.push_back({covariates.RowIndex(k), covariates.Value(k)});
+    }
+    auto comp_op = [](SparseFeatureEntry const& l, SparseFeatureEntry const& r) { return std::less<double>{}(l.value, r.value); };
+    std::stable_sort(nonzero_entries_.begin(), nonzero_entries_.end(), comp_op);
+    auto positive_begin = std::partition_point(nonzero_entries_.begin(), nonzero_entries_.end(), [](SparseFeatureEntry const& e) { return e.value < 0.0; });
+    num_negative_ = static_cast<data_size_t>(std::distance(nonzero_entries_.begin(), positive_begin));
+  }
+
+  /*! \brief Use precomputed sort indices, which must be a permutation of the observations */
+  void CopyPresortIndices(data_size_t const* presort_indices, data_size_t num_obs) {
+    feature_sort_indices_.assign(presort_indices, presort_indices + num_obs);
+    std::vector<char> seen(num_obs, 0);
+    for (data_size_t i = 0; i < num_obs; i++) {
+      data_size_t index = feature_sort_indices_[i];
+      if (index < 0 || index >= num_obs || seen[index]) {
+        Log::Fatal("Presort index of feature %d is not a permutation of the observations", feature_index_);
+      }
+      seen[index] = 1;
+    }
+  }
+
+  /*! 
+   * \brief Observation indices in sorted order of the feature. Sparse features are expanded, with their zeros 
+   *        in increasing row order between the negative and positive values.
+   */
+  std::vector<data_size_t> GetSortIndices() const {
+    if (!sparse_) return feature_sort_indices_;
+    std::vector<char> is_zero(num_obs_, 1);
+    for (auto const& entry : nonzero_entries_) is_zero[entry.row] = 0;
+    std::vector<data_size_t> out;
+    out.reserve(num_obs_);
+    for (data_size_t k = 0; k < num_negative_; k++) out.push_back(nonzero_entries_[k].row);
+    for (data_size_t i = 0; i < num_obs_; i++) {
+      if (is_zero[i]) out.push_back(i);
+    }
+    for (std::size_t k = num_negative_; k < nonzero_entries_.size(); k++) out.push_back(nonzero_entries_[k].row);
+    return out;
+  }
+
+  /*! \brief Whether only the nonzero entries of the feature are sorted (see `ArgsortRoot(SparseColumnMatrix&)`) */
+  bool IsSparse() const {return sparse_;}
+
+  /*! \brief Sort the observations by their bin codes with a (stable) counting sort */
+  void ArgsortRootBinned() {
+    data_size_t num_obs = binned_covariates_->NumRows();
+    std::vector<data_size_t> bin_begin(binned_covariates_->NumBins(feature_index_) + 1, 0);
+    for (data_size_t i = 0; i < num_obs; i++) {
+      bin_begin[binned_covariates_->BinCode(i, feature_index_) + 1]++;
+    }
+    std::partial_sum(bin_begin.begin(), bin_begin.end(), bin_begin.begin());
+    feature_sort_indices_.resize(num_obs);
+    for (data_size_t i = 0; i < num_obs; i++) {
+      feature_sort_indices_[bin_begin[binned_covariates_->BinCode(i, feature_index_)]++] = i;
+    }
+  }
+
  private:
   std::vector<data_size_t> feature_sort_indices_;
+  /*! \brief Nonzero entries of a sparse feature in sorted order, of which the first `num_negative_` are negative */
+  std::vector<SparseFeatureEntry> nonzero_entries_;
+  data_size_t num_negative_{0};
+  bool sparse_{false};
   int32_t feature_index_;
+  data_size_t num_obs_;
+  BinnedColumnMatrix const* binned_covariates_{nullptr};
 };
 
 /*! \brief Container class for FeaturePresortRoot objects stored for every feature in a dataset */
 class FeaturePresortRootContainer {
  public:
-  FeaturePresortRootContainer(Eigen::MatrixXd& covariates, std::vector<FeatureType>& feature_types) {
+  template <typename CovariateMatrix>
+  FeaturePresortRootContainer(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, BinnedColumnMatrix const* binned_covariates = nullptr, 
+                              data_size_t const* presort_index = nullptr) {
     num_features_ = covariates.cols();
+    binned_covariates_ = binned_covariates;
     feature_presort_.resize(num_features_);
+    data_size_t num_obs = covariates.rows();
     for (int i = 0; i < num_features_; i++) {
-      feature_presort_[i].reset(new FeaturePresortRoot(covariates, i, feature_types[i]));
+      data_size_t const* presort_indices = (presort_index == nullptr) ? nullptr : presort_index + static_cast<std::size_t>(i) * num_obs;
+      feature_presort_[i].reset(new FeaturePresortRoot(covariates, i, feature_types[i], binned_covariates, presort_indices));
     }
   }
 
@@ -491,7 +771,11 @@ class FeaturePresortRootContainer {
 
   FeaturePresortRoot* GetFeaturePresort(int feature_num) {return feature_presort_[feature_num].get(); }
 
+  /*! \brief Binned covariates used to presort the features (null if the raw covariates were sorted) */
+  BinnedColumnMatrix const* GetBinnedCovariates() {return binned_covariates_;}
+
  private:
+  BinnedColumnMatrix const* binned_covariates_{nullptr};
   std::vector<std::unique_ptr<FeaturePresortRoot>> feature_presort_;
   int num_features_;
 };
@@ -508,28 +792,65 @@ class FeaturePresortRootContainer {
  */
 class FeaturePresortPartition {
  public:
-  FeaturePresortPartition(FeaturePresortRoot* feature_presort_root, Eigen::MatrixXd& covariates, int32_t feature_index, FeatureType feature_type) {
+  template <typename CovariateMatrix>
+  FeaturePresortPartition(FeaturePresortRoot* feature_presort_root, CovariateMatrix& covariates, int32_t feature_index, FeatureType feature_type) {
     // Unpack all feature details
     feature_index_ = feature_index;
     feature_type_ = feature_type;
     num_obs_ = covariates.rows();
     feature_sort_indices_ = feature_presort_root->feature_sort_indices_;
+    binned_covariates_ = feature_presort_root->binned_covariates_;
+    sparse_ = feature_presort_root->sparse_;
+    nonzero_entries_ = feature_presort_root->nonzero_entries_;
 
     // Initialize new tree to root
     data_size_t node_offset = 0;
     node_offset_sizes_.emplace_back(node_offset, num_obs_);
+    if (sparse_) {
+      nonzero_offset_sizes_.emplace_back(0, static_cast<data_size_t>(nonzero_entries_.size()));
+      node_num_negative_.push_back(feature_presort_root->num_negative_);
+    }
   }
 
   ~FeaturePresortPartition() {}
 
+  /*! 
+   * \brief Return to a single root node, restoring the root sort order of `feature_presort_root` into the existing 
+   *        index buffer and keeping the capacity of the node offset vector, so that no memory is allocated
+   */
+  void ResetToRoot(FeaturePresortRoot* feature_presort_root, FeatureType feature_type) {
+    CHECK_EQ(feature_presort_root->feature_sort_indices_.size(), feature_sort_indices_.size());
+    CHECK_EQ(feature_presort_root->nonzero_entries_.size(), nonzero_entries_.size());
+    std::copy(feature_presort_root->feature_sort_indices_.begin(), feature_presort_root->feature_sort_indices_.end(), feature_sort_indices_.begin());
+    std::copy(feature_presort_root->nonzero_entries_.begin(), feature_presort_root->nonzero_entries_.end(), nonzero_entries_.begin());
+    feature_type_ = feature_type;
+    node_offset_sizes_.clear();
+    node_offset_sizes_.emplace_back(0, num_obs_);
+    if (sparse_) {
+      nonzero_offset_sizes_.clear();
+      nonzero_offset_sizes_.emplace_back(0, static_cast<data_size_t>(nonzero_entries_.size()));
+      node_num_negative_.clear();
+      node_num_negative_.push_back(feature_presort_root->num_negative_);
+    }
+  }
+
   /*! \brief Split numeric / ordered categorical feature and update sort indices */
-  void SplitFeature(Eigen::MatrixXd& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split);
+  template <typename CovariateMatrix>
+  void SplitFeature(CovariateMatrix& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split);
 
   /*! \brief Split numeric / ordered categorical feature and update sort indices */
-  void SplitFeatureNumeric(Eigen::MatrixXd& covariates, int32_t node_id, int32_t feature_index, double split_value);
+  template <typename CovariateMatrix>
+  void SplitFeatureNumeric(CovariateMatrix& covariates, int32_t node_id, int32_t feature_index, double split_value);
 
   /*! \brief Split unordered categorical feature and update sort indices */
-  void SplitFeatureCategorical(Eigen::MatrixXd& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list);
+  template <typename CovariateMatrix>
+  void SplitFeatureCategorical(CovariateMatrix& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list);
+
+  /*! 
+   * \brief Split a sparse feature, partitioning only its nonzero entries in the node according to `go_left` (indexed by row), 
+   *        given that `num_left` of the node's observations go to the left node
+   */
+  void SplitSparseFeature(int32_t node_id, std::vector<char> const& go_left, data_size_t num_left);
 
   /*! \brief Start position of node indexed by node_id */
   data_size_t NodeBegin(int32_t node_id) {return node_offset_sizes_[node_id].Begin();}
@@ -546,6 +867,21 @@ class FeaturePresortPartition {
   /*! \brief Feature sort index j */
   data_size_t SortIndex(data_size_t j) {return feature_sort_indices_[j];}
 
+  /*! \brief Whether only the nonzero entries of the feature are tracked */
+  bool IsSparse() {return sparse_;}
+
+  /*! \brief Position of the first nonzero entry of node indexed by node_id */
+  data_size_t NodeNonzeroBegin(int32_t node_id) {return nonzero_offset_sizes_[node_id].Begin();}
+
+  /*! \brief One past the position of the last nonzero entry of node indexed by node_id */
+  data_size_t NodeNonzeroEnd(int32_t node_id) {return nonzero_offset_sizes_[node_id].End();}
+
+  /*! \brief Number of negative entries of node indexed by node_id, which precede its positive entries */
+  data_size_t NodeNumNegative(int32_t node_id) {return node_num_negative_[node_id];}
+
+  /*! \brief Nonzero entry k, in sorted order within each node */
+  SparseFeatureEntry const& NonzeroEntry(data_size_t k) {return nonzero_entries_[k];}
+
   /*! \brief Feature type */
   FeatureType GetFeatureType() {return feature_type_;}
 
@@ -560,45 +896,95 @@ class FeaturePresortPartition {
 
   /*! \brief Other node tracking information */
   std::vector<NodeOffsetSize> node_offset_sizes_;
+  /*! \brief Nonzero entries of a sparse feature, their range in each node, and the number of them that are negative */
+  std::vector<SparseFeatureEntry> nonzero_entries_;
+  std::vector<NodeOffsetSize> nonzero_offset_sizes_;
+  std::vector<data_size_t> node_num_negative_;
+  bool sparse_{false};
   int32_t feature_index_;
   FeatureType feature_type_;
   data_size_t num_obs_;
+  BinnedColumnMatrix const* binned_covariates_{nullptr};
 };
 
-/*! \brief Data structure for tracking observations through a tree partition with each feature pre-sorted */
+/*! 
+ * \brief Data structure for tracking observations through a tree partition with each feature pre-sorted 
+ *
+ *  Sparse features track only their nonzero entries. Every node then also keeps its observations in a single 
+ *  row partition shared by all features, which gives the rows of each feature's implicit run of zeros.
+ */
 class SortedNodeSampleTracker {
  public:
-  SortedNodeSampleTracker(FeaturePresortRootContainer* feature_presort_root_container, Eigen::MatrixXd& covariates, std::vector<FeatureType>& feature_types) {
+  template <typename CovariateMatrix>
+  SortedNodeSampleTracker(FeaturePresortRootContainer* feature_presort_root_container, CovariateMatrix& covariates, std::vector<FeatureType>& feature_types) {
     num_features_ = covariates.cols();
+    feature_presort_root_container_ = feature_presort_root_container;
+    binned_covariates_ = feature_presort_root_container->GetBinnedCovariates();
     feature_partitions_.resize(num_features_);
     FeaturePresortRoot* feature_presort_root;
     for (int i = 0; i < num_features_; i++) {
       feature_presort_root = feature_presort_root_container->GetFeaturePresort(i);
       feature_partitions_[i].reset(new FeaturePresortPartition(feature_presort_root, covariates, i, feature_types[i]));
     }
+    sparse_ = (num_features_ > 0) && feature_partitions_[0]->IsSparse();
+    if (sparse_) {
+      node_rows_.resize(covariates.rows());
+      std::iota(node_rows_.begin(), node_rows_.end(), 0);
+      go_left_.assign(covariates.rows(), 0);
+    }
   }
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionNode(Eigen::MatrixXd& covariates, int node_id, int feature_split, TreeSplit& split) {
-    for (int i = 0; i < num_features_; i++) {
-      feature_partitions_[i]->SplitFeature(covariates, node_id, feature_split, split);
+  template <typename CovariateMatrix>
+  void PartitionNode(CovariateMatrix& covariates, int node_id, int feature_split, TreeSplit& split) {
+    if (sparse_) {
+      PartitionSparseNode(node_id, feature_split, [&](double value) {return split.SplitTrue(value);});
+      return;
     }
+    ForEachFeature(NodeSize(node_id, 0), [&](int i) {feature_partitions_[i]->SplitFeature(covariates, node_id, feature_split, split);});
   }
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionNode(Eigen::MatrixXd& covariates, int node_id, int feature_split, double split_value) {
-    for (int i = 0; i < num_features_; i++) {
-      feature_partitions_[i]->SplitFeatureNumeric(covariates, node_id, feature_split, split_value);
+  template <typename CovariateMatrix>
+  void PartitionNode(CovariateMatrix& covariates, int node_id, int feature_split, double split_value) {
+    if (sparse_) {
+      PartitionSparseNode(node_id, feature_split, [&](double value) {return SplitTrueNumeric(value, split_value);});
+      return;
     }
+    ForEachFeature(NodeSize(node_id, 0), [&](int i) {feature_partitions_[i]->SplitFeatureNumeric(covariates, node_id, feature_split, split_value);});
   }
 
   /*! \brief Partition a node based on a new split rule */
-  void PartitionNode(Eigen::MatrixXd& covariates, int node_id, int feature_split, std::vector<std::uint32_t> const& category_list) {
-    for (int i = 0; i < num_features_; i++) {
-      feature_partitions_[i]->SplitFeatureCategorical(covariates, node_id, feature_split, category_list);
+  template <typename CovariateMatrix>
+  void PartitionNode(CovariateMatrix& covariates, int node_id, int feature_split, std::vector<std::uint32_t> const& category_list) {
+    if (sparse_) {
+      std::vector<std::uint64_t> category_set_data;
+      EncodeCategorySet(category_list, category_set_data);
+      CategorySetView category_set(category_set_data.data(), category_set_data.data() + category_set_data.size());
+      PartitionSparseNode(node_id, feature_split, [&](double value) {return category_set.Contains(value);});
+      return;
     }
+    ForEachFeature(NodeSize(node_id, 0), [&](int i) {feature_partitions_[i]->SplitFeatureCategorical(covariates, node_id, feature_split, category_list);});
   }
 
+  /*! 
+   * \brief Return every feature to a single root node holding its presorted indices, reusing the existing buffers 
+   *        (equivalent to constructing a new tracker from the same presort container, without allocating)
+   */
+  void ResetToRoot(std::vector<FeatureType>& feature_types) {
+    data_size_t num_obs = (num_features_ == 0) ? 0 : NodeSize(0, 0);
+    if (sparse_) std::iota(node_rows_.begin(), node_rows_.end(), 0);
+    ForEachFeature(num_obs, [&](int i) {
+      feature_partitions_[i]->ResetToRoot(feature_presort_root_container_->GetFeaturePresort(i), feature_types[i]);
+    });
+  }
+
+  /*! 
+   * \brief Pool (not owned) whose threads `PartitionNode` and `ResetToRoot` split the features across, or null to 
+   *        process features on the calling thread
+   */
+  void SetThreadPool(ThreadPool* thread_pool) {thread_pool_ = thread_pool;}
+
   /*! \brief First index of data points contained in node_id */
   data_size_t NodeBegin(int node_id, int feature_index) {
     return feature_partitions_[feature_index]->NodeBegin(node_id);
@@ -614,34 +1000,152 @@ class SortedNodeSampleTracker {
     return feature_partitions_[feature_index]->NodeSize(node_id);
   }
 
+  /*! \brief Iterator to the first observation of node_id in sorted order of feature_index (not available for sparse features) */
   std::vector<data_size_t>::iterator NodeBeginIterator(int node_id, int feature_index) {
+    CHECK(!sparse_);
     data_size_t node_begin = NodeBegin(node_id, feature_index);
     auto begin_iter = feature_partitions_[feature_index]->feature_sort_indices_.begin();
     return begin_iter + node_begin;
   }
 
+  /*! \brief Iterator past the last observation of node_id in sorted order of feature_index (not available for sparse features) */
   std::vector<data_size_t>::iterator NodeEndIterator(int node_id, int feature_index) {
+    CHECK(!sparse_);
     data_size_t node_end = NodeEnd(node_id, feature_index);
     auto begin_iter = feature_partitions_[feature_index]->feature_sort_indices_.begin();
     return begin_iter + node_end;
   }
 
-  /*! \brief Data indices for a given node */
+  /*! \brief Data indices for a given node, in sorted order of feature_index */
   std::vector<data_size_t> NodeIndices(int node_id, int feature_index) {
+    if (sparse_) return SparseNodeIndices(node_id, feature_index);
     return feature_partitions_[feature_index]->NodeIndices(node_id);
   }
 
-  /*! \brief Feature sort index j for feature_index */
+  /*! \brief Feature sort index j for feature_index (not available for sparse features) */
   data_size_t SortIndex(data_size_t j, int feature_index) {return feature_partitions_[feature_index]->SortIndex(j); }
 
+  /*! \brief Binned covariates by which features are sorted (null if sorted by the raw covariates) */
+  BinnedColumnMatrix const* GetBinnedCovariates() {return binned_covariates_;}
+
   /*! \brief Update SampleNodeMapper for all the observations in node_id */
   void UpdateObservationMapping(int node_id, int tree_id, SampleNodeMapper* sample_node_mapper, int feature_index = 0) {
+    if (sparse_) {
+      sample_node_mapper->SetNodeIds(tree_id, node_rows_.data() + NodeBegin(node_id, 0), NodeSize(node_id, 0), node_id);
+      return;
+    }
     feature_partitions_[feature_index]->UpdateObservationMapping(node_id, tree_id, sample_node_mapper);
   }
 
+  /*! 
+   * \brief Whether only the nonzero entries of each feature are sorted. Positions [NodeBegin, NodeEnd) of a sparse feature 
+   *        then hold `NodeNumNegative` negative entries, `NodeNumZeros` implicit zeros and the remaining positive entries.
+   */
+  bool IsSparse() {return sparse_;}
+
+  /*! \brief Position of the first nonzero entry of feature_index in node_id (sparse features only) */
+  data_size_t NodeNonzeroBegin(int node_id, int feature_index) {return feature_partitions_[feature_index]->NodeNonzeroBegin(node_id);}
+
+  /*! \brief One past the position of the last nonzero entry of feature_index in node_id (sparse features only) */
+  data_size_t NodeNonzeroEnd(int node_id, int feature_index) {return feature_partitions_[feature_index]->NodeNonzeroEnd(node_id);}
+
+  /*! \brief Number of negative entries of feature_index in node_id (sparse features only) */
+  data_size_t NodeNumNegative(int node_id, int feature_index) {return feature_partitions_[feature_index]->NodeNumNegative(node_id);}
+
+  /*! \brief Number of observations in node_id for which feature_index is zero (sparse features only) */
+  data_size_t NodeNumZeros(int node_id, int feature_index) {
+    return NodeSize(node_id, feature_index) - (NodeNonzeroEnd(node_id, feature_index) - NodeNonzeroBegin(node_id, feature_index));
+  }
+
+  /*! \brief Nonzero entry k of feature_index (sparse features only) */
+  SparseFeatureEntry const& NonzeroEntry(data_size_t k, int feature_index) {return feature_partitions_[feature_index]->NonzeroEntry(k);}
+
+  /*! \brief Observations of node_id, in no feature-specific order (sparse features only) */
+  std::vector<data_size_t>::iterator NodeRowsBegin(int node_id) {return node_rows_.begin() + NodeBegin(node_id, 0);}
+
+  /*! \brief One past the last observation of node_id, in no feature-specific order (sparse features only) */
+  std::vector<data_size_t>::iterator NodeRowsEnd(int node_id) {return node_rows_.begin() + NodeEnd(node_id, 0);}
+
+  /*! \brief Whether an observation of the most recently split node went to the left node (sparse features only) */
+  bool WentLeft(data_size_t row) {return go_left_[row];}
+
  private:
+  /*! \brief Smallest number of (observation, feature) pairs processed by `ForEachFeature` for which threads are started */
+  static constexpr int64_t kParallelPartitionMinWork = 65536;
+
+  /*!
+   * \brief Run `fn(i)` for every feature `i`, spreading features across the threads of the pool when `node_size` 
+   *        observations per feature are enough work to amortize waking them. Each feature only modifies its own 
+   *        sort indices, so results do not depend on the number of threads.
+   */
+  template <typename Function>
+  void ForEachFeature(data_size_t node_size, Function&& fn) {
+    if (num_features_ == 0) return;
+    int64_t work = static_cast<int64_t>(node_size) * num_features_;
+    if (thread_pool_ == nullptr || work < kParallelPartitionMinWork) {
+      for (int i = 0; i < num_features_; i++) fn(i);
+      return;
+    }
+    thread_pool_->ParallelFor(0, num_features_, 1, [&](int64_t block_begin, int64_t block_end) {
+      for (int64_t i = block_begin; i < block_end; i++) fn(static_cast<int>(i));
+    });
+  }
+
+  /*!
+   * \brief Split a node of sparse features, marking each observation's direction from the value of `feature_split` 
+   *        (zero unless it has a nonzero entry in the node) and then partitioning the rows of the node once and the 
+   *        nonzero entries of every feature
+   */
+  template <typename SplitLeftFn>
+  void PartitionSparseNode(int node_id, int feature_split, SplitLeftFn&& split_left) {
+    auto rows_begin = NodeRowsBegin(node_id);
+    auto rows_end = NodeRowsEnd(node_id);
+    char zero_left = split_left(0.0);
+    for (auto it = rows_begin; it != rows_end; ++it) go_left_[*it] = zero_left;
+    FeaturePresortPartition* split_partition = feature_partitions_[feature_split].get();
+    for (data_size_t k = split_partition->NodeNonzeroBegin(node_id); k < split_partition->NodeNonzeroEnd(node_id); k++) {
+      SparseFeatureEntry const& entry = split_partition->NonzeroEntry(k);
+      go_left_[entry.row] = split_left(entry.value);
+    }
+    auto right_begin = std::stable_partition(rows_begin, rows_end, [&](data_size_t row) {return go_left_[row];});
+    data_size_t num_left = static_cast<data_size_t>(std::distance(rows_begin, right_begin));
+
+    // Each feature moves only its own nonzero entries
+    data_size_t num_nonzero = 0;
+    for (int i = 0; i < num_features_; i++) num_nonzero += NodeNonzeroEnd(node_id, i) - NodeNonzeroBegin(node_id, i);
+    ForEachFeature(num_nonzero / num_features_, [&](int i) {feature_partitions_[i]->SplitSparseFeature(node_id, go_left_, num_left);});
+  }
+
+  /*! \brief Expand the sorted order of a sparse feature in node_id, placing its zeros in increasing row order */
+  std::vector<data_size_t> SparseNodeIndices(int node_id, int feature_index) {
+    std::vector<data_size_t> out;
+    out.reserve(NodeSize(node_id, feature_index));
+    data_size_t nonzero_begin = NodeNonzeroBegin(node_id, feature_index);
+    data_size_t nonzero_end = NodeNonzeroEnd(node_id, feature_index);
+    data_size_t positive_begin = nonzero_begin + NodeNumNegative(node_id, feature_index);
+    std::vector<char> is_nonzero(node_rows_.size(), 0);
+    for (data_size_t k = nonzero_begin; k < nonzero_end; k++) is_nonzero[NonzeroEntry(k, feature_index).row] = 1;
+    for (data_size_t k = nonzero_begin; k < positive_begin; k++) out.push_back(NonzeroEntry(k, feature_index).row);
+    std::vector<data_size_t> zero_rows;
+    for (auto it = NodeRowsBegin(node_id); it != NodeRowsEnd(node_id); ++it) {
+      if (!is_nonzero[*it]) zero_rows.push_back(*it);
+    }
+    std::sort(zero_rows.begin(), zero_rows.end());
+    out.insert(out.end(), zero_rows.begin(), zero_rows.end());
+    for (data_size_t k = positive_begin; k < nonzero_end; k++) out.push_back(NonzeroEntry(k, feature_index).row);
+    return out;
+  }
+
   std::vector<std::unique_ptr<FeaturePresortPartition>> feature_partitions_;
+  FeaturePresortRootContainer* feature_presort_root_container_;
   int num_features_;
+  ThreadPool* thread_pool_{nullptr};
+  BinnedColumnMatrix const* binned_covariates_{nullptr};
+  /*! \brief Rows of every node (sparse features only), partitioned alongside the nonzero entries of each feature */
+  std::vector<data_size_t> node_rows_;
+  /*! \brief Direction of each observation of the most recently split node (sparse features only) */
+  std::vector<char> go_left_;
+  bool sparse_{false};
 };
 
 } // namespace StochTree
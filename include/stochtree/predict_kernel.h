@@ -0,0 +1,76 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Kernels that route a block of consecutive observations through a single tree.
+ */
+#ifndef STOCHTREE_PREDICT_KERNEL_H_
+#define STOCHTREE_PREDICT_KERNEL_H_
+
+#include <stochtree/meta.h>
+#include <stochtree/tree.h>
+#include <Eigen/Dense>
+
+#include <cstdint>
+
+namespace StochTree {
+
+/*! \brief Instruction set used to traverse a tree for a block of observations */
+enum class PredictKernel {
+  kScalar = 0,
+  kAVX2 = 1,
+  kAVX512 = 2
+};
+
+/*! \brief Maximum number of observations routed through a tree by a single call to `EvaluateTreeBlock` */
+static constexpr int kPredictBlockRows = 16;
+
+/*! \brief Most capable kernel supported by both this build and the CPU it runs on (detected once) */
+PredictKernel BestPredictKernel();
+
+/*! \brief Whether `kernel` can be used by this build on the current CPU */
+bool PredictKernelSupported(PredictKernel kernel);
+
+/*!
+ * \brief Determine the leaf node of `tree` for observations `row_begin` through `row_begin + num_rows - 1`.
+ *
+ *        The vectorized kernels move every observation in the block down the tree in lockstep,
+ *        using gathers to load split features, thresholds and child ids and compare masks to
+ *        choose a child. Trees with categorical splits and any rows left over after filling the
+ *        vector lanes are handled by `EvaluateTree`. Every kernel returns exactly the same leaf
+ *        ids, including the default (left) child for missing values.
+ * \param tree Tree used for prediction
+ * \param covariates Covariates used for prediction (single precision values are widened to double before comparisons)
+ * \param row_begin First observation in the block
+ * \param num_rows Number of observations in the block (at most `kPredictBlockRows`)
+ * \param leaf_ids Output buffer of at least `num_rows` node ids
+ * \param kernel Kernel used for the traversal (must be supported, see `PredictKernelSupported`)
+ */
+template <typename Scalar>
+void EvaluateTreeBlock(Tree const& tree, DataMatrixMapT<Scalar>& covariates, data_size_t row_begin, int num_rows,
+                       std::int32_t* leaf_ids, PredictKernel kernel);
+
+/*! \brief Same as above, using `BestPredictKernel()` */
+template <typename Scalar>
+inline void EvaluateTreeBlock(Tree const& tree, DataMatrixMapT<Scalar>& covariates, data_size_t row_begin, int num_rows,
+                              std::int32_t* leaf_ids) {
+  EvaluateTreeBlock(tree, covariates, row_begin, num_rows, leaf_ids, BestPredictKernel());
+}
+/*! \brief Same as above for sparse covariates, whose rows are always routed one at a time by `EvaluateTree` (`kernel` is ignored) */
+inline void EvaluateTreeBlock(Tree const& tree, SparseColumnMatrix& covariates, data_size_t row_begin, int num_rows,
+                              std::int32_t* leaf_ids, PredictKernel /*kernel*/ = PredictKernel::kScalar) {
+  for (int r = 0; r < num_rows; r++) {
+    leaf_ids[r] = EvaluateTree(tree, covariates, row_begin + r);
+  }
+}
+/*! \brief Same as above for binned covariates whose raw values were released (see `ForestDataset::BinCovariates`), routed one row at a time */
+inline void EvaluateTreeBlock(Tree const& tree, BinnedColumnMatrix& covariates, data_size_t row_begin, int num_rows,
+                              std::int32_t* leaf_ids, PredictKernel /*kernel*/ = PredictKernel::kScalar) {
+  for (int r = 0; r < num_rows; r++) {
+    leaf_ids[r] = EvaluateTree(tree, covariates, row_begin + r);
+  }
+}
+
+} // namespace StochTree
+
+#endif // STOCHTREE_PREDICT_KERNEL_H_
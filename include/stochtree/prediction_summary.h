@@ -0,0 +1,116 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Running estimators used to summarize posterior predictions without storing every draw.
+ */
+#ifndef STOCHTREE_PREDICTION_SUMMARY_H_
+#define STOCHTREE_PREDICTION_SUMMARY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace StochTree {
+
+/*!
+ * \brief Streaming quantile estimator based on the P-squared algorithm of
+ *        Jain and Chlamtac (1985), "The P2 algorithm for dynamic calculation of quantiles and histograms without storing observations".
+ *
+ *        Tracks five markers (the minimum, maximum, target quantile and two intermediate quantiles)
+ *        whose heights are adjusted with piecewise-parabolic interpolation as observations arrive,
+ *        so memory use is constant in the number of observations. The estimate is exact for up to
+ *        five observations and approximate thereafter.
+ */
+class P2QuantileEstimator {
+ public:
+  explicit P2QuantileEstimator(double prob = 0.5) : prob_{prob} {}
+  ~P2QuantileEstimator() {}
+
+  /*! \brief Add an observation */
+  inline void Add(double x) {
+    if (count_ < kNumMarkers) {
+      heights_[count_++] = x;
+      if (count_ == kNumMarkers) {
+        std::sort(heights_, heights_ + kNumMarkers);
+        for (int i = 0; i < kNumMarkers; i++) positions_[i] = i + 1;
+      }
+      return;
+    }
+
+    // Find the cell containing x, extending the extreme markers if needed
+    int cell;
+    if (x < heights_[0]) {
+      heights_[0] = x;
+      cell = 0;
+    } else if (x >= heights_[kNumMarkers - 1]) {
+      heights_[kNumMarkers - 1] = x;
+      cell = kNumMarkers - 2;
+    } else {
+      cell = 0;
+      while (x >= heights_[cell + 1]) cell++;
+    }
+    for (int i = cell + 1; i < kNumMarkers; i++) positions_[i]++;
+    count_++;
+
+    // Move the three interior markers toward their desired positions
+    double const desired_increments[kNumMarkers] = {0., prob_ / 2., prob_, (1. + prob_) / 2., 1.};
+    for (int i = 1; i < kNumMarkers - 1; i++) {
+      double desired = 1. + (count_ - 1) * desired_increments[i];
+      double delta = desired - positions_[i];
+      if ((delta >= 1. && positions_[i + 1] - positions_[i] > 1.) ||
+          (delta <= -1. && positions_[i - 1] - positions_[i] < -1.)) {
+        int step = (delta > 0) ? 1 : -1;
+        double candidate = Parabolic(i, step);
+        if (heights_[i - 1] < candidate && candidate < heights_[i + 1]) {
+          heights_[i] = candidate;
+        } else {
+          heights_[i] = Linear(i, step);
+        }
+        positions_[i] += step;
+      }
+    }
+  }
+
+  /*! \brief Current estimate of the quantile (NaN if no observations have been added) */
+  inline double Quantile() const {
+    if (count_ > kNumMarkers) return heights_[2];
+    if (count_ == 0) return std::nan("");
+    // Linear interpolation between order statistics of the (at most five) stored observations, 
+    // as the markers have not been adjusted toward the target quantile yet
+    double sorted[kNumMarkers];
+    std::copy(heights_, heights_ + count_, sorted);
+    std::sort(sorted, sorted + count_);
+    double h = prob_ * (count_ - 1);
+    int lower = static_cast<int>(std::floor(h));
+    int upper = std::min(lower + 1, static_cast<int>(count_) - 1);
+    return sorted[lower] + (h - lower) * (sorted[upper] - sorted[lower]);
+  }
+
+  /*! \brief Number of observations added */
+  inline int64_t Count() const {return count_;}
+
+ private:
+  static constexpr int kNumMarkers = 5;
+
+  inline double Parabolic(int i, int step) const {
+    double const n_lower = positions_[i - 1], n_i = positions_[i], n_upper = positions_[i + 1];
+    return heights_[i] + step / (n_upper - n_lower) * (
+      (n_i - n_lower + step) * (heights_[i + 1] - heights_[i]) / (n_upper - n_i) +
+      (n_upper - n_i - step) * (heights_[i] - heights_[i - 1]) / (n_i - n_lower)
+    );
+  }
+
+  inline double Linear(int i, int step) const {
+    return heights_[i] + step * (heights_[i + step] - heights_[i]) / (positions_[i + step] - positions_[i]);
+  }
+
+  double prob_;
+  double heights_[kNumMarkers];
+  double positions_[kNumMarkers];
+  int64_t count_{0};
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_PREDICTION_SUMMARY_H_
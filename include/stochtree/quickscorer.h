@@ -0,0 +1,109 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Bitvector ("QuickScorer") evaluation of tree ensembles, following
+ * Lucchese et al. (2015), "QuickScorer: a Fast Algorithm to Rank Documents with Additive Ensembles of Regression Trees"
+ */
+#ifndef STOCHTREE_QUICKSCORER_H_
+#define STOCHTREE_QUICKSCORER_H_
+
+#include <stochtree/data.h>
+#include <stochtree/ensemble.h>
+#include <stochtree/meta.h>
+#include <stochtree/tree.h>
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+namespace StochTree {
+
+/*!
+ * \brief Read-only copy of a `TreeEnsemble` that predicts by combining leaf bitmasks rather than traversing trees.
+ *
+ *        The leaves of every tree are numbered from left to right and tracked as bits of a 64-bit word.
+ *        Each split node stores a mask which clears the bits of the leaves in its left subtree.
+ *        Split nodes are grouped by feature and sorted by threshold. To score an observation, the
+ *        masks of every node whose test is false (`x[feature] > threshold`) are ANDed into the
+ *        bitvector of their tree. The observation's leaf in each tree is then the lowest remaining set bit.
+ *        For each feature, the scan stops at the first threshold that is not below the observation's
+ *        value, so only false nodes are ever visited.
+ *
+ *        Only ensembles whose trees have at most 64 leaves and no categorical splits can be compiled
+ *        (see `Supports`). Predictions are bit-identical to `TreeEnsemble` predictions, and missing
+ *        values go to the left child, as in `EvaluateTree`.
+ */
+class QuickScorerEnsemble {
+ public:
+  explicit QuickScorerEnsemble(TreeEnsemble& ensemble);
+  ~QuickScorerEnsemble() {}
+
+  /*! \brief Whether every tree in `ensemble` can be evaluated by a `QuickScorerEnsemble` */
+  static bool Supports(TreeEnsemble& ensemble);
+
+  /*! \brief Same behavior and output layout as `TreeEnsemble::PredictRowsInplace` for all trees in the ensemble */
+  void PredictRowsInplace(ForestDataset& dataset, std::vector<double>& output,
+                          data_size_t row_begin, data_size_t row_end, data_size_t offset = 0);
+  /*! \brief Same behavior and output layout as `TreeEnsemble::PredictRawRowsInplace` for all trees in the ensemble */
+  void PredictRawRowsInplace(ForestDataset& dataset, std::vector<double>& output,
+                             data_size_t row_begin, data_size_t row_end, data_size_t offset = 0);
+
+  inline int32_t NumTrees() {return num_trees_;}
+  inline int32_t OutputDimension() {return output_dimension_;}
+
+ private:
+  /*! \brief Compute the leaf bitvector of every tree for one observation, storing it in `leaf_bits` */
+  template <typename Scalar>
+  inline void ScoreRow(DataMatrixMapT<Scalar>& covariates, data_size_t row, std::uint64_t* leaf_bits) const {
+    std::fill(leaf_bits, leaf_bits + num_trees_, ~std::uint64_t(0));
+    int32_t num_features = static_cast<int32_t>(feature_begin_.size()) - 1;
+    for (int32_t f = 0; f < num_features; f++) {
+      double const fvalue = covariates(row, f);
+      // Missing values fail every comparison, so every split on `f` sends them left
+      for (int32_t i = feature_begin_[f]; i < feature_begin_[f + 1] && threshold_[i] < fvalue; i++) {
+        leaf_bits[node_tree_[i]] &= node_mask_[i];
+      }
+    }
+  }
+  /*! \brief Offset in `leaf_values_` of the exit leaf of tree `tree_num` given its bitvector */
+  inline int32_t LeafOffset(int32_t tree_num, std::uint64_t leaf_bits) const {
+    return leaf_begin_[tree_num] + CountTrailingZeros(leaf_bits) * output_dimension_;
+  }
+  static inline int CountTrailingZeros(std::uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int count = 0;
+    while ((bits & 1) == 0) {
+      bits >>= 1;
+      count++;
+    }
+    return count;
+#endif
+  }
+  /*! \brief Visit the subtree rooted at `nid`, numbering its leaves from `*num_leaves` onwards and recording split nodes */
+  void CompileSubtree(Tree* tree, int32_t tree_num, int32_t nid, int32_t* num_leaves,
+                      std::vector<int32_t>& node_feature, std::vector<double>& node_threshold,
+                      std::vector<int32_t>& node_tree, std::vector<std::uint64_t>& node_mask);
+
+  /*! \brief Thresholds of every split node, grouped by split feature and sorted within each feature */
+  std::vector<double> threshold_;
+  /*! \brief Tree containing each split node, in the same order as `threshold_` */
+  std::vector<int32_t> node_tree_;
+  /*! \brief Bitmask clearing the leaves of each split node's left subtree, in the same order as `threshold_` */
+  std::vector<std::uint64_t> node_mask_;
+  /*! \brief Start of the split nodes of each feature in `threshold_` (length: number of features + 1) */
+  std::vector<int32_t> feature_begin_;
+  /*! \brief Leaf parameters of every tree, ordered by tree, then leaf (left to right), then output dimension */
+  std::vector<double> leaf_values_;
+  /*! \brief Offset of the first leaf of each tree in `leaf_values_` */
+  std::vector<int32_t> leaf_begin_;
+  int num_trees_;
+  int output_dimension_;
+  bool is_leaf_constant_;
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_QUICKSCORER_H_
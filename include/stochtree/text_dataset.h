@@ -0,0 +1,91 @@
+/*!
+ * Copyright (c) 2024 stochtree authors. All rights reserved.
+ * Licensed under the MIT License. See LICENSE file in the project root for license information.
+ *
+ * Chunked, multithreaded loader of delimited text (CSV / TSV) files into a ForestDataset.
+ */
+#ifndef STOCHTREE_TEXT_DATASET_H_
+#define STOCHTREE_TEXT_DATASET_H_
+
+#include <stochtree/data.h>
+#include <stochtree/meta.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace StochTree {
+
+/*! \brief Options of a `TextDatasetLoader` */
+struct TextDatasetConfig {
+  /*! \brief Field delimiter, or `'\0'` to use a tab if the first line contains one and a comma otherwise */
+  char delimiter = '\0';
+  /*! \brief Whether the first line of the file holds column names */
+  bool header = true;
+  /*! \brief Column of the outcome (-1 if the file has no outcome) */
+  int outcome_column = -1;
+  /*! \brief Column of the variance weights (-1 if the file has no weights) */
+  int weight_column = -1;
+  /*! \brief Columns of the leaf regression basis (empty if the file has no basis) */
+  std::vector<int> basis_columns;
+  /*! \brief Columns of the covariates, or empty to use every column that is not an outcome, weight or basis column */
+  std::vector<int> covariate_columns;
+  /*!
+   * \brief Type of each covariate, or empty to infer them from the first chunk of the file: covariates with any value
+   *        that is not a number are unordered categorical and all others are numeric. Ordered categorical covariates
+   *        must be declared, and their values must be numeric category codes.
+   */
+  std::vector<FeatureType> feature_types;
+  /*! \brief Whether to store the covariates in single precision (see `ForestDataset::AddCovariates`) */
+  bool single_precision = false;
+  /*! \brief Number of bytes of the file read and parsed at a time, which bounds the memory used for text */
+  std::size_t chunk_bytes = 16 * 1024 * 1024;
+  /*! \brief Number of threads used to parse each chunk (values <= 0 use all available hardware threads) */
+  int num_threads = 1;
+};
+
+/*!
+ * \brief Load a delimited text file into a `ForestDataset`, without going through R or Python.
+ *
+ *        The file is read `chunk_bytes` at a time, so the text is never held in memory all at once. The lines of each chunk
+ *        are parsed in parallel with `fast_double_parser` and their values are appended directly to row-major buffers that
+ *        the dataset borrows (and retains). The buffers are reserved up front for the number of rows estimated from the file
+ *        size and the first chunk, so they are only reallocated (and their values copied) if that estimate falls short.
+ *        Results do not depend on the number of threads.
+ *
+ *        Empty fields and `NA` / `NaN` values are missing (NaN). Fields are split on the delimiter only (quoted fields are not
+ *        supported) and surrounding spaces are ignored. Values of unordered categorical covariates are treated as labels and
+ *        coded 0, 1, 2, ... in order of their first appearance in the file (see `CategoryLabels`).
+ */
+class TextDatasetLoader {
+ public:
+  explicit TextDatasetLoader(TextDatasetConfig const& config) : config_(config) {}
+  ~TextDatasetLoader() {}
+
+  /*!
+   * \brief Load `filename` into `dataset`, replacing its covariates (and its basis and variance weights, if configured)
+   * \param filename Name of the file to load
+   * \param dataset Dataset into which the data is loaded
+   */
+  void Load(std::string const& filename, ForestDataset& dataset);
+
+  /*! \brief Type of each covariate */
+  std::vector<FeatureType>& FeatureTypes() {return feature_types_;}
+  /*! \brief Values of the outcome column (empty if there is none) */
+  std::vector<double>& Outcome() {return outcome_;}
+  /*! \brief Names of the covariates from the header line (empty if the file has no header) */
+  std::vector<std::string>& CovariateNames() {return covariate_names_;}
+  /*! \brief Labels of unordered categorical covariate `covariate_num`, indexed by category code */
+  std::vector<std::string>& CategoryLabels(int covariate_num) {return category_labels_[covariate_num];}
+
+ private:
+  TextDatasetConfig config_;
+  std::vector<FeatureType> feature_types_;
+  std::vector<double> outcome_;
+  std::vector<std::string> covariate_names_;
+  std::vector<std::vector<std::string>> category_labels_;
+};
+
+} // namespace StochTree
+
+#endif // STOCHTREE_TEXT_DATASET_H_
@@ -7,6 +7,7 @@
 #define STOCHTREE_TREE_H_
 
 #include <nlohmann/json.hpp>
+#include <stochtree/category_set.h>
 #include <stochtree/data.h>
 #include <stochtree/log.h>
 #include <stochtree/meta.h>
@@ -225,9 +226,11 @@ class Tree {
    */
   void InplacePredictFromNodes(std::vector<double> result, std::vector<std::int32_t> node_indices);
   std::vector<double> PredictFromNodes(std::vector<std::int32_t> node_indices);
-  std::vector<double> PredictFromNodes(std::vector<std::int32_t> node_indices, Eigen::MatrixXd& basis);
+  template <typename Scalar>
+  std::vector<double> PredictFromNodes(std::vector<std::int32_t> node_indices, DataMatrixMapT<Scalar>& basis);
   double PredictFromNode(std::int32_t node_id);
-  double PredictFromNode(std::int32_t node_id, Eigen::MatrixXd& basis, int row_idx);
+  template <typename Scalar>
+  double PredictFromNode(std::int32_t node_id, DataMatrixMapT<Scalar>& basis, int row_idx);
 
   /** Getters **/
   /*!
@@ -327,6 +330,23 @@ class Tree {
     }
   }
   
+  /*!
+   * \brief Pointer to the `OutputDimension()` contiguous parameters of a leaf node, so that every
+   *        output dimension can be read after a single lookup (dimension `k` equals `LeafValue(nid, k)`)
+   * \param nid ID of node being queried
+   */
+  double const* LeafValues(std::int32_t nid) const {
+    if (output_dimension_ == 1) {
+      return &leaf_value_[nid];
+    }
+    std::size_t const offset_begin = leaf_vector_begin_[nid];
+    std::size_t const offset_end = leaf_vector_end_[nid];
+    if (offset_begin >= leaf_vector_.size() || offset_end > leaf_vector_.size()) {
+      Log::Fatal("No leaf vector set for node nid");
+    }
+    return leaf_vector_.data() + offset_begin;
+  }
+
   /*!
    * \brief get leaf vector of the leaf node; useful for multi-output trees
    * \param nid ID of node being queried
@@ -343,6 +363,15 @@ class Tree {
     // element, to follow with the range semantic of std::vector<>.
   }
 
+  /*!
+   * \brief Get the packed set of categories belonging to the left child of a categorical split node,
+   *        whose membership tests neither allocate nor scan the category list (empty for other nodes)
+   * \param nid ID of node being queried
+   */
+  CategorySetView CategorySplitSet(std::int32_t nid) const {
+    return CategorySetView(category_set_.data() + category_set_begin_[nid], category_set_.data() + category_set_end_[nid]);
+  }
+
   /*!
    * \brief sum of squared values for a given node
    * \param nid ID of node being queried
@@ -433,6 +462,19 @@ class Tree {
   [[nodiscard]] std::int32_t NumLeafParents() const;
   [[nodiscard]] std::int32_t NumSplitNodes() const;
 
+  /*!
+   * \brief Hash of the structure of the tree: node ids, split features, thresholds and category lists 
+   *        of every node reachable from the root, ignoring leaf values. Trees for which 
+   *        `HasSameStructure` is true always have the same hash.
+   */
+  [[nodiscard]] std::uint64_t StructureHash() const;
+
+  /*!
+   * \brief Whether `other` has exactly the same structure as this tree (see `StructureHash`), 
+   *        so that both trees route every observation to the same node id
+   */
+  [[nodiscard]] bool HasSameStructure(Tree const& other) const;
+
   /* \brief Determine whether nid is leaf parent */
   [[nodiscard]] bool IsLeafParent(std::int32_t nid) const {
     // False until we deduce left and right node are
@@ -623,7 +665,8 @@ class Tree {
    *        std::vector<int32_t> output(dataset->NumObservations()) and set the offset to 0.
    * \param covariates Eigen matrix with which to predict leaf indices
    */
-  void PredictLeafIndexInplace(Eigen::MatrixXd& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf);
+  template <typename CovariateMatrix>
+  void PredictLeafIndexInplace(CovariateMatrix& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf);
 
   /*!
    * \brief Obtain a 0-based leaf index for each observation in a ForestDataset.
@@ -667,6 +710,11 @@ class Tree {
   std::vector<std::uint64_t> category_list_begin_;
   std::vector<std::uint64_t> category_list_end_;
 
+  // Category sets encoded from the category list of each node (see category_set.h), not serialized
+  std::vector<std::uint64_t> category_set_;
+  std::vector<std::uint64_t> category_set_begin_;
+  std::vector<std::uint64_t> category_set_end_;
+
   bool has_categorical_split_{false};
   int output_dimension_{1};
 };
@@ -706,28 +754,22 @@ inline bool SplitTrueNumeric(double fvalue, double threshold) {
   return (fvalue <= threshold);
 }
 
+/*! \brief Determine whether an observation produces a "true" value in a categorical split node
+ *  \param fvalue Value of the split feature for the observation
+ *  \param category_begin Pointer to the first category index that routes an observation to the left child
+ *  \param category_end Pointer one past the last category index that routes an observation to the left child
+ */
+inline bool SplitTrueCategorical(double fvalue, std::uint32_t const* category_begin, std::uint32_t const* category_end) {
+  std::uint32_t category_value;
+  return CategoryIndex(fvalue, category_value) && (std::find(category_begin, category_end, category_value) != category_end);
+}
+
 /*! \brief Determine whether an observation produces a "true" value in a categorical split node
  *  \param fvalue Value of the split feature for the observation
  *  \param category_list Category indices that route an observation to the left child
- *  \param left_child Node id of the left child
- *  \param right_child Node id of the right child
  */
 inline bool SplitTrueCategorical(double fvalue, std::vector<std::uint32_t> const& category_list) {
-  bool category_matched;
-  // A valid (integer) category must satisfy two criteria:
-  // 1) it must be exactly representable as double
-  // 2) it must fit into uint32_t
-  auto max_representable_int
-      = std::min(static_cast<double>(std::numeric_limits<std::uint32_t>::max()),
-          static_cast<double>(std::uint64_t(1) << std::numeric_limits<double>::digits));
-  if (fvalue < 0 || std::fabs(fvalue) > max_representable_int) {
-    category_matched = false;
-  } else {
-    auto const category_value = static_cast<std::uint32_t>(fvalue);
-    category_matched = (std::find(category_list.begin(), category_list.end(), category_value)
-                        != category_list.end());
-  }
-  return category_matched;
+  return SplitTrueCategorical(fvalue, category_list.data(), category_list.data() + category_list.size());
 }
 
 /*! \brief Return left or right node id based on a numeric split
@@ -755,7 +797,8 @@ inline int NextNodeCategorical(double fvalue, std::vector<std::uint32_t> const&
  *  \param data Dataset used for prediction
  *  \param row Row indexing the prediction observation
  */
-inline int EvaluateTree(Tree const& tree, Eigen::MatrixXd& data, int row) {
+template <typename CovariateMatrix>
+inline int EvaluateTree(Tree const& tree, CovariateMatrix& data, int row) {
   int node_id = 0;
   while (!tree.IsLeaf(node_id)) {
     auto const split_index = tree.SplitIndex(node_id);
@@ -764,8 +807,7 @@ inline int EvaluateTree(Tree const& tree, Eigen::MatrixXd& data, int row) {
       node_id = tree.DefaultChild(node_id);
     } else {
       if (tree.NodeType(node_id) == StochTree::TreeNodeType::kCategoricalSplitNode) {
-        node_id = NextNodeCategorical(fvalue, tree.CategoryList(node_id),
-            tree.LeftChild(node_id), tree.RightChild(node_id));
+        node_id = tree.CategorySplitSet(node_id).Contains(fvalue) ? tree.LeftChild(node_id) : tree.RightChild(node_id);
       } else {
         node_id = NextNodeNumeric(fvalue, tree.Threshold(node_id), tree.LeftChild(node_id), tree.RightChild(node_id));
       }
@@ -788,8 +830,7 @@ inline int EvaluateTree(Tree const& tree, Eigen::Map<Eigen::Matrix<double, Eigen
       node_id = tree.DefaultChild(node_id);
     } else {
       if (tree.NodeType(node_id) == StochTree::TreeNodeType::kCategoricalSplitNode) {
-        node_id = NextNodeCategorical(fvalue, tree.CategoryList(node_id),
-            tree.LeftChild(node_id), tree.RightChild(node_id));
+        node_id = tree.CategorySplitSet(node_id).Contains(fvalue) ? tree.LeftChild(node_id) : tree.RightChild(node_id);
       } else {
         node_id = NextNodeNumeric(fvalue, tree.Threshold(node_id), tree.LeftChild(node_id), tree.RightChild(node_id));
       }
@@ -798,13 +839,33 @@ inline int EvaluateTree(Tree const& tree, Eigen::Map<Eigen::Matrix<double, Eigen
   return node_id;
 }
 
+/*! \brief Determine the node at which a tree places a given observation, without allocating memory
+ *  \param tree Tree object used for prediction
+ *  \param row Pointer to the covariates of the observation, stored contiguously
+ */
+inline int EvaluateTree(Tree const& tree, double const* row) {
+  int node_id = 0;
+  while (!tree.IsLeaf(node_id)) {
+    double const fvalue = row[tree.SplitIndex(node_id)];
+    if (std::isnan(fvalue)) {
+      node_id = tree.DefaultChild(node_id);
+    } else if (tree.NodeType(node_id) == StochTree::TreeNodeType::kCategoricalSplitNode) {
+      node_id = tree.CategorySplitSet(node_id).Contains(fvalue) ? tree.LeftChild(node_id) : tree.RightChild(node_id);
+    } else {
+      node_id = NextNodeNumeric(fvalue, tree.Threshold(node_id), tree.LeftChild(node_id), tree.RightChild(node_id));
+    }
+  }
+  return node_id;
+}
+
 /*! \brief Determine whether a given observation is "true" at a split proposed by split_index and split_value
  *  \param covariates Dataset used for prediction
  *  \param row Row indexing the prediction observation
  *  \param split_index Column of new split
  *  \param split_value Value defining the split
  */
-inline bool RowSplitLeft(Eigen::MatrixXd& covariates, int row, int split_index, double split_value) {
+template <typename CovariateMatrix>
+inline bool RowSplitLeft(CovariateMatrix& covariates, int row, int split_index, double split_value) {
   double const fvalue = covariates(row, split_index);
   return SplitTrueNumeric(fvalue, split_value);
 }
@@ -815,11 +876,23 @@ inline bool RowSplitLeft(Eigen::MatrixXd& covariates, int row, int split_index,
  *  \param split_index Column of new split
  *  \param category_list Categories defining the split
  */
-inline bool RowSplitLeft(Eigen::MatrixXd& covariates, int row, int split_index, std::vector<std::uint32_t> const& category_list) {
+template <typename CovariateMatrix>
+inline bool RowSplitLeft(CovariateMatrix& covariates, int row, int split_index, std::vector<std::uint32_t> const& category_list) {
   double const fvalue = covariates(row, split_index);
   return SplitTrueCategorical(fvalue, category_list);
 }
 
+/*! \brief Determine whether a given observation is "true" at a categorical split, without allocating memory
+ *  \param covariates Dataset used for prediction
+ *  \param row Row indexing the prediction observation
+ *  \param split_index Column of new split
+ *  \param category_set Encoded set of the categories defining the split
+ */
+template <typename CovariateMatrix>
+inline bool RowSplitLeft(CovariateMatrix& covariates, int row, int split_index, CategorySetView const& category_set) {
+  return category_set.Contains(static_cast<double>(covariates(row, split_index)));
+}
+
 class TreeSplit {
  public:
   TreeSplit() {}
@@ -831,6 +904,7 @@ class TreeSplit {
   TreeSplit(std::vector<std::uint32_t>& split_categories) {
     numeric_ = false;
     split_categories_ = split_categories;
+    EncodeCategorySet(split_categories_, split_category_set_);
     split_set_ = true;
   }
   ~TreeSplit() {}
@@ -838,15 +912,20 @@ class TreeSplit {
   bool NumericSplit() {return numeric_;}
   bool SplitTrue(double fvalue) {
     if (numeric_) return SplitTrueNumeric(fvalue, split_value_);
-    else return SplitTrueCategorical(fvalue, split_categories_);
+    else return CategorySplitSet().Contains(fvalue);
   }
   double SplitValue() {return split_value_;}
   std::vector<std::uint32_t> SplitCategories() {return split_categories_;}
+  /*! \brief Packed set of the split categories, valid for as long as this split is alive and unmodified */
+  CategorySetView CategorySplitSet() const {
+    return CategorySetView(split_category_set_.data(), split_category_set_.data() + split_category_set_.size());
+  }
  private:
   bool split_set_{false};
   bool numeric_;
   double split_value_;
   std::vector<std::uint32_t> split_categories_;
+  std::vector<std::uint64_t> split_category_set_;
 };
 
 } // namespace StochTree
@@ -39,8 +39,21 @@ static inline void VarSplitRange(ForestTracker& tracker, ForestDataset& dataset,
   }
 }
 
+/*! \brief Smallest and largest bin codes of feature `feature_split` among the observations in leaf `leaf_split` */
+static inline void VarSplitBinRange(ForestTracker& tracker, BinnedColumnMatrix& binned_covariates, int tree_num, int leaf_split, int feature_split, int& bin_min, int& bin_max) {
+  bin_min = std::numeric_limits<int>::max();
+  bin_max = std::numeric_limits<int>::min();
+  auto node_begin_iter = tracker.UnsortedNodeBeginIterator(tree_num, leaf_split);
+  auto node_end_iter = tracker.UnsortedNodeEndIterator(tree_num, leaf_split);
+  for (auto i = node_begin_iter; i != node_end_iter; i++) {
+    int bin = binned_covariates.BinCode(*i, feature_split);
+    bin_min = std::min(bin_min, bin);
+    bin_max = std::max(bin_max, bin);
+  }
+}
+
 static inline bool NodesNonConstantAfterSplit(ForestDataset& dataset, ForestTracker& tracker, TreeSplit& split, int tree_num, int leaf_split, int feature_split) {
-  int p = dataset.GetCovariates().cols();
+  int p = dataset.NumCovariates();
   data_size_t idx;
   double feature_value;
   double split_feature_value;
@@ -83,7 +96,7 @@ static inline bool NodesNonConstantAfterSplit(ForestDataset& dataset, ForestTrac
 }
 
 static inline bool NodeNonConstant(ForestDataset& dataset, ForestTracker& tracker, int tree_num, int node_id) {
-  int p = dataset.GetCovariates().cols();
+  int p = dataset.NumCovariates();
   data_size_t idx;
   double feature_value;
   double var_max;
@@ -124,7 +137,7 @@ static inline void AddSplitToModel(ForestTracker& tracker, ForestDataset& datase
   int right_node = tree->RightChild(leaf_node);
 
   // Update the ForestTracker
-  tracker.AddSplit(dataset.GetCovariates(), split, feature_split, tree_num, leaf_node, left_node, right_node, keep_sorted);
+  tracker.AddSplit(dataset, split, feature_split, tree_num, leaf_node, left_node, right_node, keep_sorted);
 }
 
 static inline void RemoveSplitFromModel(ForestTracker& tracker, ForestDataset& dataset, TreePrior& tree_prior, std::mt19937& gen, Tree* tree, int tree_num, int leaf_node, int left_node, int right_node, bool keep_sorted = false) {
@@ -138,7 +151,7 @@ static inline void RemoveSplitFromModel(ForestTracker& tracker, ForestDataset& d
   }
 
   // Update the ForestTracker
-  tracker.RemoveSplit(dataset.GetCovariates(), tree, tree_num, leaf_node, left_node, right_node, keep_sorted);
+  tracker.RemoveSplit(dataset, tree, tree_num, leaf_node, left_node, right_node, keep_sorted);
 }
 
 static inline double ComputeMeanOutcome(ColumnVector& residual) {
@@ -151,17 +164,19 @@ static inline double ComputeMeanOutcome(ColumnVector& residual) {
 }
 
 static inline void UpdateResidualEntireForest(ForestTracker& tracker, ForestDataset& dataset, ColumnVector& residual, TreeEnsemble* forest, bool requires_basis, std::function<double(double, double)> op) {
-  data_size_t n = dataset.GetCovariates().rows();
+  data_size_t n = dataset.NumObservations();
   double tree_pred = 0.;
   double pred_value = 0.;
   double new_resid = 0.;
   int32_t leaf_pred;
   for (data_size_t i = 0; i < n; i++) {
+    pred_value = 0.;
     for (int j = 0; j < forest->NumTrees(); j++) {
+      tree_pred = 0.;
       Tree* tree = forest->GetTree(j);
       leaf_pred = tracker.GetNodeId(i, j);
       if (requires_basis) {
-        tree_pred += tree->PredictFromNode(leaf_pred, dataset.GetBasis(), i);
+        dataset.VisitBasis([&](auto& basis) {tree_pred += tree->PredictFromNode(leaf_pred, basis, i);});
       } else {
         tree_pred += tree->PredictFromNode(leaf_pred);
       }
@@ -176,29 +191,38 @@ static inline void UpdateResidualEntireForest(ForestTracker& tracker, ForestData
 }
 
 static inline void UpdateResidualTree(ForestTracker& tracker, ForestDataset& dataset, ColumnVector& residual, Tree* tree, int tree_num, bool requires_basis, std::function<double(double, double)> op, bool tree_new) {
-  data_size_t n = dataset.GetCovariates().rows();
+  data_size_t n = dataset.NumObservations();
   double pred_value;
-  int32_t leaf_pred;
   double new_resid;
-  for (data_size_t i = 0; i < n; i++) {
-    if (tree_new) {
-      // If the tree has been newly sampled or adjusted, we must rerun the prediction 
-      // method and update the SamplePredMapper stored in tracker
-      leaf_pred = tracker.GetNodeId(i, tree_num);
-      if (requires_basis) {
-        pred_value = tree->PredictFromNode(leaf_pred, dataset.GetBasis(), i);
-      } else {
-        pred_value = tree->PredictFromNode(leaf_pred);
+  if (tree_new || !tracker.CachesTreePredictions()) {
+    // If the tree has been newly sampled or adjusted, we must rerun the prediction 
+    // method and update the SamplePredMapper stored in tracker, reading the tree's 
+    // (contiguous) leaf ids directly from the SampleNodeMapper. Trackers that do not 
+    // cache tree predictions also recompute the predictions of an unmodified tree, 
+    // which are zero if the tree has not yet been subtracted from the residual.
+    if (!tree_new && !tracker.HasTreeSamplePredictions(tree_num)) return;
+    tracker.GetSampleNodeMapper()->VisitTreeNodeIds(tree_num, [&](auto* leaf_ids) {
+      for (data_size_t i = 0; i < n; i++) {
+        if (requires_basis) {
+          dataset.VisitBasis([&](auto& basis) {pred_value = tree->PredictFromNode(leaf_ids[i], basis, i);});
+        } else {
+          pred_value = tree->PredictFromNode(leaf_ids[i]);
+        }
+        tracker.SetTreeSamplePrediction(i, tree_num, pred_value);
+        // Run op (either plus or minus) on the residual and the new prediction
+        new_resid = op(residual.GetElement(i), pred_value);
+        residual.SetElement(i, new_resid);
       }
-      tracker.SetTreeSamplePrediction(i, tree_num, pred_value);
-    } else {
+    });
+  } else {
+    for (data_size_t i = 0; i < n; i++) {
       // If the tree has not yet been modified via a sampling step, 
       // we can query its prediction directly from the SamplePredMapper stored in tracker
       pred_value = tracker.GetTreeSamplePrediction(i, tree_num);
+      // Run op (either plus or minus) on the residual and the new prediction
+      new_resid = op(residual.GetElement(i), pred_value);
+      residual.SetElement(i, new_resid);
     }
-    // Run op (either plus or minus) on the residual and the new prediction
-    new_resid = op(residual.GetElement(i), pred_value);
-    residual.SetElement(i, new_resid);
   }
 }
 
@@ -252,7 +276,13 @@ class MCMCForestSampler {
       // Subtract tree i's predictions back out of the residual
       tree = ensemble->GetTree(i);
       UpdateResidualTree(tracker, dataset, residual, tree, i, leaf_model.RequiresBasis(), minus_op_, true);
+      
+      // Update tree i's contribution to the tracked test set predictions
+      if (tracker.HasTestSet()) tracker.UpdateTestSetTree(*tree, i, leaf_model.RequiresBasis());
     }
+
+    // Record test set predictions from the leaf nodes tracked during sampling
+    if (tracker.HasTestSet()) tracker.RecordTestSetPrediction(*ensemble);
   }
  
  private:
@@ -311,7 +341,7 @@ class MCMCForestSampler {
                        TreePrior& tree_prior, std::mt19937& gen, int tree_num, std::vector<double>& variable_weights, 
                        double global_variance, double prob_grow_old) {
     // Extract dataset information
-    data_size_t n = dataset.GetCovariates().rows();
+    data_size_t n = dataset.NumObservations();
 
     // Choose a leaf node at random
     int num_leaves = tree->NumLeaves();
@@ -323,7 +353,7 @@ class MCMCForestSampler {
     int leaf_depth = tree->GetDepth(leaf_chosen);
 
     // Select a split variable at random
-    int p = dataset.GetCovariates().cols();
+    int p = dataset.NumCovariates();
     CHECK_EQ(variable_weights.size(), p);
     // std::vector<double> var_weights(p);
     // std::fill(var_weights.begin(), var_weights.end(), 1.0/p);
@@ -332,15 +362,28 @@ class MCMCForestSampler {
 
     // Determine the range of possible cutpoints
     // TODO: specialize this for binary / ordered categorical / unordered categorical variables
-    double var_min, var_max;
-    VarSplitRange(tracker, dataset, tree_num, leaf_chosen, var_chosen, var_min, var_max);
-    if (var_max <= var_min) {
-      return;
+    double split_point_chosen;
+    if (dataset.HasBinnedCovariates()) {
+      // Propose the upper bound of one of the bins spanned by the node, except the last
+      BinnedColumnMatrix& binned_covariates = dataset.GetBinnedCovariates();
+      int bin_min, bin_max;
+      VarSplitBinRange(tracker, binned_covariates, tree_num, leaf_chosen, var_chosen, bin_min, bin_max);
+      if (bin_max <= bin_min) {
+        return;
+      }
+      std::uniform_int_distribution<int> split_bin_dist(bin_min, bin_max - 1);
+      split_point_chosen = binned_covariates.UpperBound(var_chosen, split_bin_dist(gen));
+    } else {
+      double var_min, var_max;
+      VarSplitRange(tracker, dataset, tree_num, leaf_chosen, var_chosen, var_min, var_max);
+      if (var_max <= var_min) {
+        return;
+      }
+      
+      // Split based on var_min to var_max in a given node
+      std::uniform_real_distribution<double> split_point_dist(var_min, var_max);
+      split_point_chosen = split_point_dist(gen);
     }
-    
-    // Split based on var_min to var_max in a given node
-    std::uniform_real_distribution<double> split_point_dist(var_min, var_max);
-    double split_point_chosen = split_point_dist(gen);
 
     // Create a split object
     TreeSplit split = TreeSplit(split_point_chosen);
@@ -517,7 +560,7 @@ class GFRForestSampler {
       
       // Reset the tree and sample trackers
       ensemble->ResetInitTree(i);
-      tracker.ResetRoot(dataset.GetCovariates(), feature_types, i);
+      tracker.ResetRoot(dataset, feature_types, i);
       tree = ensemble->GetTree(i);
       
       // Sample tree i
@@ -529,7 +572,13 @@ class GFRForestSampler {
       
       // Subtract tree i's predictions back out of the residual
       UpdateResidualTree(tracker, dataset, residual, tree, i, leaf_model.RequiresBasis(), minus_op_, true);
+      
+      // Update tree i's contribution to the tracked test set predictions
+      if (tracker.HasTestSet()) tracker.UpdateTestSetTree(*tree, i, leaf_model.RequiresBasis());
     }
+
+    // Record test set predictions from the leaf nodes tracked during sampling
+    if (tracker.HasTestSet()) tracker.RecordTestSetPrediction(*ensemble);
   }
 
  private:
@@ -547,7 +596,7 @@ class GFRForestSampler {
     int curr_node_id;
     data_size_t curr_node_begin;
     data_size_t curr_node_end;
-    data_size_t n = dataset.GetCovariates().rows();
+    data_size_t n = dataset.NumObservations();
     // Mapping from node id to start and end points of sorted indices
     std::unordered_map<int, std::pair<data_size_t, data_size_t>> node_index_map;
     node_index_map.insert({root_id, std::make_pair(0, n)});
@@ -580,7 +629,7 @@ class GFRForestSampler {
     std::vector<double> cutpoint_values;
     std::vector<FeatureType> cutpoint_feature_types;
     StochTree::data_size_t valid_cutpoint_count;
-    CutpointGridContainer cutpoint_grid_container(dataset.GetCovariates(), residual.GetData(), cutpoint_grid_size);
+    CutpointGridContainer cutpoint_grid_container(dataset, residual.GetData(), cutpoint_grid_size);
     EvaluateCutpoints(tree, tracker, leaf_model, dataset, residual, tree_prior, gen, tree_num, global_variance,
                       cutpoint_grid_size, node_id, node_begin, node_end, log_cutpoint_evaluations, cutpoint_features, 
                       cutpoint_values, cutpoint_feature_types, valid_cutpoint_count, variable_weights, feature_types, 
@@ -645,11 +694,7 @@ class GFRForestSampler {
       // Determine the number of observation in the newly created left node
       int left_node = tree->LeftChild(node_id);
       int right_node = tree->RightChild(node_id);
-      auto left_begin_iter = tracker.SortedNodeBeginIterator(left_node, feature_split);
-      auto left_end_iter = tracker.SortedNodeEndIterator(left_node, feature_split);
-      for (auto i = left_begin_iter; i < left_end_iter; i++) {
-        left_n += 1;
-      }
+      left_n = tracker.SortedNodeSize(left_node, feature_split);
 
       // Add the begin and end indices for the new left and right nodes to node_index_map
       node_index_map.insert({left_node, std::make_pair(node_begin, node_begin + left_n)});
@@ -1,9 +1,32 @@
 #include <cpp11.hpp>
+#include <stochtree/arrow_dataset.h>
+#include <stochtree/category_encoder.h>
 #include <stochtree/container.h>
 #include <stochtree/data.h>
+#include <algorithm>
 #include <memory>
 #include <vector>
 
+/*! 
+ * \brief Column-major elements of an integer or logical R matrix, which are converted in place unless the matrix has 
+ *        missing values, in which case `NA` is converted to NaN in a double precision copy (stored in `converted`)
+ */
+static int const* IntegerMatrixData(SEXP matrix, std::vector<double>& converted) {
+    if (TYPEOF(matrix) != INTSXP && TYPEOF(matrix) != LGLSXP) {
+        cpp11::stop("Expected an integer or logical matrix");
+    }
+    int const* data_ptr = (TYPEOF(matrix) == INTSXP) ? INTEGER(matrix) : LOGICAL(matrix);
+    R_xlen_t n = Rf_xlength(matrix);
+    if (std::find(data_ptr, data_ptr + n, NA_INTEGER) != data_ptr + n) {
+        converted.resize(n);
+        for (R_xlen_t i = 0; i < n; i++) {
+            converted[i] = (data_ptr[i] == NA_INTEGER) ? NA_REAL : static_cast<double>(data_ptr[i]);
+        }
+        return nullptr;
+    }
+    return data_ptr;
+}
+
 [[cpp11::register]]
 cpp11::external_pointer<StochTree::ForestDataset> create_forest_dataset_cpp() {
     // Create smart pointer to newly allocated object
@@ -39,7 +62,7 @@ bool dataset_has_variance_weights_cpp(cpp11::external_pointer<StochTree::ForestD
 }
 
 [[cpp11::register]]
-void forest_dataset_add_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> covariates) {
+void forest_dataset_add_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> covariates, bool borrow) {
     // TODO: add handling code on the R side to ensure matrices are column-major
     bool row_major{false};
 
@@ -47,14 +70,55 @@ void forest_dataset_add_covariates_cpp(cpp11::external_pointer<StochTree::Forest
     StochTree::data_size_t n = covariates.nrow();
     int num_covariates = covariates.ncol();
     double* covariate_data_ptr = REAL(PROTECT(covariates));
-    dataset_ptr->AddCovariates(covariate_data_ptr, n, num_covariates, row_major);
+    // A borrowed matrix is read in place, so the R object must be kept alive by the caller
+    dataset_ptr->AddCovariates(covariate_data_ptr, n, num_covariates, row_major, borrow);
     
     // Unprotect pointers to R data
     UNPROTECT(1);
 }
 
 [[cpp11::register]]
-void forest_dataset_add_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> basis) {
+void forest_dataset_add_integer_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, SEXP covariates) {
+    // Integer and logical matrices are converted to double in a single pass, without an intermediate double matrix in R
+    StochTree::data_size_t n = Rf_nrows(covariates);
+    int num_covariates = Rf_ncols(covariates);
+    std::vector<double> converted;
+    int const* data_ptr = IntegerMatrixData(covariates, converted);
+    if (data_ptr != nullptr) {
+        dataset_ptr->AddCovariatesStrided(data_ptr, n, num_covariates, 1, n);
+    } else {
+        dataset_ptr->AddCovariates(converted.data(), n, num_covariates, false);
+    }
+}
+
+[[cpp11::register]]
+void forest_dataset_add_sparse_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::integers col_ptr, cpp11::integers row_index, cpp11::doubles values, int num_row, int num_col) {
+    // Slots `p`, `i` and `x` of a dgCMatrix hold the (0-based) compressed sparse column representation
+    dataset_ptr->AddSparseCovariates(INTEGER(col_ptr), INTEGER(row_index), REAL(values), num_row, num_col);
+}
+
+[[cpp11::register]]
+cpp11::writable::integers forest_dataset_add_arrow_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, SEXP schema_xptr, SEXP array_xptr, bool single_precision, int num_threads) {
+    // External pointers to the `ArrowSchema` and (exported) `ArrowArray` structs of a nanoarrow record batch; the importer moves the array out
+    ArrowSchema* schema = static_cast<ArrowSchema*>(R_ExternalPtrAddr(schema_xptr));
+    ArrowArray* array = static_cast<ArrowArray*>(R_ExternalPtrAddr(array_xptr));
+    if (schema == nullptr || array == nullptr) {
+        cpp11::stop("Expected external pointers to an Arrow schema and array");
+    }
+    StochTree::ArrowDatasetConfig config;
+    config.single_precision = single_precision;
+    config.num_threads = num_threads;
+    StochTree::ArrowDatasetImporter importer(config);
+    importer.Import(array, schema, *dataset_ptr);
+    cpp11::writable::integers output(importer.FeatureTypes().size());
+    for (size_t j = 0; j < importer.FeatureTypes().size(); j++) {
+        output[j] = static_cast<int>(importer.FeatureTypes()[j]);
+    }
+    return output;
+}
+
+[[cpp11::register]]
+void forest_dataset_add_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> basis, bool borrow) {
     // TODO: add handling code on the R side to ensure matrices are column-major
     bool row_major{false};
 
@@ -62,12 +126,26 @@ void forest_dataset_add_basis_cpp(cpp11::external_pointer<StochTree::ForestDatas
     StochTree::data_size_t n = basis.nrow();
     int num_basis = basis.ncol();
     double* basis_data_ptr = REAL(PROTECT(basis));
-    dataset_ptr->AddBasis(basis_data_ptr, n, num_basis, row_major);
+    dataset_ptr->AddBasis(basis_data_ptr, n, num_basis, row_major, borrow);
     
     // Unprotect pointers to R data
     UNPROTECT(1);
 }
 
+[[cpp11::register]]
+void forest_dataset_add_integer_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, SEXP basis) {
+    // Integer and logical matrices are converted to double in a single pass, without an intermediate double matrix in R
+    StochTree::data_size_t n = Rf_nrows(basis);
+    int num_basis = Rf_ncols(basis);
+    std::vector<double> converted;
+    int const* data_ptr = IntegerMatrixData(basis, converted);
+    if (data_ptr != nullptr) {
+        dataset_ptr->AddBasisStrided(data_ptr, n, num_basis, 1, n);
+    } else {
+        dataset_ptr->AddBasis(converted.data(), n, num_basis, false);
+    }
+}
+
 [[cpp11::register]]
 void forest_dataset_update_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> basis) {
     // TODO: add handling code on the R side to ensure matrices are column-major
@@ -83,6 +161,16 @@ void forest_dataset_update_basis_cpp(cpp11::external_pointer<StochTree::ForestDa
     UNPROTECT(1);
 }
 
+[[cpp11::register]]
+void forest_dataset_bin_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, int max_bins, int num_threads, bool release_covariates) {
+    dataset_ptr->BinCovariates(max_bins, num_threads, release_covariates);
+}
+
+[[cpp11::register]]
+void forest_dataset_add_row_major_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, int num_threads) {
+    dataset_ptr->AddRowMajorCovariates(num_threads);
+}
+
 [[cpp11::register]]
 void forest_dataset_add_weights_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles weights) {
     // Add weights
@@ -171,3 +259,56 @@ void rfx_dataset_add_weights_cpp(cpp11::external_pointer<StochTree::RandomEffect
     // Unprotect pointers to R data
     UNPROTECT(1);
 }
+
+/*! \brief Build a category dictionary from an R character vector of levels (kept in the order given) */
+static StochTree::CategoryDictionary StringDictionary(cpp11::strings levels) {
+    std::vector<std::string> level_vec(levels.size());
+    for (R_xlen_t k = 0; k < levels.size(); k++) {
+        level_vec[k] = std::string(levels[k]);
+    }
+    StochTree::CategoryDictionary dictionary;
+    dictionary.SetStringLevels(level_vec);
+    return dictionary;
+}
+
+/*! \brief Pointers to the elements of an R character vector, with null pointers for `NA` */
+static std::vector<char const*> StringPointers(cpp11::strings x) {
+    std::vector<char const*> pointers(x.size());
+    for (R_xlen_t i = 0; i < x.size(); i++) {
+        SEXP element = STRING_ELT(x, i);
+        pointers[i] = (element == NA_STRING) ? nullptr : CHAR(element);
+    }
+    return pointers;
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles category_codes_cpp(cpp11::strings x, cpp11::strings levels, int num_threads) {
+    StochTree::CategoryDictionary dictionary = StringDictionary(levels);
+    std::vector<char const*> values = StringPointers(x);
+    cpp11::writable::doubles output(x.size());
+    dictionary.EncodeStrings(values.data(), values.size(), REAL(output), 1, num_threads);
+    return output;
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles_matrix<> category_one_hot_cpp(cpp11::strings x, cpp11::strings levels, int num_threads) {
+    StochTree::CategoryDictionary dictionary = StringDictionary(levels);
+    std::vector<char const*> values = StringPointers(x);
+    std::vector<double> codes(values.size());
+    dictionary.EncodeStrings(values.data(), values.size(), codes.data(), 1, num_threads);
+    cpp11::writable::doubles_matrix<> output(values.size(), dictionary.NumLevels() + 1);
+    dictionary.OneHot(codes.data(), values.size(), REAL(output), num_threads);
+    return output;
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles category_integer_levels_cpp(cpp11::doubles x, int num_threads) {
+    StochTree::CategoryDictionary dictionary;
+    dictionary.FitIntegers(REAL(x), x.size(), num_threads);
+    std::vector<std::int64_t>& levels = dictionary.IntegerLevels();
+    cpp11::writable::doubles output(levels.size());
+    for (size_t k = 0; k < levels.size(); k++) {
+        output[k] = static_cast<double>(levels[k]);
+    }
+    return output;
+}
@@ -0,0 +1,349 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/arrow_dataset.h>
+#include <stochtree/log.h>
+#include <stochtree/parallel.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace StochTree {
+
+namespace {
+
+/*! \brief Number of rows of every column converted by each parallel task */
+constexpr int64_t kArrowRowsPerBlock = 65536;
+
+/*! \brief Physical type of the values of an Arrow column (or of the indices of a dictionary-encoded column) */
+enum class ArrowValueType {kBool, kInt8, kUInt8, kInt16, kUInt16, kInt32, kUInt32, kInt64, kUInt64, kFloat, kDouble};
+
+/*! \brief Column of a record batch */
+struct ArrowColumn {
+  ArrowArray const* array;
+  ArrowSchema const* schema;
+  ArrowValueType type;
+  /*! \brief Index of the first row of the record batch in the buffers of `array` */
+  int64_t offset;
+  std::string name;
+};
+
+/*! \brief Type of the values of an Arrow array with format string `format` */
+ArrowValueType ParseFormat(const char* format, std::string const& column_name) {
+  std::string format_string = (format == nullptr) ? "" : format;
+  if (format_string == "b") return ArrowValueType::kBool;
+  if (format_string == "c") return ArrowValueType::kInt8;
+  if (format_string == "C") return ArrowValueType::kUInt8;
+  if (format_string == "s") return ArrowValueType::kInt16;
+  if (format_string == "S") return ArrowValueType::kUInt16;
+  if (format_string == "i") return ArrowValueType::kInt32;
+  if (format_string == "I") return ArrowValueType::kUInt32;
+  if (format_string == "l") return ArrowValueType::kInt64;
+  if (format_string == "L") return ArrowValueType::kUInt64;
+  if (format_string == "f") return ArrowValueType::kFloat;
+  if (format_string == "g") return ArrowValueType::kDouble;
+  Log::Fatal("Column %s has Arrow format \"%s\", which is not supported", column_name.c_str(), format_string.c_str());
+  return ArrowValueType::kDouble;
+}
+
+/*! \brief Whether `column` may contain nulls (a null count of -1 means that it is unknown) */
+inline bool HasNulls(ArrowColumn const& column) {
+  return column.array->null_count != 0 && column.array->buffers[0] != nullptr;
+}
+
+/*! \brief Whether bit `index` of an Arrow bitmap is set */
+inline bool BitIsSet(std::uint8_t const* bitmap, int64_t index) {
+  return (bitmap[index >> 3] >> (index & 7)) & 1;
+}
+
+/*! \brief Convert rows `[row_begin, row_end)` of `column`, whose values are of type `Source`, into `output[row_begin, row_end)` */
+template <typename Source, typename Output>
+void ConvertRows(ArrowColumn const& column, int64_t row_begin, int64_t row_end, Output* output) {
+  Source const* data = static_cast<Source const*>(column.array->buffers[1]) + column.offset;
+  if (HasNulls(column)) {
+    std::uint8_t const* validity = static_cast<std::uint8_t const*>(column.array->buffers[0]);
+    for (int64_t i = row_begin; i < row_end; i++) {
+      output[i] = BitIsSet(validity, column.offset + i) ? static_cast<Output>(data[i]) : std::numeric_limits<Output>::quiet_NaN();
+    }
+  } else {
+    for (int64_t i = row_begin; i < row_end; i++) {
+      output[i] = static_cast<Output>(data[i]);
+    }
+  }
+}
+
+/*! \brief Convert rows `[row_begin, row_end)` of a boolean (bit-packed) column into `output[row_begin, row_end)` */
+template <typename Output>
+void ConvertBoolRows(ArrowColumn const& column, int64_t row_begin, int64_t row_end, Output* output) {
+  std::uint8_t const* data = static_cast<std::uint8_t const*>(column.array->buffers[1]);
+  std::uint8_t const* validity = HasNulls(column) ? static_cast<std::uint8_t const*>(column.array->buffers[0]) : nullptr;
+  for (int64_t i = row_begin; i < row_end; i++) {
+    if (validity != nullptr && !BitIsSet(validity, column.offset + i)) {
+      output[i] = std::numeric_limits<Output>::quiet_NaN();
+    } else {
+      output[i] = BitIsSet(data, column.offset + i) ? 1 : 0;
+    }
+  }
+}
+
+/*! \brief Convert rows `[row_begin, row_end)` of `column` into `output[row_begin, row_end)`, with nulls converted to NaN */
+template <typename Output>
+void ConvertColumnRows(ArrowColumn const& column, int64_t row_begin, int64_t row_end, Output* output) {
+  switch (column.type) {
+    case ArrowValueType::kBool: ConvertBoolRows(column, row_begin, row_end, output); break;
+    case ArrowValueType::kInt8: ConvertRows<std::int8_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kUInt8: ConvertRows<std::uint8_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kInt16: ConvertRows<std::int16_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kUInt16: ConvertRows<std::uint16_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kInt32: ConvertRows<std::int32_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kUInt32: ConvertRows<std::uint32_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kInt64: ConvertRows<std::int64_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kUInt64: ConvertRows<std::uint64_t>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kFloat: ConvertRows<float>(column, row_begin, row_end, output); break;
+    case ArrowValueType::kDouble: ConvertRows<double>(column, row_begin, row_end, output); break;
+  }
+}
+
+/*!
+ * \brief If `columns` all hold values of type `Scalar` (of Arrow type `type`) without nulls, and their buffers are laid out as
+ *        consecutive columns of one column-major matrix, return a pointer to the first value of that matrix, otherwise null
+ */
+template <typename Scalar>
+Scalar* ContiguousColumns(std::vector<ArrowColumn const*> const& columns, data_size_t num_rows, ArrowValueType type) {
+  if (columns.empty()) return nullptr;
+  Scalar const* first = nullptr;
+  for (std::size_t k = 0; k < columns.size(); k++) {
+    ArrowColumn const& column = *columns[k];
+    if (column.type != type || column.schema->dictionary != nullptr || HasNulls(column)) return nullptr;
+    Scalar const* data = static_cast<Scalar const*>(column.array->buffers[1]) + column.offset;
+    if (k == 0) {
+      first = data;
+    } else if (data != first + k * static_cast<std::size_t>(num_rows)) {
+      return nullptr;
+    }
+  }
+  // Borrowed buffers are never written to
+  return const_cast<Scalar*>(first);
+}
+
+/*! \brief Values of the dictionary of a dictionary-encoded column, as strings */
+std::vector<std::string> DictionaryLabels(ArrowColumn const& column) {
+  ArrowArray const* dictionary = column.array->dictionary;
+  ArrowSchema const* dictionary_schema = column.schema->dictionary;
+  if (dictionary == nullptr) {
+    Log::Fatal("Dictionary-encoded column %s has no dictionary", column.name.c_str());
+  }
+  std::string format = (dictionary_schema->format == nullptr) ? "" : dictionary_schema->format;
+  int64_t num_labels = dictionary->length;
+  std::vector<std::string> labels(num_labels);
+  std::uint8_t const* validity = (dictionary->null_count != 0) ? static_cast<std::uint8_t const*>(dictionary->buffers[0]) : nullptr;
+  if (format == "u" || format == "U") {
+    // Strings, with 32-bit ("u") or 64-bit ("U") offsets into the character buffer
+    char const* characters = static_cast<char const*>(dictionary->buffers[2]);
+    for (int64_t k = 0; k < num_labels; k++) {
+      int64_t index = dictionary->offset + k;
+      if (validity != nullptr && !BitIsSet(validity, index)) continue;
+      int64_t begin, end;
+      if (format == "u") {
+        begin = static_cast<std::int32_t const*>(dictionary->buffers[1])[index];
+        end = static_cast<std::int32_t const*>(dictionary->buffers[1])[index + 1];
+      } else {
+        begin = static_cast<std::int64_t const*>(dictionary->buffers[1])[index];
+        end = static_cast<std::int64_t const*>(dictionary->buffers[1])[index + 1];
+      }
+      labels[k].assign(characters + begin, characters + end);
+    }
+  } else {
+    // Numbers, printed as integers when they are integers
+    ArrowColumn values{dictionary, dictionary_schema, ParseFormat(dictionary_schema->format, column.name), dictionary->offset, column.name};
+    std::vector<double> converted(num_labels);
+    ConvertColumnRows(values, 0, num_labels, converted.data());
+    char buffer[32];
+    for (int64_t k = 0; k < num_labels; k++) {
+      if (std::isnan(converted[k])) continue;
+      if (std::floor(converted[k]) == converted[k] && std::abs(converted[k]) < 9.007199254740992e15) {
+        std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(converted[k]));
+      } else {
+        std::snprintf(buffer, sizeof(buffer), "%.17g", converted[k]);
+      }
+      labels[k] = buffer;
+    }
+  }
+  return labels;
+}
+
+} // namespace
+
+void ArrowDatasetImporter::Import(struct ArrowArray* array, struct ArrowSchema const* schema, ForestDataset& dataset) {
+  CHECK_NOTNULL(array);
+  CHECK_NOTNULL(schema);
+  if (array->release == nullptr) {
+    Log::Fatal("The Arrow array has already been released");
+  }
+  // Move the array out of the caller's struct, which is marked released, and release it once it is no longer referenced
+  std::shared_ptr<ArrowArray> owned_array(new ArrowArray(*array), [](ArrowArray* owned) {
+    if (owned->release != nullptr) owned->release(owned);
+    delete owned;
+  });
+  array->release = nullptr;
+  feature_types_.clear();
+  outcome_.clear();
+  covariate_names_.clear();
+  category_labels_.clear();
+
+  // Validate the record batch and its columns
+  if (schema->format == nullptr || std::strcmp(schema->format, "+s") != 0) {
+    Log::Fatal("An Arrow record batch must be a struct array (format \"+s\")");
+  }
+  if (owned_array->n_children != schema->n_children) {
+    Log::Fatal("The Arrow array has %lld columns but its schema has %lld", static_cast<long long>(owned_array->n_children),
+               static_cast<long long>(schema->n_children));
+  }
+  if (owned_array->null_count != 0 && owned_array->n_buffers > 0 && owned_array->buffers[0] != nullptr) {
+    Log::Fatal("Arrow record batches with null rows are not supported");
+  }
+  if (owned_array->length > std::numeric_limits<data_size_t>::max()) {
+    Log::Fatal("The Arrow record batch has too many rows");
+  }
+  data_size_t num_rows = static_cast<data_size_t>(owned_array->length);
+  int num_columns = static_cast<int>(owned_array->n_children);
+  std::vector<ArrowColumn> columns(num_columns);
+  for (int j = 0; j < num_columns; j++) {
+    ArrowArray const* child = owned_array->children[j];
+    ArrowSchema const* child_schema = schema->children[j];
+    std::string name = (child_schema->name == nullptr) ? std::to_string(j) : child_schema->name;
+    int64_t offset = owned_array->offset + child->offset;
+    if (child->length < owned_array->offset + owned_array->length || child->n_buffers < 2) {
+      Log::Fatal("Column %s of the Arrow record batch is truncated or corrupt", name.c_str());
+    }
+    columns[j] = ArrowColumn{child, child_schema, ParseFormat(child_schema->format, name), offset, name};
+    if (child_schema->dictionary != nullptr && (columns[j].type == ArrowValueType::kBool ||
+        columns[j].type == ArrowValueType::kFloat || columns[j].type == ArrowValueType::kDouble)) {
+      Log::Fatal("Column %s of the Arrow record batch has dictionary indices that are not integers", name.c_str());
+    }
+  }
+
+  // Resolve the role of each column
+  enum ColumnRole {kSkip, kCovariate, kBasis, kOutcome, kWeight};
+  std::vector<ColumnRole> roles(num_columns, kSkip);
+  auto assign_role = [&](int column, ColumnRole role) {
+    if (column < 0 || column >= num_columns) {
+      Log::Fatal("Column %d is out of range for an Arrow record batch with %d columns", column, num_columns);
+    }
+    if (roles[column] != kSkip) {
+      Log::Fatal("Column %d of the Arrow record batch is assigned to more than one role", column);
+    }
+    if (role != kCovariate && columns[column].schema->dictionary != nullptr) {
+      Log::Fatal("Dictionary-encoded column %s can only be a covariate", columns[column].name.c_str());
+    }
+    roles[column] = role;
+  };
+  if (config_.outcome_column >= 0) assign_role(config_.outcome_column, kOutcome);
+  if (config_.weight_column >= 0) assign_role(config_.weight_column, kWeight);
+  std::vector<ArrowColumn const*> basis_columns;
+  for (int column : config_.basis_columns) {
+    assign_role(column, kBasis);
+    basis_columns.push_back(&columns[column]);
+  }
+  std::vector<int> covariate_indices = config_.covariate_columns;
+  if (covariate_indices.empty()) {
+    for (int j = 0; j < num_columns; j++) {
+      if (roles[j] == kSkip) covariate_indices.push_back(j);
+    }
+  }
+  std::vector<ArrowColumn const*> covariate_columns;
+  for (int column : covariate_indices) {
+    assign_role(column, kCovariate);
+    covariate_columns.push_back(&columns[column]);
+  }
+  int num_covariates = static_cast<int>(covariate_columns.size());
+  int num_basis = static_cast<int>(basis_columns.size());
+
+  // Feature types, names and category labels of the covariates
+  category_labels_.resize(num_covariates);
+  for (int k = 0; k < num_covariates; k++) {
+    ArrowColumn const& column = *covariate_columns[k];
+    covariate_names_.push_back(column.name);
+    if (column.schema->dictionary != nullptr) {
+      bool ordered = (column.schema->flags & ARROW_FLAG_DICTIONARY_ORDERED) != 0;
+      feature_types_.push_back(ordered ? FeatureType::kOrderedCategorical : FeatureType::kUnorderedCategorical);
+      category_labels_[k] = DictionaryLabels(column);
+    } else if (column.type == ArrowValueType::kBool) {
+      feature_types_.push_back(FeatureType::kOrderedCategorical);
+    } else {
+      feature_types_.push_back(FeatureType::kNumeric);
+    }
+  }
+
+  // Convert the rows of `selected` block by block into consecutive columns of `output`
+  auto convert = [&](std::vector<ArrowColumn const*> const& selected, auto* output) {
+    ParallelFor(0, num_rows, kArrowRowsPerBlock, config_.num_threads, [&](int64_t block_begin, int64_t block_end) {
+      for (std::size_t k = 0; k < selected.size(); k++) {
+        ConvertColumnRows(*selected[k], block_begin, block_end, output + k * static_cast<std::size_t>(num_rows));
+      }
+    });
+  };
+  std::size_t num_covariate_values = static_cast<std::size_t>(num_rows) * num_covariates;
+  std::size_t num_basis_values = static_cast<std::size_t>(num_rows) * num_basis;
+  bool borrowed = false;
+
+  // Covariates, borrowed if the buffers allow it and converted into a column-major buffer otherwise
+  if (config_.single_precision) {
+    float* borrowed_covariates = config_.borrow ? ContiguousColumns<float>(covariate_columns, num_rows, ArrowValueType::kFloat) : nullptr;
+    if (borrowed_covariates != nullptr) {
+      dataset.AddCovariates(borrowed_covariates, num_rows, num_covariates, false, true);
+      borrowed = true;
+    } else {
+      auto covariates = std::make_shared<std::vector<float>>(num_covariate_values);
+      convert(covariate_columns, covariates->data());
+      dataset.AddCovariates(covariates->data(), num_rows, num_covariates, false, true);
+      dataset.RetainStorage(covariates);
+    }
+  } else {
+    double* borrowed_covariates = config_.borrow ? ContiguousColumns<double>(covariate_columns, num_rows, ArrowValueType::kDouble) : nullptr;
+    if (borrowed_covariates != nullptr) {
+      dataset.AddCovariates(borrowed_covariates, num_rows, num_covariates, false, true);
+      borrowed = true;
+    } else {
+      auto covariates = std::make_shared<std::vector<double>>(num_covariate_values);
+      convert(covariate_columns, covariates->data());
+      dataset.AddCovariates(covariates->data(), num_rows, num_covariates, false, true);
+      dataset.RetainStorage(covariates);
+    }
+  }
+
+  // Basis, which keeps the precision of its buffers when it is borrowed
+  if (num_basis > 0) {
+    double* borrowed_basis = config_.borrow ? ContiguousColumns<double>(basis_columns, num_rows, ArrowValueType::kDouble) : nullptr;
+    float* borrowed_float_basis = config_.borrow ? ContiguousColumns<float>(basis_columns, num_rows, ArrowValueType::kFloat) : nullptr;
+    if (borrowed_basis != nullptr) {
+      dataset.AddBasis(borrowed_basis, num_rows, num_basis, false, true);
+      borrowed = true;
+    } else if (borrowed_float_basis != nullptr) {
+      dataset.AddBasis(borrowed_float_basis, num_rows, num_basis, false, true);
+      borrowed = true;
+    } else {
+      auto basis = std::make_shared<std::vector<double>>(num_basis_values);
+      convert(basis_columns, basis->data());
+      dataset.AddBasis(basis->data(), num_rows, num_basis, false, true);
+      dataset.RetainStorage(basis);
+    }
+  }
+
+  // Outcome and variance weights are always copied
+  if (config_.outcome_column >= 0) {
+    outcome_.resize(num_rows);
+    convert(std::vector<ArrowColumn const*>{&columns[config_.outcome_column]}, outcome_.data());
+  }
+  if (config_.weight_column >= 0) {
+    std::vector<double> weights(num_rows);
+    convert(std::vector<ArrowColumn const*>{&columns[config_.weight_column]}, weights.data());
+    dataset.AddVarianceWeights(weights.data(), num_rows);
+  }
+
+  // Keep the Arrow buffers alive for as long as the dataset borrows them (otherwise `owned_array` is released here)
+  if (borrowed) dataset.RetainStorage(owned_array);
+}
+
+} // namespace StochTree
@@ -0,0 +1,232 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/binary_dataset.h>
+#include <stochtree/io.h>
+#include <stochtree/log.h>
+#include <stochtree/partition_tracker.h>
+
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace StochTree {
+
+static constexpr std::uint32_t kBinaryDatasetByteOrder = 0x01020304;
+
+/*! \brief Write `num_bytes` zero bytes */
+static void WritePadding(VirtualFileWriter* writer, std::uint64_t num_bytes) {
+  std::vector<char> padding(num_bytes, 0);
+  if (num_bytes > 0 && writer->Write(padding.data(), num_bytes) != num_bytes) {
+    Log::Fatal("Failed to write binary dataset file");
+  }
+}
+
+/*! \brief Write `count` values starting at `data` */
+template <typename T>
+static void WriteValues(VirtualFileWriter* writer, T const* data, std::uint64_t count) {
+  std::uint64_t num_bytes = count * sizeof(T);
+  if (num_bytes > 0 && writer->Write(data, num_bytes) != num_bytes) {
+    Log::Fatal("Failed to write binary dataset file");
+  }
+}
+
+/*! \brief Write the columns of `matrix` one after the other, converting each value to `Scalar` */
+template <typename Scalar, typename Matrix>
+static void WriteColumns(VirtualFileWriter* writer, Matrix& matrix) {
+  std::vector<Scalar> column(matrix.rows());
+  for (int j = 0; j < matrix.cols(); j++) {
+    for (data_size_t i = 0; i < matrix.rows(); i++) {
+      column[i] = static_cast<Scalar>(matrix(i, j));
+    }
+    WriteValues(writer, column.data(), column.size());
+  }
+}
+
+/*! \brief Offset of the first `kBinaryDatasetAlignment`-aligned block after a block of `num_bytes` bytes starting at `offset` */
+static std::uint64_t NextBlockOffset(std::uint64_t offset, std::uint64_t num_bytes) {
+  return BinaryWriter::AlignedSize(offset + num_bytes, kBinaryDatasetAlignment);
+}
+
+void SaveBinaryDataset(ForestDataset& dataset, std::vector<FeatureType> const& feature_types, std::string const& filename, bool include_presort) {
+  CHECK(dataset.HasCovariates());
+  CHECK_EQ(static_cast<int>(feature_types.size()), dataset.NumCovariates());
+  if (dataset.HasReleasedCovariates()) {
+    Log::Fatal("A dataset whose covariates were released after binning cannot be saved");
+  }
+  std::uint64_t num_rows = dataset.NumObservations();
+  std::uint64_t num_covariates = dataset.NumCovariates();
+  std::uint64_t num_basis = dataset.HasBasis() ? dataset.NumBasis() : 0;
+
+  // Lay out the blocks
+  BinaryDatasetHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kBinaryDatasetMagic, sizeof(header.magic));
+  header.version = kBinaryDatasetVersion;
+  header.byte_order = kBinaryDatasetByteOrder;
+  header.num_rows = num_rows;
+  header.num_covariates = num_covariates;
+  header.num_basis = num_basis;
+  header.covariate_bytes = dataset.HasSinglePrecisionCovariates() ? sizeof(float) : sizeof(double);
+  header.basis_bytes = (num_basis == 0) ? 0 : (dataset.HasSinglePrecisionBasis() ? sizeof(float) : sizeof(double));
+  std::uint64_t offset = NextBlockOffset(0, sizeof(header));
+  header.covariate_offset = offset;
+  offset = NextBlockOffset(offset, num_rows * num_covariates * header.covariate_bytes);
+  if (num_basis > 0) {
+    header.basis_offset = offset;
+    offset = NextBlockOffset(offset, num_rows * num_basis * header.basis_bytes);
+  }
+  if (dataset.HasVarWeights()) {
+    header.var_weights_offset = offset;
+    offset = NextBlockOffset(offset, num_rows * sizeof(double));
+  }
+  header.feature_types_offset = offset;
+  offset = NextBlockOffset(offset, num_covariates * sizeof(std::int32_t));
+  if (include_presort) {
+    header.presort_offset = offset;
+  }
+
+  auto writer = VirtualFileWriter::Make(filename);
+  if (!writer->Init()) {
+    Log::Fatal("Could not open %s for writing", filename.c_str());
+  }
+  std::uint64_t written = 0;
+  auto write_block = [&](std::uint64_t block_offset, std::uint64_t num_bytes, auto&& write_fn) {
+    WritePadding(writer.get(), block_offset - written);
+    write_fn();
+    written = block_offset + num_bytes;
+  };
+  write_block(0, sizeof(header), [&]() {WriteValues(writer.get(), reinterpret_cast<char const*>(&header), sizeof(header));});
+  write_block(header.covariate_offset, num_rows * num_covariates * header.covariate_bytes, [&]() {
+    if (dataset.HasSinglePrecisionCovariates()) {
+      WriteColumns<float>(writer.get(), dataset.GetFloatCovariates());
+    } else {
+      dataset.VisitCovariates([&](auto& covariates) {WriteColumns<double>(writer.get(), covariates);});
+    }
+  });
+  if (num_basis > 0) {
+    write_block(header.basis_offset, num_rows * num_basis * header.basis_bytes, [&]() {
+      if (dataset.HasSinglePrecisionBasis()) {
+        WriteColumns<float>(writer.get(), dataset.GetFloatBasis());
+      } else {
+        WriteColumns<double>(writer.get(), dataset.GetBasis());
+      }
+    });
+  }
+  if (dataset.HasVarWeights()) {
+    write_block(header.var_weights_offset, num_rows * sizeof(double), [&]() {
+      WriteValues(writer.get(), dataset.GetVarWeights().data(), num_rows);
+    });
+  }
+  write_block(header.feature_types_offset, num_covariates * sizeof(std::int32_t), [&]() {
+    std::vector<std::int32_t> feature_type_codes(feature_types.begin(), feature_types.end());
+    WriteValues(writer.get(), feature_type_codes.data(), num_covariates);
+  });
+  if (include_presort) {
+    // Sort the raw covariates exactly as ForestTracker would, one feature at a time
+    write_block(header.presort_offset, num_rows * num_covariates * sizeof(data_size_t), [&]() {
+      dataset.VisitCovariates([&](auto& covariates) {
+        for (int j = 0; j < static_cast<int>(num_covariates); j++) {
+          FeaturePresortRoot presort(covariates, j, feature_types[j]);
+          WriteValues(writer.get(), presort.GetSortIndices().data(), num_rows);
+        }
+      });
+    });
+  }
+}
+
+/*! \brief Check that a block of `num_bytes` bytes at `offset` lies within a file of `file_size` bytes and is aligned */
+static void CheckBlock(std::uint64_t offset, std::uint64_t num_bytes, std::uint64_t file_size, std::string const& filename) {
+  if (offset % kBinaryDatasetAlignment != 0 || offset < sizeof(BinaryDatasetHeader) || offset > file_size || num_bytes > file_size - offset) {
+    Log::Fatal("Binary dataset file %s is truncated or corrupt", filename.c_str());
+  }
+}
+
+void LoadBinaryDataset(std::string const& filename, ForestDataset& dataset, std::vector<FeatureType>& feature_types) {
+  auto reader = VirtualFileReader::Make(filename);
+  if (!reader->Init()) {
+    Log::Fatal("Could not open %s for reading", filename.c_str());
+  }
+
+  // Map the file if possible, otherwise read it into an (8-byte aligned) buffer; either way, the dataset keeps the storage alive
+  std::size_t file_size = 0;
+  char const* file_data = reader->MapReadOnly(&file_size);
+  std::shared_ptr<void const> storage;
+  if (file_data != nullptr) {
+    storage = std::shared_ptr<VirtualFileReader>(std::move(reader));
+  } else {
+    auto buffer = std::make_shared<std::vector<std::uint64_t>>();
+    const std::size_t chunk_words = 1 << 17;
+    std::size_t bytes_read;
+    do {
+      buffer->resize(file_size / sizeof(std::uint64_t) + chunk_words);
+      bytes_read = reader->Read(reinterpret_cast<char*>(buffer->data()) + file_size, chunk_words * sizeof(std::uint64_t));
+      file_size += bytes_read;
+    } while (bytes_read == chunk_words * sizeof(std::uint64_t));
+    file_data = reinterpret_cast<char const*>(buffer->data());
+    storage = buffer;
+  }
+
+  // Validate the header and the extent of every block
+  BinaryDatasetHeader header;
+  if (file_size < sizeof(header)) {
+    Log::Fatal("Binary dataset file %s is truncated or corrupt", filename.c_str());
+  }
+  std::memcpy(&header, file_data, sizeof(header));
+  if (std::memcmp(header.magic, kBinaryDatasetMagic, sizeof(header.magic)) != 0) {
+    Log::Fatal("%s is not a binary dataset file", filename.c_str());
+  }
+  if (header.version != kBinaryDatasetVersion) {
+    Log::Fatal("Binary dataset file %s has unsupported version %u", filename.c_str(), header.version);
+  }
+  if (header.byte_order != kBinaryDatasetByteOrder) {
+    Log::Fatal("Binary dataset file %s was written on a machine with a different byte order", filename.c_str());
+  }
+  if (header.num_rows < 0 || header.num_rows > std::numeric_limits<data_size_t>::max() || header.num_covariates < 0 || header.num_basis < 0 ||
+      (header.covariate_bytes != sizeof(float) && header.covariate_bytes != sizeof(double)) ||
+      (header.num_basis > 0 && header.basis_bytes != sizeof(float) && header.basis_bytes != sizeof(double))) {
+    Log::Fatal("Binary dataset file %s is truncated or corrupt", filename.c_str());
+  }
+  data_size_t num_rows = header.num_rows;
+  int num_covariates = header.num_covariates;
+  int num_basis = header.num_basis;
+  std::uint64_t column_count = static_cast<std::uint64_t>(num_rows);
+  CheckBlock(header.covariate_offset, column_count * num_covariates * header.covariate_bytes, file_size, filename);
+  CheckBlock(header.feature_types_offset, static_cast<std::uint64_t>(num_covariates) * sizeof(std::int32_t), file_size, filename);
+  if (num_basis > 0) CheckBlock(header.basis_offset, column_count * num_basis * header.basis_bytes, file_size, filename);
+  if (header.var_weights_offset != 0) CheckBlock(header.var_weights_offset, column_count * sizeof(double), file_size, filename);
+  if (header.presort_offset != 0) CheckBlock(header.presort_offset, column_count * num_covariates * sizeof(data_size_t), file_size, filename);
+
+  // Feature types are copied, since they are small and must be validated
+  std::vector<std::int32_t> feature_type_codes(num_covariates);
+  std::memcpy(feature_type_codes.data(), file_data + header.feature_types_offset, num_covariates * sizeof(std::int32_t));
+  feature_types.resize(num_covariates);
+  for (int j = 0; j < num_covariates; j++) {
+    if (feature_type_codes[j] < kNumeric || feature_type_codes[j] > kUnorderedCategorical) {
+      Log::Fatal("Binary dataset file %s has an invalid type for feature %d", filename.c_str(), j);
+    }
+    feature_types[j] = static_cast<FeatureType>(feature_type_codes[j]);
+  }
+
+  // Borrow the column-major covariates, basis and presort index from the file (borrowed buffers are never written to)
+  char* mutable_data = const_cast<char*>(file_data);
+  if (header.covariate_bytes == sizeof(float)) {
+    dataset.AddCovariates(reinterpret_cast<float*>(mutable_data + header.covariate_offset), num_rows, num_covariates, false, true);
+  } else {
+    dataset.AddCovariates(reinterpret_cast<double*>(mutable_data + header.covariate_offset), num_rows, num_covariates, false, true);
+  }
+  if (num_basis > 0) {
+    if (header.basis_bytes == sizeof(float)) {
+      dataset.AddBasis(reinterpret_cast<float*>(mutable_data + header.basis_offset), num_rows, num_basis, false, true);
+    } else {
+      dataset.AddBasis(reinterpret_cast<double*>(mutable_data + header.basis_offset), num_rows, num_basis, false, true);
+    }
+  }
+  if (header.var_weights_offset != 0) {
+    dataset.AddVarianceWeights(reinterpret_cast<double*>(mutable_data + header.var_weights_offset), num_rows);
+  }
+  if (header.presort_offset != 0) {
+    dataset.AddPresortIndex(reinterpret_cast<data_size_t const*>(file_data + header.presort_offset), num_rows, num_covariates);
+  }
+  dataset.RetainStorage(storage);
+}
+
+} // namespace StochTree
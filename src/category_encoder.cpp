@@ -0,0 +1,209 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/category_encoder.h>
+#include <stochtree/log.h>
+#include <stochtree/parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include <unordered_set>
+
+namespace StochTree {
+
+/*! \brief Number of observations fitted or encoded by each parallel task */
+static constexpr int64_t kCategoryEncoderBlockSize = 16384;
+
+/*! \brief Whether `value` is an integer that fits in an int64 */
+static bool IsIntegerValue(double value) {
+  return std::floor(value) == value && value >= -9.2233720368547758e18 && value < 9.2233720368547758e18;
+}
+
+/*!
+ * \brief Collect the unique non-missing values of `values`, block by block in parallel, and merge them into a sorted vector.
+ *        `key_fn(i, &key)` returns false for missing values.
+ */
+template <typename Key, typename KeyFn>
+static std::vector<Key> SortedUniqueValues(data_size_t num_values, int num_threads, KeyFn&& key_fn) {
+  int64_t num_blocks = (static_cast<int64_t>(num_values) + kCategoryEncoderBlockSize - 1) / kCategoryEncoderBlockSize;
+  std::vector<std::unordered_set<Key>> block_values(num_blocks);
+  ParallelFor(0, num_values, kCategoryEncoderBlockSize, num_threads, [&](int64_t block_begin, int64_t block_end) {
+    std::unordered_set<Key>& unique_values = block_values[block_begin / kCategoryEncoderBlockSize];
+    Key key;
+    for (int64_t i = block_begin; i < block_end; i++) {
+      if (key_fn(i, &key)) unique_values.insert(key);
+    }
+  });
+  std::unordered_set<Key> merged;
+  for (auto& unique_values : block_values) {
+    merged.insert(unique_values.begin(), unique_values.end());
+  }
+  std::vector<Key> output(merged.begin(), merged.end());
+  std::sort(output.begin(), output.end());
+  return output;
+}
+
+void CategoryDictionary::FitStrings(char const* const* values, data_size_t num_values, int num_threads) {
+  std::vector<std::string_view> levels = SortedUniqueValues<std::string_view>(num_values, num_threads, [&](int64_t i, std::string_view* key) {
+    if (values[i] == nullptr) return false;
+    *key = std::string_view(values[i]);
+    return true;
+  });
+  SetStringLevels(std::vector<std::string>(levels.begin(), levels.end()));
+}
+
+void CategoryDictionary::FitIntegers(double const* values, data_size_t num_values, int num_threads) {
+  // Non-integer values are recorded by the workers and reported on the calling thread, as Log::Fatal may call into the R API
+  std::atomic<int64_t> invalid_index(-1);
+  std::vector<std::int64_t> levels = SortedUniqueValues<std::int64_t>(num_values, num_threads, [&](int64_t i, std::int64_t* key) {
+    if (std::isnan(values[i])) return false;
+    if (!IsIntegerValue(values[i])) {
+      int64_t expected = -1;
+      invalid_index.compare_exchange_strong(expected, i);
+      return false;
+    }
+    *key = static_cast<std::int64_t>(values[i]);
+    return true;
+  });
+  if (invalid_index.load() >= 0) {
+    Log::Fatal("Value %f of an integer categorical feature is not an integer", values[invalid_index.load()]);
+  }
+  SetIntegerLevels(levels);
+}
+
+void CategoryDictionary::SetStringLevels(std::vector<std::string> const& levels) {
+  is_string_ = true;
+  string_levels_ = levels;
+  integer_levels_.clear();
+  BuildIndex();
+}
+
+void CategoryDictionary::SetIntegerLevels(std::vector<std::int64_t> const& levels) {
+  is_string_ = false;
+  integer_levels_ = levels;
+  string_levels_.clear();
+  BuildIndex();
+}
+
+void CategoryDictionary::BuildIndex() {
+  string_index_.clear();
+  integer_index_.clear();
+  if (is_string_) {
+    string_index_.reserve(string_levels_.size());
+    for (int k = 0; k < static_cast<int>(string_levels_.size()); k++) {
+      if (!string_index_.emplace(string_levels_[k], k).second) {
+        Log::Fatal("Level %s appears more than once in a category dictionary", string_levels_[k].c_str());
+      }
+    }
+  } else {
+    integer_index_.reserve(integer_levels_.size());
+    for (int k = 0; k < static_cast<int>(integer_levels_.size()); k++) {
+      if (!integer_index_.emplace(integer_levels_[k], k).second) {
+        Log::Fatal("Level %lld appears more than once in a category dictionary", static_cast<long long>(integer_levels_[k]));
+      }
+    }
+  }
+}
+
+double CategoryDictionary::Code(char const* value) const {
+  CHECK(is_string_);
+  if (value == nullptr) return std::numeric_limits<double>::quiet_NaN();
+  // Heterogeneous lookup of unordered_map needs C++20, so the key is copied
+  auto pos = string_index_.find(std::string(value));
+  return (pos == string_index_.end()) ? string_levels_.size() : pos->second;
+}
+
+double CategoryDictionary::Code(double value) const {
+  CHECK(!is_string_);
+  if (std::isnan(value)) return std::numeric_limits<double>::quiet_NaN();
+  if (!IsIntegerValue(value)) return integer_levels_.size();
+  auto pos = integer_index_.find(static_cast<std::int64_t>(value));
+  return (pos == integer_index_.end()) ? integer_levels_.size() : pos->second;
+}
+
+void CategoryDictionary::EncodeStrings(char const* const* values, data_size_t num_values, double* output, std::int64_t output_stride, int num_threads) const {
+  ParallelFor(0, num_values, kCategoryEncoderBlockSize, num_threads, [&](int64_t block_begin, int64_t block_end) {
+    for (int64_t i = block_begin; i < block_end; i++) {
+      output[i * output_stride] = Code(values[i]);
+    }
+  });
+}
+
+void CategoryDictionary::EncodeIntegers(double const* values, data_size_t num_values, double* output, std::int64_t output_stride, int num_threads) const {
+  ParallelFor(0, num_values, kCategoryEncoderBlockSize, num_threads, [&](int64_t block_begin, int64_t block_end) {
+    for (int64_t i = block_begin; i < block_end; i++) {
+      output[i * output_stride] = Code(values[i]);
+    }
+  });
+}
+
+void CategoryDictionary::OneHot(double const* codes, data_size_t num_values, double* output, int num_threads) const {
+  int num_columns = NumLevels() + 1;
+  ParallelFor(0, num_values, kCategoryEncoderBlockSize, num_threads, [&](int64_t block_begin, int64_t block_end) {
+    for (int j = 0; j < num_columns; j++) {
+      std::fill(output + j * static_cast<int64_t>(num_values) + block_begin, output + j * static_cast<int64_t>(num_values) + block_end, 0.);
+    }
+    for (int64_t i = block_begin; i < block_end; i++) {
+      if (std::isnan(codes[i])) continue;
+      int64_t column = std::min<int64_t>(static_cast<int64_t>(codes[i]), num_columns - 1);
+      output[column * num_values + i] = 1.;
+    }
+  });
+}
+
+nlohmann::json CategoryDictionary::to_json() {
+  nlohmann::json output_obj;
+  output_obj.emplace("is_string", is_string_);
+  if (is_string_) {
+    output_obj.emplace("levels", string_levels_);
+  } else {
+    output_obj.emplace("levels", integer_levels_);
+  }
+  return output_obj;
+}
+
+void CategoryDictionary::from_json(const nlohmann::json& dictionary_json) {
+  if (dictionary_json.at("is_string").get<bool>()) {
+    SetStringLevels(dictionary_json.at("levels").get<std::vector<std::string>>());
+  } else {
+    SetIntegerLevels(dictionary_json.at("levels").get<std::vector<std::int64_t>>());
+  }
+}
+
+int CategoryEncoder::AddFeature(FeatureType feature_type, std::string const& feature_name) {
+  if (feature_type != kOrderedCategorical && feature_type != kUnorderedCategorical) {
+    Log::Fatal("Category dictionaries can only be added for categorical features");
+  }
+  dictionaries_.emplace_back();
+  feature_types_.push_back(feature_type);
+  feature_names_.push_back(feature_name);
+  return static_cast<int>(dictionaries_.size()) - 1;
+}
+
+nlohmann::json CategoryEncoder::to_json() {
+  nlohmann::json output_obj;
+  nlohmann::json features = nlohmann::json::array();
+  for (int j = 0; j < NumFeatures(); j++) {
+    nlohmann::json feature_json = dictionaries_[j].to_json();
+    feature_json.emplace("feature_type", static_cast<int>(feature_types_[j]));
+    feature_json.emplace("name", feature_names_[j]);
+    features.emplace_back(feature_json);
+  }
+  output_obj.emplace("num_features", NumFeatures());
+  output_obj.emplace("features", features);
+  return output_obj;
+}
+
+void CategoryEncoder::from_json(const nlohmann::json& encoder_json) {
+  Reset();
+  int num_features = encoder_json.at("num_features");
+  CHECK_EQ(num_features, static_cast<int>(encoder_json.at("features").size()));
+  for (int j = 0; j < num_features; j++) {
+    const nlohmann::json& feature_json = encoder_json.at("features").at(j);
+    int feature_num = AddFeature(static_cast<FeatureType>(feature_json.at("feature_type").get<int>()), feature_json.at("name").get<std::string>());
+    dictionaries_[feature_num].from_json(feature_json);
+  }
+}
+
+} // namespace StochTree
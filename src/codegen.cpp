@@ -0,0 +1,139 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/codegen.h>
+#include <stochtree/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <locale>
+#include <sstream>
+
+namespace StochTree {
+
+/*! \brief Literal which evaluates to exactly `value` when compiled (17 significant digits round-trip any double) */
+static std::string DoubleLiteral(double value) {
+  if (std::isnan(value)) return "std::numeric_limits<double>::quiet_NaN()";
+  if (std::isinf(value)) return (value > 0) ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+  std::ostringstream literal;
+  literal.imbue(std::locale::classic());
+  literal.precision(17);
+  literal << value;
+  return literal.str();
+}
+
+static void WriteNode(Tree* tree, int32_t nid, int depth, std::ostream& output) {
+  std::string indent(2 * depth, ' ');
+  if (tree->IsLeaf(nid)) {
+    for (int32_t k = 0; k < tree->OutputDimension(); k++) {
+      output << indent << "out[" << k << "] += " << DoubleLiteral(tree->LeafValue(nid, k)) << ";\n";
+    }
+    return;
+  }
+  std::string fvalue = "row[" + std::to_string(tree->SplitIndex(nid)) + "]";
+  bool missing_left = (tree->DefaultChild(nid) == tree->LeftChild(nid));
+  output << indent << "if (";
+  if (tree->NodeType(nid) == TreeNodeType::kCategoricalSplitNode) {
+    output << (missing_left ? "std::isnan(" + fvalue + ") || " : "!std::isnan(" + fvalue + ") && ");
+    output << "CategoryMatch(" << fvalue << ", {";
+    std::vector<std::uint32_t> categories = tree->CategoryList(nid);
+    for (size_t c = 0; c < categories.size(); c++) {
+      output << (c > 0 ? ", " : "") << categories[c] << "u";
+    }
+    output << "})";
+  } else if (missing_left) {
+    // Negated so that missing values, which fail every comparison, take the left branch
+    output << "!(" << fvalue << " > " << DoubleLiteral(tree->Threshold(nid)) << ")";
+  } else {
+    output << fvalue << " <= " << DoubleLiteral(tree->Threshold(nid));
+  }
+  output << ") {\n";
+  WriteNode(tree, tree->LeftChild(nid), depth + 1, output);
+  output << indent << "} else {\n";
+  WriteNode(tree, tree->RightChild(nid), depth + 1, output);
+  output << indent << "}\n";
+}
+
+void GenerateForestSource(ForestContainer& forest_container, std::vector<int> const& sample_indices, std::ostream& output) {
+  std::vector<int> samples = sample_indices;
+  if (samples.empty()) {
+    samples.resize(forest_container.NumSamples());
+    for (int i = 0; i < forest_container.NumSamples(); i++) samples[i] = i;
+  }
+  for (int sample_num : samples) {
+    if (sample_num < 0 || sample_num >= forest_container.NumSamples()) {
+      Log::Fatal("Sample index %d is out of range for a container of %d forest samples", sample_num, forest_container.NumSamples());
+    }
+  }
+  int output_dimension = forest_container.OutputDimension();
+  int num_features = 0;
+  for (int sample_num : samples) {
+    TreeEnsemble* ensemble = forest_container.GetEnsemble(sample_num);
+    for (int j = 0; j < ensemble->NumTrees(); j++) {
+      Tree* tree = ensemble->GetTree(j);
+      for (int32_t nid : tree->GetInternalNodes()) {
+        num_features = std::max(num_features, tree->SplitIndex(nid) + 1);
+      }
+    }
+  }
+
+  output << "// Generated by stochtree. Do not edit.\n"
+         << "// Forest samples: " << samples.size() << ", output dimension: " << output_dimension
+         << ", covariates: " << num_features << "\n"
+         << "#include <cmath>\n"
+         << "#include <cstdint>\n"
+         << "#include <initializer_list>\n"
+         << "#include <limits>\n\n"
+         << "#if defined(_MSC_VER)\n"
+         << "#define STOCHTREE_MODEL_EXPORT extern \"C\" __declspec(dllexport)\n"
+         << "#else\n"
+         << "#define STOCHTREE_MODEL_EXPORT extern \"C\" __attribute__((visibility(\"default\")))\n"
+         << "#endif\n\n"
+         << "namespace {\n\n"
+         << "// Same rule as StochTree::SplitTrueCategorical\n"
+         << "inline bool CategoryMatch(double fvalue, std::initializer_list<std::uint32_t> categories) {\n"
+         << "  if (fvalue < 0 || std::fabs(fvalue) > static_cast<double>(std::numeric_limits<std::uint32_t>::max())) return false;\n"
+         << "  std::uint32_t const category = static_cast<std::uint32_t>(fvalue);\n"
+         << "  for (std::uint32_t c : categories) {\n"
+         << "    if (c == category) return true;\n"
+         << "  }\n"
+         << "  return false;\n"
+         << "}\n";
+
+  for (size_t s = 0; s < samples.size(); s++) {
+    TreeEnsemble* ensemble = forest_container.GetEnsemble(samples[s]);
+    output << "\n// Forest sample " << samples[s] << "\n"
+           << "void PredictSample" << s << "(const double* row, double* out) {\n";
+    for (int j = 0; j < ensemble->NumTrees(); j++) {
+      output << "  // Tree " << j << "\n";
+      WriteNode(ensemble->GetTree(j), 0, 1, output);
+    }
+    output << "}\n";
+  }
+
+  output << "\n} // namespace\n\n"
+         << "STOCHTREE_MODEL_EXPORT int stochtree_model_num_features(void) {return " << num_features << ";}\n"
+         << "STOCHTREE_MODEL_EXPORT int stochtree_model_num_samples(void) {return " << samples.size() << ";}\n"
+         << "STOCHTREE_MODEL_EXPORT int stochtree_model_output_dimension(void) {return " << output_dimension << ";}\n\n"
+         << "STOCHTREE_MODEL_EXPORT void predict(const double* row, double* out) {\n"
+         << "  for (int i = 0; i < " << samples.size() * output_dimension << "; i++) out[i] = 0.0;\n";
+  for (size_t s = 0; s < samples.size(); s++) {
+    output << "  PredictSample" << s << "(row, out + " << s * output_dimension << ");\n";
+  }
+  output << "}\n";
+}
+
+std::string GenerateForestSource(ForestContainer& forest_container, std::vector<int> const& sample_indices) {
+  std::ostringstream output;
+  GenerateForestSource(forest_container, sample_indices, output);
+  return output.str();
+}
+
+void GenerateForestSourceFile(ForestContainer& forest_container, std::vector<int> const& sample_indices, std::string filename) {
+  std::ofstream output_file(filename);
+  if (!output_file) {
+    Log::Fatal("Could not open %s for writing", filename.c_str());
+  }
+  GenerateForestSource(forest_container, sample_indices, output_file);
+}
+
+} // namespace StochTree
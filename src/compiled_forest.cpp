@@ -0,0 +1,193 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/compiled_forest.h>
+#include <stochtree/parallel.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace StochTree {
+
+CompiledForestContainer::CompiledForestContainer(ForestContainer& forest_container) {
+  num_samples_ = forest_container.NumSamples();
+  output_dimension_ = forest_container.OutputDimension();
+  is_leaf_constant_ = forest_container.IsLeafConstant();
+
+  // Reserve the node arrays up front so that they are allocated exactly once
+  int64_t total_nodes = 0;
+  int64_t total_trees = 0;
+  for (int i = 0; i < num_samples_; i++) {
+    TreeEnsemble* ensemble = forest_container.GetEnsemble(i);
+    for (int j = 0; j < ensemble->NumTrees(); j++) {
+      total_nodes += ensemble->GetTree(j)->NumValidNodes();
+    }
+    total_trees += ensemble->NumTrees();
+  }
+  if (total_nodes > std::numeric_limits<int32_t>::max()) {
+    Log::Fatal("Forest container has too many nodes to be compiled");
+  }
+  node_type_.reserve(total_nodes);
+  split_index_.reserve(total_nodes);
+  threshold_.reserve(total_nodes);
+  left_child_.reserve(total_nodes);
+  category_begin_.reserve(total_nodes);
+  category_end_.reserve(total_nodes);
+  tree_root_.reserve(total_trees);
+  forest_begin_.reserve(num_samples_ + 1);
+
+  for (int i = 0; i < num_samples_; i++) {
+    TreeEnsemble* ensemble = forest_container.GetEnsemble(i);
+    CHECK_EQ(ensemble->OutputDimension(), output_dimension_);
+    forest_begin_.push_back(static_cast<int32_t>(tree_root_.size()));
+    for (int j = 0; j < ensemble->NumTrees(); j++) {
+      CompileTree(ensemble->GetTree(j));
+    }
+  }
+  forest_begin_.push_back(static_cast<int32_t>(tree_root_.size()));
+}
+
+void CompiledForestContainer::CompileTree(Tree* tree) {
+  CHECK_EQ(tree->OutputDimension(), output_dimension_);
+  int32_t root = static_cast<int32_t>(node_type_.size());
+  tree_root_.push_back(root);
+
+  // Nodes are visited breadth-first and appended in the order they are visited, so the node
+  // at position `k` of `source_nodes` is stored at index `root + k` of the compiled arrays.
+  // Deleted nodes are unreachable from the root and are therefore never visited.
+  std::vector<int32_t> source_nodes = {0};
+  for (size_t k = 0; k < source_nodes.size(); k++) {
+    int32_t nid = source_nodes[k];
+    TreeNodeType node_type = tree->NodeType(nid);
+    node_type_.push_back(node_type);
+    if (tree->IsLeaf(nid)) {
+      node_type_.back() = TreeNodeType::kLeafNode;
+      split_index_.push_back(static_cast<int32_t>(leaf_values_.size()));
+      threshold_.push_back(0.);
+      left_child_.push_back(-1);
+      for (int32_t d = 0; d < output_dimension_; d++) {
+        leaf_values_.push_back(tree->LeafValue(nid, d));
+      }
+    } else {
+      split_index_.push_back(tree->SplitIndex(nid));
+      threshold_.push_back(tree->Threshold(nid));
+      left_child_.push_back(root + static_cast<int32_t>(source_nodes.size()));
+      source_nodes.push_back(tree->LeftChild(nid));
+      source_nodes.push_back(tree->RightChild(nid));
+    }
+    category_begin_.push_back(static_cast<int64_t>(category_set_.size()));
+    if (node_type_.back() == TreeNodeType::kCategoricalSplitNode) {
+      EncodeCategorySet(tree->CategoryList(nid), category_set_);
+    }
+    category_end_.push_back(static_cast<int64_t>(category_set_.size()));
+  }
+}
+
+std::vector<double> CompiledForestContainer::Predict(ForestDataset& dataset, int num_threads) {
+  data_size_t n = dataset.NumObservations();
+  std::vector<double> output(n*num_samples_);
+  PredictInplace(dataset, output, num_threads);
+  return output;
+}
+
+std::vector<double> CompiledForestContainer::PredictRaw(ForestDataset& dataset, int num_threads) {
+  data_size_t n = dataset.NumObservations();
+  std::vector<double> output(n * output_dimension_ * num_samples_);
+  PredictRawInplace(dataset, output, num_threads);
+  return output;
+}
+
+std::vector<double> CompiledForestContainer::PredictRawSingleForest(ForestDataset& dataset, int forest_num) {
+  CHECK_LT(forest_num, num_samples_);
+  data_size_t n = dataset.NumObservations();
+  std::vector<double> output(n * output_dimension_);
+  PredictRawRowsInplace(dataset, output, forest_num, 0, n, 0);
+  return output;
+}
+
+void CompiledForestContainer::PredictInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads) {
+  data_size_t n = dataset.NumObservations();
+  CHECK_GE(output.size(), n*num_samples_);
+  if (!is_leaf_constant_) CHECK(dataset.HasBasis());
+  int64_t num_row_blocks = (n + kPredictRowBlockSize - 1) / kPredictRowBlockSize;
+  ParallelFor(0, num_samples_ * num_row_blocks, 1, num_threads, [&](int64_t work_begin, int64_t work_end) {
+    for (int64_t work = work_begin; work < work_end; work++) {
+      int sample_num = work / num_row_blocks;
+      data_size_t row_begin = (work % num_row_blocks) * kPredictRowBlockSize;
+      data_size_t row_end = std::min(row_begin + kPredictRowBlockSize, n);
+      PredictRowsInplace(dataset, output, sample_num, row_begin, row_end, sample_num*n);
+    }
+  });
+}
+
+void CompiledForestContainer::PredictRawInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads) {
+  data_size_t n = dataset.NumObservations();
+  CHECK_GE(output.size(), n * output_dimension_ * num_samples_);
+  int64_t num_row_blocks = (n + kPredictRowBlockSize - 1) / kPredictRowBlockSize;
+  ParallelFor(0, num_samples_ * num_row_blocks, 1, num_threads, [&](int64_t work_begin, int64_t work_end) {
+    for (int64_t work = work_begin; work < work_end; work++) {
+      int sample_num = work / num_row_blocks;
+      data_size_t row_begin = (work % num_row_blocks) * kPredictRowBlockSize;
+      data_size_t row_end = std::min(row_begin + kPredictRowBlockSize, n);
+      PredictRawRowsInplace(dataset, output, sample_num, row_begin, row_end, sample_num*n*output_dimension_);
+    }
+  });
+}
+
+void CompiledForestContainer::PredictRowsInplace(ForestDataset& dataset, std::vector<double>& output, int forest_num,
+                                                 data_size_t row_begin, data_size_t row_end, data_size_t offset) {
+  int32_t tree_begin = forest_begin_[forest_num];
+  int32_t tree_end = forest_begin_[forest_num + 1];
+  double pred;
+  if (is_leaf_constant_) {
+    dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+      for (data_size_t i = row_begin; i < row_end; i++) {
+        pred = 0.0;
+        for (int32_t j = tree_begin; j < tree_end; j++) {
+          int32_t nidx = EvaluateTree(j, covariates, i);
+          pred += leaf_values_[split_index_[nidx]];
+        }
+        output[i + offset] = pred;
+      }
+    });
+  } else {
+    CHECK_EQ(output_dimension_, dataset.NumBasis());
+    dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+      dataset.VisitBasis([&](auto& basis) {
+        for (data_size_t i = row_begin; i < row_end; i++) {
+          pred = 0.0;
+          for (int32_t j = tree_begin; j < tree_end; j++) {
+            int32_t nidx = EvaluateTree(j, covariates, i);
+            double const* leaf_value = leaf_values_.data() + split_index_[nidx];
+            for (int32_t k = 0; k < output_dimension_; k++) {
+              pred += leaf_value[k] * basis(i, k);
+            }
+          }
+          output[i + offset] = pred;
+        }
+      });
+    });
+  }
+}
+
+void CompiledForestContainer::PredictRawRowsInplace(ForestDataset& dataset, std::vector<double>& output, int forest_num,
+                                                    data_size_t row_begin, data_size_t row_end, data_size_t offset) {
+  int32_t tree_begin = forest_begin_[forest_num];
+  int32_t tree_end = forest_begin_[forest_num + 1];
+  double* row_output;
+  dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+    for (data_size_t i = row_begin; i < row_end; i++) {
+      // Each tree is traversed once per row and its leaf vector accumulated into every output dimension,
+      // which sums the trees in the same order as the per-dimension loop in TreeEnsemble
+      row_output = output.data() + i*output_dimension_ + offset;
+      std::fill(row_output, row_output + output_dimension_, 0.0);
+      for (int32_t j = tree_begin; j < tree_end; j++) {
+        int32_t nidx = EvaluateTree(j, covariates, i);
+        double const* leaf_value = leaf_values_.data() + split_index_[nidx];
+        for (int32_t k = 0; k < output_dimension_; k++) {
+          row_output[k] += leaf_value[k];
+        }
+      }
+    }
+  });
+}
+
+} // namespace StochTree
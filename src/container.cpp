@@ -2,6 +2,11 @@
 #include <Eigen/Dense>
 #include <stochtree/container.h>
 #include <stochtree/data.h>
+#include <stochtree/parallel.h>
+#include <stochtree/predict_kernel.h>
+#include <stochtree/prediction_summary.h>
+
+#include <algorithm>
 
 namespace StochTree {
 
@@ -27,6 +32,7 @@ ForestContainer::ForestContainer(int num_samples, int num_trees, int output_dime
 }
 
 void ForestContainer::CopyFromPreviousSample(int new_sample_id, int previous_sample_id) {
+  InvalidateQuickScorer(new_sample_id);
   forests_[new_sample_id].reset(new TreeEnsemble(*forests_[previous_sample_id]));
 }
 
@@ -34,6 +40,7 @@ void ForestContainer::InitializeRoot(double leaf_value) {
   CHECK(initialized_);
   CHECK_EQ(num_samples_, 0);
   CHECK_EQ(forests_.size(), 0);
+  InvalidateQuickScorers();
   forests_.resize(1);
   forests_[0].reset(new TreeEnsemble(num_trees_, output_dimension_, is_leaf_constant_));
   // NOTE: not setting num_samples = 1, since we are just initializing constant root 
@@ -46,6 +53,7 @@ void ForestContainer::InitializeRoot(std::vector<double>& leaf_vector) {
   CHECK(initialized_);
   CHECK_EQ(num_samples_, 0);
   CHECK_EQ(forests_.size(), 0);
+  InvalidateQuickScorers();
   forests_.resize(1);
   forests_[0].reset(new TreeEnsemble(num_trees_, output_dimension_, is_leaf_constant_));
   // NOTE: not setting num_samples = 1, since we are just initializing constant root 
@@ -59,38 +67,281 @@ void ForestContainer::AddSamples(int num_samples) {
   int total_new_samples = num_samples + num_samples_;
   forests_.resize(total_new_samples);
   for (int i = num_samples_; i < total_new_samples; i++) {
+    InvalidateQuickScorer(i);
     forests_[i].reset(new TreeEnsemble(num_trees_, output_dimension_, is_leaf_constant_));
   }
   num_samples_ = total_new_samples;
 }
 
-std::vector<double> ForestContainer::Predict(ForestDataset& dataset) {
+std::vector<double> ForestContainer::Predict(ForestDataset& dataset, int num_threads, ForestPredictEngine engine) {
   data_size_t n = dataset.NumObservations();
   data_size_t total_output_size = n*num_samples_;
   std::vector<double> output(total_output_size);
-  data_size_t offset = 0;
-  for (int i = 0; i < num_samples_; i++) {
-    auto num_trees = forests_[i]->NumTrees();
-    forests_[i]->PredictInplace(dataset, output, 0, num_trees, offset);
-    offset += n;
-  }
+  PredictInplace(dataset, output, num_threads, engine);
   return output;
 }
 
-std::vector<double> ForestContainer::PredictRaw(ForestDataset& dataset) {
+std::vector<double> ForestContainer::PredictRaw(ForestDataset& dataset, int num_threads, ForestPredictEngine engine) {
   data_size_t n = dataset.NumObservations();
   data_size_t total_output_size = n * output_dimension_ * num_samples_;
   std::vector<double> output(total_output_size);
-  data_size_t offset = 0;
-  for (int i = 0; i < num_samples_; i++) {
-    auto num_trees = forests_[i]->NumTrees();
-    forests_[i]->PredictRawInplace(dataset, output, 0, num_trees, offset);
-    offset += n * output_dimension_;
-  }
+  PredictRawInplace(dataset, output, num_threads, engine);
   return output;
 }
 
-std::vector<double> ForestContainer::PredictRaw(ForestDataset& dataset, int forest_num) {
+std::vector<QuickScorerEnsemble*> ForestContainer::BuildQuickScorers(int num_threads) {
+  std::lock_guard<std::mutex> lock(quick_scorers_mutex_);
+  quick_scorers_.resize(num_samples_);
+  quick_scorers_current_.resize(num_samples_, 0);
+  ParallelFor(0, num_samples_, 1, num_threads, [&](int64_t sample_begin, int64_t sample_end) {
+    for (int64_t i = sample_begin; i < sample_end; i++) {
+      if (quick_scorers_current_[i]) continue;
+      quick_scorers_[i].reset();
+      if (QuickScorerEnsemble::Supports(*forests_[i])) {
+        quick_scorers_[i] = std::make_unique<QuickScorerEnsemble>(*forests_[i]);
+      }
+      quick_scorers_current_[i] = 1;
+    }
+  });
+  std::vector<QuickScorerEnsemble*> scorers(num_samples_);
+  for (int i = 0; i < num_samples_; i++) scorers[i] = quick_scorers_[i].get();
+  return scorers;
+}
+
+std::vector<std::vector<std::vector<int>>> ForestContainer::GroupTreeStructures(int num_threads) {
+  std::vector<std::vector<std::vector<int>>> groups(num_trees_);
+  ParallelFor(0, num_trees_, 1, num_threads, [&](int64_t tree_begin, int64_t tree_end) {
+    for (int64_t t = tree_begin; t < tree_end; t++) {
+      // Groups whose structure has a given hash, confirmed with an exact comparison in case of collisions
+      std::unordered_map<std::uint64_t, std::vector<int>> groups_by_hash;
+      for (int j = 0; j < num_samples_; j++) {
+        Tree* tree = forests_[j]->GetTree(t);
+        std::vector<int>& candidates = groups_by_hash[tree->StructureHash()];
+        bool matched = false;
+        for (int g : candidates) {
+          if (forests_[groups[t][g][0]]->GetTree(t)->HasSameStructure(*tree)) {
+            groups[t][g].push_back(j);
+            matched = true;
+            break;
+          }
+        }
+        if (!matched) {
+          candidates.push_back(groups[t].size());
+          groups[t].push_back({j});
+        }
+      }
+    }
+  });
+  return groups;
+}
+
+void ForestContainer::PredictStructureMemoized(ForestDataset& dataset, std::vector<double>& output, int num_threads, bool raw) {
+  data_size_t n = dataset.NumObservations();
+  bool use_basis = !raw && !is_leaf_constant_;
+  if (use_basis) {
+    CHECK(dataset.HasBasis());
+    CHECK_EQ(output_dimension_, dataset.NumBasis());
+  }
+  int output_dimension = raw ? output_dimension_ : 1;
+  int64_t sample_stride = static_cast<int64_t>(n) * output_dimension;
+  std::vector<std::vector<std::vector<int>>> groups = GroupTreeStructures(num_threads);
+
+  // Each unit of work is a (block of rows, range of samples) pair. Samples are only split into 
+  // ranges when there are fewer row blocks than threads, since every range repeats the traversals.
+  int64_t num_row_blocks = (n + kPredictRowBlockSize - 1) / kPredictRowBlockSize;
+  int64_t num_sample_ranges = std::max<int64_t>(1, std::min<int64_t>(num_samples_, ResolveNumThreads(num_threads) / std::max<int64_t>(num_row_blocks, 1)));
+  int64_t samples_per_range = (num_samples_ + num_sample_ranges - 1) / num_sample_ranges;
+  // Covariates and basis are read at their stored (double or single) precision
+  dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+    dataset.VisitBasis([&](auto& basis) {
+      ParallelFor(0, num_row_blocks * num_sample_ranges, 1, num_threads, [&](int64_t work_begin, int64_t work_end) {
+        PredictKernel kernel = BestPredictKernel();
+        std::vector<std::int32_t> leaf_ids(kPredictRowBlockSize);
+        auto const* basis_data = use_basis ? basis.data() : nullptr;
+        int64_t basis_column_stride = use_basis ? basis.outerStride() : 0;
+        int64_t basis_row_stride = use_basis ? basis.innerStride() : 0;
+        for (int64_t work = work_begin; work < work_end; work++) {
+          data_size_t row_begin = (work / num_sample_ranges) * kPredictRowBlockSize;
+          data_size_t row_end = std::min(row_begin + kPredictRowBlockSize, n);
+          data_size_t block_rows = row_end - row_begin;
+          int sample_begin = (work % num_sample_ranges) * samples_per_range;
+          int sample_end = std::min<int64_t>(sample_begin + samples_per_range, num_samples_);
+          for (int j = sample_begin; j < sample_end; j++) {
+            double* sample_output = output.data() + j * sample_stride + static_cast<int64_t>(row_begin) * output_dimension;
+            std::fill(sample_output, sample_output + block_rows * output_dimension, 0.0);
+          }
+          // Trees are accumulated in order, so every output element sums its trees in the same order as tree traversal
+          for (int t = 0; t < num_trees_; t++) {
+            for (std::vector<int> const& group : groups[t]) {
+              auto group_begin = std::lower_bound(group.begin(), group.end(), sample_begin);
+              auto group_end = std::lower_bound(group_begin, group.end(), sample_end);
+              if (group_begin == group_end) continue;
+              // Route the block of rows once for every sample sharing this structure
+              Tree const& structure = *forests_[*group_begin]->GetTree(t);
+              for (data_size_t r = 0; r < block_rows; r += kPredictBlockRows) {
+                int num_rows = std::min<data_size_t>(kPredictBlockRows, block_rows - r);
+                EvaluateTreeBlock(structure, covariates, row_begin + r, num_rows, leaf_ids.data() + r, kernel);
+              }
+              for (auto it = group_begin; it != group_end; ++it) {
+                Tree const& tree = *forests_[*it]->GetTree(t);
+                double* sample_output = output.data() + *it * sample_stride;
+                for (data_size_t r = 0; r < block_rows; r++) {
+                  data_size_t row = row_begin + r;
+                  double const* leaf_values = tree.LeafValues(leaf_ids[r]);
+                  if (raw) {
+                    double* row_output = sample_output + static_cast<int64_t>(row) * output_dimension;
+                    for (int k = 0; k < output_dimension; k++) {
+                      row_output[k] += leaf_values[k];
+                    }
+                  } else if (use_basis) {
+                    for (int k = 0; k < output_dimension_; k++) {
+                      sample_output[row] += leaf_values[k] * basis_data[row * basis_row_stride + k * basis_column_stride];
+                    }
+                  } else {
+                    sample_output[row] += leaf_values[0];
+                  }
+                }
+              }
+            }
+          }
+        }
+      });
+    });
+  });
+}
+
+void ForestContainer::PredictInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads, ForestPredictEngine engine) {
+  data_size_t n = dataset.NumObservations();
+  CHECK_GE(output.size(), n*num_samples_);
+  // The other engines read covariates through pointers into dense storage
+  if (dataset.HasSparseCovariates()) engine = ForestPredictEngine::kTreeTraversal;
+  if (engine == ForestPredictEngine::kStructureMemoized) {
+    PredictStructureMemoized(dataset, output, num_threads, false);
+    return;
+  }
+  std::vector<QuickScorerEnsemble*> scorers;
+  if (engine == ForestPredictEngine::kQuickScorer) scorers = BuildQuickScorers(num_threads);
+  // Each unit of work is a (forest sample, block of rows) pair, so that 
+  // threads are kept busy whether there are few samples or few rows
+  int64_t num_row_blocks = (n + kPredictRowBlockSize - 1) / kPredictRowBlockSize;
+  ParallelFor(0, num_samples_ * num_row_blocks, 1, num_threads, [&](int64_t work_begin, int64_t work_end) {
+    for (int64_t work = work_begin; work < work_end; work++) {
+      int sample_num = work / num_row_blocks;
+      data_size_t row_begin = (work % num_row_blocks) * kPredictRowBlockSize;
+      data_size_t row_end = std::min(row_begin + kPredictRowBlockSize, n);
+      if (!scorers.empty() && scorers[sample_num]) {
+        scorers[sample_num]->PredictRowsInplace(dataset, output, row_begin, row_end, sample_num*n);
+      } else {
+        auto num_trees = forests_[sample_num]->NumTrees();
+        forests_[sample_num]->PredictRowsInplace(dataset, output, 0, num_trees, row_begin, row_end, sample_num*n);
+      }
+    }
+  });
+}
+
+void ForestContainer::PredictRawInplace(ForestDataset& dataset, std::vector<double>& output, int num_threads, ForestPredictEngine engine) {
+  data_size_t n = dataset.NumObservations();
+  CHECK_GE(output.size(), n * output_dimension_ * num_samples_);
+  if (dataset.HasSparseCovariates()) engine = ForestPredictEngine::kTreeTraversal;
+  if (engine == ForestPredictEngine::kStructureMemoized) {
+    PredictStructureMemoized(dataset, output, num_threads, true);
+    return;
+  }
+  std::vector<QuickScorerEnsemble*> scorers;
+  if (engine == ForestPredictEngine::kQuickScorer) scorers = BuildQuickScorers(num_threads);
+  int64_t num_row_blocks = (n + kPredictRowBlockSize - 1) / kPredictRowBlockSize;
+  ParallelFor(0, num_samples_ * num_row_blocks, 1, num_threads, [&](int64_t work_begin, int64_t work_end) {
+    for (int64_t work = work_begin; work < work_end; work++) {
+      int sample_num = work / num_row_blocks;
+      data_size_t row_begin = (work % num_row_blocks) * kPredictRowBlockSize;
+      data_size_t row_end = std::min(row_begin + kPredictRowBlockSize, n);
+      if (!scorers.empty() && scorers[sample_num]) {
+        scorers[sample_num]->PredictRawRowsInplace(dataset, output, row_begin, row_end, sample_num*n*output_dimension_);
+      } else {
+        auto num_trees = forests_[sample_num]->NumTrees();
+        forests_[sample_num]->PredictRawRowsInplace(dataset, output, 0, num_trees, row_begin, row_end, sample_num*n*output_dimension_);
+      }
+    }
+  });
+}
+
+void ForestContainer::PredictInplace(double const* covariates, double const* basis, data_size_t num_rows, int num_covariates, double* output) {
+  for (int j = 0; j < num_samples_; j++) {
+    forests_[j]->PredictInplace(covariates, basis, num_rows, num_covariates, output + static_cast<int64_t>(j) * num_rows);
+  }
+}
+
+void ForestContainer::PredictRawInplace(double const* covariates, data_size_t num_rows, int num_covariates, double* output) {
+  int64_t sample_stride = static_cast<int64_t>(num_rows) * output_dimension_;
+  for (int j = 0; j < num_samples_; j++) {
+    forests_[j]->PredictRawInplace(covariates, num_rows, num_covariates, output + j * sample_stride);
+  }
+}
+
+void ForestContainer::PredictSummary(ForestDataset& dataset, std::vector<int>& sample_indices, std::vector<double>& quantile_probs, 
+                                     std::vector<double>& mean_output, std::vector<double>& variance_output, 
+                                     std::vector<double>& quantile_output, int num_threads) {
+  data_size_t n = dataset.NumObservations();
+  std::vector<int> samples = sample_indices;
+  if (samples.empty()) {
+    samples.resize(num_samples_);
+    for (int i = 0; i < num_samples_; i++) samples[i] = i;
+  }
+  for (int sample_num : samples) {
+    if (sample_num < 0 || sample_num >= num_samples_) {
+      Log::Fatal("Sample index %d is out of range for a container of %d forest samples", sample_num, num_samples_);
+    }
+  }
+  for (double prob : quantile_probs) {
+    if (!(prob >= 0. && prob <= 1.)) {
+      Log::Fatal("Quantile probabilities must be between 0 and 1");
+    }
+  }
+  int num_quantiles = quantile_probs.size();
+  mean_output.assign(n, 0.);
+  variance_output.assign(n, 0.);
+  quantile_output.assign(n*num_quantiles, 0.);
+
+  // Rows are summarized a block at a time, so only the running estimators of one block of 
+  // rows per thread and a single block of predictions are held in memory at once
+  int64_t num_row_blocks = (n + kPredictRowBlockSize - 1) / kPredictRowBlockSize;
+  ParallelFor(0, num_row_blocks, 1, num_threads, [&](int64_t block_begin, int64_t block_end) {
+    std::vector<double> block_pred(kPredictRowBlockSize);
+    std::vector<double> block_sum_squares(kPredictRowBlockSize);
+    std::vector<P2QuantileEstimator> block_quantiles;
+    for (int64_t block = block_begin; block < block_end; block++) {
+      data_size_t row_begin = block * kPredictRowBlockSize;
+      data_size_t row_end = std::min(row_begin + kPredictRowBlockSize, n);
+      data_size_t block_rows = row_end - row_begin;
+      double* block_mean = mean_output.data() + row_begin;
+      std::fill(block_sum_squares.begin(), block_sum_squares.end(), 0.);
+      block_quantiles.clear();
+      for (int j = 0; j < num_quantiles; j++) {
+        block_quantiles.insert(block_quantiles.end(), block_rows, P2QuantileEstimator(quantile_probs[j]));
+      }
+      for (size_t s = 0; s < samples.size(); s++) {
+        TreeEnsemble* forest = forests_[samples[s]].get();
+        forest->PredictRowsInplace(dataset, block_pred, 0, forest->NumTrees(), row_begin, row_end, -row_begin);
+        for (data_size_t r = 0; r < block_rows; r++) {
+          double delta = block_pred[r] - block_mean[r];
+          block_mean[r] += delta / (s + 1);
+          block_sum_squares[r] += delta * (block_pred[r] - block_mean[r]);
+          for (int j = 0; j < num_quantiles; j++) {
+            block_quantiles[j*block_rows + r].Add(block_pred[r]);
+          }
+        }
+      }
+      for (data_size_t r = 0; r < block_rows; r++) {
+        variance_output[row_begin + r] = (samples.size() > 1) ? block_sum_squares[r] / (samples.size() - 1) : 0.;
+        for (int j = 0; j < num_quantiles; j++) {
+          quantile_output[j*n + row_begin + r] = block_quantiles[j*block_rows + r].Quantile();
+        }
+      }
+    }
+  });
+}
+
+std::vector<double> ForestContainer::PredictRawSingleForest(ForestDataset& dataset, int forest_num) {
   data_size_t n = dataset.NumObservations();
   data_size_t total_output_size = n * output_dimension_;
   std::vector<double> output(total_output_size);
@@ -127,6 +378,7 @@ void ForestContainer::from_json(const json& forest_container_json) {
   this->initialized_ = forest_container_json.at("initialized");
 
   std::string forest_label;
+  InvalidateQuickScorers();
   forests_.clear();
   forests_.resize(this->num_samples_);
   for (int i = 0; i < this->num_samples_; i++) {
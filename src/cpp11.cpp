@@ -48,18 +48,49 @@ extern "C" SEXP _stochtree_dataset_has_variance_weights_cpp(SEXP dataset) {
   END_CPP11
 }
 // R_data.cpp
-void forest_dataset_add_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> covariates);
-extern "C" SEXP _stochtree_forest_dataset_add_covariates_cpp(SEXP dataset_ptr, SEXP covariates) {
+void forest_dataset_add_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> covariates, bool borrow);
+extern "C" SEXP _stochtree_forest_dataset_add_covariates_cpp(SEXP dataset_ptr, SEXP covariates, SEXP borrow) {
   BEGIN_CPP11
-    forest_dataset_add_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::doubles_matrix<>>>(covariates));
+    forest_dataset_add_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::doubles_matrix<>>>(covariates), cpp11::as_cpp<cpp11::decay_t<bool>>(borrow));
     return R_NilValue;
   END_CPP11
 }
 // R_data.cpp
-void forest_dataset_add_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> basis);
-extern "C" SEXP _stochtree_forest_dataset_add_basis_cpp(SEXP dataset_ptr, SEXP basis) {
+void forest_dataset_add_integer_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, SEXP covariates);
+extern "C" SEXP _stochtree_forest_dataset_add_integer_covariates_cpp(SEXP dataset_ptr, SEXP covariates) {
   BEGIN_CPP11
-    forest_dataset_add_basis_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::doubles_matrix<>>>(basis));
+    forest_dataset_add_integer_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<SEXP>>(covariates));
+    return R_NilValue;
+  END_CPP11
+}
+// R_data.cpp
+void forest_dataset_add_sparse_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::integers col_ptr, cpp11::integers row_index, cpp11::doubles values, int num_row, int num_col);
+extern "C" SEXP _stochtree_forest_dataset_add_sparse_covariates_cpp(SEXP dataset_ptr, SEXP col_ptr, SEXP row_index, SEXP values, SEXP num_row, SEXP num_col) {
+  BEGIN_CPP11
+    forest_dataset_add_sparse_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::integers>>(col_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::integers>>(row_index), cpp11::as_cpp<cpp11::decay_t<cpp11::doubles>>(values), cpp11::as_cpp<cpp11::decay_t<int>>(num_row), cpp11::as_cpp<cpp11::decay_t<int>>(num_col));
+    return R_NilValue;
+  END_CPP11
+}
+// R_data.cpp
+cpp11::writable::integers forest_dataset_add_arrow_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, SEXP schema_xptr, SEXP array_xptr, bool single_precision, int num_threads);
+extern "C" SEXP _stochtree_forest_dataset_add_arrow_covariates_cpp(SEXP dataset_ptr, SEXP schema_xptr, SEXP array_xptr, SEXP single_precision, SEXP num_threads) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(forest_dataset_add_arrow_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<SEXP>>(schema_xptr), cpp11::as_cpp<cpp11::decay_t<SEXP>>(array_xptr), cpp11::as_cpp<cpp11::decay_t<bool>>(single_precision), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads)));
+  END_CPP11
+}
+// R_data.cpp
+void forest_dataset_add_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles_matrix<> basis, bool borrow);
+extern "C" SEXP _stochtree_forest_dataset_add_basis_cpp(SEXP dataset_ptr, SEXP basis, SEXP borrow) {
+  BEGIN_CPP11
+    forest_dataset_add_basis_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::doubles_matrix<>>>(basis), cpp11::as_cpp<cpp11::decay_t<bool>>(borrow));
+    return R_NilValue;
+  END_CPP11
+}
+// R_data.cpp
+void forest_dataset_add_integer_basis_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, SEXP basis);
+extern "C" SEXP _stochtree_forest_dataset_add_integer_basis_cpp(SEXP dataset_ptr, SEXP basis) {
+  BEGIN_CPP11
+    forest_dataset_add_integer_basis_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<SEXP>>(basis));
     return R_NilValue;
   END_CPP11
 }
@@ -72,6 +103,22 @@ extern "C" SEXP _stochtree_forest_dataset_update_basis_cpp(SEXP dataset_ptr, SEX
   END_CPP11
 }
 // R_data.cpp
+void forest_dataset_bin_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, int max_bins, int num_threads, bool release_covariates);
+extern "C" SEXP _stochtree_forest_dataset_bin_covariates_cpp(SEXP dataset_ptr, SEXP max_bins, SEXP num_threads, SEXP release_covariates) {
+  BEGIN_CPP11
+    forest_dataset_bin_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<int>>(max_bins), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads), cpp11::as_cpp<cpp11::decay_t<bool>>(release_covariates));
+    return R_NilValue;
+  END_CPP11
+}
+// R_data.cpp
+void forest_dataset_add_row_major_covariates_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, int num_threads);
+extern "C" SEXP _stochtree_forest_dataset_add_row_major_covariates_cpp(SEXP dataset_ptr, SEXP num_threads) {
+  BEGIN_CPP11
+    forest_dataset_add_row_major_covariates_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset_ptr), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads));
+    return R_NilValue;
+  END_CPP11
+}
+// R_data.cpp
 void forest_dataset_add_weights_cpp(cpp11::external_pointer<StochTree::ForestDataset> dataset_ptr, cpp11::doubles weights);
 extern "C" SEXP _stochtree_forest_dataset_add_weights_cpp(SEXP dataset_ptr, SEXP weights) {
   BEGIN_CPP11
@@ -145,6 +192,27 @@ extern "C" SEXP _stochtree_rfx_dataset_add_weights_cpp(SEXP dataset_ptr, SEXP we
     return R_NilValue;
   END_CPP11
 }
+// R_data.cpp
+cpp11::writable::doubles category_codes_cpp(cpp11::strings x, cpp11::strings levels, int num_threads);
+extern "C" SEXP _stochtree_category_codes_cpp(SEXP x, SEXP levels, SEXP num_threads) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(category_codes_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::strings>>(x), cpp11::as_cpp<cpp11::decay_t<cpp11::strings>>(levels), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads)));
+  END_CPP11
+}
+// R_data.cpp
+cpp11::writable::doubles_matrix<> category_one_hot_cpp(cpp11::strings x, cpp11::strings levels, int num_threads);
+extern "C" SEXP _stochtree_category_one_hot_cpp(SEXP x, SEXP levels, SEXP num_threads) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(category_one_hot_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::strings>>(x), cpp11::as_cpp<cpp11::decay_t<cpp11::strings>>(levels), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads)));
+  END_CPP11
+}
+// R_data.cpp
+cpp11::writable::doubles category_integer_levels_cpp(cpp11::doubles x, int num_threads);
+extern "C" SEXP _stochtree_category_integer_levels_cpp(SEXP x, SEXP num_threads) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(category_integer_levels_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::doubles>>(x), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads)));
+  END_CPP11
+}
 // R_random_effects.cpp
 cpp11::external_pointer<StochTree::RandomEffectsContainer> rfx_container_cpp(int num_components, int num_groups);
 extern "C" SEXP _stochtree_rfx_container_cpp(SEXP num_components, SEXP num_groups) {
@@ -425,17 +493,17 @@ extern "C" SEXP _stochtree_update_residual_forest_container_cpp(SEXP data, SEXP
   END_CPP11
 }
 // forest.cpp
-cpp11::writable::doubles_matrix<> predict_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset);
-extern "C" SEXP _stochtree_predict_forest_cpp(SEXP forest_samples, SEXP dataset) {
+cpp11::writable::doubles_matrix<> predict_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, int num_threads, int engine);
+extern "C" SEXP _stochtree_predict_forest_cpp(SEXP forest_samples, SEXP dataset, SEXP num_threads, SEXP engine) {
   BEGIN_CPP11
-    return cpp11::as_sexp(predict_forest_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestContainer>>>(forest_samples), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset)));
+    return cpp11::as_sexp(predict_forest_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestContainer>>>(forest_samples), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads), cpp11::as_cpp<cpp11::decay_t<int>>(engine)));
   END_CPP11
 }
 // forest.cpp
-cpp11::writable::doubles_matrix<> predict_forest_raw_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset);
-extern "C" SEXP _stochtree_predict_forest_raw_cpp(SEXP forest_samples, SEXP dataset) {
+cpp11::writable::doubles_matrix<> predict_forest_raw_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, int num_threads, int engine);
+extern "C" SEXP _stochtree_predict_forest_raw_cpp(SEXP forest_samples, SEXP dataset, SEXP num_threads, SEXP engine) {
   BEGIN_CPP11
-    return cpp11::as_sexp(predict_forest_raw_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestContainer>>>(forest_samples), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset)));
+    return cpp11::as_sexp(predict_forest_raw_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestContainer>>>(forest_samples), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads), cpp11::as_cpp<cpp11::decay_t<int>>(engine)));
   END_CPP11
 }
 // forest.cpp
@@ -445,6 +513,13 @@ extern "C" SEXP _stochtree_predict_forest_raw_single_forest_cpp(SEXP forest_samp
     return cpp11::as_sexp(predict_forest_raw_single_forest_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestContainer>>>(forest_samples), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset), cpp11::as_cpp<cpp11::decay_t<int>>(forest_num)));
   END_CPP11
 }
+// forest.cpp
+cpp11::writable::list predict_summary_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, cpp11::integers sample_indices, cpp11::doubles quantile_probs, int num_threads);
+extern "C" SEXP _stochtree_predict_summary_forest_cpp(SEXP forest_samples, SEXP dataset, SEXP sample_indices, SEXP quantile_probs, SEXP num_threads) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(predict_summary_forest_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestContainer>>>(forest_samples), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(dataset), cpp11::as_cpp<cpp11::decay_t<cpp11::integers>>(sample_indices), cpp11::as_cpp<cpp11::decay_t<cpp11::doubles>>(quantile_probs), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads)));
+  END_CPP11
+}
 // kernel.cpp
 cpp11::external_pointer<StochTree::ForestKernel> forest_kernel_cpp();
 extern "C" SEXP _stochtree_forest_kernel_cpp() {
@@ -541,10 +616,33 @@ extern "C" SEXP _stochtree_tree_prior_cpp(SEXP alpha, SEXP beta, SEXP min_sample
   END_CPP11
 }
 // sampler.cpp
-cpp11::external_pointer<StochTree::ForestTracker> forest_tracker_cpp(cpp11::external_pointer<StochTree::ForestDataset> data, cpp11::integers feature_types, int num_trees, StochTree::data_size_t n);
-extern "C" SEXP _stochtree_forest_tracker_cpp(SEXP data, SEXP feature_types, SEXP num_trees, SEXP n) {
+cpp11::external_pointer<StochTree::ForestTracker> forest_tracker_cpp(cpp11::external_pointer<StochTree::ForestDataset> data, cpp11::integers feature_types, int num_trees, StochTree::data_size_t n, bool cache_tree_predictions);
+extern "C" SEXP _stochtree_forest_tracker_cpp(SEXP data, SEXP feature_types, SEXP num_trees, SEXP n, SEXP cache_tree_predictions) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(forest_tracker_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(data), cpp11::as_cpp<cpp11::decay_t<cpp11::integers>>(feature_types), cpp11::as_cpp<cpp11::decay_t<int>>(num_trees), cpp11::as_cpp<cpp11::decay_t<StochTree::data_size_t>>(n), cpp11::as_cpp<cpp11::decay_t<bool>>(cache_tree_predictions)));
+  END_CPP11
+}
+// sampler.cpp
+void forest_tracker_add_test_set_cpp(cpp11::external_pointer<StochTree::ForestTracker> tracker, cpp11::external_pointer<StochTree::ForestDataset> test_data);
+extern "C" SEXP _stochtree_forest_tracker_add_test_set_cpp(SEXP tracker, SEXP test_data) {
+  BEGIN_CPP11
+    forest_tracker_add_test_set_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestTracker>>>(tracker), cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(test_data));
+    return R_NilValue;
+  END_CPP11
+}
+// sampler.cpp
+cpp11::writable::doubles_matrix<> forest_tracker_test_set_predictions_cpp(cpp11::external_pointer<StochTree::ForestTracker> tracker);
+extern "C" SEXP _stochtree_forest_tracker_test_set_predictions_cpp(SEXP tracker) {
   BEGIN_CPP11
-    return cpp11::as_sexp(forest_tracker_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestDataset>>>(data), cpp11::as_cpp<cpp11::decay_t<cpp11::integers>>(feature_types), cpp11::as_cpp<cpp11::decay_t<int>>(num_trees), cpp11::as_cpp<cpp11::decay_t<StochTree::data_size_t>>(n)));
+    return cpp11::as_sexp(forest_tracker_test_set_predictions_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestTracker>>>(tracker)));
+  END_CPP11
+}
+// sampler.cpp
+void forest_tracker_set_num_threads_cpp(cpp11::external_pointer<StochTree::ForestTracker> tracker, int num_threads);
+extern "C" SEXP _stochtree_forest_tracker_set_num_threads_cpp(SEXP tracker, SEXP num_threads) {
+  BEGIN_CPP11
+    forest_tracker_set_num_threads_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<StochTree::ForestTracker>>>(tracker), cpp11::as_cpp<cpp11::decay_t<int>>(num_threads));
+    return R_NilValue;
   END_CPP11
 }
 // serialization.cpp
@@ -755,6 +853,21 @@ extern "C" SEXP _stochtree_json_add_rfx_groupids_cpp(SEXP json_ptr, SEXP groupid
   END_CPP11
 }
 // serialization.cpp
+void json_add_category_encoder_cpp(cpp11::external_pointer<nlohmann::json> json_ptr, cpp11::strings feature_names, cpp11::integers feature_types, cpp11::list feature_levels);
+extern "C" SEXP _stochtree_json_add_category_encoder_cpp(SEXP json_ptr, SEXP feature_names, SEXP feature_types, SEXP feature_levels) {
+  BEGIN_CPP11
+    json_add_category_encoder_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<nlohmann::json>>>(json_ptr), cpp11::as_cpp<cpp11::decay_t<cpp11::strings>>(feature_names), cpp11::as_cpp<cpp11::decay_t<cpp11::integers>>(feature_types), cpp11::as_cpp<cpp11::decay_t<cpp11::list>>(feature_levels));
+    return R_NilValue;
+  END_CPP11
+}
+// serialization.cpp
+cpp11::writable::list json_extract_category_encoder_cpp(cpp11::external_pointer<nlohmann::json> json_ptr);
+extern "C" SEXP _stochtree_json_extract_category_encoder_cpp(SEXP json_ptr) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(json_extract_category_encoder_cpp(cpp11::as_cpp<cpp11::decay_t<cpp11::external_pointer<nlohmann::json>>>(json_ptr)));
+  END_CPP11
+}
+// serialization.cpp
 void json_save_cpp(cpp11::external_pointer<nlohmann::json> json_ptr, std::string filename);
 extern "C" SEXP _stochtree_json_save_cpp(SEXP json_ptr, SEXP filename) {
   BEGIN_CPP11
@@ -775,6 +888,9 @@ extern "C" {
 static const R_CallMethodDef CallEntries[] = {
     {"_stochtree_add_sample_forest_container_cpp",                   (DL_FUNC) &_stochtree_add_sample_forest_container_cpp,                    1},
     {"_stochtree_all_roots_forest_container_cpp",                    (DL_FUNC) &_stochtree_all_roots_forest_container_cpp,                     2},
+    {"_stochtree_category_codes_cpp",                                (DL_FUNC) &_stochtree_category_codes_cpp,                                 3},
+    {"_stochtree_category_integer_levels_cpp",                       (DL_FUNC) &_stochtree_category_integer_levels_cpp,                        2},
+    {"_stochtree_category_one_hot_cpp",                              (DL_FUNC) &_stochtree_category_one_hot_cpp,                               3},
     {"_stochtree_create_column_vector_cpp",                          (DL_FUNC) &_stochtree_create_column_vector_cpp,                           1},
     {"_stochtree_create_forest_dataset_cpp",                         (DL_FUNC) &_stochtree_create_forest_dataset_cpp,                          0},
     {"_stochtree_create_rfx_dataset_cpp",                            (DL_FUNC) &_stochtree_create_rfx_dataset_cpp,                             0},
@@ -785,9 +901,15 @@ static const R_CallMethodDef CallEntries[] = {
     {"_stochtree_dataset_num_rows_cpp",                              (DL_FUNC) &_stochtree_dataset_num_rows_cpp,                               1},
     {"_stochtree_forest_container_cpp",                              (DL_FUNC) &_stochtree_forest_container_cpp,                               3},
     {"_stochtree_forest_container_from_json_cpp",                    (DL_FUNC) &_stochtree_forest_container_from_json_cpp,                     2},
-    {"_stochtree_forest_dataset_add_basis_cpp",                      (DL_FUNC) &_stochtree_forest_dataset_add_basis_cpp,                       2},
-    {"_stochtree_forest_dataset_add_covariates_cpp",                 (DL_FUNC) &_stochtree_forest_dataset_add_covariates_cpp,                  2},
+    {"_stochtree_forest_dataset_add_arrow_covariates_cpp",           (DL_FUNC) &_stochtree_forest_dataset_add_arrow_covariates_cpp,            5},
+    {"_stochtree_forest_dataset_add_basis_cpp",                      (DL_FUNC) &_stochtree_forest_dataset_add_basis_cpp,                       3},
+    {"_stochtree_forest_dataset_add_covariates_cpp",                 (DL_FUNC) &_stochtree_forest_dataset_add_covariates_cpp,                  3},
+    {"_stochtree_forest_dataset_add_integer_basis_cpp",              (DL_FUNC) &_stochtree_forest_dataset_add_integer_basis_cpp,               2},
+    {"_stochtree_forest_dataset_add_integer_covariates_cpp",         (DL_FUNC) &_stochtree_forest_dataset_add_integer_covariates_cpp,          2},
+    {"_stochtree_forest_dataset_add_row_major_covariates_cpp",       (DL_FUNC) &_stochtree_forest_dataset_add_row_major_covariates_cpp,        2},
+    {"_stochtree_forest_dataset_add_sparse_covariates_cpp",          (DL_FUNC) &_stochtree_forest_dataset_add_sparse_covariates_cpp,           6},
     {"_stochtree_forest_dataset_add_weights_cpp",                    (DL_FUNC) &_stochtree_forest_dataset_add_weights_cpp,                     2},
+    {"_stochtree_forest_dataset_bin_covariates_cpp",                 (DL_FUNC) &_stochtree_forest_dataset_bin_covariates_cpp,                  4},
     {"_stochtree_forest_dataset_update_basis_cpp",                   (DL_FUNC) &_stochtree_forest_dataset_update_basis_cpp,                    2},
     {"_stochtree_forest_kernel_compute_kernel_train_cpp",            (DL_FUNC) &_stochtree_forest_kernel_compute_kernel_train_cpp,             4},
     {"_stochtree_forest_kernel_compute_kernel_train_test_cpp",       (DL_FUNC) &_stochtree_forest_kernel_compute_kernel_train_test_cpp,        5},
@@ -796,11 +918,15 @@ static const R_CallMethodDef CallEntries[] = {
     {"_stochtree_forest_kernel_cpp",                                 (DL_FUNC) &_stochtree_forest_kernel_cpp,                                  0},
     {"_stochtree_forest_kernel_get_test_leaf_indices_cpp",           (DL_FUNC) &_stochtree_forest_kernel_get_test_leaf_indices_cpp,            1},
     {"_stochtree_forest_kernel_get_train_leaf_indices_cpp",          (DL_FUNC) &_stochtree_forest_kernel_get_train_leaf_indices_cpp,           1},
-    {"_stochtree_forest_tracker_cpp",                                (DL_FUNC) &_stochtree_forest_tracker_cpp,                                 4},
+    {"_stochtree_forest_tracker_add_test_set_cpp",                   (DL_FUNC) &_stochtree_forest_tracker_add_test_set_cpp,                    2},
+    {"_stochtree_forest_tracker_cpp",                                (DL_FUNC) &_stochtree_forest_tracker_cpp,                                 5},
+    {"_stochtree_forest_tracker_set_num_threads_cpp",                (DL_FUNC) &_stochtree_forest_tracker_set_num_threads_cpp,                 2},
+    {"_stochtree_forest_tracker_test_set_predictions_cpp",           (DL_FUNC) &_stochtree_forest_tracker_test_set_predictions_cpp,            1},
     {"_stochtree_init_json_cpp",                                     (DL_FUNC) &_stochtree_init_json_cpp,                                      0},
     {"_stochtree_is_leaf_constant_forest_container_cpp",             (DL_FUNC) &_stochtree_is_leaf_constant_forest_container_cpp,              1},
     {"_stochtree_json_add_bool_cpp",                                 (DL_FUNC) &_stochtree_json_add_bool_cpp,                                  3},
     {"_stochtree_json_add_bool_subfolder_cpp",                       (DL_FUNC) &_stochtree_json_add_bool_subfolder_cpp,                        4},
+    {"_stochtree_json_add_category_encoder_cpp",                     (DL_FUNC) &_stochtree_json_add_category_encoder_cpp,                      4},
     {"_stochtree_json_add_double_cpp",                               (DL_FUNC) &_stochtree_json_add_double_cpp,                                3},
     {"_stochtree_json_add_double_subfolder_cpp",                     (DL_FUNC) &_stochtree_json_add_double_subfolder_cpp,                      4},
     {"_stochtree_json_add_forest_cpp",                               (DL_FUNC) &_stochtree_json_add_forest_cpp,                                2},
@@ -817,6 +943,7 @@ static const R_CallMethodDef CallEntries[] = {
     {"_stochtree_json_contains_field_subfolder_cpp",                 (DL_FUNC) &_stochtree_json_contains_field_subfolder_cpp,                  3},
     {"_stochtree_json_extract_bool_cpp",                             (DL_FUNC) &_stochtree_json_extract_bool_cpp,                              2},
     {"_stochtree_json_extract_bool_subfolder_cpp",                   (DL_FUNC) &_stochtree_json_extract_bool_subfolder_cpp,                    3},
+    {"_stochtree_json_extract_category_encoder_cpp",                 (DL_FUNC) &_stochtree_json_extract_category_encoder_cpp,                  1},
     {"_stochtree_json_extract_double_cpp",                           (DL_FUNC) &_stochtree_json_extract_double_cpp,                            2},
     {"_stochtree_json_extract_double_subfolder_cpp",                 (DL_FUNC) &_stochtree_json_extract_double_subfolder_cpp,                  3},
     {"_stochtree_json_extract_string_cpp",                           (DL_FUNC) &_stochtree_json_extract_string_cpp,                            2},
@@ -833,9 +960,10 @@ static const R_CallMethodDef CallEntries[] = {
     {"_stochtree_num_samples_forest_container_cpp",                  (DL_FUNC) &_stochtree_num_samples_forest_container_cpp,                   1},
     {"_stochtree_num_trees_forest_container_cpp",                    (DL_FUNC) &_stochtree_num_trees_forest_container_cpp,                     1},
     {"_stochtree_output_dimension_forest_container_cpp",             (DL_FUNC) &_stochtree_output_dimension_forest_container_cpp,              1},
-    {"_stochtree_predict_forest_cpp",                                (DL_FUNC) &_stochtree_predict_forest_cpp,                                 2},
-    {"_stochtree_predict_forest_raw_cpp",                            (DL_FUNC) &_stochtree_predict_forest_raw_cpp,                             2},
+    {"_stochtree_predict_forest_cpp",                                (DL_FUNC) &_stochtree_predict_forest_cpp,                                 4},
+    {"_stochtree_predict_forest_raw_cpp",                            (DL_FUNC) &_stochtree_predict_forest_raw_cpp,                             4},
     {"_stochtree_predict_forest_raw_single_forest_cpp",              (DL_FUNC) &_stochtree_predict_forest_raw_single_forest_cpp,               3},
+    {"_stochtree_predict_summary_forest_cpp",                        (DL_FUNC) &_stochtree_predict_summary_forest_cpp,                         5},
     {"_stochtree_rfx_container_cpp",                                 (DL_FUNC) &_stochtree_rfx_container_cpp,                                  2},
     {"_stochtree_rfx_container_from_json_cpp",                       (DL_FUNC) &_stochtree_rfx_container_from_json_cpp,                        2},
     {"_stochtree_rfx_container_get_alpha_cpp",                       (DL_FUNC) &_stochtree_rfx_container_get_alpha_cpp,                        1},
@@ -6,7 +6,9 @@
 
 namespace StochTree {
 
-void FeatureCutpointGrid::CalculateStrides(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types) {
+template <typename CovariateMatrix>
+void FeatureCutpointGrid::CalculateStrides(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types, 
+                                           double const* node_residual_sum) {
   // Reset the stride vectors
   node_stride_begin_.clear();
   node_stride_length_.clear();
@@ -14,7 +16,20 @@ void FeatureCutpointGrid::CalculateStrides(Eigen::MatrixXd& covariates, Eigen::V
 
   // Compute feature strides
   FeatureType feature_type = feature_types[feature_index];
-  if (feature_type == FeatureType::kNumeric) {
+  BinnedColumnMatrix const* binned_covariates = feature_node_sort_tracker->GetBinnedCovariates();
+  if (binned_covariates != nullptr) {
+    CalculateStridesBinned(*binned_covariates, residuals, feature_node_sort_tracker, node_begin, node_end, feature_index, feature_type);
+  } else if (feature_node_sort_tracker->IsSparse()) {
+    double residual_sum = 0.0;
+    if (node_residual_sum != nullptr) {
+      residual_sum = *node_residual_sum;
+    } else if (feature_type == FeatureType::kUnorderedCategorical) {
+      for (auto it = feature_node_sort_tracker->NodeRowsBegin(node_id); it != feature_node_sort_tracker->NodeRowsEnd(node_id); ++it) {
+        residual_sum += residuals(*it);
+      }
+    }
+    CalculateStridesSparse(residuals, feature_node_sort_tracker, node_id, node_begin, node_end, feature_index, feature_type, residual_sum);
+  } else if (feature_type == FeatureType::kNumeric) {
     CalculateStridesNumeric(covariates, residuals, feature_node_sort_tracker, node_id, node_begin, node_end, feature_index);
   } else if (feature_type == FeatureType::kOrderedCategorical) {
     CalculateStridesOrderedCategorical(covariates, residuals, feature_node_sort_tracker, node_id, node_begin, node_end, feature_index);
@@ -23,7 +38,8 @@ void FeatureCutpointGrid::CalculateStrides(Eigen::MatrixXd& covariates, Eigen::V
   }
 }
 
-void FeatureCutpointGrid::CalculateStridesNumeric(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index) {
+template <typename CovariateMatrix>
+void FeatureCutpointGrid::CalculateStridesNumeric(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index) {
   data_size_t node_size = node_end - node_begin;
   // Check if node has fewer observations than cutpoint_grid_size
   if (node_size <= cutpoint_grid_size_) {
@@ -41,7 +57,8 @@ void FeatureCutpointGrid::CalculateStridesNumeric(Eigen::MatrixXd& covariates, E
   }
 }
 
-void FeatureCutpointGrid::CalculateStridesOrderedCategorical(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index) {
+template <typename CovariateMatrix>
+void FeatureCutpointGrid::CalculateStridesOrderedCategorical(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index) {
   data_size_t node_size = node_end - node_begin;
   
   // Edge case 1: single observation
@@ -103,7 +120,8 @@ void FeatureCutpointGrid::CalculateStridesOrderedCategorical(Eigen::MatrixXd& co
   }
 }
 
-void FeatureCutpointGrid::CalculateStridesUnorderedCategorical(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index) {
+template <typename CovariateMatrix>
+void FeatureCutpointGrid::CalculateStridesUnorderedCategorical(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index) {
   // TODO: refactor so that this initial code is shared between ordered and unordered categorical cutpoint calculation
   data_size_t node_size = node_end - node_begin;
   std::vector<double> bin_sums;
@@ -174,6 +192,10 @@ void FeatureCutpointGrid::CalculateStridesUnorderedCategorical(Eigen::MatrixXd&
   }
 
   // Now re-arrange the categories according to the average outcome as in Fisher (1958)
+  SortStridesByMeanOutcome(bin_sums);
+}
+
+void FeatureCutpointGrid::SortStridesByMeanOutcome(std::vector<double>& bin_sums) {
 //  CHECK_EQ(residuals.cols(), 1);
   std::vector<double> bin_avgs(bin_sums.size());
   for (int i = 0; i < bin_sums.size(); i++) {
@@ -199,7 +221,142 @@ void FeatureCutpointGrid::CalculateStridesUnorderedCategorical(Eigen::MatrixXd&
   }
 }
 
-void FeatureCutpointGrid::EnumerateNumericCutpointsDeduplication(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index) {
+void FeatureCutpointGrid::CalculateStridesBinned(BinnedColumnMatrix const& binned_covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, data_size_t node_begin, data_size_t node_end, int32_t feature_index, FeatureType feature_type) {
+  bool unordered_categorical = (feature_type == FeatureType::kUnorderedCategorical);
+  if (unordered_categorical && !binned_covariates.IsExact(feature_index)) {
+    Log::Fatal("Unordered categorical feature %d has more categories than the number of bins", feature_index);
+  }
+  
+  // Numeric features of nodes larger than the cutpoint grid are thinned out as in ScanNumericCutpoints
+  data_size_t node_size = node_end - node_begin;
+  bool thin_cutpoints = (feature_type == FeatureType::kNumeric) && (node_size > cutpoint_grid_size_);
+  double step_size = node_size / cutpoint_grid_size_;
+
+  // Observations are sorted by bin code, so a stride ends when the code changes
+  std::vector<double> bin_sums;
+  data_size_t stride_begin = node_begin;
+  data_size_t stride_length = 0;
+  double bin_sum = 0;
+  for (data_size_t i = node_begin; i < node_end; i++) {
+    data_size_t current_sort_ind = feature_node_sort_tracker->SortIndex(i, feature_index);
+    std::uint16_t current_code = binned_covariates.BinCode(current_sort_ind, feature_index);
+    stride_length += 1;
+    if (unordered_categorical) bin_sum += residuals(current_sort_ind);
+
+    bool stride_complete = (i == node_end - 1);
+    if (!stride_complete) {
+      bool bin_complete = !thin_cutpoints || ((stride_length <= step_size) && ((stride_length + 1) > step_size));
+      std::uint16_t next_code = binned_covariates.BinCode(feature_node_sort_tracker->SortIndex(i + 1, feature_index), feature_index);
+      stride_complete = bin_complete && (next_code != current_code);
+    }
+    if (stride_complete) {
+      // The upper bound of the bin is the cutpoint, so splits map back to real-valued thresholds (or categories)
+      node_stride_begin_.push_back(stride_begin);
+      node_stride_length_.push_back(stride_length);
+      cutpoint_values_.push_back(binned_covariates.UpperBound(feature_index, current_code));
+      if (unordered_categorical) bin_sums.push_back(bin_sum);
+      stride_begin += stride_length;
+      stride_length = 0;
+      bin_sum = 0;
+    }
+  }
+
+  if (unordered_categorical) SortStridesByMeanOutcome(bin_sums);
+}
+
+void FeatureCutpointGrid::CalculateStridesSparse(Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, FeatureType feature_type, double node_residual_sum) {
+  bool numeric = (feature_type == FeatureType::kNumeric);
+  bool unordered_categorical = (feature_type == FeatureType::kUnorderedCategorical);
+  data_size_t node_size = node_end - node_begin;
+  data_size_t nonzero_begin = feature_node_sort_tracker->NodeNonzeroBegin(node_id, feature_index);
+  data_size_t nonzero_end = feature_node_sort_tracker->NodeNonzeroEnd(node_id, feature_index);
+  data_size_t num_negative = feature_node_sort_tracker->NodeNumNegative(node_id, feature_index);
+  data_size_t num_zeros = feature_node_sort_tracker->NodeNumZeros(node_id, feature_index);
+
+  // Values appear in sorted order as runs: one run per nonzero entry, and the zeros as a single run between the negative and positive entries
+  data_size_t num_runs = (nonzero_end - nonzero_begin) + (num_zeros > 0 ? 1 : 0);
+  auto run_entry = [&](data_size_t run) -> data_size_t {
+    // Position of the nonzero entry of a run, or -1 for the run of zeros
+    if (run < num_negative) return nonzero_begin + run;
+    if (num_zeros == 0) return nonzero_begin + run;
+    if (run == num_negative) return -1;
+    return nonzero_begin + run - 1;
+  };
+  auto run_value = [&](data_size_t run) -> double {
+    data_size_t k = run_entry(run);
+    return (k < 0) ? 0.0 : feature_node_sort_tracker->NonzeroEntry(k, feature_index).value;
+  };
+  auto cutpoint_value = [&](double value) -> double {
+    return numeric ? value : static_cast<double>(static_cast<std::uint32_t>(value));
+  };
+
+  // Edge case 1: single observation
+  if (node_size == 1) {
+    node_stride_begin_.push_back(node_begin);
+    node_stride_length_.push_back(1);
+    cutpoint_values_.push_back(cutpoint_value(run_value(0)));
+    return;
+  }
+
+  // Edge case 2: single unique value (or category)
+  double first_val = run_value(0);
+  double last_val = run_value(num_runs - 1);
+  bool single_value = numeric ? (std::fabs(last_val - first_val) < StochTree::kEpsilon) : 
+                                (static_cast<std::uint32_t>(last_val) == static_cast<std::uint32_t>(first_val));
+  if (single_value) {
+    node_stride_begin_.push_back(node_begin);
+    node_stride_length_.push_back(node_size);
+    cutpoint_values_.push_back(cutpoint_value(first_val));
+    return;
+  }
+
+  // The residual sum of the zeros is the node's residual sum less that of the nonzero entries
+  double zeros_residual_sum = node_residual_sum;
+  if (unordered_categorical) {
+    for (data_size_t k = nonzero_begin; k < nonzero_end; k++) zeros_residual_sum -= residuals(feature_node_sort_tracker->NonzeroEntry(k, feature_index).row);
+  }
+
+  // Numeric features of nodes larger than the cutpoint grid are thinned out as in ScanNumericCutpoints
+  bool thin_cutpoints = numeric && (node_size > cutpoint_grid_size_);
+  double step_size = node_size / cutpoint_grid_size_;
+
+  // Apply the dense algorithms run by run, since a stride cannot end between two observations of the same value
+  std::vector<double> bin_sums;
+  data_size_t stride_begin = node_begin;
+  data_size_t stride_length = 0;
+  double bin_sum = 0;
+  for (data_size_t run = 0; run < num_runs; run++) {
+    data_size_t k = run_entry(run);
+    double current_val = run_value(run);
+    stride_length += (k < 0) ? num_zeros : 1;
+    if (unordered_categorical) bin_sum += (k < 0) ? zeros_residual_sum : residuals(feature_node_sort_tracker->NonzeroEntry(k, feature_index).row);
+
+    bool stride_complete = (run == num_runs - 1);
+    if (!stride_complete) {
+      double next_val = run_value(run + 1);
+      if (unordered_categorical) {
+        stride_complete = (static_cast<std::uint32_t>(next_val) != static_cast<std::uint32_t>(current_val));
+      } else {
+        bool bin_complete = !thin_cutpoints || ((stride_length <= step_size) && ((stride_length + 1) > step_size));
+        stride_complete = bin_complete && (std::fabs(next_val - current_val) > StochTree::kEpsilon);
+      }
+    }
+    if (stride_complete) {
+      node_stride_begin_.push_back(stride_begin);
+      node_stride_length_.push_back(stride_length);
+      cutpoint_values_.push_back(cutpoint_value(current_val));
+      if (unordered_categorical) bin_sums.push_back(bin_sum);
+      stride_begin += stride_length;
+      stride_length = 0;
+      bin_sum = 0;
+    }
+  }
+
+  if (unordered_categorical) SortStridesByMeanOutcome(bin_sums);
+}
+
+template <typename CovariateMatrix>
+void FeatureCutpointGrid::EnumerateNumericCutpointsDeduplication(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index) {
   // Edge case 1: single observation
   double single_value;
   if (node_end - node_begin == 1) {
@@ -258,7 +415,8 @@ void FeatureCutpointGrid::EnumerateNumericCutpointsDeduplication(Eigen::MatrixXd
   }
 }
 
-void FeatureCutpointGrid::ScanNumericCutpoints(Eigen::MatrixXd& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index) {
+template <typename CovariateMatrix>
+void FeatureCutpointGrid::ScanNumericCutpoints(CovariateMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, data_size_t node_size, int32_t feature_index) {
   // Edge case 1: single observation
   double single_value;
   if (node_end - node_begin == 1) {
@@ -320,4 +478,10 @@ void FeatureCutpointGrid::ScanNumericCutpoints(Eigen::MatrixXd& covariates, Eige
   }
 }
 
+// Covariates may be stored densely in double or single precision, as a sparse matrix, or as bins only (see ForestDataset)
+template void FeatureCutpointGrid::CalculateStrides(DataMatrixMapT<double>& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types, double const* node_residual_sum);
+template void FeatureCutpointGrid::CalculateStrides(DataMatrixMapT<float>& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types, double const* node_residual_sum);
+template void FeatureCutpointGrid::CalculateStrides(SparseColumnMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types, double const* node_residual_sum);
+template void FeatureCutpointGrid::CalculateStrides(BinnedColumnMatrix& covariates, Eigen::VectorXd& residuals, SortedNodeSampleTracker* feature_node_sort_tracker, int32_t node_id, data_size_t node_begin, data_size_t node_end, int32_t feature_index, std::vector<FeatureType>& feature_types, double const* node_residual_sum);
+
 } // namespace StochTree
@@ -1,46 +1,227 @@
 /*! Copyright (c) 2024 by stochtree authors */
 #include <Eigen/Dense>
 #include <stochtree/data.h>
+#include <stochtree/parallel.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <numeric>
+#include <type_traits>
 
 namespace StochTree {
 
-ColumnMatrix::ColumnMatrix(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
-  LoadData(data_ptr, num_row, num_col, is_row_major);
+ColumnVector::ColumnVector(double* data_ptr, data_size_t num_row) {
+  LoadData(data_ptr, num_row);
 }
 
-void ColumnMatrix::LoadData(double* data_ptr, data_size_t num_row, int num_col, bool is_row_major) {
-  data_.resize(num_row, num_col);
+void ColumnVector::LoadData(double* data_ptr, data_size_t num_row) {
+  data_.resize(num_row);
 
   // Copy data from R / Python process memory to Eigen matrix
   double temp_value;
   for (data_size_t i = 0; i < num_row; ++i) {
-    for (int j = 0; j < num_col; ++j) {
-      if (is_row_major){
-        // Numpy 2-d arrays are stored in "row major" order
-        temp_value = static_cast<double>(*(data_ptr + static_cast<data_size_t>(num_col) * i + j));
+    temp_value = static_cast<double>(*(data_ptr + i));
+    data_(i) = temp_value;
+  }
+}
+
+void SparseColumnMatrix::LoadData(int const* col_ptr, int const* row_index, double const* values, data_size_t num_row, int num_col) {
+  if (col_ptr[0] != 0) {
+    Log::Fatal("Column pointers of a sparse matrix must start at 0");
+  }
+  for (int j = 0; j < num_col; j++) {
+    if (col_ptr[j + 1] < col_ptr[j]) {
+      Log::Fatal("Column pointers of a sparse matrix must be nondecreasing");
+    }
+    // Element access uses a binary search, which requires sorted, unique rows within each column
+    for (int k = col_ptr[j]; k < col_ptr[j + 1]; k++) {
+      if (row_index[k] < 0 || row_index[k] >= num_row || (k > col_ptr[j] && row_index[k] <= row_index[k - 1])) {
+        Log::Fatal("Row indices of column %d of a sparse matrix must be strictly increasing and less than %d", j, num_row);
+      }
+    }
+  }
+  Eigen::Map<const MatrixType> source(num_row, num_col, col_ptr[num_col], col_ptr, row_index, values);
+  data_ = source;
+}
+
+template <typename Scalar>
+void BinnedColumnMatrix::LoadData(DataMatrixMapT<Scalar>& covariates, int max_bins, int num_threads) {
+  if (max_bins < 2 || max_bins > 65536) {
+    Log::Fatal("max_bins must be between 2 and 65536, got %d", max_bins);
+  }
+  num_rows_ = covariates.rows();
+  num_cols_ = covariates.cols();
+
+  // The code width only depends on max_bins, so codes can be written as soon as a feature's bins are known
+  wide_codes_ = max_bins > 256;
+  std::size_t num_codes = static_cast<std::size_t>(num_rows_) * num_cols_;
+  codes_.clear();
+  codes_wide_.clear();
+  if (wide_codes_) {
+    codes_wide_.resize(num_codes);
+  } else {
+    codes_.resize(num_codes);
+  }
+
+  // Missing values are rejected on the calling thread, as Log::Fatal may call into the R API
+  for (int j = 0; j < num_cols_; j++) {
+    for (data_size_t i = 0; i < num_rows_; i++) {
+      if (std::isnan(covariates(i, j))) Log::Fatal("Binned covariates cannot contain missing values (feature %d)", j);
+    }
+  }
+
+  // Sort each feature, choose its bin upper bounds and assign its codes, holding one sort index per thread at a time
+  std::vector<std::vector<double>> feature_bounds(num_cols_);
+  std::vector<char> feature_exact(num_cols_);
+  ParallelFor(0, num_cols_, 1, num_threads, [&](int64_t col_begin, int64_t col_end) {
+    for (int j = col_begin; j < col_end; j++) {
+      std::vector<data_size_t> sort_indices(num_rows_);
+      std::iota(sort_indices.begin(), sort_indices.end(), 0);
+      std::stable_sort(sort_indices.begin(), sort_indices.end(), [&](data_size_t l, data_size_t r) {return covariates(l, j) < covariates(r, j);});
+
+      // Unique values and their counts
+      std::vector<double> unique_values;
+      std::vector<data_size_t> unique_counts;
+      for (data_size_t i = 0; i < num_rows_; i++) {
+        double value = covariates(sort_indices[i], j);
+        if (unique_values.empty() || value != unique_values.back()) {
+          unique_values.push_back(value);
+          unique_counts.push_back(0);
+        }
+        unique_counts.back()++;
+      }
+
+      std::vector<double>& bounds = feature_bounds[j];
+      feature_exact[j] = unique_values.size() <= static_cast<std::size_t>(max_bins);
+      if (feature_exact[j]) {
+        bounds = std::move(unique_values);
       } else {
-        // R matrices are stored in "column major" order
-        temp_value = static_cast<double>(*(data_ptr + static_cast<data_size_t>(num_row) * j + i));
+        // Close a bin once it holds its share of the rows not yet assigned to a bin
+        data_size_t rows_left = num_rows_;
+        data_size_t bin_count = 0;
+        int bins_left = max_bins;
+        for (std::size_t k = 0; k < unique_values.size(); k++) {
+          bin_count += unique_counts[k];
+          bool last_value = (k == unique_values.size() - 1);
+          if (last_value || (bins_left > 1 && bin_count >= static_cast<double>(rows_left) / bins_left)) {
+            bounds.push_back(unique_values[k]);
+            rows_left -= bin_count;
+            bin_count = 0;
+            bins_left--;
+          }
+        }
+      }
+
+      // Assign codes by walking the feature in sorted order
+      std::size_t offset = static_cast<std::size_t>(j) * num_rows_;
+      std::uint16_t bin = 0;
+      for (data_size_t i = 0; i < num_rows_; i++) {
+        data_size_t row = sort_indices[i];
+        while (covariates(row, j) > bounds[bin]) bin++;
+        if (wide_codes_) {
+          codes_wide_[offset + row] = bin;
+        } else {
+          codes_[offset + row] = static_cast<std::uint8_t>(bin);
+        }
       }
-      data_(i, j) = temp_value;
     }
+  });
+
+  // Lay out the bin upper bounds of every feature contiguously
+  bin_offsets_.assign(num_cols_ + 1, 0);
+  for (int j = 0; j < num_cols_; j++) {
+    bin_offsets_[j + 1] = bin_offsets_[j] + feature_bounds[j].size();
   }
+  upper_bounds_.resize(bin_offsets_[num_cols_]);
+  for (int j = 0; j < num_cols_; j++) {
+    std::copy(feature_bounds[j].begin(), feature_bounds[j].end(), upper_bounds_.begin() + bin_offsets_[j]);
+  }
+  exact_.assign(feature_exact.begin(), feature_exact.end());
 }
 
-ColumnVector::ColumnVector(double* data_ptr, data_size_t num_row) {
-  LoadData(data_ptr, num_row);
+template void BinnedColumnMatrix::LoadData<double>(DataMatrixMapT<double>& covariates, int max_bins, int num_threads);
+template void BinnedColumnMatrix::LoadData<float>(DataMatrixMapT<float>& covariates, int max_bins, int num_threads);
+
+bool BinnedColumnMatrix::SplitBin(int col, double threshold, int& bin) const {
+  auto bounds_begin = upper_bounds_.begin() + bin_offsets_[col];
+  auto bounds_end = upper_bounds_.begin() + bin_offsets_[col + 1];
+  // Bins whose upper bound is at most the threshold are entirely to the left of the split
+  int num_left = static_cast<int>(std::upper_bound(bounds_begin, bounds_end, threshold) - bounds_begin);
+  bin = num_left - 1;
+  if (exact_[col] || num_left == NumBins(col)) return true;
+  // Otherwise the next bin straddles the threshold unless it starts right after it
+  return num_left > 0 && *(bounds_begin + (num_left - 1)) == threshold;
 }
 
-void ColumnVector::LoadData(double* data_ptr, data_size_t num_row) {
-  data_.resize(num_row);
+void ForestDataset::BinCovariates(int max_bins, int num_threads, bool release_covariates) {
+  CHECK(has_covariates_);
+  if (sparse_covariates_stored_) {
+    Log::Fatal("Sparse covariates cannot be binned");
+  }
+  if (raw_covariates_released_) {
+    Log::Fatal("The covariates of this dataset were released when they were binned and cannot be binned again");
+  }
+  VisitDenseCovariates([&](auto& covariates) {binned_covariates_.LoadData(covariates, max_bins, num_threads);});
+  has_binned_covariates_ = true;
+  if (release_covariates) {
+    covariates_ = ColumnMatrix();
+    float_covariates_ = FloatColumnMatrix();
+    single_precision_covariates_ = false;
+    row_major_covariates_ = ColumnMatrix();
+    row_major_float_covariates_ = FloatColumnMatrix();
+    row_major_storage_.reset();
+    row_major_copy_stored_ = false;
+    has_row_major_covariates_ = false;
+    presort_index_ = nullptr;
+    raw_covariates_released_ = true;
+  }
+}
 
-  // Copy data from R / Python process memory to Eigen matrix
-  double temp_value;
-  for (data_size_t i = 0; i < num_row; ++i) {
-    temp_value = static_cast<double>(*(data_ptr + i));
-    data_(i) = temp_value;
+/*! \brief Number of rows transposed by each parallel task of `AddRowMajorCovariates` */
+static constexpr int64_t kRowMajorRowBlockSize = 256;
+/*! \brief Number of columns of the tiles in which `AddRowMajorCovariates` transposes a block of rows */
+static constexpr int kRowMajorColumnTileSize = 64;
+
+/*! \brief Copy `covariates` into a new row-major buffer, in tiles of rows and columns whose cache lines stay resident while they are transposed */
+template <typename Scalar>
+static std::shared_ptr<std::vector<Scalar>> RowMajorCopy(DataMatrixMapT<Scalar>& covariates, int num_threads) {
+  int64_t num_row = covariates.rows();
+  int num_col = covariates.cols();
+  auto output = std::make_shared<std::vector<Scalar>>(num_row * num_col);
+  Scalar* output_data = output->data();
+  ParallelFor(0, num_row, kRowMajorRowBlockSize, num_threads, [&](int64_t block_begin, int64_t block_end) {
+    for (int tile_begin = 0; tile_begin < num_col; tile_begin += kRowMajorColumnTileSize) {
+      int tile_end = std::min(num_col, tile_begin + kRowMajorColumnTileSize);
+      for (int64_t i = block_begin; i < block_end; i++) {
+        Scalar* row_output = output_data + i * num_col;
+        for (int j = tile_begin; j < tile_end; j++) {
+          row_output[j] = covariates(i, j);
+        }
+      }
+    }
+  });
+  return output;
+}
+
+void ForestDataset::AddRowMajorCovariates(int num_threads) {
+  CHECK(has_covariates_);
+  if (sparse_covariates_stored_) {
+    Log::Fatal("A row-major copy can only be made of dense covariates");
   }
+  if (has_row_major_covariates_) return;
+  VisitDenseCovariates([&](auto& covariates) {
+    // Covariates that borrow a row-major buffer (e.g. a C-ordered numpy array) are read in place
+    if (covariates.outerStride() == 1 || covariates.cols() == 1) return;
+    auto storage = RowMajorCopy(covariates, num_threads);
+    if constexpr (std::is_same_v<typename std::decay_t<decltype(covariates)>::Scalar, float>) {
+      row_major_float_covariates_.BorrowData(storage->data(), num_observations_, num_covariates_, true);
+    } else {
+      row_major_covariates_.BorrowData(storage->data(), num_observations_, num_covariates_, true);
+    }
+    row_major_storage_ = std::move(storage);
+    row_major_copy_stored_ = true;
+  });
+  has_row_major_covariates_ = true;
 }
 
 void LoadData(double* data_ptr, int num_row, int num_col, bool is_row_major, Eigen::MatrixXd& data_matrix) {
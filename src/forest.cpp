@@ -106,12 +106,12 @@ void update_residual_forest_container_cpp(cpp11::external_pointer<StochTree::For
 }
 
 [[cpp11::register]]
-cpp11::writable::doubles_matrix<> predict_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset) {
+cpp11::writable::doubles_matrix<> predict_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, int num_threads = 1, int engine = 0) {
     // Predict from the sampled forests
-    std::vector<double> output_raw = forest_samples->Predict(*dataset);
+    std::vector<double> output_raw = forest_samples->Predict(*dataset, num_threads, static_cast<StochTree::ForestPredictEngine>(engine));
     
     // Convert result to a matrix
-    int n = dataset->GetCovariates().rows();
+    int n = dataset->NumObservations();
     int num_samples = forest_samples->NumSamples();
     cpp11::writable::doubles_matrix<> output(n, num_samples);
     for (size_t i = 0; i < n; i++) {
@@ -124,14 +124,14 @@ cpp11::writable::doubles_matrix<> predict_forest_cpp(cpp11::external_pointer<Sto
 }
 
 [[cpp11::register]]
-cpp11::writable::doubles_matrix<> predict_forest_raw_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset) {
+cpp11::writable::doubles_matrix<> predict_forest_raw_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, int num_threads = 1, int engine = 0) {
     // Predict from the sampled forests
-    std::vector<double> output_raw = forest_samples->PredictRaw(*dataset);
-    
-    // Convert result to a matrix
-    int n = dataset->GetCovariates().rows();
+    int n = dataset->NumObservations();
     int num_samples = forest_samples->NumSamples();
     int output_dimension = forest_samples->OutputDimension();
+    std::vector<double> output_raw = forest_samples->PredictRaw(*dataset, num_threads, static_cast<StochTree::ForestPredictEngine>(engine));
+    
+    // Convert result to a matrix
     int num_rows = n * output_dimension;
     cpp11::writable::doubles_matrix<> output(num_rows, num_samples);
     for (size_t i = 0; i < num_rows; i++) {
@@ -146,10 +146,10 @@ cpp11::writable::doubles_matrix<> predict_forest_raw_cpp(cpp11::external_pointer
 [[cpp11::register]]
 cpp11::writable::doubles_matrix<> predict_forest_raw_single_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, int forest_num) {
     // Predict from the sampled forests
-    std::vector<double> output_raw = forest_samples->PredictRaw(*dataset, forest_num);
+    std::vector<double> output_raw = forest_samples->PredictRawSingleForest(*dataset, forest_num);
     
     // Convert result to a matrix
-    int n = dataset->GetCovariates().rows();
+    int n = dataset->NumObservations();
     int output_dimension = forest_samples->OutputDimension();
     cpp11::writable::doubles_matrix<> output(n, output_dimension);
     for (size_t i = 0; i < n; i++) {
@@ -160,3 +160,33 @@ cpp11::writable::doubles_matrix<> predict_forest_raw_single_forest_cpp(cpp11::ex
     
     return output;
 }
+
+[[cpp11::register]]
+cpp11::writable::list predict_summary_forest_cpp(cpp11::external_pointer<StochTree::ForestContainer> forest_samples, cpp11::external_pointer<StochTree::ForestDataset> dataset, cpp11::integers sample_indices, cpp11::doubles quantile_probs, int num_threads = 1) {
+    // Unpack the (0-indexed) samples and quantiles to summarize
+    std::vector<int> sample_indices_cpp(sample_indices.begin(), sample_indices.end());
+    std::vector<double> quantile_probs_cpp(quantile_probs.begin(), quantile_probs.end());
+    
+    // Summarize predictions from the sampled forests
+    std::vector<double> mean_raw;
+    std::vector<double> variance_raw;
+    std::vector<double> quantile_raw;
+    forest_samples->PredictSummary(*dataset, sample_indices_cpp, quantile_probs_cpp, mean_raw, variance_raw, quantile_raw, num_threads);
+    
+    // Convert quantiles to a matrix
+    int n = dataset->NumObservations();
+    int num_quantiles = quantile_probs_cpp.size();
+    cpp11::writable::doubles_matrix<> quantile_output(n, num_quantiles);
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < num_quantiles; j++) {
+            quantile_output(i, j) = quantile_raw[n*j + i];
+        }
+    }
+    
+    // Return list of mean, variance, and quantiles
+    cpp11::writable::list result;
+    result.push_back(cpp11::writable::doubles(mean_raw.begin(), mean_raw.end()));
+    result.push_back(cpp11::writable::doubles(variance_raw.begin(), variance_raw.end()));
+    result.push_back(quantile_output);
+    return result;
+}
@@ -11,12 +11,22 @@
 #include <sstream>
 #include <unordered_map>
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace StochTree {
 
 struct LocalFile : VirtualFileReader, VirtualFileWriter {
   LocalFile(const std::string& filename, const std::string& mode)
       : filename_(filename), mode_(mode) {}
   virtual ~LocalFile() {
+#if !defined(_WIN32)
+    if (mapped_ != NULL) {
+      munmap(mapped_, mapped_size_);
+    }
+#endif
     if (file_ != NULL) {
       fclose(file_);
     }
@@ -46,8 +56,42 @@ struct LocalFile : VirtualFileReader, VirtualFileWriter {
     return fwrite(buffer, bytes, 1, file_) == 1 ? bytes : 0;
   }
 
+  const char* MapReadOnly(size_t* size) {
+#if !defined(_WIN32)
+    if (mapped_ == NULL && file_ != NULL) {
+      struct stat file_stat;
+      if (fstat(fileno(file_), &file_stat) != 0 || file_stat.st_size <= 0) {
+        return NULL;
+      }
+      void* mapped = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fileno(file_), 0);
+      if (mapped == MAP_FAILED) {
+        return NULL;
+      }
+      mapped_ = mapped;
+      mapped_size_ = file_stat.st_size;
+    }
+    *size = mapped_size_;
+    return static_cast<const char*>(mapped_);
+#else
+    // Memory mapping is not implemented on Windows, where files are read into memory instead
+    return NULL;
+#endif
+  }
+
+  size_t Size() const {
+#if !defined(_WIN32)
+    struct stat file_stat;
+    if (file_ != NULL && fstat(fileno(file_), &file_stat) == 0 && file_stat.st_size > 0) {
+      return static_cast<size_t>(file_stat.st_size);
+    }
+#endif
+    return 0;
+  }
+
  private:
   FILE* file_ = NULL;
+  void* mapped_ = NULL;
+  size_t mapped_size_ = 0;
   const std::string filename_;
   const std::string mode_;
 };
@@ -68,13 +68,22 @@ void AccumulateSingleNodeSuffStat(SuffStatType& node_suff_stat, ForestDataset& d
 }
 
 template<typename SuffStatType>
-void AccumulateCutpointBinSuffStat(SuffStatType& left_suff_stat, ForestTracker& tracker, CutpointGridContainer& cutpoint_grid_container, 
+void AccumulateZerosSuffStat(SuffStatType& zeros_suff_stat, SuffStatType& node_suff_stat, ForestTracker& tracker, ForestDataset& dataset, 
+                             ColumnVector& residual, int node_id, int feature_num) {
+  // The implicit zeros of a sparse feature hold every observation of the node that is not one of its nonzero entries
+  SortedNodeSampleTracker* sorted_tracker = tracker.GetSortedNodeSampleTracker();
+  SuffStatType nonzero_suff_stat = node_suff_stat;
+  nonzero_suff_stat.ResetSuffStat();
+  for (data_size_t k = sorted_tracker->NodeNonzeroBegin(node_id, feature_num); k < sorted_tracker->NodeNonzeroEnd(node_id, feature_num); k++) {
+    nonzero_suff_stat.IncrementSuffStat(dataset, residual.GetData(), sorted_tracker->NonzeroEntry(k, feature_num).row);
+  }
+  zeros_suff_stat.SubtractSuffStat(node_suff_stat, nonzero_suff_stat);
+}
+
+template<typename SuffStatType>
+void AccumulateCutpointBinSuffStat(SuffStatType& left_suff_stat, SuffStatType& zeros_suff_stat, ForestTracker& tracker, CutpointGridContainer& cutpoint_grid_container, 
                                    ForestDataset& dataset, ColumnVector& residual, double global_variance, int tree_num, int node_id, 
                                    int feature_num, int cutpoint_num) {
-  // Acquire iterators
-  auto node_begin_iter = tracker.SortedNodeBeginIterator(node_id, feature_num);
-  auto node_end_iter = tracker.SortedNodeEndIterator(node_id, feature_num);
-  
   // Determine node start point
   data_size_t node_begin = tracker.SortedNodeBegin(node_id, feature_num);
 
@@ -83,6 +92,30 @@ void AccumulateCutpointBinSuffStat(SuffStatType& left_suff_stat, ForestTracker&
   data_size_t current_bin_size = cutpoint_grid_container.BinLength(cutpoint_num, feature_num);
   data_size_t next_bin_begin = cutpoint_grid_container.BinStartIndex(cutpoint_num + 1, feature_num);
 
+  SortedNodeSampleTracker* sorted_tracker = tracker.GetSortedNodeSampleTracker();
+  if (sorted_tracker->IsSparse()) {
+    // Negative entries precede the run of zeros and positive entries follow it, and a bin holds either all or none of the zeros
+    data_size_t nonzero_begin = sorted_tracker->NodeNonzeroBegin(node_id, feature_num);
+    data_size_t zeros_begin = node_begin + sorted_tracker->NodeNumNegative(node_id, feature_num);
+    data_size_t num_zeros = sorted_tracker->NodeNumZeros(node_id, feature_num);
+    data_size_t zeros_end = zeros_begin + num_zeros;
+    data_size_t bin_end = current_bin_begin + current_bin_size;
+    for (data_size_t i = current_bin_begin; i < std::min(bin_end, zeros_begin); i++) {
+      left_suff_stat.IncrementSuffStat(dataset, residual.GetData(), sorted_tracker->NonzeroEntry(nonzero_begin + i - node_begin, feature_num).row);
+    }
+    if ((num_zeros > 0) && (current_bin_begin <= zeros_begin) && (zeros_begin < bin_end)) {
+      left_suff_stat.AddSuffStat(left_suff_stat, zeros_suff_stat);
+    }
+    for (data_size_t i = std::max(current_bin_begin, zeros_end); i < bin_end; i++) {
+      left_suff_stat.IncrementSuffStat(dataset, residual.GetData(), sorted_tracker->NonzeroEntry(nonzero_begin + i - node_begin - num_zeros, feature_num).row);
+    }
+    return;
+  }
+
+  // Acquire iterators
+  auto node_begin_iter = tracker.SortedNodeBeginIterator(node_id, feature_num);
+  auto node_end_iter = tracker.SortedNodeEndIterator(node_id, feature_num);
+
   // Cutpoint specific iterators
   // TODO: fix the hack of having to subtract off node_begin, probably by cleaning up the CutpointGridContainer interface
   auto cutpoint_begin_iter = node_begin_iter + current_bin_begin - node_begin;
@@ -142,6 +175,7 @@ void GaussianConstantLeafModel::EvaluateAllPossibleSplits(ForestDataset& dataset
   GaussianConstantSuffStat node_suff_stat = GaussianConstantSuffStat();
   GaussianConstantSuffStat left_suff_stat = GaussianConstantSuffStat();
   GaussianConstantSuffStat right_suff_stat = GaussianConstantSuffStat();
+  GaussianConstantSuffStat zeros_suff_stat = GaussianConstantSuffStat();
 
   // Accumulate aggregate sufficient statistic for the node to be split
   AccumulateSingleNodeSuffStat<GaussianConstantSuffStat, false>(node_suff_stat, dataset, tracker, residual, tree_num, node_id);
@@ -150,11 +184,7 @@ void GaussianConstantLeafModel::EvaluateAllPossibleSplits(ForestDataset& dataset
   double no_split_log_ml = NoSplitLogMarginalLikelihood(node_suff_stat, global_variance);
 
   // Unpack data
-  Eigen::MatrixXd covariates = dataset.GetCovariates();
-  Eigen::VectorXd outcome = residual.GetData();
-  Eigen::VectorXd var_weights;
-  bool has_weights = dataset.HasVarWeights();
-  if (has_weights) var_weights = dataset.GetVarWeights();
+  Eigen::VectorXd& outcome = residual.GetData();
   
   // Minimum size of newly created leaf nodes (used to rule out invalid splits)
   int32_t min_samples_in_leaf = tree_prior.GetMinSamplesLeaf();
@@ -172,16 +202,21 @@ void GaussianConstantLeafModel::EvaluateAllPossibleSplits(ForestDataset& dataset
   double cutoff_value = 0.0;
   double log_split_eval = 0.0;
   double split_log_ml;
-  for (int j = 0; j < covariates.cols(); j++) {
+  for (int j = 0; j < dataset.NumCovariates(); j++) {
 
     if (std::abs(variable_weights.at(j)) > kEpsilon) {
       // Enumerate cutpoint strides
-      cutpoint_grid_container.CalculateStrides(covariates, outcome, tracker.GetSortedNodeSampleTracker(), node_id, node_begin, node_end, j, feature_types);
+      cutpoint_grid_container.CalculateStrides(dataset, outcome, tracker.GetSortedNodeSampleTracker(), node_id, node_begin, node_end, j, feature_types);
       
       // Reset sufficient statistics
       left_suff_stat.ResetSuffStat();
       right_suff_stat.ResetSuffStat();
 
+      // Sufficient statistics of the implicit zeros of a sparse feature
+      if (tracker.GetSortedNodeSampleTracker()->IsSparse()) {
+        AccumulateZerosSuffStat<GaussianConstantSuffStat>(zeros_suff_stat, node_suff_stat, tracker, dataset, residual, node_id, j);
+      }
+
       // Iterate through possible cutpoints
       int32_t num_feature_cutpoints = cutpoint_grid_container.NumCutpoints(j);
       feature_type = feature_types[j];
@@ -192,7 +227,7 @@ void GaussianConstantLeafModel::EvaluateAllPossibleSplits(ForestDataset& dataset
         next_bin_begin = cutpoint_grid_container.BinStartIndex(cutpoint_idx + 1, j);
 
         // Accumulate sufficient statistics for the left node
-        AccumulateCutpointBinSuffStat<GaussianConstantSuffStat>(left_suff_stat, tracker, cutpoint_grid_container, dataset, residual,
+        AccumulateCutpointBinSuffStat<GaussianConstantSuffStat>(left_suff_stat, zeros_suff_stat, tracker, cutpoint_grid_container, dataset, residual,
                                                                 global_variance, tree_num, node_id, j, cutpoint_idx);
 
         // Compute the corresponding right node sufficient statistics
@@ -341,6 +376,7 @@ void GaussianUnivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestData
   GaussianUnivariateRegressionSuffStat node_suff_stat = GaussianUnivariateRegressionSuffStat();
   GaussianUnivariateRegressionSuffStat left_suff_stat = GaussianUnivariateRegressionSuffStat();
   GaussianUnivariateRegressionSuffStat right_suff_stat = GaussianUnivariateRegressionSuffStat();
+  GaussianUnivariateRegressionSuffStat zeros_suff_stat = GaussianUnivariateRegressionSuffStat();
 
   // Accumulate aggregate sufficient statistic for the node to be split
   AccumulateSingleNodeSuffStat<GaussianUnivariateRegressionSuffStat, false>(node_suff_stat, dataset, tracker, residual, tree_num, node_id);
@@ -349,11 +385,7 @@ void GaussianUnivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestData
   double no_split_log_ml = NoSplitLogMarginalLikelihood(node_suff_stat, global_variance);
 
   // Unpack data
-  Eigen::MatrixXd covariates = dataset.GetCovariates();
-  Eigen::VectorXd outcome = residual.GetData();
-  Eigen::VectorXd var_weights;
-  bool has_weights = dataset.HasVarWeights();
-  if (has_weights) var_weights = dataset.GetVarWeights();
+  Eigen::VectorXd& outcome = residual.GetData();
   
   // Minimum size of newly created leaf nodes (used to rule out invalid splits)
   int32_t min_samples_in_leaf = tree_prior.GetMinSamplesLeaf();
@@ -371,16 +403,21 @@ void GaussianUnivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestData
   double cutoff_value = 0.0;
   double log_split_eval = 0.0;
   double split_log_ml;
-  for (int j = 0; j < covariates.cols(); j++) {
+  for (int j = 0; j < dataset.NumCovariates(); j++) {
 
     if (std::abs(variable_weights.at(j)) > kEpsilon) {
       // Enumerate cutpoint strides
-      cutpoint_grid_container.CalculateStrides(covariates, outcome, tracker.GetSortedNodeSampleTracker(), node_id, node_begin, node_end, j, feature_types);
+      cutpoint_grid_container.CalculateStrides(dataset, outcome, tracker.GetSortedNodeSampleTracker(), node_id, node_begin, node_end, j, feature_types);
       
       // Reset sufficient statistics
       left_suff_stat.ResetSuffStat();
       right_suff_stat.ResetSuffStat();
 
+      // Sufficient statistics of the implicit zeros of a sparse feature
+      if (tracker.GetSortedNodeSampleTracker()->IsSparse()) {
+        AccumulateZerosSuffStat<GaussianUnivariateRegressionSuffStat>(zeros_suff_stat, node_suff_stat, tracker, dataset, residual, node_id, j);
+      }
+
       // Iterate through possible cutpoints
       int32_t num_feature_cutpoints = cutpoint_grid_container.NumCutpoints(j);
       feature_type = feature_types[j];
@@ -391,7 +428,7 @@ void GaussianUnivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestData
         next_bin_begin = cutpoint_grid_container.BinStartIndex(cutpoint_idx + 1, j);
 
         // Accumulate sufficient statistics for the left node
-        AccumulateCutpointBinSuffStat<GaussianUnivariateRegressionSuffStat>(left_suff_stat, tracker, cutpoint_grid_container, dataset, residual,
+        AccumulateCutpointBinSuffStat<GaussianUnivariateRegressionSuffStat>(left_suff_stat, zeros_suff_stat, tracker, cutpoint_grid_container, dataset, residual,
                                                                 global_variance, tree_num, node_id, j, cutpoint_idx);
 
         // Compute the corresponding right node sufficient statistics
@@ -496,7 +533,7 @@ void GaussianUnivariateRegressionLeafModel::SetEnsembleRootPredictedValue(Forest
 std::tuple<double, double, data_size_t, data_size_t> GaussianMultivariateRegressionLeafModel::EvaluateProposedSplit(ForestDataset& dataset, ForestTracker& tracker, ColumnVector& residual,
                                                                                                       TreeSplit& split, int tree_num, int leaf_num, int split_feature, double global_variance) {
   // Initialize sufficient statistics
-  int num_basis = dataset.GetBasis().cols();
+  int num_basis = dataset.NumBasis();
   GaussianMultivariateRegressionSuffStat node_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
   GaussianMultivariateRegressionSuffStat left_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
   GaussianMultivariateRegressionSuffStat right_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
@@ -517,7 +554,7 @@ std::tuple<double, double, data_size_t, data_size_t> GaussianMultivariateRegress
 std::tuple<double, double, data_size_t, data_size_t> GaussianMultivariateRegressionLeafModel::EvaluateExistingSplit(ForestDataset& dataset, ForestTracker& tracker, ColumnVector& residual, double global_variance,
                                                                                                       int tree_num, int split_node_id, int left_node_id, int right_node_id) {
   // Initialize sufficient statistics
-  int num_basis = dataset.GetBasis().cols();
+  int num_basis = dataset.NumBasis();
   GaussianMultivariateRegressionSuffStat node_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
   GaussianMultivariateRegressionSuffStat left_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
   GaussianMultivariateRegressionSuffStat right_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
@@ -539,10 +576,11 @@ void GaussianMultivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestDa
                                                           std::vector<int>& cutpoint_features, std::vector<double>& cutpoint_values, std::vector<FeatureType>& cutpoint_feature_types, data_size_t& valid_cutpoint_count,
                                                           CutpointGridContainer& cutpoint_grid_container, data_size_t node_begin, data_size_t node_end, std::vector<double>& variable_weights, std::vector<FeatureType>& feature_types) {
   // Initialize sufficient statistics
-  int basis_dim = dataset.GetBasis().cols();
+  int basis_dim = dataset.NumBasis();
   GaussianMultivariateRegressionSuffStat node_suff_stat = GaussianMultivariateRegressionSuffStat(basis_dim);
   GaussianMultivariateRegressionSuffStat left_suff_stat = GaussianMultivariateRegressionSuffStat(basis_dim);
   GaussianMultivariateRegressionSuffStat right_suff_stat = GaussianMultivariateRegressionSuffStat(basis_dim);
+  GaussianMultivariateRegressionSuffStat zeros_suff_stat = GaussianMultivariateRegressionSuffStat(basis_dim);
 
   // Accumulate aggregate sufficient statistic for the node to be split
   AccumulateSingleNodeSuffStat<GaussianMultivariateRegressionSuffStat, false>(node_suff_stat, dataset, tracker, residual, tree_num, node_id);
@@ -551,11 +589,7 @@ void GaussianMultivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestDa
   double no_split_log_ml = NoSplitLogMarginalLikelihood(node_suff_stat, global_variance);
 
   // Unpack data
-  Eigen::MatrixXd covariates = dataset.GetCovariates();
-  Eigen::VectorXd outcome = residual.GetData();
-  Eigen::VectorXd var_weights;
-  bool has_weights = dataset.HasVarWeights();
-  if (has_weights) var_weights = dataset.GetVarWeights();
+  Eigen::VectorXd& outcome = residual.GetData();
   
   // Minimum size of newly created leaf nodes (used to rule out invalid splits)
   int32_t min_samples_in_leaf = tree_prior.GetMinSamplesLeaf();
@@ -573,16 +607,21 @@ void GaussianMultivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestDa
   double cutoff_value = 0.0;
   double log_split_eval = 0.0;
   double split_log_ml;
-  for (int j = 0; j < covariates.cols(); j++) {
+  for (int j = 0; j < dataset.NumCovariates(); j++) {
 
     if (std::abs(variable_weights.at(j)) > kEpsilon) {
       // Enumerate cutpoint strides
-      cutpoint_grid_container.CalculateStrides(covariates, outcome, tracker.GetSortedNodeSampleTracker(), node_id, node_begin, node_end, j, feature_types);
+      cutpoint_grid_container.CalculateStrides(dataset, outcome, tracker.GetSortedNodeSampleTracker(), node_id, node_begin, node_end, j, feature_types);
       
       // Reset sufficient statistics
       left_suff_stat.ResetSuffStat();
       right_suff_stat.ResetSuffStat();
 
+      // Sufficient statistics of the implicit zeros of a sparse feature
+      if (tracker.GetSortedNodeSampleTracker()->IsSparse()) {
+        AccumulateZerosSuffStat<GaussianMultivariateRegressionSuffStat>(zeros_suff_stat, node_suff_stat, tracker, dataset, residual, node_id, j);
+      }
+
       // Iterate through possible cutpoints
       int32_t num_feature_cutpoints = cutpoint_grid_container.NumCutpoints(j);
       feature_type = feature_types[j];
@@ -593,7 +632,7 @@ void GaussianMultivariateRegressionLeafModel::EvaluateAllPossibleSplits(ForestDa
         next_bin_begin = cutpoint_grid_container.BinStartIndex(cutpoint_idx + 1, j);
 
         // Accumulate sufficient statistics for the left node
-        AccumulateCutpointBinSuffStat<GaussianMultivariateRegressionSuffStat>(left_suff_stat, tracker, cutpoint_grid_container, dataset, residual,
+        AccumulateCutpointBinSuffStat<GaussianMultivariateRegressionSuffStat>(left_suff_stat, zeros_suff_stat, tracker, cutpoint_grid_container, dataset, residual,
                                                                               global_variance, tree_num, node_id, j, cutpoint_idx);
 
         // Compute the corresponding right node sufficient statistics
@@ -666,7 +705,7 @@ void GaussianMultivariateRegressionLeafModel::SampleLeafParameters(ForestDataset
   std::vector<int32_t> tree_leaves = tree->GetLeaves();
   
   // Initialize sufficient statistics
-  int num_basis = dataset.GetBasis().cols();
+  int num_basis = dataset.NumBasis();
   GaussianMultivariateRegressionSuffStat node_suff_stat = GaussianMultivariateRegressionSuffStat(num_basis);
 
   // Sample each leaf node parameter
@@ -692,7 +731,7 @@ void GaussianMultivariateRegressionLeafModel::SampleLeafParameters(ForestDataset
 
 void GaussianMultivariateRegressionLeafModel::SetEnsembleRootPredictedValue(ForestDataset& dataset, TreeEnsemble* ensemble, double root_pred_value) {
   int num_trees = ensemble->NumTrees();
-  int num_basis = dataset.GetBasis().cols();
+  int num_basis = dataset.NumBasis();
   
   // Check that root predicted value is close to 0
   // TODO: formalize and document this
@@ -14,12 +14,33 @@
 
 namespace StochTree {
 
-ForestTracker::ForestTracker(Eigen::MatrixXd& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations) {
-  sample_pred_mapper_ = std::make_unique<SamplePredMapper>(num_trees, num_observations);
+template <typename CovariateMatrix>
+ForestTracker::ForestTracker(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, 
+                             BinnedColumnMatrix const* binned_covariates, bool cache_tree_predictions) {
+  Initialize(covariates, feature_types, num_trees, num_observations, binned_covariates, nullptr, cache_tree_predictions);
+}
+
+ForestTracker::ForestTracker(ForestDataset& dataset, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, 
+                             bool cache_tree_predictions) {
+  BinnedColumnMatrix const* binned_covariates = dataset.HasBinnedCovariates() ? &dataset.GetBinnedCovariates() : nullptr;
+  dataset.VisitCovariates([&](auto& covariates) {
+    Initialize(covariates, feature_types, num_trees, num_observations, binned_covariates, dataset.GetPresortIndex(), cache_tree_predictions);
+  });
+}
+
+template <typename CovariateMatrix>
+void ForestTracker::Initialize(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, 
+                               BinnedColumnMatrix const* binned_covariates, data_size_t const* presort_index, bool cache_tree_predictions) {
+  if (cache_tree_predictions) {
+    sample_pred_mapper_ = std::make_unique<SamplePredMapper>(num_trees, num_observations);
+  } else {
+    tree_has_predictions_.assign(num_trees, 0);
+  }
   sample_node_mapper_ = std::make_unique<SampleNodeMapper>(num_trees, num_observations);
   unsorted_node_sample_tracker_ = std::make_unique<UnsortedNodeSampleTracker>(num_observations, num_trees);
-  presort_container_ = std::make_unique<FeaturePresortRootContainer>(covariates, feature_types);
+  presort_container_ = std::make_unique<FeaturePresortRootContainer>(covariates, feature_types, binned_covariates, presort_index);
   sorted_node_sample_tracker_ = std::make_unique<SortedNodeSampleTracker>(presort_container_.get(), covariates, feature_types);
+  sorted_node_sample_tracker_->SetThreadPool(thread_pool_.get());
 
   num_trees_ = num_trees;
   num_observations_ = num_observations;
@@ -27,10 +48,32 @@ ForestTracker::ForestTracker(Eigen::MatrixXd& covariates, std::vector<FeatureTyp
   feature_types_ = feature_types;
 }
 
-void ForestTracker::ResetRoot(Eigen::MatrixXd& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num) {
+template <typename CovariateMatrix>
+void ForestTracker::ResetRoot(CovariateMatrix& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num) {
   AssignAllSamplesToRoot(tree_num);
   unsorted_node_sample_tracker_->ResetTreeToRoot(tree_num, covariates.rows());
-  sorted_node_sample_tracker_.reset(new SortedNodeSampleTracker(presort_container_.get(), covariates, feature_types));
+  if (test_node_sample_tracker_) {
+    test_node_sample_tracker_->ResetTreeToRoot(tree_num, test_dataset_->NumObservations());
+    test_tree_current_[tree_num] = 0;
+  }
+  sorted_node_sample_tracker_->ResetToRoot(feature_types);
+}
+
+void ForestTracker::ResetRoot(ForestDataset& dataset, std::vector<FeatureType>& feature_types, int32_t tree_num) {
+  dataset.VisitCovariates([&](auto& covariates) {ResetRoot(covariates, feature_types, tree_num);});
+}
+
+void ForestTracker::SetNumThreads(int num_threads) {
+  // Samplers call this every iteration, so keep the current pool unless the number of threads changes
+  if (num_threads == num_threads_ && (thread_pool_ != nullptr) == (ResolveNumThreads(num_threads) > 1)) return;
+  num_threads_ = num_threads;
+  sorted_node_sample_tracker_->SetThreadPool(nullptr);
+  if (ResolveNumThreads(num_threads) > 1) {
+    thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+  } else {
+    thread_pool_.reset();
+  }
+  sorted_node_sample_tracker_->SetThreadPool(thread_pool_.get());
 }
 
 data_size_t ForestTracker::GetNodeId(int observation_num, int tree_num) {return sample_node_mapper_->GetNodeId(observation_num, tree_num);}
@@ -70,36 +113,182 @@ void ForestTracker::AssignAllSamplesToRoot(int32_t tree_num) {
   sample_node_mapper_->AssignAllSamplesToRoot(tree_num);
 }
 
+void ForestTracker::AddTestSet(ForestDataset& test_dataset) {
+  CHECK_EQ(test_dataset.NumCovariates(), num_features_);
+  // Held-out observations start in the root of every tree, so the trees must not have been grown yet
+  for (int j = 0; j < num_trees_; j++) {
+    CHECK(unsorted_node_sample_tracker_->IsLeaf(j, Tree::kRoot));
+  }
+  test_dataset_ = &test_dataset;
+  test_node_sample_tracker_ = std::make_unique<UnsortedNodeSampleTracker>(test_dataset.NumObservations(), num_trees_);
+  test_tree_predictions_.clear();
+  test_tree_current_.assign(num_trees_, 0);
+  test_output_dimension_ = 0;
+  test_predictions_.clear();
+}
+
+template <typename TermFn>
+void ForestTracker::VisitTestSetTree(Tree& tree, int32_t tree_num, bool requires_basis, TermFn&& term_fn) {
+  int output_dimension = requires_basis ? tree.OutputDimension() : 1;
+  if (requires_basis) {
+    CHECK(test_dataset_->HasBasis());
+    CHECK_EQ(test_dataset_->NumBasis(), output_dimension);
+  }
+  FeatureUnsortedPartition* partition = test_node_sample_tracker_->GetFeaturePartition(tree_num);
+  test_dataset_->VisitBasis([&](auto& basis) {
+    for (int leaf : tree.GetLeaves()) {
+      double const* leaf_values = tree.LeafValues(leaf);
+      data_size_t const* leaf_rows = partition->indices_.data() + partition->NodeBegin(leaf);
+      data_size_t leaf_size = partition->NodeSize(leaf);
+      if (requires_basis) {
+        for (int32_t k = 0; k < output_dimension; k++) {
+          for (data_size_t r = 0; r < leaf_size; r++) {
+            term_fn(k, leaf_rows[r], leaf_values[k] * static_cast<double>(basis(leaf_rows[r], k)));
+          }
+        }
+      } else {
+        for (data_size_t r = 0; r < leaf_size; r++) {
+          term_fn(0, leaf_rows[r], leaf_values[0]);
+        }
+      }
+    }
+  });
+}
+
+void ForestTracker::UpdateTestSetTree(Tree& tree, int32_t tree_num, bool requires_basis) {
+  CHECK(test_node_sample_tracker_);
+  // Without cached tree predictions, RecordTestSetPrediction sums the trees' leaf values directly
+  if (!CachesTreePredictions()) return;
+  data_size_t n = test_dataset_->NumObservations();
+  int output_dimension = requires_basis ? tree.OutputDimension() : 1;
+  if (output_dimension != test_output_dimension_) {
+    test_output_dimension_ = output_dimension;
+    test_tree_predictions_.assign(static_cast<size_t>(num_trees_) * output_dimension * n, 0.);
+    std::fill(test_tree_current_.begin(), test_tree_current_.end(), 0);
+  }
+  double* tree_predictions = test_tree_predictions_.data() + static_cast<size_t>(tree_num) * output_dimension * n;
+  VisitTestSetTree(tree, tree_num, requires_basis, [&](int32_t k, data_size_t row, double value) {
+    tree_predictions[static_cast<size_t>(k) * n + row] = value;
+  });
+  test_tree_current_[tree_num] = 1;
+}
+
+void ForestTracker::RecordTestSetPrediction(TreeEnsemble& ensemble) {
+  CHECK(test_node_sample_tracker_);
+  CHECK_EQ(ensemble.NumTrees(), num_trees_);
+  bool requires_basis = !ensemble.IsLeafConstant();
+  data_size_t n = test_dataset_->NumObservations();
+  size_t offset = test_predictions_.size();
+  test_predictions_.resize(offset + n, 0.);
+  double* output = test_predictions_.data() + offset;
+  if (!CachesTreePredictions()) {
+    // Each observation visits the trees (and the terms of their leaf regressions) in the same order as below
+    for (int j = 0; j < num_trees_; j++) {
+      VisitTestSetTree(*ensemble.GetTree(j), j, requires_basis, [&](int32_t k, data_size_t row, double value) {
+        output[row] += value;
+      });
+    }
+    return;
+  }
+  for (int j = 0; j < num_trees_; j++) {
+    if (!test_tree_current_[j]) UpdateTestSetTree(*ensemble.GetTree(j), j, requires_basis);
+  }
+  // Trees (and the terms of each tree's leaf regression) are accumulated in order into every observation's 
+  // prediction, which matches the order of summation (and therefore the result) of TreeEnsemble::PredictInplace
+  int num_terms = num_trees_ * test_output_dimension_;
+  for (int t = 0; t < num_terms; t++) {
+    double const* term = test_tree_predictions_.data() + static_cast<size_t>(t) * n;
+    for (data_size_t i = 0; i < n; i++) {
+      output[i] += term[i];
+    }
+  }
+}
+
+void ForestTracker::AddTestSetSplit(TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id) {
+  test_dataset_->VisitCovariates([&](auto& covariates) {
+    test_node_sample_tracker_->PartitionTreeNodeBy(tree_id, split_node_id, left_node_id, right_node_id, [&](data_size_t row) {
+      double fvalue = covariates(row, split_feature);
+      // Missing values take the default (left) child at prediction time
+      return std::isnan(fvalue) || split.SplitTrue(fvalue);
+    });
+  });
+  test_tree_current_[tree_id] = 0;
+}
+
 void ForestTracker::AssignAllSamplesToConstantPrediction(double value) {
   for (int i = 0; i < num_trees_; i++) {
-    sample_pred_mapper_->AssignAllSamplesToConstantPrediction(i, value);
+    AssignAllSamplesToConstantPrediction(i, value);
   }
 }
 
 void ForestTracker::AssignAllSamplesToConstantPrediction(int32_t tree_num, double value) {
-  sample_pred_mapper_->AssignAllSamplesToConstantPrediction(tree_num, value);
+  if (sample_pred_mapper_) {
+    sample_pred_mapper_->AssignAllSamplesToConstantPrediction(tree_num, value);
+  } else if (value == 0.) {
+    tree_has_predictions_[tree_num] = 0;
+  } else {
+    Log::Fatal("Constant tree predictions can only be assigned by a tracker that caches tree predictions");
+  }
 }
 
-void ForestTracker::AddSplit(Eigen::MatrixXd& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted) {
-  sample_node_mapper_->AddSplit(covariates, split, split_feature, tree_id, split_node_id, left_node_id, right_node_id);
-  unsorted_node_sample_tracker_->PartitionTreeNode(covariates, tree_id, split_node_id, left_node_id, right_node_id, split_feature, split);
-  if (keep_sorted) {
+template <typename CovariateMatrix>
+void ForestTracker::AddSplit(CovariateMatrix& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted) {
+  if (keep_sorted && sorted_node_sample_tracker_->IsSparse()) {
+    // The sorted tracker routes every observation of the node using the nonzero entries of the split feature,
+    // which the other trackers reuse rather than looking up each observation in the sparse column
     sorted_node_sample_tracker_->PartitionNode(covariates, split_node_id, split_feature, split);
+    sorted_node_sample_tracker_->UpdateObservationMapping(left_node_id, tree_id, sample_node_mapper_.get());
+    sorted_node_sample_tracker_->UpdateObservationMapping(right_node_id, tree_id, sample_node_mapper_.get());
+    unsorted_node_sample_tracker_->PartitionTreeNodeBy(tree_id, split_node_id, left_node_id, right_node_id,
+                                                       [&](data_size_t row) { return sorted_node_sample_tracker_->WentLeft(row); });
+  } else {
+    sample_node_mapper_->AddSplit(covariates, split, split_feature, tree_id, split_node_id, left_node_id, right_node_id);
+    unsorted_node_sample_tracker_->PartitionTreeNode(covariates, tree_id, split_node_id, left_node_id, right_node_id, split_feature, split);
+    if (keep_sorted) {
+      sorted_node_sample_tracker_->PartitionNode(covariates, split_node_id, split_feature, split);
+    }
   }
+  if (test_node_sample_tracker_) AddTestSetSplit(split, split_feature, tree_id, split_node_id, left_node_id, right_node_id);
 }
 
-void ForestTracker::RemoveSplit(Eigen::MatrixXd& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted) {
+template <typename CovariateMatrix>
+void ForestTracker::RemoveSplit(CovariateMatrix& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted) {
   unsorted_node_sample_tracker_->PruneTreeNodeToLeaf(tree_id, split_node_id);
   unsorted_node_sample_tracker_->UpdateObservationMapping(tree, tree_id, sample_node_mapper_.get());
+  if (test_node_sample_tracker_) {
+    // The held-out observations of the pruned children already form the index range of the node
+    test_node_sample_tracker_->PruneTreeNodeToLeaf(tree_id, split_node_id);
+    test_tree_current_[tree_id] = 0;
+  }
   // TODO: WARN if this is called from the GFR Tree Sampler
 }
 
+void ForestTracker::AddSplit(ForestDataset& dataset, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted) {
+  dataset.VisitCovariates([&](auto& covariates) {
+    AddSplit(covariates, split, split_feature, tree_id, split_node_id, left_node_id, right_node_id, keep_sorted);
+  });
+}
+
+void ForestTracker::RemoveSplit(ForestDataset& dataset, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted) {
+  dataset.VisitCovariates([&](auto& covariates) {
+    RemoveSplit(covariates, tree, tree_id, split_node_id, left_node_id, right_node_id, keep_sorted);
+  });
+}
+
 double ForestTracker::GetTreeSamplePrediction(data_size_t sample_id, int tree_id) {
+  if (!sample_pred_mapper_) {
+    Log::Fatal("Tree predictions are not cached by this tracker");
+  }
   return sample_pred_mapper_->GetPred(sample_id, tree_id);
 }
 
 void ForestTracker::SetTreeSamplePrediction(data_size_t sample_id, int tree_id, double value) {
-  sample_pred_mapper_->SetPred(sample_id, tree_id, value);
+  if (sample_pred_mapper_) {
+    sample_pred_mapper_->SetPred(sample_id, tree_id, value);
+  } else {
+    // Only record that the tree's predictions are now part of the residual
+    tree_has_predictions_[tree_id] = 1;
+  }
 }
 
 FeatureUnsortedPartition::FeatureUnsortedPartition(data_size_t n) {
@@ -138,7 +327,8 @@ int FeatureUnsortedPartition::RightNode(int node_id) {
   return right_nodes_[node_id];
 }
 
-void FeatureUnsortedPartition::PartitionNode(Eigen::MatrixXd& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split) {
+template <typename CovariateMatrix>
+void FeatureUnsortedPartition::PartitionNode(CovariateMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split) {
   // Partition-related values
   data_size_t node_start_idx = node_begin_[node_id];
   data_size_t num_node_elements = node_length_[node_id];
@@ -157,7 +347,8 @@ void FeatureUnsortedPartition::PartitionNode(Eigen::MatrixXd& covariates, int no
   ExpandNodeTrackingVectors(node_id, left_node_id, right_node_id, node_start_idx, num_true, num_false);
 }
 
-void FeatureUnsortedPartition::PartitionNode(Eigen::MatrixXd& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value) {
+template <typename CovariateMatrix>
+void FeatureUnsortedPartition::PartitionNode(CovariateMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value) {
   // Partition-related values
   data_size_t node_start_idx = node_begin_[node_id];
   data_size_t num_node_elements = node_length_[node_id];
@@ -176,7 +367,8 @@ void FeatureUnsortedPartition::PartitionNode(Eigen::MatrixXd& covariates, int no
   ExpandNodeTrackingVectors(node_id, left_node_id, right_node_id, node_start_idx, num_true, num_false);
 }
 
-void FeatureUnsortedPartition::PartitionNode(Eigen::MatrixXd& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list) {
+template <typename CovariateMatrix>
+void FeatureUnsortedPartition::PartitionNode(CovariateMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list) {
   // Partition-related values
   data_size_t node_start_idx = node_begin_[node_id];
   data_size_t num_node_elements = node_length_[node_id];
@@ -184,7 +376,11 @@ void FeatureUnsortedPartition::PartitionNode(Eigen::MatrixXd& covariates, int no
   // Partition the node indices 
   auto node_begin = (indices_.begin() + node_begin_[node_id]);
   auto node_end = (indices_.begin() + node_begin_[node_id] + node_length_[node_id]);
-  auto right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return RowSplitLeft(covariates, row, feature_split, category_list); });
+  // Encode the categories once so that each row is tested in constant time
+  std::vector<std::uint64_t> category_set_data;
+  EncodeCategorySet(category_list, category_set_data);
+  CategorySetView category_set(category_set_data.data(), category_set_data.data() + category_set_data.size());
+  auto right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return RowSplitLeft(covariates, row, feature_split, category_set); });
   
   // Determine the number of true and false elements
   node_begin = (indices_.begin() + node_begin_[node_id]);
@@ -235,14 +431,7 @@ void FeatureUnsortedPartition::ExpandNodeTrackingVectors(int node_id, int left_n
 }
 
 void FeatureUnsortedPartition::UpdateObservationMapping(int node_id, int tree_id, SampleNodeMapper* sample_node_mapper) {
-  data_size_t node_begin = node_begin_[node_id];
-  data_size_t node_size = node_length_[node_id];
-  data_size_t node_end = node_begin + node_size;
-  data_size_t idx;
-  for (data_size_t i = node_begin; i < node_end; i++) {
-    idx = indices_[i];
-    sample_node_mapper->SetNodeId(idx, tree_id, node_id);
-  }
+  sample_node_mapper->SetNodeIds(tree_id, indices_.data() + node_begin_[node_id], node_length_[node_id], node_id);
 }
 
 bool FeatureUnsortedPartition::IsLeaf(int node_id) {
@@ -309,16 +498,29 @@ void FeaturePresortPartition::AddLeftRightNodes(data_size_t left_node_begin, dat
   node_offset_sizes_.emplace_back(right_node_begin, right_node_size);
 }
 
-void FeaturePresortPartition::SplitFeature(Eigen::MatrixXd& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split) {
+template <typename CovariateMatrix>
+void FeaturePresortPartition::SplitFeature(CovariateMatrix& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split) {
   // Partition-related values
   data_size_t node_start_idx = NodeBegin(node_id);
   data_size_t node_end_idx = NodeEnd(node_id);
   data_size_t num_node_elements = NodeSize(node_id);
 
-  // Partition the node indices 
+  // Partition the node indices, comparing bin codes when they determine the split exactly
   auto node_begin = (feature_sort_indices_.begin() + node_start_idx);
   auto node_end = (feature_sort_indices_.begin() + node_end_idx);
-  auto right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return split.SplitTrue(covariates(row, feature_index)); });
+  std::vector<data_size_t>::iterator right_node_begin;
+  int split_bin;
+  if (binned_covariates_ != nullptr && split.NumericSplit() && binned_covariates_->SplitBin(feature_index, split.SplitValue(), split_bin)) {
+    right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return binned_covariates_->BinCode(row, feature_index) <= split_bin; });
+  } else if (binned_covariates_ != nullptr && !split.NumericSplit() && binned_covariates_->IsExact(feature_index)) {
+    // Every bin of an exactly binned feature holds a single category
+    int num_bins = binned_covariates_->NumBins(feature_index);
+    std::vector<char> bin_left(num_bins);
+    for (int b = 0; b < num_bins; b++) bin_left[b] = split.SplitTrue(binned_covariates_->UpperBound(feature_index, b));
+    right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return bin_left[binned_covariates_->BinCode(row, feature_index)]; });
+  } else {
+    right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return split.SplitTrue(covariates(row, feature_index)); });
+  }
   
   // Add the left and right nodes to the offset size vector
   node_begin = (feature_sort_indices_.begin() + node_start_idx);
@@ -327,7 +529,8 @@ void FeaturePresortPartition::SplitFeature(Eigen::MatrixXd& covariates, int32_t
   AddLeftRightNodes(node_start_idx, num_true, node_start_idx + num_true, num_false);
 }
 
-void FeaturePresortPartition::SplitFeatureNumeric(Eigen::MatrixXd& covariates, int32_t node_id, int32_t feature_index, double split_value) {
+template <typename CovariateMatrix>
+void FeaturePresortPartition::SplitFeatureNumeric(CovariateMatrix& covariates, int32_t node_id, int32_t feature_index, double split_value) {
   // Partition-related values
   data_size_t node_start_idx = NodeBegin(node_id);
   data_size_t node_end_idx = NodeEnd(node_id);
@@ -345,7 +548,8 @@ void FeaturePresortPartition::SplitFeatureNumeric(Eigen::MatrixXd& covariates, i
   AddLeftRightNodes(node_start_idx, num_true, node_start_idx + num_true, num_false);
 }
 
-void FeaturePresortPartition::SplitFeatureCategorical(Eigen::MatrixXd& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list) {
+template <typename CovariateMatrix>
+void FeaturePresortPartition::SplitFeatureCategorical(CovariateMatrix& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list) {
   // Partition-related values
   data_size_t node_start_idx = NodeBegin(node_id);
   data_size_t node_end_idx = NodeEnd(node_id);
@@ -354,7 +558,11 @@ void FeaturePresortPartition::SplitFeatureCategorical(Eigen::MatrixXd& covariate
   // Partition the node indices 
   auto node_begin = (feature_sort_indices_.begin() + node_start_idx);
   auto node_end = (feature_sort_indices_.begin() + node_end_idx);
-  auto right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return RowSplitLeft(covariates, row, feature_index, category_list); });
+  // Encode the categories once so that each row is tested in constant time
+  std::vector<std::uint64_t> category_set_data;
+  EncodeCategorySet(category_list, category_set_data);
+  CategorySetView category_set(category_set_data.data(), category_set_data.data() + category_set_data.size());
+  auto right_node_begin = std::stable_partition(node_begin, node_end, [&](int row) { return RowSplitLeft(covariates, row, feature_index, category_set); });
   
   // Add the left and right nodes to the offset size vector
   node_begin = (feature_sort_indices_.begin() + node_start_idx);
@@ -363,15 +571,29 @@ void FeaturePresortPartition::SplitFeatureCategorical(Eigen::MatrixXd& covariate
   AddLeftRightNodes(node_start_idx, num_true, node_start_idx + num_true, num_false);
 }
 
+void FeaturePresortPartition::SplitSparseFeature(int32_t node_id, std::vector<char> const& go_left, data_size_t num_left) {
+  // Partition the node's nonzero entries, whose negative entries (which come first) remain ahead of the positive entries on both sides
+  data_size_t nonzero_start_idx = NodeNonzeroBegin(node_id);
+  auto nonzero_begin = nonzero_entries_.begin() + nonzero_start_idx;
+  auto nonzero_end = nonzero_entries_.begin() + NodeNonzeroEnd(node_id);
+  auto right_nonzero_begin = std::stable_partition(nonzero_begin, nonzero_end, [&](SparseFeatureEntry const& entry) { return go_left[entry.row]; });
+  auto left_positive_begin = std::partition_point(nonzero_begin, right_nonzero_begin, [](SparseFeatureEntry const& entry) { return entry.value < 0.0; });
+  data_size_t left_num_nonzero = std::distance(nonzero_begin, right_nonzero_begin);
+  data_size_t right_num_nonzero = std::distance(right_nonzero_begin, nonzero_end);
+  data_size_t left_num_negative = std::distance(nonzero_begin, left_positive_begin);
+  data_size_t right_num_negative = NodeNumNegative(node_id) - left_num_negative;
+
+  // Add the left and right nodes to the offset size vectors
+  data_size_t node_start_idx = NodeBegin(node_id);
+  AddLeftRightNodes(node_start_idx, num_left, node_start_idx + num_left, NodeSize(node_id) - num_left);
+  nonzero_offset_sizes_.emplace_back(nonzero_start_idx, left_num_nonzero);
+  nonzero_offset_sizes_.emplace_back(nonzero_start_idx + left_num_nonzero, right_num_nonzero);
+  node_num_negative_.push_back(left_num_negative);
+  node_num_negative_.push_back(right_num_negative);
+}
+
 void FeaturePresortPartition::UpdateObservationMapping(int node_id, int tree_id, SampleNodeMapper* sample_node_mapper) {
-  data_size_t node_begin = NodeBegin(node_id);
-  data_size_t node_size = NodeSize(node_id);
-  data_size_t node_end = NodeEnd(node_id);
-  data_size_t idx;
-  for (data_size_t i = node_begin; i < node_end; i++) {
-    idx = feature_sort_indices_[i];
-    sample_node_mapper->SetNodeId(idx, tree_id, node_id);
-  }
+  sample_node_mapper->SetNodeIds(tree_id, feature_sort_indices_.data() + NodeBegin(node_id), NodeSize(node_id), node_id);
 }
 
 std::vector<data_size_t> FeaturePresortPartition::NodeIndices(int node_id) {
@@ -384,4 +606,49 @@ std::vector<data_size_t> FeaturePresortPartition::NodeIndices(int node_id) {
   return out;
 }
 
+// Covariates may be stored densely in double or single precision, or as a sparse matrix (see ForestDataset)
+template ForestTracker::ForestTracker(DataMatrixMapT<double>& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, BinnedColumnMatrix const* binned_covariates, bool cache_tree_predictions);
+template void ForestTracker::ResetRoot(DataMatrixMapT<double>& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num);
+template void ForestTracker::AddSplit(DataMatrixMapT<double>& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void ForestTracker::RemoveSplit(DataMatrixMapT<double>& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void FeatureUnsortedPartition::PartitionNode(DataMatrixMapT<double>& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split);
+template void FeatureUnsortedPartition::PartitionNode(DataMatrixMapT<double>& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value);
+template void FeatureUnsortedPartition::PartitionNode(DataMatrixMapT<double>& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list);
+template void FeaturePresortPartition::SplitFeature(DataMatrixMapT<double>& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split);
+template void FeaturePresortPartition::SplitFeatureNumeric(DataMatrixMapT<double>& covariates, int32_t node_id, int32_t feature_index, double split_value);
+template void FeaturePresortPartition::SplitFeatureCategorical(DataMatrixMapT<double>& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list);
+
+template ForestTracker::ForestTracker(DataMatrixMapT<float>& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, BinnedColumnMatrix const* binned_covariates, bool cache_tree_predictions);
+template void ForestTracker::ResetRoot(DataMatrixMapT<float>& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num);
+template void ForestTracker::AddSplit(DataMatrixMapT<float>& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void ForestTracker::RemoveSplit(DataMatrixMapT<float>& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void FeatureUnsortedPartition::PartitionNode(DataMatrixMapT<float>& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split);
+template void FeatureUnsortedPartition::PartitionNode(DataMatrixMapT<float>& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value);
+template void FeatureUnsortedPartition::PartitionNode(DataMatrixMapT<float>& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list);
+template void FeaturePresortPartition::SplitFeature(DataMatrixMapT<float>& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split);
+template void FeaturePresortPartition::SplitFeatureNumeric(DataMatrixMapT<float>& covariates, int32_t node_id, int32_t feature_index, double split_value);
+template void FeaturePresortPartition::SplitFeatureCategorical(DataMatrixMapT<float>& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list);
+
+template ForestTracker::ForestTracker(SparseColumnMatrix& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, BinnedColumnMatrix const* binned_covariates, bool cache_tree_predictions);
+template void ForestTracker::ResetRoot(SparseColumnMatrix& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num);
+template void ForestTracker::AddSplit(SparseColumnMatrix& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void ForestTracker::RemoveSplit(SparseColumnMatrix& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void FeatureUnsortedPartition::PartitionNode(SparseColumnMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split);
+template void FeatureUnsortedPartition::PartitionNode(SparseColumnMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value);
+template void FeatureUnsortedPartition::PartitionNode(SparseColumnMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list);
+template void FeaturePresortPartition::SplitFeature(SparseColumnMatrix& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split);
+template void FeaturePresortPartition::SplitFeatureNumeric(SparseColumnMatrix& covariates, int32_t node_id, int32_t feature_index, double split_value);
+template void FeaturePresortPartition::SplitFeatureCategorical(SparseColumnMatrix& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list);
+
+template ForestTracker::ForestTracker(BinnedColumnMatrix& covariates, std::vector<FeatureType>& feature_types, int num_trees, int num_observations, BinnedColumnMatrix const* binned_covariates, bool cache_tree_predictions);
+template void ForestTracker::ResetRoot(BinnedColumnMatrix& covariates, std::vector<FeatureType>& feature_types, int32_t tree_num);
+template void ForestTracker::AddSplit(BinnedColumnMatrix& covariates, TreeSplit& split, int32_t split_feature, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void ForestTracker::RemoveSplit(BinnedColumnMatrix& covariates, Tree* tree, int32_t tree_id, int32_t split_node_id, int32_t left_node_id, int32_t right_node_id, bool keep_sorted);
+template void FeatureUnsortedPartition::PartitionNode(BinnedColumnMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, TreeSplit& split);
+template void FeatureUnsortedPartition::PartitionNode(BinnedColumnMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, double split_value);
+template void FeatureUnsortedPartition::PartitionNode(BinnedColumnMatrix& covariates, int node_id, int left_node_id, int right_node_id, int feature_split, std::vector<std::uint32_t> const& category_list);
+template void FeaturePresortPartition::SplitFeature(BinnedColumnMatrix& covariates, int32_t node_id, int32_t feature_index, TreeSplit& split);
+template void FeaturePresortPartition::SplitFeatureNumeric(BinnedColumnMatrix& covariates, int32_t node_id, int32_t feature_index, double split_value);
+template void FeaturePresortPartition::SplitFeatureCategorical(BinnedColumnMatrix& covariates, int32_t node_id, int32_t feature_index, std::vector<std::uint32_t> const& category_list);
+
 }  // namespace StochTree
@@ -0,0 +1,187 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/predict_kernel.h>
+
+// Vectorized kernels are compiled with per-function target attributes and selected at runtime,
+// so the library itself does not need to be built with -mavx2 / -mavx512f
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define STOCHTREE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace StochTree {
+
+#ifdef STOCHTREE_X86_SIMD
+
+/*! \brief Gather 4 covariates (at element offsets `offset`) of the active lanes as doubles */
+__attribute__((target("avx2")))
+static inline __m256d GatherCovariatesAVX2(double const* covariates, __m256i offset, __m128i active) {
+  return _mm256_mask_i64gather_pd(_mm256_setzero_pd(), covariates, offset, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(active)), 8);
+}
+
+/*! \brief Same as above, widening single precision covariates (exactly) to double */
+__attribute__((target("avx2")))
+static inline __m256d GatherCovariatesAVX2(float const* covariates, __m256i offset, __m128i active) {
+  return _mm256_cvtps_pd(_mm256_mask_i64gather_ps(_mm_setzero_ps(), covariates, offset, _mm_castsi128_ps(active), 4));
+}
+
+/*! \brief Gather 8 covariates (at element offsets `offset`) of the active lanes as doubles */
+__attribute__((target("avx512f")))
+static inline __m512d GatherCovariatesAVX512(double const* covariates, __m512i offset, __mmask8 active) {
+  return _mm512_mask_i64gather_pd(_mm512_setzero_pd(), active, offset, covariates, 8);
+}
+
+/*! \brief Same as above, widening single precision covariates (exactly) to double */
+__attribute__((target("avx512f")))
+static inline __m512d GatherCovariatesAVX512(float const* covariates, __m512i offset, __mmask8 active) {
+  return _mm512_cvtps_pd(_mm512_mask_i64gather_ps(_mm256_setzero_ps(), active, offset, covariates, 4));
+}
+
+/*! \brief Route groups of 4 rows through a tree with AVX2 gathers, returning the number of rows processed */
+template <typename Scalar>
+__attribute__((target("avx2")))
+static int EvaluateTreeBlockAVX2(Tree const& tree, Scalar const* covariates, int64_t column_stride, int64_t row_stride,
+                                 data_size_t row_begin, int num_rows, std::int32_t* leaf_ids) {
+  int const* left_child = tree.cleft_.data();
+  int const* right_child = tree.cright_.data();
+  int const* split_index = tree.split_index_.data();
+  double const* threshold = tree.threshold_.data();
+  __m128i const invalid_node = _mm_set1_epi32(Tree::kInvalidNodeId);
+  __m128i const all_ones = _mm_set1_epi32(-1);
+  __m256i const column_stride_epi64 = _mm256_set1_epi64x(column_stride);
+  __m256i const row_stride_epi64 = _mm256_set1_epi64x(row_stride);
+  // Select the low 32 bits of each 64-bit comparison result
+  __m256i const narrow_mask = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  int processed = 0;
+  for (; processed + 4 <= num_rows; processed += 4) {
+    __m128i node = _mm_setzero_si128();
+    __m256i row = _mm256_add_epi64(_mm256_set1_epi64x(row_begin + processed), _mm256_setr_epi64x(0, 1, 2, 3));
+    __m256i row_offset = _mm256_mul_epi32(row, row_stride_epi64);
+    while (true) {
+      __m128i left = _mm_i32gather_epi32(left_child, node, 4);
+      __m128i active = _mm_andnot_si128(_mm_cmpeq_epi32(left, invalid_node), all_ones);
+      if (_mm_testz_si128(active, active)) break;
+      __m256d active_pd = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(active));
+      __m128i right = _mm_mask_i32gather_epi32(node, right_child, node, active, 4);
+      __m128i feature = _mm_mask_i32gather_epi32(_mm_setzero_si128(), split_index, node, active, 4);
+      __m256d split_value = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), threshold, node, active_pd, 8);
+      __m256i offset = _mm256_add_epi64(_mm256_mul_epi32(_mm256_cvtepi32_epi64(feature), column_stride_epi64), row_offset);
+      __m256d fvalue = GatherCovariatesAVX2(covariates, offset, active);
+      // "Not greater than" is true both for fvalue <= threshold and for missing values,
+      // which matches SplitTrueNumeric and the default (left) child in EvaluateTree
+      __m256d go_left = _mm256_cmp_pd(fvalue, split_value, _CMP_NGT_UQ);
+      __m128i go_left_epi32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(go_left), narrow_mask));
+      __m128i next = _mm_blendv_epi8(right, left, go_left_epi32);
+      node = _mm_blendv_epi8(node, next, active);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(leaf_ids + processed), node);
+  }
+  return processed;
+}
+
+/*! \brief Route groups of 16 rows through a tree with AVX-512 gathers, returning the number of rows processed */
+template <typename Scalar>
+__attribute__((target("avx512f")))
+static int EvaluateTreeBlockAVX512(Tree const& tree, Scalar const* covariates, int64_t column_stride, int64_t row_stride,
+                                   data_size_t row_begin, int num_rows, std::int32_t* leaf_ids) {
+  int const* left_child = tree.cleft_.data();
+  int const* right_child = tree.cright_.data();
+  int const* split_index = tree.split_index_.data();
+  double const* threshold = tree.threshold_.data();
+  __m512i const invalid_node = _mm512_set1_epi32(Tree::kInvalidNodeId);
+  __m512i const column_stride_epi64 = _mm512_set1_epi64(column_stride);
+  __m512i const row_stride_epi64 = _mm512_set1_epi64(row_stride);
+  int processed = 0;
+  for (; processed + 16 <= num_rows; processed += 16) {
+    __m512i node = _mm512_setzero_si512();
+    __m512i row_lo = _mm512_add_epi64(_mm512_set1_epi64(row_begin + processed), _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i row_hi = _mm512_add_epi64(row_lo, _mm512_set1_epi64(8));
+    __m512i row_offset_lo = _mm512_mul_epi32(row_lo, row_stride_epi64);
+    __m512i row_offset_hi = _mm512_mul_epi32(row_hi, row_stride_epi64);
+    while (true) {
+      __m512i left = _mm512_i32gather_epi32(node, left_child, 4);
+      __mmask16 active = _mm512_cmpneq_epi32_mask(left, invalid_node);
+      if (active == 0) break;
+      __mmask8 active_lo = static_cast<__mmask8>(active);
+      __mmask8 active_hi = static_cast<__mmask8>(active >> 8);
+      __m512i right = _mm512_mask_i32gather_epi32(node, active, node, right_child, 4);
+      __m512i feature = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, node, split_index, 4);
+      // Thresholds and covariates are doubles, so they are gathered in two halves of 8 lanes
+      __m256i node_lo = _mm512_castsi512_si256(node);
+      __m256i node_hi = _mm512_extracti64x4_epi64(node, 1);
+      __m512d split_value_lo = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), active_lo, node_lo, threshold, 8);
+      __m512d split_value_hi = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), active_hi, node_hi, threshold, 8);
+      __m512i offset_lo = _mm512_add_epi64(_mm512_mul_epi32(_mm512_cvtepi32_epi64(_mm512_castsi512_si256(feature)), column_stride_epi64), row_offset_lo);
+      __m512i offset_hi = _mm512_add_epi64(_mm512_mul_epi32(_mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(feature, 1)), column_stride_epi64), row_offset_hi);
+      __m512d fvalue_lo = GatherCovariatesAVX512(covariates, offset_lo, active_lo);
+      __m512d fvalue_hi = GatherCovariatesAVX512(covariates, offset_hi, active_hi);
+      // "Not greater than" sends missing values to the default (left) child, as in EvaluateTree
+      __mmask8 go_left_lo = _mm512_cmp_pd_mask(fvalue_lo, split_value_lo, _CMP_NGT_UQ);
+      __mmask8 go_left_hi = _mm512_cmp_pd_mask(fvalue_hi, split_value_hi, _CMP_NGT_UQ);
+      __mmask16 go_left = static_cast<__mmask16>(go_left_lo | (static_cast<unsigned>(go_left_hi) << 8));
+      __m512i next = _mm512_mask_blend_epi32(go_left, right, left);
+      node = _mm512_mask_blend_epi32(active, node, next);
+    }
+    _mm512_storeu_si512(leaf_ids + processed, node);
+  }
+  return processed;
+}
+
+static PredictKernel DetectPredictKernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return PredictKernel::kAVX512;
+  if (__builtin_cpu_supports("avx2")) return PredictKernel::kAVX2;
+  return PredictKernel::kScalar;
+}
+
+#else
+
+static PredictKernel DetectPredictKernel() {
+  return PredictKernel::kScalar;
+}
+
+#endif // STOCHTREE_X86_SIMD
+
+PredictKernel BestPredictKernel() {
+  static PredictKernel const best_kernel = DetectPredictKernel();
+  return best_kernel;
+}
+
+bool PredictKernelSupported(PredictKernel kernel) {
+  return static_cast<int>(kernel) <= static_cast<int>(BestPredictKernel());
+}
+
+template <typename Scalar>
+void EvaluateTreeBlock(Tree const& tree, DataMatrixMapT<Scalar>& covariates, data_size_t row_begin, int num_rows,
+                       std::int32_t* leaf_ids, PredictKernel kernel) {
+  CHECK_LE(num_rows, kPredictBlockRows);
+  int processed = 0;
+  if (tree.IsLeaf(0)) {
+    for (int r = 0; r < num_rows; r++) leaf_ids[r] = 0;
+    return;
+  }
+#ifdef STOCHTREE_X86_SIMD
+  // Categorical splits need a membership test that does not map onto a single compare
+  // Gather offsets use the strides of the map, so borrowed row-major data is read in place
+  if (!tree.HasCategoricalSplit()) {
+    int64_t column_stride = covariates.outerStride();
+    int64_t row_stride = covariates.innerStride();
+    if (kernel == PredictKernel::kAVX512) {
+      processed += EvaluateTreeBlockAVX512(tree, covariates.data(), column_stride, row_stride, row_begin, num_rows, leaf_ids);
+    }
+    if (kernel == PredictKernel::kAVX512 || kernel == PredictKernel::kAVX2) {
+      processed += EvaluateTreeBlockAVX2(tree, covariates.data(), column_stride, row_stride, row_begin + processed,
+                                         num_rows - processed, leaf_ids + processed);
+    }
+  }
+#endif
+  for (int r = processed; r < num_rows; r++) {
+    leaf_ids[r] = EvaluateTree(tree, covariates, row_begin + r);
+  }
+}
+
+template void EvaluateTreeBlock<double>(Tree const& tree, DataMatrixMapT<double>& covariates, data_size_t row_begin, int num_rows,
+                                        std::int32_t* leaf_ids, PredictKernel kernel);
+template void EvaluateTreeBlock<float>(Tree const& tree, DataMatrixMapT<float>& covariates, data_size_t row_begin, int num_rows,
+                                       std::int32_t* leaf_ids, PredictKernel kernel);
+
+} // namespace StochTree
@@ -2,15 +2,23 @@
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <nlohmann/json.hpp>
+#include <stochtree/arrow_dataset.h>
+#include <stochtree/binary_dataset.h>
+#include <stochtree/category_encoder.h>
 #include <stochtree/container.h>
 #include <stochtree/data.h>
 #include <stochtree/leaf_model.h>
 #include <stochtree/meta.h>
+#include <stochtree/parallel.h>
 #include <stochtree/partition_tracker.h>
 #include <stochtree/tree_sampler.h>
 #include <stochtree/variance_model.h>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 #define STRINGIFY(x) #x
@@ -19,6 +27,39 @@
 namespace py = pybind11;
 using data_size_t = StochTree::data_size_t;
 
+/*!
+ * \brief Call `fn(data_ptr, row_stride, col_stride)` with a typed pointer to the elements of the 2-d `array` and its strides 
+ *        (in elements), for float64, float32, int32, int64, uint8 and bool arrays, without converting or copying the array
+ */
+template <typename Function>
+void VisitArrayElements(py::array& array, Function&& fn) {
+  if (array.ndim() != 2) {
+    throw std::runtime_error("Expected a 2-d array");
+  }
+  auto visit = [&](auto const* data_ptr) {
+    py::ssize_t itemsize = array.itemsize();
+    if (array.strides(0) % itemsize != 0 || array.strides(1) % itemsize != 0) {
+      throw std::runtime_error("Array strides must be multiples of the element size");
+    }
+    fn(data_ptr, static_cast<std::ptrdiff_t>(array.strides(0) / itemsize), static_cast<std::ptrdiff_t>(array.strides(1) / itemsize));
+  };
+  if (py::isinstance<py::array_t<double>>(array)) {
+    visit(static_cast<double const*>(array.data()));
+  } else if (py::isinstance<py::array_t<float>>(array)) {
+    visit(static_cast<float const*>(array.data()));
+  } else if (py::isinstance<py::array_t<std::int32_t>>(array)) {
+    visit(static_cast<std::int32_t const*>(array.data()));
+  } else if (py::isinstance<py::array_t<std::int64_t>>(array)) {
+    visit(static_cast<std::int64_t const*>(array.data()));
+  } else if (py::isinstance<py::array_t<std::uint8_t>>(array)) {
+    visit(static_cast<std::uint8_t const*>(array.data()));
+  } else if (py::isinstance<py::array_t<bool>>(array)) {
+    visit(static_cast<bool const*>(array.data()));
+  } else {
+    throw std::runtime_error("Unsupported array dtype");
+  }
+}
+
 enum ForestLeafModel {
     kConstant, 
     kUnivariateRegression, 
@@ -33,20 +74,55 @@ class ForestDatasetCpp {
   }
   ~ForestDatasetCpp() {}
 
-  void AddCovariates(py::array_t<double> covariate_matrix, data_size_t num_row, int num_col, bool row_major) {
+  void AddCovariates(py::array_t<double> covariate_matrix, data_size_t num_row, int num_col, bool row_major, bool borrow) {
     // Extract pointer to contiguous block of memory
     double* data_ptr = static_cast<double*>(covariate_matrix.mutable_data());
     
-    // Load covariates
-    dataset_->AddCovariates(data_ptr, num_row, num_col, row_major);
+    // Load covariates (a borrowed array must be kept alive by the Python Dataset)
+    dataset_->AddCovariates(data_ptr, num_row, num_col, row_major, borrow);
   }
 
-  void AddBasis(py::array_t<double> basis_matrix, data_size_t num_row, int num_col, bool row_major) {
+  void AddBasis(py::array_t<double> basis_matrix, data_size_t num_row, int num_col, bool row_major, bool borrow) {
     // Extract pointer to contiguous block of memory
     double* data_ptr = static_cast<double*>(basis_matrix.mutable_data());
     
-    // Load covariates
-    dataset_->AddBasis(data_ptr, num_row, num_col, row_major);
+    // Load covariates (a borrowed array must be kept alive by the Python Dataset)
+    dataset_->AddBasis(data_ptr, num_row, num_col, row_major, borrow);
+  }
+
+  void AddCovariatesFloat32(py::array_t<float> covariate_matrix, data_size_t num_row, int num_col, bool row_major, bool borrow) {
+    // Covariates are stored in single precision, without converting them to double
+    float* data_ptr = static_cast<float*>(covariate_matrix.mutable_data());
+    dataset_->AddCovariates(data_ptr, num_row, num_col, row_major, borrow);
+  }
+
+  void AddCovariatesArray(py::array covariate_matrix, bool single_precision) {
+    // Read the array (of any supported dtype, contiguous or not) in place and convert it in a single pass
+    data_size_t num_row = covariate_matrix.shape(0);
+    int num_col = covariate_matrix.shape(1);
+    VisitArrayElements(covariate_matrix, [&](auto const* data_ptr, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride) {
+      dataset_->AddCovariatesStrided(data_ptr, num_row, num_col, row_stride, col_stride, single_precision);
+    });
+  }
+
+  void AddBasisArray(py::array basis_matrix, bool single_precision) {
+    // Read the array (of any supported dtype, contiguous or not) in place and convert it in a single pass
+    data_size_t num_row = basis_matrix.shape(0);
+    int num_col = basis_matrix.shape(1);
+    VisitArrayElements(basis_matrix, [&](auto const* data_ptr, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride) {
+      dataset_->AddBasisStrided(data_ptr, num_row, num_col, row_stride, col_stride, single_precision);
+    });
+  }
+
+  void AddSparseCovariates(py::array_t<int> col_ptr, py::array_t<int> row_index, py::array_t<double> values, data_size_t num_row, int num_col) {
+    // Compressed sparse column covariates are copied as is, without densifying them
+    dataset_->AddSparseCovariates(col_ptr.data(), row_index.data(), values.data(), num_row, num_col);
+  }
+
+  void AddBasisFloat32(py::array_t<float> basis_matrix, data_size_t num_row, int num_col, bool row_major, bool borrow) {
+    // Basis is stored in single precision, without converting it to double
+    float* data_ptr = static_cast<float*>(basis_matrix.mutable_data());
+    dataset_->AddBasis(data_ptr, num_row, num_col, row_major, borrow);
   }
 
   void UpdateBasis(py::array_t<double> basis_matrix, data_size_t num_row, int num_col, bool row_major) {
@@ -57,6 +133,14 @@ class ForestDatasetCpp {
     dataset_->UpdateBasis(data_ptr, num_row, num_col, row_major);
   }
 
+  void BinCovariates(int max_bins, int num_threads, bool release_covariates) {
+    dataset_->BinCovariates(max_bins, num_threads, release_covariates);
+  }
+
+  void AddRowMajorCovariates(int num_threads) {
+    dataset_->AddRowMajorCovariates(num_threads);
+  }
+
   void AddVarianceWeights(py::array_t<double> weight_vector, data_size_t num_row) {
     // Extract pointer to contiguous block of memory
     double* data_ptr = static_cast<double*>(weight_vector.mutable_data());
@@ -69,6 +153,34 @@ class ForestDatasetCpp {
     return dataset_->NumObservations();
   }
 
+  void SaveBinary(std::string filename, py::array_t<int> feature_types, bool include_presort) {
+    std::vector<StochTree::FeatureType> feature_types_(feature_types.size());
+    for (int i = 0; i < feature_types.size(); i++) {
+      feature_types_[i] = static_cast<StochTree::FeatureType>(feature_types.at(i));
+    }
+    StochTree::SaveBinaryDataset(*dataset_, feature_types_, filename, include_presort);
+  }
+
+  std::vector<int> LoadBinary(std::string filename) {
+    // The dataset keeps the memory-mapped file alive, so nothing needs to be retained on the Python side
+    std::vector<StochTree::FeatureType> feature_types;
+    StochTree::LoadBinaryDataset(filename, *dataset_, feature_types);
+    return std::vector<int>(feature_types.begin(), feature_types.end());
+  }
+
+  std::vector<int> AddArrowCovariates(py::object schema_capsule, py::object array_capsule, bool single_precision, int num_threads) {
+    // Capsules of the Arrow PyCapsule interface (see `__arrow_c_array__`); the importer moves the array out of its capsule
+    ArrowSchema* schema = static_cast<ArrowSchema*>(PyCapsule_GetPointer(schema_capsule.ptr(), "arrow_schema"));
+    ArrowArray* array = static_cast<ArrowArray*>(PyCapsule_GetPointer(array_capsule.ptr(), "arrow_array"));
+    if (schema == nullptr || array == nullptr) throw py::error_already_set();
+    StochTree::ArrowDatasetConfig config;
+    config.single_precision = single_precision;
+    config.num_threads = num_threads;
+    StochTree::ArrowDatasetImporter importer(config);
+    importer.Import(array, schema, *dataset_);
+    return std::vector<int>(importer.FeatureTypes().begin(), importer.FeatureTypes().end());
+  }
+
   StochTree::ForestDataset* GetDataset() {
     return dataset_.get();
   }
@@ -139,12 +251,12 @@ class ForestContainerCpp {
     return forest_samples_->NumSamples();
   }
 
-  py::array_t<double> Predict(ForestDatasetCpp& dataset) {
+  py::array_t<double> Predict(ForestDatasetCpp& dataset, int num_threads, int engine) {
     // Predict from the forest container
     data_size_t n = dataset.NumRows();
     int num_samples = this->NumSamples();
     StochTree::ForestDataset* data_ptr = dataset.GetDataset();
-    std::vector<double> output_raw = forest_samples_->Predict(*data_ptr);
+    std::vector<double> output_raw = forest_samples_->Predict(*data_ptr, num_threads, static_cast<StochTree::ForestPredictEngine>(engine));
 
     // Convert result to a matrix
     auto result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n, num_samples}));
@@ -162,13 +274,13 @@ class ForestContainerCpp {
     return result;
   }
 
-  py::array_t<double> PredictRaw(ForestDatasetCpp& dataset) {
+  py::array_t<double> PredictRaw(ForestDatasetCpp& dataset, int num_threads, int engine) {
     // Predict from the forest container
     data_size_t n = dataset.NumRows();
     int num_samples = this->NumSamples();
     int output_dim = this->OutputDimension();
     StochTree::ForestDataset* data_ptr = dataset.GetDataset();
-    std::vector<double> output_raw = forest_samples_->PredictRaw(*data_ptr);
+    std::vector<double> output_raw = forest_samples_->PredictRaw(*data_ptr, num_threads, static_cast<StochTree::ForestPredictEngine>(engine));
 
     // Convert result to 3 dimensional array (n x num_samples x output_dim)
     auto result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n, num_samples, output_dim}));
@@ -193,7 +305,7 @@ class ForestContainerCpp {
     int num_samples = this->NumSamples();
     int output_dim = this->OutputDimension();
     StochTree::ForestDataset* data_ptr = dataset.GetDataset();
-    std::vector<double> output_raw = forest_samples_->PredictRaw(*data_ptr, forest_num);
+    std::vector<double> output_raw = forest_samples_->PredictRawSingleForest(*data_ptr, forest_num);
 
     // Convert result to a matrix
     auto result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n, output_dim}));
@@ -210,6 +322,45 @@ class ForestContainerCpp {
     return result;
   }
 
+  py::tuple PredictSummary(ForestDatasetCpp& dataset, py::array_t<int> sample_indices, py::array_t<double> quantile_probs, int num_threads) {
+    // Unpack the (0-indexed) samples and quantiles to summarize
+    std::vector<int> sample_indices_(sample_indices.size());
+    for (int i = 0; i < sample_indices.size(); i++) {
+      sample_indices_[i] = sample_indices.at(i);
+    }
+    std::vector<double> quantile_probs_(quantile_probs.size());
+    for (int i = 0; i < quantile_probs.size(); i++) {
+      quantile_probs_[i] = quantile_probs.at(i);
+    }
+
+    // Summarize predictions from the forest container
+    data_size_t n = dataset.NumRows();
+    int num_quantiles = quantile_probs_.size();
+    StochTree::ForestDataset* data_ptr = dataset.GetDataset();
+    std::vector<double> mean_raw;
+    std::vector<double> variance_raw;
+    std::vector<double> quantile_raw;
+    forest_samples_->PredictSummary(*data_ptr, sample_indices_, quantile_probs_, mean_raw, variance_raw, quantile_raw, num_threads);
+
+    // Convert results to arrays (quantiles as an n x num_quantiles matrix)
+    auto mean_result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n}));
+    auto variance_result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n}));
+    auto quantile_result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n, num_quantiles}));
+    auto mean_accessor = mean_result.mutable_unchecked<1>();
+    auto variance_accessor = variance_result.mutable_unchecked<1>();
+    auto quantile_accessor = quantile_result.mutable_unchecked<2>();
+    for (size_t i = 0; i < n; i++) {
+      mean_accessor(i) = mean_raw[i];
+      variance_accessor(i) = variance_raw[i];
+      for (int j = 0; j < num_quantiles; j++) {
+        // NOTE: converting from "column-major" to "row-major" here
+        quantile_accessor(i,j) = quantile_raw[j*n + i];
+      }
+    }
+
+    return py::make_tuple(mean_result, variance_result, quantile_result);
+  }
+
   void SetRootValue(int forest_num, double leaf_value) {
     forest_samples_->InitializeRoot(leaf_value);
   }
@@ -255,7 +406,7 @@ class ForestContainerCpp {
 
 class ForestSamplerCpp {
  public:
-  ForestSamplerCpp(ForestDatasetCpp& dataset, py::array_t<int> feature_types, int num_trees, data_size_t num_obs, double alpha, double beta, int min_samples_leaf) {
+  ForestSamplerCpp(ForestDatasetCpp& dataset, py::array_t<int> feature_types, int num_trees, data_size_t num_obs, double alpha, double beta, int min_samples_leaf, bool cache_tree_predictions) {
     // Convert vector of integers to std::vector of enum FeatureType
     std::vector<StochTree::FeatureType> feature_types_(feature_types.size());
     for (int i = 0; i < feature_types.size(); i++) {
@@ -264,13 +415,40 @@ class ForestSamplerCpp {
     
     // Initialize pointer to C++ ForestTracker and TreePrior classes
     StochTree::ForestDataset* dataset_ptr = dataset.GetDataset();
-    tracker_ = std::make_unique<StochTree::ForestTracker>(dataset_ptr->GetCovariates(), feature_types_, num_trees, num_obs);
+    tracker_ = std::make_unique<StochTree::ForestTracker>(*dataset_ptr, feature_types_, num_trees, num_obs, cache_tree_predictions);
     split_prior_ = std::make_unique<StochTree::TreePrior>(alpha, beta, min_samples_leaf);
   }
   ~ForestSamplerCpp() {}
 
   StochTree::ForestTracker* GetTracker() {return tracker_.get();}
 
+  void AddTestSet(ForestDatasetCpp& test_dataset) {
+    tracker_->AddTestSet(*test_dataset.GetDataset());
+  }
+
+  void SetNumThreads(int num_threads) {
+    tracker_->SetNumThreads(num_threads);
+  }
+
+  py::array_t<double> GetTestSetPredictions() {
+    // Unpack the predictions recorded during sampling
+    std::vector<double>& output_raw = tracker_->GetTestSetPredictions();
+    data_size_t n = tracker_->NumTestObservations();
+    int num_samples = tracker_->NumTestSetPredictions();
+
+    // Convert result to a matrix
+    auto result = py::array_t<double>(py::detail::any_container<py::ssize_t>({n, num_samples}));
+    auto accessor = result.mutable_unchecked<2>();
+    for (size_t i = 0; i < n; i++) {
+      for (int j = 0; j < num_samples; j++) {
+        // NOTE: converting from "column-major" to "row-major" here
+        accessor(i,j) = output_raw[j*n + i];
+      }
+    }
+
+    return result;
+  }
+
   void SampleOneIteration(ForestContainerCpp& forest_samples, ForestDatasetCpp& dataset, ResidualCpp& residual, RngCpp& rng, 
                           py::array_t<int> feature_types, int cutpoint_grid_size, py::array_t<double> leaf_model_scale_input, 
                           py::array_t<double> variable_weights, double global_variance, int leaf_model_int, bool gfr = true, bool pre_initialized = false) {
@@ -408,6 +586,104 @@ void ForestContainerCpp::UpdateResidual(ForestDatasetCpp& dataset, ResidualCpp&
   StochTree::UpdateResidualEntireForest(*(sampler.GetTracker()), *(dataset.GetDataset()), *(residual.GetData()), forest_samples_->GetEnsemble(forest_num), requires_basis, op);
 }
 
+class CategoryEncoderCpp {
+ public:
+  CategoryEncoderCpp() {
+    // Initialize pointer to C++ CategoryEncoder class
+    encoder_ = std::make_unique<StochTree::CategoryEncoder>();
+  }
+  ~CategoryEncoderCpp() {}
+
+  int AddFeature(int feature_type, std::string feature_name, std::vector<std::string> levels) {
+    int feature_num = encoder_->AddFeature(static_cast<StochTree::FeatureType>(feature_type), feature_name);
+    encoder_->GetDictionary(feature_num).SetStringLevels(levels);
+    return feature_num;
+  }
+
+  int FitFeature(int feature_type, std::string feature_name, py::list values, int num_threads) {
+    int feature_num = encoder_->AddFeature(static_cast<StochTree::FeatureType>(feature_type), feature_name);
+    std::vector<std::string> storage;
+    std::vector<char const*> value_ptrs = StringPointers(values, storage);
+    encoder_->GetDictionary(feature_num).FitStrings(value_ptrs.data(), value_ptrs.size(), num_threads);
+    return feature_num;
+  }
+
+  int NumFeatures() {
+    return encoder_->NumFeatures();
+  }
+
+  int NumLevels(int feature_num) {
+    return encoder_->GetDictionary(feature_num).NumLevels();
+  }
+
+  std::vector<std::string> Levels(int feature_num) {
+    return encoder_->GetDictionary(feature_num).StringLevels();
+  }
+
+  py::array_t<double> EncodeStrings(int feature_num, py::list values, int num_threads) {
+    std::vector<std::string> storage;
+    std::vector<char const*> value_ptrs = StringPointers(values, storage);
+    auto result = py::array_t<double>(py::detail::any_container<py::ssize_t>({static_cast<py::ssize_t>(value_ptrs.size())}));
+    encoder_->GetDictionary(feature_num).EncodeStrings(value_ptrs.data(), value_ptrs.size(), result.mutable_data(), 1, num_threads);
+    return result;
+  }
+
+  py::array_t<double> EncodeCategorical(int feature_num, py::array_t<std::int64_t> category_codes, std::vector<std::string> categories, int num_threads) {
+    // Look up each category of a pandas categorical once, then map the integer codes (-1 for missing) through the lookup table
+    StochTree::CategoryDictionary& dictionary = encoder_->GetDictionary(feature_num);
+    std::vector<double> category_table(categories.size());
+    for (size_t k = 0; k < categories.size(); k++) {
+      category_table[k] = dictionary.Code(categories[k].c_str());
+    }
+    data_size_t n = category_codes.size();
+    std::int64_t const* code_ptr = category_codes.data();
+    auto result = py::array_t<double>(py::detail::any_container<py::ssize_t>({static_cast<py::ssize_t>(n)}));
+    double* result_ptr = result.mutable_data();
+    std::int64_t num_categories = categories.size();
+    StochTree::ParallelFor(0, n, 16384, num_threads, [&](int64_t block_begin, int64_t block_end) {
+      for (int64_t i = block_begin; i < block_end; i++) {
+        std::int64_t code = code_ptr[i];
+        result_ptr[i] = (code < 0 || code >= num_categories) ? std::numeric_limits<double>::quiet_NaN() : category_table[code];
+      }
+    });
+    return result;
+  }
+
+  py::array_t<double> OneHot(int feature_num, py::array_t<double> codes, int num_threads) {
+    StochTree::CategoryDictionary& dictionary = encoder_->GetDictionary(feature_num);
+    data_size_t n = codes.size();
+    py::ssize_t num_columns = dictionary.NumLevels() + 1;
+    auto result = py::array_t<double, py::array::f_style>(py::detail::any_container<py::ssize_t>({static_cast<py::ssize_t>(n), num_columns}));
+    dictionary.OneHot(codes.data(), n, result.mutable_data(), num_threads);
+    return result;
+  }
+
+  nlohmann::json ToJson() {
+    return encoder_->to_json();
+  }
+
+  void LoadFromJson(JsonCpp& json);
+
+ private:
+  std::unique_ptr<StochTree::CategoryEncoder> encoder_;
+
+  /*! \brief Pointers to the string value of each element of `values` (converted with `str`), with null pointers for `None` and NaN */
+  static std::vector<char const*> StringPointers(py::list& values, std::vector<std::string>& storage) {
+    storage.resize(values.size());
+    std::vector<char const*> value_ptrs(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      py::handle value = values[i];
+      if (value.is_none() || (py::isinstance<py::float_>(value) && std::isnan(value.cast<double>()))) {
+        value_ptrs[i] = nullptr;
+      } else {
+        storage[i] = py::str(value).cast<std::string>();
+        value_ptrs[i] = storage[i].c_str();
+      }
+    }
+    return value_ptrs;
+  }
+};
+
 class JsonCpp {
  public:
   JsonCpp() {
@@ -442,6 +718,14 @@ class JsonCpp {
     return forest_label;
   }
 
+  void AddCategoryEncoder(CategoryEncoderCpp& category_encoder) {
+    if (json_->contains("category_encoder")) {
+      json_->at("category_encoder") = category_encoder.ToJson();
+    } else {
+      json_->emplace("category_encoder", category_encoder.ToJson());
+    }
+  }
+
   void AddDouble(std::string field_name, double field_value) {
     if (json_->contains(field_name)) {
       json_->at(field_name) = field_value;
@@ -673,6 +957,10 @@ class JsonCpp {
     return json_->at("forests").at(forest_label);
   }
 
+  nlohmann::json SubsetJsonCategoryEncoder() {
+    return json_->at("category_encoder");
+  }
+
  private:
   std::unique_ptr<nlohmann::json> json_;
 };
@@ -683,6 +971,10 @@ void ForestContainerCpp::LoadFromJson(JsonCpp& json, std::string forest_label) {
   forest_samples_->from_json(forest_json);
 }
 
+void CategoryEncoderCpp::LoadFromJson(JsonCpp& json) {
+  encoder_->from_json(json.SubsetJsonCategoryEncoder());
+}
+
 PYBIND11_MODULE(stochtree_cpp, m) {
   py::class_<JsonCpp>(m, "JsonCpp")
     .def(py::init<>())
@@ -700,6 +992,7 @@ PYBIND11_MODULE(stochtree_cpp, m) {
     .def("AddStringVector", &JsonCpp::AddStringVector)
     .def("AddStringVectorSubfolder", &JsonCpp::AddStringVectorSubfolder)
     .def("AddForest", &JsonCpp::AddForest)
+    .def("AddCategoryEncoder", &JsonCpp::AddCategoryEncoder)
     .def("ContainsField", &JsonCpp::ContainsField)
     .def("ContainsFieldSubfolder", &JsonCpp::ContainsFieldSubfolder)
     .def("ExtractDouble", &JsonCpp::ExtractDouble)
@@ -713,13 +1006,35 @@ PYBIND11_MODULE(stochtree_cpp, m) {
     .def("ExtractStringVector", &JsonCpp::ExtractStringVector)
     .def("ExtractStringVectorSubfolder", &JsonCpp::ExtractStringVectorSubfolder)
     .def("SubsetJsonForest", &JsonCpp::SubsetJsonForest);
+
+  py::class_<CategoryEncoderCpp>(m, "CategoryEncoderCpp")
+    .def(py::init<>())
+    .def("AddFeature", &CategoryEncoderCpp::AddFeature)
+    .def("FitFeature", &CategoryEncoderCpp::FitFeature)
+    .def("NumFeatures", &CategoryEncoderCpp::NumFeatures)
+    .def("NumLevels", &CategoryEncoderCpp::NumLevels)
+    .def("Levels", &CategoryEncoderCpp::Levels)
+    .def("EncodeStrings", &CategoryEncoderCpp::EncodeStrings)
+    .def("EncodeCategorical", &CategoryEncoderCpp::EncodeCategorical)
+    .def("OneHot", &CategoryEncoderCpp::OneHot)
+    .def("LoadFromJson", &CategoryEncoderCpp::LoadFromJson);
   
   py::class_<ForestDatasetCpp>(m, "ForestDatasetCpp")
     .def(py::init<>())
     .def("AddCovariates", &ForestDatasetCpp::AddCovariates)
     .def("AddBasis", &ForestDatasetCpp::AddBasis)
+    .def("AddCovariatesFloat32", &ForestDatasetCpp::AddCovariatesFloat32)
+    .def("AddCovariatesArray", &ForestDatasetCpp::AddCovariatesArray)
+    .def("AddBasisArray", &ForestDatasetCpp::AddBasisArray)
+    .def("AddSparseCovariates", &ForestDatasetCpp::AddSparseCovariates)
+    .def("AddArrowCovariates", &ForestDatasetCpp::AddArrowCovariates)
+    .def("AddBasisFloat32", &ForestDatasetCpp::AddBasisFloat32)
     .def("UpdateBasis", &ForestDatasetCpp::UpdateBasis)
+    .def("BinCovariates", &ForestDatasetCpp::BinCovariates)
+    .def("AddRowMajorCovariates", &ForestDatasetCpp::AddRowMajorCovariates)
     .def("AddVarianceWeights", &ForestDatasetCpp::AddVarianceWeights)
+    .def("SaveBinary", &ForestDatasetCpp::SaveBinary)
+    .def("LoadBinary", &ForestDatasetCpp::LoadBinary)
     .def("NumRows", &ForestDatasetCpp::NumRows);
 
   py::class_<ResidualCpp>(m, "ResidualCpp")
@@ -732,9 +1047,10 @@ PYBIND11_MODULE(stochtree_cpp, m) {
     .def(py::init<int,int,bool>())
     .def("OutputDimension", &ForestContainerCpp::OutputDimension)
     .def("NumSamples", &ForestContainerCpp::NumSamples)
-    .def("Predict", &ForestContainerCpp::Predict)
-    .def("PredictRaw", &ForestContainerCpp::PredictRaw)
+    .def("Predict", &ForestContainerCpp::Predict, py::arg("dataset"), py::arg("num_threads"), py::arg("engine") = 0)
+    .def("PredictRaw", &ForestContainerCpp::PredictRaw, py::arg("dataset"), py::arg("num_threads"), py::arg("engine") = 0)
     .def("PredictRawSingleForest", &ForestContainerCpp::PredictRawSingleForest)
+    .def("PredictSummary", &ForestContainerCpp::PredictSummary)
     .def("SetRootValue", &ForestContainerCpp::SetRootValue)
     .def("SetRootVector", &ForestContainerCpp::SetRootVector)
     .def("UpdateResidual", &ForestContainerCpp::UpdateResidual)
@@ -743,8 +1059,11 @@ PYBIND11_MODULE(stochtree_cpp, m) {
     .def("LoadFromJson", &ForestContainerCpp::LoadFromJson);
 
   py::class_<ForestSamplerCpp>(m, "ForestSamplerCpp")
-    .def(py::init<ForestDatasetCpp&, py::array_t<int>, int, data_size_t, double, double, int>())
-    .def("SampleOneIteration", &ForestSamplerCpp::SampleOneIteration);
+    .def(py::init<ForestDatasetCpp&, py::array_t<int>, int, data_size_t, double, double, int, bool>())
+    .def("SampleOneIteration", &ForestSamplerCpp::SampleOneIteration)
+    .def("AddTestSet", &ForestSamplerCpp::AddTestSet)
+    .def("SetNumThreads", &ForestSamplerCpp::SetNumThreads)
+    .def("GetTestSetPredictions", &ForestSamplerCpp::GetTestSetPredictions);
 
   py::class_<GlobalVarianceModelCpp>(m, "GlobalVarianceModelCpp")
     .def(py::init<>())
@@ -0,0 +1,150 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/log.h>
+#include <stochtree/quickscorer.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace StochTree {
+
+/*! \brief Maximum number of leaves per tree, set by the width of the leaf bitvectors */
+static constexpr int32_t kQuickScorerMaxLeaves = 64;
+
+bool QuickScorerEnsemble::Supports(TreeEnsemble& ensemble) {
+  for (int j = 0; j < ensemble.NumTrees(); j++) {
+    Tree* tree = ensemble.GetTree(j);
+    if (tree->HasCategoricalSplit() || tree->NumLeaves() > kQuickScorerMaxLeaves) return false;
+  }
+  return true;
+}
+
+QuickScorerEnsemble::QuickScorerEnsemble(TreeEnsemble& ensemble) {
+  if (!Supports(ensemble)) {
+    Log::Fatal("QuickScorerEnsemble requires trees with at most 64 leaves and no categorical splits");
+  }
+  num_trees_ = ensemble.NumTrees();
+  output_dimension_ = ensemble.OutputDimension();
+  is_leaf_constant_ = ensemble.IsLeafConstant();
+
+  // Collect split nodes and leaves of every tree
+  std::vector<int32_t> node_feature;
+  std::vector<double> node_threshold;
+  std::vector<int32_t> node_tree;
+  std::vector<std::uint64_t> node_mask;
+  leaf_begin_.resize(num_trees_);
+  for (int32_t j = 0; j < num_trees_; j++) {
+    leaf_begin_[j] = static_cast<int32_t>(leaf_values_.size());
+    int32_t num_leaves = 0;
+    CompileSubtree(ensemble.GetTree(j), j, 0, &num_leaves, node_feature, node_threshold, node_tree, node_mask);
+  }
+
+  // Group split nodes by feature, with increasing thresholds within a feature
+  std::vector<size_t> order(node_feature.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (node_feature[a] != node_feature[b]) return node_feature[a] < node_feature[b];
+    return node_threshold[a] < node_threshold[b];
+  });
+  int32_t num_features = node_feature.empty() ? 0 : *std::max_element(node_feature.begin(), node_feature.end()) + 1;
+  feature_begin_.assign(num_features + 1, 0);
+  threshold_.reserve(order.size());
+  node_tree_.reserve(order.size());
+  node_mask_.reserve(order.size());
+  for (size_t i : order) {
+    threshold_.push_back(node_threshold[i]);
+    node_tree_.push_back(node_tree[i]);
+    node_mask_.push_back(node_mask[i]);
+    feature_begin_[node_feature[i] + 1]++;
+  }
+  for (int32_t f = 0; f < num_features; f++) {
+    feature_begin_[f + 1] += feature_begin_[f];
+  }
+}
+
+void QuickScorerEnsemble::CompileSubtree(Tree* tree, int32_t tree_num, int32_t nid, int32_t* num_leaves,
+                                         std::vector<int32_t>& node_feature, std::vector<double>& node_threshold,
+                                         std::vector<int32_t>& node_tree, std::vector<std::uint64_t>& node_mask) {
+  if (tree->IsLeaf(nid)) {
+    // Leaves are reached in left-to-right order, so they are stored in bit order
+    for (int32_t k = 0; k < output_dimension_; k++) {
+      leaf_values_.push_back(tree->LeafValue(nid, k));
+    }
+    (*num_leaves)++;
+    return;
+  }
+  int32_t left_begin = *num_leaves;
+  CompileSubtree(tree, tree_num, tree->LeftChild(nid), num_leaves, node_feature, node_threshold, node_tree, node_mask);
+  int32_t left_size = *num_leaves - left_begin;
+  std::uint64_t left_bits = (left_size == kQuickScorerMaxLeaves) ? ~std::uint64_t(0) : ((std::uint64_t(1) << left_size) - 1);
+  node_feature.push_back(tree->SplitIndex(nid));
+  node_threshold.push_back(tree->Threshold(nid));
+  node_tree.push_back(tree_num);
+  node_mask.push_back(~(left_bits << left_begin));
+  CompileSubtree(tree, tree_num, tree->RightChild(nid), num_leaves, node_feature, node_threshold, node_tree, node_mask);
+}
+
+void QuickScorerEnsemble::PredictRowsInplace(ForestDataset& dataset, std::vector<double>& output,
+                                             data_size_t row_begin, data_size_t row_end, data_size_t offset) {
+  CHECK_LE(row_end, dataset.NumObservations());
+  CHECK_GE(dataset.NumCovariates(), static_cast<int64_t>(feature_begin_.size()) - 1);
+  if (output.size() < row_end + offset) {
+    Log::Fatal("Mismatched size of prediction vector and training data");
+  }
+  std::vector<std::uint64_t> leaf_bits(num_trees_);
+  double pred;
+  if (is_leaf_constant_) {
+    dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+      for (data_size_t i = row_begin; i < row_end; i++) {
+        ScoreRow(covariates, i, leaf_bits.data());
+        pred = 0.0;
+        for (int32_t j = 0; j < num_trees_; j++) {
+          pred += leaf_values_[LeafOffset(j, leaf_bits[j])];
+        }
+        output[i + offset] = pred;
+      }
+    });
+  } else {
+    CHECK(dataset.HasBasis());
+    CHECK_EQ(output_dimension_, dataset.NumBasis());
+    dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+      dataset.VisitBasis([&](auto& basis) {
+        for (data_size_t i = row_begin; i < row_end; i++) {
+          ScoreRow(covariates, i, leaf_bits.data());
+          pred = 0.0;
+          for (int32_t j = 0; j < num_trees_; j++) {
+            double const* leaf_value = leaf_values_.data() + LeafOffset(j, leaf_bits[j]);
+            for (int32_t k = 0; k < output_dimension_; k++) {
+              pred += leaf_value[k] * basis(i, k);
+            }
+          }
+          output[i + offset] = pred;
+        }
+      });
+    });
+  }
+}
+
+void QuickScorerEnsemble::PredictRawRowsInplace(ForestDataset& dataset, std::vector<double>& output,
+                                                data_size_t row_begin, data_size_t row_end, data_size_t offset) {
+  CHECK_LE(row_end, dataset.NumObservations());
+  CHECK_GE(dataset.NumCovariates(), static_cast<int64_t>(feature_begin_.size()) - 1);
+  if (output.size() < row_end * output_dimension_ + offset) {
+    Log::Fatal("Mismatched size of raw prediction vector and training data");
+  }
+  std::vector<std::uint64_t> leaf_bits(num_trees_);
+  dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+    for (data_size_t i = row_begin; i < row_end; i++) {
+      ScoreRow(covariates, i, leaf_bits.data());
+      double* row_output = output.data() + i*output_dimension_ + offset;
+      std::fill(row_output, row_output + output_dimension_, 0.0);
+      for (int32_t j = 0; j < num_trees_; j++) {
+        double const* leaf_value = leaf_values_.data() + LeafOffset(j, leaf_bits[j]);
+        for (int32_t k = 0; k < output_dimension_; k++) {
+          row_output[k] += leaf_value[k];
+        }
+      }
+    }
+  });
+}
+
+} // namespace StochTree
@@ -182,7 +182,7 @@ cpp11::external_pointer<StochTree::TreePrior> tree_prior_cpp(double alpha, doubl
 }
 
 [[cpp11::register]]
-cpp11::external_pointer<StochTree::ForestTracker> forest_tracker_cpp(cpp11::external_pointer<StochTree::ForestDataset> data, cpp11::integers feature_types, int num_trees, StochTree::data_size_t n) {
+cpp11::external_pointer<StochTree::ForestTracker> forest_tracker_cpp(cpp11::external_pointer<StochTree::ForestDataset> data, cpp11::integers feature_types, int num_trees, StochTree::data_size_t n, bool cache_tree_predictions) {
     // Convert vector of integers to std::vector of enum FeatureType
     std::vector<StochTree::FeatureType> feature_types_(feature_types.size());
     for (int i = 0; i < feature_types.size(); i++) {
@@ -190,8 +190,36 @@ cpp11::external_pointer<StochTree::ForestTracker> forest_tracker_cpp(cpp11::exte
     }
     
     // Create smart pointer to newly allocated object
-    std::unique_ptr<StochTree::ForestTracker> tracker_ptr_ = std::make_unique<StochTree::ForestTracker>(data->GetCovariates(), feature_types_, num_trees, n);
+    std::unique_ptr<StochTree::ForestTracker> tracker_ptr_ = std::make_unique<StochTree::ForestTracker>(*data, feature_types_, num_trees, n, cache_tree_predictions);
     
     // Release management of the pointer to R session
     return cpp11::external_pointer<StochTree::ForestTracker>(tracker_ptr_.release());
-}
\ No newline at end of file
+}
+
+[[cpp11::register]]
+void forest_tracker_add_test_set_cpp(cpp11::external_pointer<StochTree::ForestTracker> tracker, cpp11::external_pointer<StochTree::ForestDataset> test_data) {
+    tracker->AddTestSet(*test_data);
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles_matrix<> forest_tracker_test_set_predictions_cpp(cpp11::external_pointer<StochTree::ForestTracker> tracker) {
+    // Unpack the predictions recorded during sampling
+    std::vector<double>& output_raw = tracker->GetTestSetPredictions();
+    int n = tracker->NumTestObservations();
+    int num_samples = tracker->NumTestSetPredictions();
+    
+    // Convert result to a matrix
+    cpp11::writable::doubles_matrix<> output(n, num_samples);
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < num_samples; j++) {
+            output(i, j) = output_raw[n*j + i];
+        }
+    }
+    
+    return output;
+}
+
+[[cpp11::register]]
+void forest_tracker_set_num_threads_cpp(cpp11::external_pointer<StochTree::ForestTracker> tracker, int num_threads) {
+    tracker->SetNumThreads(num_threads);
+}
@@ -1,5 +1,6 @@
 #include <cpp11.hpp>
 #include "stochtree_types.h"
+#include <stochtree/category_encoder.h>
 #include <stochtree/container.h>
 #include <stochtree/leaf_model.h>
 #include <stochtree/meta.h>
@@ -304,6 +305,49 @@ std::string json_add_rfx_groupids_cpp(cpp11::external_pointer<nlohmann::json> js
     return rfx_label;
 }
 
+[[cpp11::register]]
+void json_add_category_encoder_cpp(cpp11::external_pointer<nlohmann::json> json_ptr, cpp11::strings feature_names, cpp11::integers feature_types, cpp11::list feature_levels) {
+    StochTree::CategoryEncoder encoder;
+    for (R_xlen_t j = 0; j < feature_names.size(); j++) {
+        int feature_num = encoder.AddFeature(static_cast<StochTree::FeatureType>(feature_types[j]), std::string(feature_names[j]));
+        cpp11::strings levels(feature_levels[j]);
+        std::vector<std::string> level_vec(levels.size());
+        for (R_xlen_t k = 0; k < levels.size(); k++) level_vec[k] = std::string(levels[k]);
+        encoder.GetDictionary(feature_num).SetStringLevels(level_vec);
+    }
+    if (json_ptr->contains("category_encoder")) {
+        json_ptr->at("category_encoder") = encoder.to_json();
+    } else {
+        json_ptr->emplace("category_encoder", encoder.to_json());
+    }
+}
+
+[[cpp11::register]]
+cpp11::writable::list json_extract_category_encoder_cpp(cpp11::external_pointer<nlohmann::json> json_ptr) {
+    StochTree::CategoryEncoder encoder;
+    encoder.from_json(json_ptr->at("category_encoder"));
+    int num_features = encoder.NumFeatures();
+    cpp11::writable::strings feature_names(num_features);
+    cpp11::writable::integers feature_types(num_features);
+    cpp11::writable::list feature_levels(num_features);
+    for (int j = 0; j < num_features; j++) {
+        feature_names[j] = encoder.GetFeatureName(j);
+        feature_types[j] = static_cast<int>(encoder.GetFeatureType(j));
+        // Levels are returned as strings, which is how R encodes categorical data (integer levels are written by Python models)
+        StochTree::CategoryDictionary& dictionary = encoder.GetDictionary(j);
+        cpp11::writable::strings levels(dictionary.NumLevels());
+        for (int k = 0; k < dictionary.NumLevels(); k++) {
+            levels[k] = dictionary.IsStringFeature() ? dictionary.StringLevels()[k] : std::to_string(dictionary.IntegerLevels()[k]);
+        }
+        feature_levels[j] = levels;
+    }
+    cpp11::writable::list output;
+    output.push_back(feature_names);
+    output.push_back(feature_types);
+    output.push_back(feature_levels);
+    return output;
+}
+
 [[cpp11::register]]
 void json_save_cpp(cpp11::external_pointer<nlohmann::json> json_ptr, std::string filename) {
     std::ofstream output_file(filename);
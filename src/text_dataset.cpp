@@ -0,0 +1,371 @@
+/*! Copyright (c) 2024 by stochtree authors */
+#include <stochtree/text_dataset.h>
+#include <stochtree/common.h>
+#include <stochtree/io.h>
+#include <stochtree/log.h>
+#include <stochtree/parallel.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace StochTree {
+
+namespace {
+
+/*! \brief Number of lines of a chunk parsed by each parallel task */
+constexpr int64_t kTextDatasetLinesPerBlock = 1024;
+
+/*! \brief Destination of the values of a column of the file */
+struct ColumnTarget {
+  enum Kind {kSkip, kCovariate, kBasis, kOutcome, kWeight};
+  Kind kind{kSkip};
+  int index{0};
+};
+
+/*! \brief Label of an unordered categorical covariate, which is coded once the chunk has been parsed */
+struct PendingLabel {
+  data_size_t row;
+  int covariate;
+  const char* begin;
+  const char* end;
+};
+
+/*! \brief First malformed line of a block of lines, reported on the calling thread once the block has been parsed */
+struct LineError {
+  int64_t line{-1};
+  int num_fields{0};
+  int column{-1};
+  std::string field;
+};
+
+/*! \brief Strip surrounding spaces from the field `[begin, end)` */
+inline void TrimField(const char*& begin, const char*& end) {
+  while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+}
+
+/*! \brief Whether the (trimmed) field `[begin, end)` is a missing value */
+inline bool IsMissingField(const char* begin, const char* end) {
+  return begin == end || (end - begin == 2 && begin[0] == 'N' && begin[1] == 'A');
+}
+
+/*!
+ * \brief Parse the (trimmed) field `[begin, end)` as a number with `fast_double_parser`, falling back to `strtod` for
+ *        values such as `inf` or `nan`. The field must be followed by a character that ends a number (a delimiter or newline).
+ * \return Whether the whole field is a number
+ */
+inline bool ParseNumberField(const char* begin, const char* end, double* out) {
+  const char* parsed_end = fast_double_parser::parse_number(begin, out);
+  if (parsed_end == end) return true;
+  char* strtod_end;
+  *out = std::strtod(begin, &strtod_end);
+  return strtod_end == end;
+}
+
+/*! \brief Split the line `[begin, end)` on `delimiter` into `fields`, as (begin, end) pairs of trimmed fields */
+inline void SplitLine(const char* begin, const char* end, char delimiter, std::vector<std::pair<const char*, const char*>>& fields) {
+  fields.clear();
+  const char* field_begin = begin;
+  while (true) {
+    const char* field_end = static_cast<const char*>(std::memchr(field_begin, delimiter, end - field_begin));
+    if (field_end == nullptr) field_end = end;
+    const char* trimmed_begin = field_begin;
+    const char* trimmed_end = field_end;
+    TrimField(trimmed_begin, trimmed_end);
+    fields.emplace_back(trimmed_begin, trimmed_end);
+    if (field_end == end) break;
+    field_begin = field_end + 1;
+  }
+}
+
+/*! \brief Find the (non-empty) lines of `[data, data + size)`, which ends with a newline, stripping carriage returns */
+void FindLines(char const* data, std::size_t size, std::vector<std::pair<const char*, const char*>>& lines) {
+  lines.clear();
+  const char* pos = data;
+  const char* data_end = data + size;
+  while (pos < data_end) {
+    const char* line_end = static_cast<const char*>(std::memchr(pos, '\n', data_end - pos));
+    const char* next = line_end + 1;
+    if (line_end > pos && line_end[-1] == '\r') --line_end;
+    if (line_end > pos) lines.emplace_back(pos, line_end);
+    pos = next;
+  }
+}
+
+} // namespace
+
+void TextDatasetLoader::Load(std::string const& filename, ForestDataset& dataset) {
+  auto reader = VirtualFileReader::Make(filename);
+  if (!reader->Init()) {
+    Log::Fatal("Could not open %s for reading", filename.c_str());
+  }
+  CHECK_GT(config_.chunk_bytes, 0);
+  feature_types_.clear();
+  outcome_.clear();
+  covariate_names_.clear();
+  category_labels_.clear();
+
+  // Row-major buffers for the parsed values, which the dataset borrows and retains at the end
+  auto double_covariates = std::make_shared<std::vector<double>>();
+  auto float_covariates = std::make_shared<std::vector<float>>();
+  auto basis = std::make_shared<std::vector<double>>();
+  std::vector<double> weights;
+
+  std::vector<ColumnTarget> targets;
+  std::vector<std::unordered_map<std::string, int>> category_codes;
+  int num_columns = 0;
+  int num_covariates = 0;
+  int num_basis = static_cast<int>(config_.basis_columns.size());
+  char delimiter = config_.delimiter;
+  data_size_t num_rows = 0;
+  int64_t num_lines_read = 0;
+
+  // Resolve the columns of the file from its first line
+  auto initialize_columns = [&](const char* line_begin, const char* line_end) {
+    if (delimiter == '\0') {
+      delimiter = (std::memchr(line_begin, '\t', line_end - line_begin) != nullptr) ? '\t' : ',';
+    }
+    std::vector<std::pair<const char*, const char*>> fields;
+    SplitLine(line_begin, line_end, delimiter, fields);
+    num_columns = static_cast<int>(fields.size());
+    targets.assign(num_columns, ColumnTarget());
+    auto assign_target = [&](int column, ColumnTarget::Kind kind, int index) {
+      if (column < 0 || column >= num_columns) {
+        Log::Fatal("Column %d is out of range for %s, which has %d columns", column, filename.c_str(), num_columns);
+      }
+      if (targets[column].kind != ColumnTarget::kSkip) {
+        Log::Fatal("Column %d of %s is assigned to more than one role", column, filename.c_str());
+      }
+      targets[column].kind = kind;
+      targets[column].index = index;
+    };
+    if (config_.outcome_column >= 0) assign_target(config_.outcome_column, ColumnTarget::kOutcome, 0);
+    if (config_.weight_column >= 0) assign_target(config_.weight_column, ColumnTarget::kWeight, 0);
+    for (int k = 0; k < num_basis; k++) assign_target(config_.basis_columns[k], ColumnTarget::kBasis, k);
+    std::vector<int> covariate_columns = config_.covariate_columns;
+    if (covariate_columns.empty()) {
+      for (int j = 0; j < num_columns; j++) {
+        if (targets[j].kind == ColumnTarget::kSkip) covariate_columns.push_back(j);
+      }
+    }
+    num_covariates = static_cast<int>(covariate_columns.size());
+    for (int k = 0; k < num_covariates; k++) assign_target(covariate_columns[k], ColumnTarget::kCovariate, k);
+    if (config_.header) {
+      for (int k = 0; k < num_covariates; k++) {
+        covariate_names_.emplace_back(fields[covariate_columns[k]].first, fields[covariate_columns[k]].second);
+      }
+    }
+    if (!config_.feature_types.empty() && static_cast<int>(config_.feature_types.size()) != num_covariates) {
+      Log::Fatal("%d feature types were provided for %d covariates", static_cast<int>(config_.feature_types.size()), num_covariates);
+    }
+    category_codes.resize(num_covariates);
+    category_labels_.resize(num_covariates);
+  };
+
+  // Infer the feature types from the first chunk, flagging covariates with any value that is neither missing nor a number
+  auto infer_feature_types = [&](std::vector<std::pair<const char*, const char*>> const& lines) {
+    std::vector<char> is_categorical(num_covariates, 0);
+    std::mutex flag_mutex;
+    ParallelFor(0, lines.size(), kTextDatasetLinesPerBlock, config_.num_threads, [&](int64_t block_begin, int64_t block_end) {
+      std::vector<char> block_is_categorical(num_covariates, 0);
+      std::vector<std::pair<const char*, const char*>> fields;
+      double value;
+      for (int64_t i = block_begin; i < block_end; i++) {
+        SplitLine(lines[i].first, lines[i].second, delimiter, fields);
+        for (int j = 0; j < num_columns && j < static_cast<int>(fields.size()); j++) {
+          if (targets[j].kind != ColumnTarget::kCovariate || block_is_categorical[targets[j].index]) continue;
+          if (!IsMissingField(fields[j].first, fields[j].second) && !ParseNumberField(fields[j].first, fields[j].second, &value)) {
+            block_is_categorical[targets[j].index] = 1;
+          }
+        }
+      }
+      std::lock_guard<std::mutex> lock(flag_mutex);
+      for (int k = 0; k < num_covariates; k++) is_categorical[k] |= block_is_categorical[k];
+    });
+    feature_types_.resize(num_covariates);
+    for (int k = 0; k < num_covariates; k++) {
+      feature_types_[k] = is_categorical[k] ? FeatureType::kUnorderedCategorical : FeatureType::kNumeric;
+    }
+  };
+
+  // Reserve the output buffers for an estimate of the number of rows in the file, from its size and the average length
+  // of the lines of the first chunk, so that appending the rows of later chunks does not usually reallocate them
+  auto reserve_rows = [&](auto& covariates, std::size_t chunk_size, std::size_t num_chunk_lines) {
+    std::size_t file_size = reader->Size();
+    if (file_size == 0 || chunk_size == 0 || num_chunk_lines == 0) return;
+    double estimate = 1.05 * static_cast<double>(file_size) * num_chunk_lines / chunk_size;
+    std::size_t num_rows_estimate = static_cast<std::size_t>(std::min(estimate, static_cast<double>(std::numeric_limits<data_size_t>::max())));
+    covariates.reserve(num_rows_estimate * num_covariates);
+    basis->reserve(num_rows_estimate * num_basis);
+    if (config_.outcome_column >= 0) outcome_.reserve(num_rows_estimate);
+    if (config_.weight_column >= 0) weights.reserve(num_rows_estimate);
+  };
+
+  // Parse the complete lines of a chunk into the output buffers
+  auto parse_lines = [&](auto& covariates, std::vector<std::pair<const char*, const char*>> const& lines) {
+    int64_t num_new_rows = lines.size();
+    if (num_rows + num_new_rows > std::numeric_limits<data_size_t>::max()) {
+      Log::Fatal("%s has too many rows", filename.c_str());
+    }
+    std::size_t new_num_rows = static_cast<std::size_t>(num_rows) + num_new_rows;
+    covariates.resize(new_num_rows * num_covariates);
+    basis->resize(new_num_rows * num_basis);
+    if (config_.outcome_column >= 0) outcome_.resize(new_num_rows);
+    if (config_.weight_column >= 0) weights.resize(new_num_rows);
+    int64_t num_blocks = (num_new_rows + kTextDatasetLinesPerBlock - 1) / kTextDatasetLinesPerBlock;
+    std::vector<std::vector<PendingLabel>> pending_labels(num_blocks);
+    // Workers record malformed lines rather than raising errors, as Log::Fatal may call into the R API
+    std::vector<LineError> block_errors(num_blocks);
+    ParallelFor(0, num_new_rows, kTextDatasetLinesPerBlock, config_.num_threads, [&](int64_t block_begin, int64_t block_end) {
+      std::vector<PendingLabel>& block_labels = pending_labels[block_begin / kTextDatasetLinesPerBlock];
+      LineError& block_error = block_errors[block_begin / kTextDatasetLinesPerBlock];
+      std::vector<std::pair<const char*, const char*>> fields;
+      double value;
+      for (int64_t i = block_begin; i < block_end; i++) {
+        std::size_t row = static_cast<std::size_t>(num_rows) + i;
+        SplitLine(lines[i].first, lines[i].second, delimiter, fields);
+        if (static_cast<int>(fields.size()) != num_columns) {
+          block_error.line = i;
+          block_error.num_fields = static_cast<int>(fields.size());
+          return;
+        }
+        for (int j = 0; j < num_columns; j++) {
+          ColumnTarget const& target = targets[j];
+          if (target.kind == ColumnTarget::kSkip) continue;
+          const char* field_begin = fields[j].first;
+          const char* field_end = fields[j].second;
+          if (IsMissingField(field_begin, field_end)) {
+            value = std::numeric_limits<double>::quiet_NaN();
+          } else if (target.kind == ColumnTarget::kCovariate && feature_types_[target.index] == FeatureType::kUnorderedCategorical) {
+            block_labels.push_back({static_cast<data_size_t>(row), target.index, field_begin, field_end});
+            continue;
+          } else if (!ParseNumberField(field_begin, field_end, &value)) {
+            block_error.line = i;
+            block_error.column = j;
+            block_error.field.assign(field_begin, field_end);
+            return;
+          }
+          switch (target.kind) {
+            case ColumnTarget::kCovariate:
+              covariates[row * num_covariates + target.index] = value;
+              break;
+            case ColumnTarget::kBasis:
+              (*basis)[row * num_basis + target.index] = value;
+              break;
+            case ColumnTarget::kOutcome:
+              outcome_[row] = value;
+              break;
+            case ColumnTarget::kWeight:
+              weights[row] = value;
+              break;
+            default:
+              break;
+          }
+        }
+      }
+    });
+    for (LineError const& error : block_errors) {
+      if (error.line < 0) continue;
+      long long data_row = static_cast<long long>(num_lines_read + error.line + 1);
+      if (error.column < 0) {
+        Log::Fatal("Data row %lld of %s has %d fields, expected %d", data_row, filename.c_str(), error.num_fields, num_columns);
+      } else {
+        Log::Fatal("Could not parse \"%s\" in data row %lld, column %d of %s as a number", error.field.c_str(), data_row,
+                   error.column, filename.c_str());
+      }
+    }
+
+    // Code categorical labels serially in file order, so that codes do not depend on the number of threads
+    for (auto& block_labels : pending_labels) {
+      for (PendingLabel const& label : block_labels) {
+        std::string label_string(label.begin, label.end);
+        auto inserted = category_codes[label.covariate].emplace(label_string, static_cast<int>(category_labels_[label.covariate].size()));
+        if (inserted.second) category_labels_[label.covariate].push_back(label_string);
+        covariates[static_cast<std::size_t>(label.row) * num_covariates + label.covariate] = inserted.first->second;
+      }
+    }
+    num_rows = static_cast<data_size_t>(new_num_rows);
+    num_lines_read += num_new_rows;
+  };
+
+  // Read the file one chunk at a time, carrying the partial line at the end of a chunk over to the next one
+  auto load = [&](auto& covariates) {
+    std::vector<char> buffer;
+    std::vector<std::pair<const char*, const char*>> lines;
+    std::size_t carry = 0;
+    bool first_chunk = true;
+    bool end_of_file = false;
+    while (!end_of_file) {
+      buffer.resize(carry + config_.chunk_bytes + 1);
+      std::size_t bytes_read = reader->Read(buffer.data() + carry, config_.chunk_bytes);
+      end_of_file = bytes_read < config_.chunk_bytes;
+      std::size_t size = carry + bytes_read;
+      std::size_t parse_size;
+      if (end_of_file) {
+        if (size > 0 && buffer[size - 1] != '\n') buffer[size++] = '\n';
+        parse_size = size;
+      } else {
+        const char* last_newline = nullptr;
+        for (std::size_t i = size; i > 0; i--) {
+          if (buffer[i - 1] == '\n') {
+            last_newline = buffer.data() + i - 1;
+            break;
+          }
+        }
+        if (last_newline == nullptr) {
+          // A single line is longer than the chunk, so keep reading it
+          carry = size;
+          continue;
+        }
+        parse_size = last_newline - buffer.data() + 1;
+      }
+
+      FindLines(buffer.data(), parse_size, lines);
+      std::size_t first_line = 0;
+      if (first_chunk && !lines.empty()) {
+        initialize_columns(lines[0].first, lines[0].second);
+        if (config_.header) first_line = 1;
+        if (config_.feature_types.empty()) {
+          infer_feature_types(std::vector<std::pair<const char*, const char*>>(lines.begin() + first_line, lines.end()));
+        } else {
+          feature_types_ = config_.feature_types;
+        }
+        if (!end_of_file) reserve_rows(covariates, parse_size, lines.size());
+        first_chunk = false;
+      }
+      if (first_line > 0) lines.erase(lines.begin(), lines.begin() + first_line);
+      parse_lines(covariates, lines);
+
+      carry = size - parse_size;
+      std::memmove(buffer.data(), buffer.data() + parse_size, carry);
+    }
+    if (first_chunk) {
+      Log::Fatal("%s is empty", filename.c_str());
+    }
+  };
+
+  if (config_.single_precision) {
+    load(*float_covariates);
+    dataset.AddCovariates(float_covariates->data(), num_rows, num_covariates, true, true);
+    dataset.RetainStorage(float_covariates);
+  } else {
+    load(*double_covariates);
+    dataset.AddCovariates(double_covariates->data(), num_rows, num_covariates, true, true);
+    dataset.RetainStorage(double_covariates);
+  }
+  if (num_basis > 0) {
+    dataset.AddBasis(basis->data(), num_rows, num_basis, true, true);
+    dataset.RetainStorage(basis);
+  }
+  if (config_.weight_column >= 0) {
+    dataset.AddVarianceWeights(weights.data(), num_rows);
+  }
+}
+
+} // namespace StochTree
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <type_traits>
 #include <sstream>
 
@@ -38,6 +39,69 @@ std::int32_t Tree::NumSplitNodes() const {
   return splits;
 }
 
+namespace {
+
+inline void HashCombine(std::uint64_t& seed, std::uint64_t value) {
+  seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+inline std::uint64_t ThresholdBits(double threshold) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &threshold, sizeof(bits));
+  return bits;
+}
+
+} // namespace
+
+std::uint64_t Tree::StructureHash() const {
+  std::uint64_t seed = 0;
+  auto const& self = *this;
+  this->WalkTree([&seed, &self](std::int32_t nidx) {
+                   HashCombine(seed, static_cast<std::uint64_t>(nidx));
+                   HashCombine(seed, static_cast<std::uint64_t>(self.node_type_[nidx]));
+                   if (!self.IsLeaf(nidx)) {
+                     HashCombine(seed, static_cast<std::uint64_t>(self.split_index_[nidx]));
+                     HashCombine(seed, static_cast<std::uint64_t>(self.cleft_[nidx]));
+                     HashCombine(seed, static_cast<std::uint64_t>(self.cright_[nidx]));
+                     if (self.node_type_[nidx] == TreeNodeType::kCategoricalSplitNode) {
+                       for (std::uint64_t i = self.category_list_begin_[nidx]; i < self.category_list_end_[nidx]; i++) {
+                         HashCombine(seed, self.category_list_[i]);
+                       }
+                     } else {
+                       HashCombine(seed, ThresholdBits(self.threshold_[nidx]));
+                     }
+                   }
+                   return true;
+                 });
+  return seed;
+}
+
+bool Tree::HasSameStructure(Tree const& other) const {
+  bool same = true;
+  auto const& self = *this;
+  this->WalkTree([&same, &self, &other](std::int32_t nidx) {
+                   if (nidx >= other.NumNodes() || self.node_type_[nidx] != other.node_type_[nidx]) {
+                     same = false;
+                   } else if (!self.IsLeaf(nidx)) {
+                     if (self.split_index_[nidx] != other.split_index_[nidx] || 
+                         self.cleft_[nidx] != other.cleft_[nidx] || self.cright_[nidx] != other.cright_[nidx]) {
+                       same = false;
+                     } else if (self.node_type_[nidx] == TreeNodeType::kCategoricalSplitNode) {
+                       same = std::equal(self.category_list_.begin() + self.category_list_begin_[nidx], 
+                                         self.category_list_.begin() + self.category_list_end_[nidx], 
+                                         other.category_list_.begin() + other.category_list_begin_[nidx], 
+                                         other.category_list_.begin() + other.category_list_end_[nidx]);
+                     } else {
+                       same = ThresholdBits(self.threshold_[nidx]) == ThresholdBits(other.threshold_[nidx]);
+                     }
+                   } else if (!other.IsLeaf(nidx)) {
+                     same = false;
+                   }
+                   return same;
+                 });
+  return same;
+}
+
 void Tree::InplacePredictFromNodes(std::vector<double> result, std::vector<std::int32_t> node_indices) {
   if (result.size() != node_indices.size()) {
     Log::Fatal("Indices and result vector are different sizes");
@@ -64,18 +128,21 @@ std::vector<double> Tree::PredictFromNodes(std::vector<std::int32_t> node_indice
   return result;
 }
 
-double Tree::PredictFromNode(std::int32_t node_id, Eigen::MatrixXd& basis, int row_idx) {
+template <typename Scalar>
+double Tree::PredictFromNode(std::int32_t node_id, DataMatrixMapT<Scalar>& basis, int row_idx) {
   if (!this->IsLeaf(node_id)) {
     Log::Fatal("Node %d is not a leaf node", node_id);
   }
+  double const* leaf_values = LeafValues(node_id);
   double pred = 0;
   for (int32_t k = 0; k < output_dimension_; k++) {
-    pred += LeafValue(node_id, k) * basis(row_idx, k);
+    pred += leaf_values[k] * basis(row_idx, k);
   }
   return pred;
 }
 
-std::vector<double> Tree::PredictFromNodes(std::vector<std::int32_t> node_indices, Eigen::MatrixXd& basis) {
+template <typename Scalar>
+std::vector<double> Tree::PredictFromNodes(std::vector<std::int32_t> node_indices, DataMatrixMapT<Scalar>& basis) {
   data_size_t n = node_indices.size();
   std::vector<double> result(n);
   for (data_size_t i = 0; i < n; i++) {
@@ -107,6 +174,9 @@ void Tree::CloneFromTree(Tree* tree) {
   category_list_ = tree->category_list_;
   category_list_begin_ = tree->category_list_begin_;
   category_list_end_ = tree->category_list_end_;
+  category_set_ = tree->category_set_;
+  category_set_begin_ = tree->category_set_begin_;
+  category_set_end_ = tree->category_set_end_;
 
   has_categorical_split_ = tree->has_categorical_split_;
   output_dimension_ = tree->output_dimension_;
@@ -138,6 +208,8 @@ std::int32_t Tree::AllocNode() {
   leaf_vector_end_.push_back(leaf_vector_.size());
   category_list_begin_.push_back(category_list_.size());
   category_list_end_.push_back(category_list_.size());
+  category_set_begin_.push_back(category_set_.size());
+  category_set_end_.push_back(category_set_.size());
 
   return nd;
 }
@@ -306,6 +378,9 @@ void Tree::Reset() {
   category_list_.clear();
   category_list_begin_.clear();
   category_list_end_.clear();
+  category_set_.clear();
+  category_set_begin_.clear();
+  category_set_end_.clear();
 
   leaves_.clear();
   leaf_parents_.clear();
@@ -339,6 +414,9 @@ void Tree::Init(std::int32_t output_dimension) {
   category_list_.clear();
   category_list_begin_.clear();
   category_list_end_.clear();
+  category_set_.clear();
+  category_set_begin_.clear();
+  category_set_end_.clear();
 
   leaves_.clear();
   leaf_parents_.clear();
@@ -374,6 +452,9 @@ void Tree::SetCategoricalSplit(std::int32_t nid, std::int32_t split_index, std::
   category_list_.insert(category_list_.end(), category_list.begin(), category_list.end());
   category_list_begin_.at(nid) = begin;
   category_list_end_.at(nid) = end;
+  category_set_begin_.at(nid) = category_set_.size();
+  EncodeCategorySet(category_list, category_set_);
+  category_set_end_.at(nid) = category_set_.size();
 
   split_index_.at(nid) = split_index;
   node_type_.at(nid) = TreeNodeType::kCategoricalSplitNode;
@@ -421,10 +502,11 @@ void Tree::SetLeafVector(std::int32_t nid, std::vector<double> const& node_leaf_
 }
 
 void Tree::PredictLeafIndexInplace(ForestDataset* dataset, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf) {
-  PredictLeafIndexInplace(dataset->GetCovariates(), output, offset, max_leaf);
+  dataset->VisitPredictionCovariates([&](auto& covariates) {PredictLeafIndexInplace(covariates, output, offset, max_leaf);});
 }
 
-void Tree::PredictLeafIndexInplace(Eigen::MatrixXd& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf) {
+template <typename CovariateMatrix>
+void Tree::PredictLeafIndexInplace(CovariateMatrix& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf) {
   int n = covariates.rows();
   CHECK_GE(output.size(), offset + n);
   std::map<int32_t,int32_t> renumber_map;
@@ -613,6 +695,20 @@ void JsonToSplitCategoryVector(const json& tree_json, Tree* tree) {
   }
 }
 
+void EncodeCategorySplits(Tree* tree) {
+  tree->category_set_.clear();
+  tree->category_set_begin_.assign(tree->NumNodes(), 0);
+  tree->category_set_end_.assign(tree->NumNodes(), 0);
+  for (int i = 0; i < tree->NumNodes(); i++) {
+    tree->category_set_begin_[i] = tree->category_set_.size();
+    if (tree->node_type_[i] == TreeNodeType::kCategoricalSplitNode) {
+      std::uint32_t const* category_data = tree->category_list_.data();
+      EncodeCategorySet(category_data + tree->category_list_begin_[i], category_data + tree->category_list_end_[i], tree->category_set_);
+    }
+    tree->category_set_end_[i] = tree->category_set_.size();
+  }
+}
+
 void JsonToNodeLists(const json& tree_json, Tree* tree) {
   tree->internal_nodes_.clear();
   int num_internal_nodes = tree_json.at("internal_nodes").size();
@@ -652,6 +748,18 @@ void Tree::from_json(const json& tree_json) {
   JsonToMultivariateLeafVector(tree_json, this);
   JsonToSplitCategoryVector(tree_json, this);
   JsonToNodeLists(tree_json, this);
-}
+  // Category sets are rebuilt from the category lists, so the JSON format is unchanged
+  EncodeCategorySplits(this);
+}
+
+// Covariates and basis may be stored in double or single precision, and covariates may also be sparse or binned (see ForestDataset)
+template double Tree::PredictFromNode<double>(std::int32_t node_id, DataMatrixMapT<double>& basis, int row_idx);
+template double Tree::PredictFromNode<float>(std::int32_t node_id, DataMatrixMapT<float>& basis, int row_idx);
+template std::vector<double> Tree::PredictFromNodes<double>(std::vector<std::int32_t> node_indices, DataMatrixMapT<double>& basis);
+template std::vector<double> Tree::PredictFromNodes<float>(std::vector<std::int32_t> node_indices, DataMatrixMapT<float>& basis);
+template void Tree::PredictLeafIndexInplace(DataMatrixMapT<double>& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf);
+template void Tree::PredictLeafIndexInplace(DataMatrixMapT<float>& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf);
+template void Tree::PredictLeafIndexInplace(SparseColumnMatrix& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf);
+template void Tree::PredictLeafIndexInplace(BinnedColumnMatrix& covariates, std::vector<int32_t>& output, int32_t offset, int32_t max_leaf);
 
 } // namespace StochTree
@@ -27,7 +27,8 @@ class BARTModel:
                cutpoint_grid_size = 100, sigma_leaf: float = None, alpha: float = 0.95, beta: float = 2.0, min_samples_leaf: int = 5, 
                nu: float = 3, lamb: float = None, a_leaf: float = 3, b_leaf: float = None, q: float = 0.9, sigma2: float = None, 
                num_trees: int = 200, num_gfr: int = 5, num_burnin: int = 0, num_mcmc: int = 100, sample_sigma_global: bool = True, 
-               sample_sigma_leaf: bool = True, random_seed: int = -1, keep_burnin: bool = False, keep_gfr: bool = False) -> None:
+               sample_sigma_leaf: bool = True, random_seed: int = -1, keep_burnin: bool = False, keep_gfr: bool = False, 
+               num_threads: int = 1) -> None:
         """Runs a BART sampler on provided training set. Predictions will be cached for the training set and (if provided) the test set. 
         Does not require a leaf regression basis. 
 
@@ -86,6 +87,9 @@ class BARTModel:
             Whether or not "burnin" samples should be included in predictions. Defaults to ``False``. Ignored if ``num_mcmc == 0``.
         keep_gfr : :obj:`bool`, optional
             Whether or not "warm-start" / grow-from-root samples should be included in predictions. Defaults to ``False``. Ignored if ``num_mcmc == 0``.
+        num_threads : :obj:`int`, optional
+            Number of threads used to encode categorical covariates, to partition the presorted covariates after each grow-from-root split 
+            and to predict from the sampled forests (values <= 0 use all available cores). Samples do not depend on the number of threads. Defaults to ``1``.
         
         Returns
         -------
@@ -144,7 +148,7 @@ class BARTModel:
                 raise ValueError("X_test and basis_test must have the same number of rows")
         
         # Covariate preprocessing
-        self._covariate_transformer = CovariateTransformer()
+        self._covariate_transformer = CovariateTransformer(num_threads)
         self._covariate_transformer.fit(X_train)
         X_train_processed = self._covariate_transformer.transform(X_train)
         if X_test is not None:
@@ -218,6 +222,9 @@ class BARTModel:
         
         # Sampling data structures
         forest_sampler = ForestSampler(forest_dataset_train, feature_types, num_trees, self.n_train, alpha, beta, min_samples_leaf)
+        forest_sampler.set_num_threads(num_threads)
+        if self.has_test:
+            forest_sampler.add_test_set(forest_dataset_test)
 
         # Determine the leaf model
         if not self.has_basis:
@@ -305,13 +312,13 @@ class BARTModel:
                 raise RuntimeError("There are no samples to retain!")
         
         # Store predictions
-        yhat_train_raw = self.forest_container.forest_container_cpp.Predict(forest_dataset_train.dataset_cpp)[:,self.keep_indices]
+        yhat_train_raw = self.forest_container.forest_container_cpp.Predict(forest_dataset_train.dataset_cpp, num_threads)[:,self.keep_indices]
         self.y_hat_train = yhat_train_raw*self.y_std + self.y_bar
         if self.has_test:
-            yhat_test_raw = self.forest_container.forest_container_cpp.Predict(forest_dataset_test.dataset_cpp)[:,self.keep_indices]
+            yhat_test_raw = forest_sampler.test_set_predictions()[:,self.keep_indices]
             self.y_hat_test = yhat_test_raw*self.y_std + self.y_bar
     
-    def predict(self, covariates: np.array, basis: np.array = None) -> np.array:
+    def predict(self, covariates: np.array, basis: np.array = None, num_threads: int = 1) -> np.array:
         """Predict outcome from every retained forest of a BART sampler.
 
         Parameters
@@ -320,6 +327,8 @@ class BARTModel:
             Test set covariates.
         basis_train : :obj:`np.array`, optional
             Optional test set basis vector, must be provided if the model was trained with a leaf regression basis.
+        num_threads : :obj:`int`, optional
+            Number of threads used for forest prediction (values <= 0 use all available cores). Defaults to ``1``.
         
         Returns
         -------
@@ -349,5 +358,52 @@ class BARTModel:
         pred_dataset.add_covariates(covariates)
         if basis is not None:
             pred_dataset.add_basis(basis)
-        pred_raw = self.forest_container.forest_container_cpp.Predict(pred_dataset.dataset_cpp)
+        pred_raw = self.forest_container.forest_container_cpp.Predict(pred_dataset.dataset_cpp, num_threads)
         return pred_raw[:,self.keep_indices]*self.y_std + self.y_bar
+    
+    def predict_summary(self, covariates: np.array, basis: np.array = None, quantiles: np.array = np.array([0.025, 0.975]), num_threads: int = 1) -> tuple:
+        """Summarize the posterior distribution of predictions from every retained forest of a BART sampler, 
+        without storing a matrix of predictions for every retained forest.
+
+        Parameters
+        ----------
+        covariates : np.array
+            Test set covariates.
+        basis : :obj:`np.array`, optional
+            Optional test set basis vector, must be provided if the model was trained with a leaf regression basis.
+        quantiles : :obj:`np.array`, optional
+            Probabilities of the posterior quantiles to estimate (via the streaming P-squared algorithm). Defaults to ``[0.025, 0.975]``.
+        num_threads : :obj:`int`, optional
+            Number of threads used for prediction (values <= 0 use all available cores). Defaults to ``1``.
+        
+        Returns
+        -------
+        tuple
+            Posterior mean and variance of each prediction (arrays with as many elements as rows in ``covariates``) 
+            and an array of estimated posterior quantiles with as many rows as in ``covariates`` and one column per element of ``quantiles``.
+        """
+        if not self.is_sampled():
+            msg = (
+                "This BARTModel instance is not fitted yet. Call 'fit' with "
+                "appropriate arguments before using this model."
+            )
+            raise NotSampledError(msg)
+        
+        # Convert everything to standard shape (2-dimensional)
+        if covariates.ndim == 1:
+            covariates = np.expand_dims(covariates, 1)
+        if basis is not None:
+            if basis.ndim == 1:
+                basis = np.expand_dims(basis, 1)
+        
+        # Data checks
+        if basis is not None:
+            if basis.shape[0] != covariates.shape[0]:
+                raise ValueError("covariates and basis must have the same number of rows")
+
+        pred_dataset = Dataset()
+        pred_dataset.add_covariates(covariates)
+        if basis is not None:
+            pred_dataset.add_basis(basis)
+        pred_mean, pred_variance, pred_quantiles = self.forest_container.predict_summary(pred_dataset, self.keep_indices, quantiles, num_threads)
+        return pred_mean*self.y_std + self.y_bar, pred_variance*self.y_std*self.y_std, pred_quantiles*self.y_std + self.y_bar
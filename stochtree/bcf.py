@@ -40,7 +40,7 @@ class BCFModel:
                num_trees_mu: int = 200, num_trees_tau: int = 50, num_gfr: int = 5, num_burnin: int = 0, num_mcmc: int = 100, 
                sample_sigma_global: bool = True, sample_sigma_leaf_mu: bool = True, sample_sigma_leaf_tau: bool = False, 
                propensity_covariate: str = "mu", adaptive_coding: bool = True, b_0: float = -0.5, b_1: float = 0.5, 
-               random_seed: int = -1, keep_burnin: bool = False, keep_gfr: bool = False) -> None:
+               random_seed: int = -1, keep_burnin: bool = False, keep_gfr: bool = False, num_threads: int = 1) -> None:
         """Runs a BCF sampler on provided training set. Outcome predictions and estimates of the prognostic and treatment effect functions 
         will be cached for the training set and (if provided) the test set.
 
@@ -148,6 +148,9 @@ class BCFModel:
             Whether or not "burnin" samples should be included in predictions. Defaults to ``False``. Ignored if ``num_mcmc == 0``.
         keep_gfr : :obj:`bool`, optional
             Whether or not "warm-start" / grow-from-root samples should be included in predictions. Defaults to ``False``. Ignored if ``num_mcmc == 0``.
+        num_threads : :obj:`int`, optional
+            Number of threads used to encode categorical covariates, to partition the presorted covariates after each grow-from-root split 
+            and to predict from the sampled forests (values <= 0 use all available cores). Samples do not depend on the number of threads. Defaults to ``1``.
         
         Returns
         -------
@@ -454,7 +457,7 @@ class BCFModel:
             variable_subset_tau = [i for i in range(X_train.shape[1])]
         
         # Covariate preprocessing
-        self._covariate_transformer = CovariateTransformer()
+        self._covariate_transformer = CovariateTransformer(num_threads)
         self._covariate_transformer.fit(X_train)
         X_train_processed = self._covariate_transformer.transform(X_train)
         if X_test is not None:
@@ -489,11 +492,11 @@ class BCFModel:
             self.bart_propensity_model = BARTModel()
             if self.has_test:
                 pi_test = np.mean(self.bart_propensity_model.y_hat_test, axis = 1, keepdims = True)
-                self.bart_propensity_model.sample(X_train=X_train_processed, y_train=Z_train, X_test=X_test_processed, num_gfr=10, num_mcmc=10)
+                self.bart_propensity_model.sample(X_train=X_train_processed, y_train=Z_train, X_test=X_test_processed, num_gfr=10, num_mcmc=10, num_threads=num_threads)
                 pi_train = np.mean(self.bart_propensity_model.y_hat_train, axis = 1, keepdims = True)
                 pi_test = np.mean(self.bart_propensity_model.y_hat_test, axis = 1, keepdims = True)
             else:
-                self.bart_propensity_model.sample(X_train=X_train_processed, y_train=Z_train, num_gfr=10, num_mcmc=10)
+                self.bart_propensity_model.sample(X_train=X_train_processed, y_train=Z_train, num_gfr=10, num_mcmc=10, num_threads=num_threads)
                 pi_train = np.mean(self.bart_propensity_model.y_hat_train, axis = 1, keepdims = True)
             self.internal_propensity_model = True
         else:
@@ -616,6 +619,8 @@ class BCFModel:
         # Sampling data structures
         forest_sampler_mu = ForestSampler(forest_dataset_train, feature_types, num_trees_mu, self.n_train, alpha_mu, beta_mu, min_samples_leaf_mu)
         forest_sampler_tau = ForestSampler(forest_dataset_train, feature_types, num_trees_tau, self.n_train, alpha_tau, beta_tau, min_samples_leaf_tau)
+        forest_sampler_mu.set_num_threads(num_threads)
+        forest_sampler_tau.set_num_threads(num_threads)
 
         # Container of forest samples
         self.forest_container_mu = ForestContainer(num_trees_mu, 1, True)
@@ -775,9 +780,9 @@ class BCFModel:
                 raise RuntimeError("There are no samples to retain!")
         
         # Store predictions
-        mu_raw = self.forest_container_mu.forest_container_cpp.Predict(forest_dataset_train.dataset_cpp)
+        mu_raw = self.forest_container_mu.forest_container_cpp.Predict(forest_dataset_train.dataset_cpp, num_threads)
         self.mu_hat_train = mu_raw[:,self.keep_indices]*self.y_std + self.y_bar
-        tau_raw_train = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_train.dataset_cpp)
+        tau_raw_train = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_train.dataset_cpp, num_threads)
         self.tau_hat_train = tau_raw_train[:,self.keep_indices]
         if self.adaptive_coding:
             adaptive_coding_weights = np.expand_dims(self.b1_samples[self.keep_indices] - self.b0_samples[self.keep_indices], axis=(0,2))
@@ -789,9 +794,9 @@ class BCFModel:
             treatment_term_train = Z_train*np.squeeze(self.tau_hat_train)
         self.y_hat_train = self.mu_hat_train + treatment_term_train
         if self.has_test:
-            mu_raw_test = self.forest_container_mu.forest_container_cpp.Predict(forest_dataset_test.dataset_cpp)
+            mu_raw_test = self.forest_container_mu.forest_container_cpp.Predict(forest_dataset_test.dataset_cpp, num_threads)
             self.mu_hat_test = mu_raw_test[:,self.keep_indices]*self.y_std + self.y_bar
-            tau_raw_test = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_test.dataset_cpp)
+            tau_raw_test = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_test.dataset_cpp, num_threads)
             self.tau_hat_test = tau_raw_test[:,self.keep_indices]
             if self.adaptive_coding:
                 adaptive_coding_weights_test = np.expand_dims(self.b1_samples[self.keep_indices] - self.b0_samples[self.keep_indices], axis=(0,2))
@@ -803,7 +808,7 @@ class BCFModel:
                 treatment_term_test = Z_test*np.squeeze(self.tau_hat_test)
             self.y_hat_test = self.mu_hat_test + treatment_term_test
     
-    def predict_tau(self, X: np.array, Z: np.array, propensity: np.array = None) -> np.array:
+    def predict_tau(self, X: np.array, Z: np.array, propensity: np.array = None, num_threads: int = 1) -> np.array:
         """Predict CATE function for every provided observation.
 
         Parameters
@@ -814,6 +819,8 @@ class BCFModel:
             Test set treatment indicators.
         propensity : :obj:`np.array`, optional
             Optional test set propensities. Must be provided if propensities were provided when the model was sampled.
+        num_threads : :obj:`int`, optional
+            Number of threads used for forest prediction (values <= 0 use all available cores). Defaults to ``1``.
         
         Returns
         -------
@@ -847,7 +854,7 @@ class BCFModel:
                 if not self.internal_propensity_model:
                     raise ValueError("Propensity scores not provided, but no propensity model was trained during sampling")
                 else:
-                    propensity = np.mean(self.bart_propensity_model.predict(X), axis=1, keepdims=True)
+                    propensity = np.mean(self.bart_propensity_model.predict(X, num_threads=num_threads), axis=1, keepdims=True)
         
         # Update covariates to include propensities if requested
         if self.propensity_covariate == "tau":
@@ -861,7 +868,7 @@ class BCFModel:
         forest_dataset_tau.add_basis(Z)
         
         # Estimate treatment effect
-        tau_raw = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_tau.dataset_cpp)
+        tau_raw = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_tau.dataset_cpp, num_threads)
         tau_raw = tau_raw*self.y_std
         if self.adaptive_coding:
             tau_raw = tau_raw*np.expand_dims(self.b1_samples - self.b0_samples, axis=(0,2))
@@ -870,7 +877,7 @@ class BCFModel:
         # Return result matrices as a tuple
         return tau_x
     
-    def predict(self, X: np.array, Z: np.array, propensity: np.array = None) -> np.array:
+    def predict(self, X: np.array, Z: np.array, propensity: np.array = None, num_threads: int = 1) -> np.array:
         """Predict outcome model components (CATE function and prognostic function) as well as overall outcome for every provided observation. 
         Predicted outcomes are computed as ``yhat = mu_x + Z*tau_x`` where mu_x is a sample of the prognostic function and tau_x is a sample of the treatment effect (CATE) function.
 
@@ -882,6 +889,8 @@ class BCFModel:
             Test set treatment indicators.
         propensity : :obj:`np.array`, optional
             Optional test set propensities. Must be provided if propensities were provided when the model was sampled.
+        num_threads : :obj:`int`, optional
+            Number of threads used for forest prediction (values <= 0 use all available cores). Defaults to ``1``.
         
         Returns
         -------
@@ -917,7 +926,7 @@ class BCFModel:
                 if not self.internal_propensity_model:
                     raise ValueError("Propensity scores not provided, but no propensity model was trained during sampling")
                 else:
-                    propensity = np.mean(self.bart_propensity_model.predict(X), axis=1, keepdims=True)
+                    propensity = np.mean(self.bart_propensity_model.predict(X, num_threads=num_threads), axis=1, keepdims=True)
         
         # Update covariates to include propensities if requested
         if self.propensity_covariate == "mu":
@@ -943,11 +952,11 @@ class BCFModel:
         forest_dataset_tau.add_basis(Z)
         
         # Estimate prognostic term
-        mu_raw = self.forest_container_mu.forest_container_cpp.Predict(forest_dataset_mu.dataset_cpp)
+        mu_raw = self.forest_container_mu.forest_container_cpp.Predict(forest_dataset_mu.dataset_cpp, num_threads)
         mu_x = mu_raw[:,self.keep_indices]*self.y_std + self.y_bar
         
         # Estimate treatment effect
-        tau_raw = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_tau.dataset_cpp)
+        tau_raw = self.forest_container_tau.forest_container_cpp.PredictRaw(forest_dataset_tau.dataset_cpp, num_threads)
         if self.adaptive_coding:
             tau_raw = tau_raw*np.expand_dims(self.b1_samples - self.b0_samples, axis=(0,2))
         tau_raw = tau_raw*self.y_std
@@ -4,28 +4,73 @@ Python classes wrapping C++ data objects
 import numpy as np
 from stochtree_cpp import ForestDatasetCpp, ResidualCpp
 
+# Array dtypes that the C++ dataset reads in place (with any strides) and converts in a single pass
+_CONVERTIBLE_DTYPES = (np.float64, np.float32, np.int32, np.int64, np.uint8, np.bool_)
+
 class Dataset:
     def __init__(self) -> None:
         # Initialize a ForestDatasetCpp object
         self.dataset_cpp = ForestDatasetCpp()
     
-    def add_covariates(self, covariates: np.array):
+    def add_covariates(self, covariates: np.array, borrow: bool = False):
         """
-        Add covariates to a dataset
+        Add covariates to a dataset. If ``borrow`` is True, the C++ dataset reads a 
+        (C-contiguous, float64) view of ``covariates`` in place rather than copying it, 
+        and this object keeps a reference to the array so its memory stays valid.
+        ``float32`` covariates are stored in single precision rather than converted to ``float64``, 
+        and ``scipy.sparse`` covariates are copied in compressed sparse column form without 
+        being densified (``borrow`` is ignored for sparse covariates). Unless ``borrow`` is True, 
+        ``float64``, ``float32``, ``int32``, ``int64``, ``uint8`` and ``bool`` arrays (including 
+        non-contiguous views) are converted directly into the C++ dataset without a temporary copy.
         """
+        if hasattr(covariates, "tocsc"):
+            # tocsc() returns the matrix itself if it is already CSC, so canonicalize a copy (sorted rows, 
+            # duplicate entries summed) rather than modifying the caller's matrix
+            covariates_csc = covariates.tocsc(copy=True)
+            covariates_csc.sum_duplicates()
+            if covariates_csc.nnz > np.iinfo(np.int32).max:
+                raise ValueError("Sparse covariates must have fewer than 2^31 nonzero entries")
+            n, p = covariates_csc.shape
+            self.dataset_cpp.AddSparseCovariates(
+                np.ascontiguousarray(covariates_csc.indptr, dtype=np.int32), 
+                np.ascontiguousarray(covariates_csc.indices, dtype=np.int32), 
+                np.ascontiguousarray(covariates_csc.data, dtype=np.float64), n, p
+            )
+            return
         covariates_ = np.expand_dims(covariates, 1) if np.ndim(covariates) == 1 else covariates
+        if not borrow and isinstance(covariates_, np.ndarray) and covariates_.dtype in _CONVERTIBLE_DTYPES:
+            self.dataset_cpp.AddCovariatesArray(covariates_, covariates_.dtype == np.float32)
+            return
         n, p = covariates_.shape
-        covariates_rowmajor = np.ascontiguousarray(covariates)
-        self.dataset_cpp.AddCovariates(covariates_rowmajor, n, p, True)
+        if covariates_.dtype == np.float32:
+            covariates_rowmajor = np.ascontiguousarray(covariates, dtype=np.float32)
+            add_covariates = self.dataset_cpp.AddCovariatesFloat32
+        else:
+            covariates_rowmajor = np.ascontiguousarray(covariates, dtype=np.float64)
+            add_covariates = self.dataset_cpp.AddCovariates
+        if borrow:
+            self._borrowed_covariates = covariates_rowmajor
+        add_covariates(covariates_rowmajor, n, p, True, borrow)
     
-    def add_basis(self, basis: np.array):
+    def add_basis(self, basis: np.array, borrow: bool = False):
         """
-        Add basis matrix to a dataset
+        Add basis matrix to a dataset, reading it in place if ``borrow`` is True and 
+        storing ``float32`` bases in single precision (see ``add_covariates``)
         """
         basis_ = np.expand_dims(basis, 1) if np.ndim(basis) == 1 else basis
+        if not borrow and isinstance(basis_, np.ndarray) and basis_.dtype in _CONVERTIBLE_DTYPES:
+            self.dataset_cpp.AddBasisArray(basis_, basis_.dtype == np.float32)
+            return
         n, p = basis_.shape
-        basis_rowmajor = np.ascontiguousarray(basis_)
-        self.dataset_cpp.AddBasis(basis_rowmajor, n, p, True)
+        if basis_.dtype == np.float32:
+            basis_rowmajor = np.ascontiguousarray(basis_, dtype=np.float32)
+            add_basis = self.dataset_cpp.AddBasisFloat32
+        else:
+            basis_rowmajor = np.ascontiguousarray(basis_, dtype=np.float64)
+            add_basis = self.dataset_cpp.AddBasis
+        if borrow:
+            self._borrowed_basis = basis_rowmajor
+        add_basis(basis_rowmajor, n, p, True, borrow)
     
     def update_basis(self, basis: np.array):
         """
@@ -36,12 +81,73 @@ class Dataset:
         basis_rowmajor = np.ascontiguousarray(basis_)
         self.dataset_cpp.UpdateBasis(basis_rowmajor, n, p, True)
     
+    def bin_covariates(self, max_bins: int = 256, num_threads: int = 1, release_covariates: bool = False):
+        """
+        Store the covariates as 1- or 2-byte bin codes used by the grow-from-root and MCMC samplers, 
+        with split thresholds restricted to bin boundaries. Must be called before the dataset is used 
+        to construct a ``ForestSampler``. Covariates with at most ``max_bins`` unique values are binned exactly.
+
+        Parameters
+        ----------
+        max_bins : int, optional
+            Maximum number of bins per covariate (between 2 and 65536). Defaults to ``256``.
+        num_threads : int, optional
+            Number of threads used to bin the covariates (values <= 0 use all available threads). Defaults to ``1``.
+        release_covariates : bool, optional
+            Whether to free the raw covariates once they are binned, so that grow-from-root sampling only keeps the 
+            bin codes in memory. A dataset whose covariates were released cannot be saved or copied row-major, and 
+            evaluates any split on the bin upper bounds. Defaults to ``False``.
+        """
+        self.dataset_cpp.BinCovariates(int(max_bins), int(num_threads), bool(release_covariates))
+    
+    def add_row_major_covariates(self, num_threads: int = 1):
+        """
+        Keep a row-major copy of the covariates, which prediction reads instead of the column-major covariates 
+        used by the samplers. This speeds up prediction over wide covariate matrices, at the cost of storing the 
+        covariates twice. Covariates added from a C-ordered array without copying are already row-major and are not copied again.
+
+        Parameters
+        ----------
+        num_threads : int, optional
+            Number of threads used to copy the covariates (values <= 0 use all available threads). Defaults to ``1``.
+        """
+        self.dataset_cpp.AddRowMajorCovariates(int(num_threads))
+    
     def add_variance_weights(self, variance_weights: np.array):
         """
         Add variance weights to a dataset
         """
         n = variance_weights.size
         self.dataset_cpp.AddVarianceWeights(variance_weights, n)
+    
+    def add_arrow_covariates(self, record_batch, single_precision: bool = False, num_threads: int = 1) -> np.array:
+        """
+        Add the columns of an Arrow record batch (any object implementing ``__arrow_c_array__``, such as a 
+        ``pyarrow.RecordBatch``) as covariates, without converting them to a numpy array first. 
+        Dictionary-encoded columns become categorical covariates coded by their dictionary indices, 
+        boolean columns become ordered categorical covariates and nulls become NaN. Buffers that are 
+        already laid out as a column-major matrix are borrowed, and all others are converted in C++ 
+        using ``num_threads`` threads. Returns the type of each covariate.
+        """
+        schema_capsule, array_capsule = record_batch.__arrow_c_array__()
+        return np.asarray(self.dataset_cpp.AddArrowCovariates(schema_capsule, array_capsule, single_precision, num_threads), dtype=np.int32)
+    
+    def save_binary(self, filename: str, feature_types: np.array, include_presort: bool = False):
+        """
+        Write the dataset and the type of each covariate to a binary columnar file which 
+        ``load_binary`` maps into memory instead of parsing or copying it. If ``include_presort`` 
+        is True, the file also stores the sort order of every covariate, so that samplers run 
+        on the loaded dataset skip the initial sort.
+        """
+        self.dataset_cpp.SaveBinary(filename, np.asarray(feature_types, dtype=np.int32), include_presort)
+    
+    def load_binary(self, filename: str) -> np.array:
+        """
+        Load a file written by ``save_binary``, replacing the covariates (and the basis and variance 
+        weights, if the file has them). The file is memory-mapped read-only, so that processes loading 
+        the same file share its memory. Returns the type of each covariate.
+        """
+        return np.asarray(self.dataset_cpp.LoadBinary(filename), dtype=np.int32)
 
 class Residual:
     def __init__(self, residual: np.array) -> None:
@@ -7,23 +7,41 @@ from .data import Dataset, Residual
 from stochtree_cpp import ForestContainerCpp
 from typing import Union
 
+# Codes of the ForestPredictEngine values in include/stochtree/container.h
+_PREDICT_ENGINES = {"traversal": 0, "quickscorer": 1, "memoized": 2}
+
+def _predict_engine_code(engine: str) -> int:
+    if engine not in _PREDICT_ENGINES:
+        raise ValueError("engine must be one of 'traversal', 'quickscorer' or 'memoized'")
+    return _PREDICT_ENGINES[engine]
+
 class ForestContainer:
     def __init__(self, num_trees: int, output_dimension: int, leaf_constant: bool) -> None:
         # Initialize a ForestContainerCpp object
         self.forest_container_cpp = ForestContainerCpp(num_trees, output_dimension, leaf_constant)
     
-    def predict(self, dataset: Dataset) -> np.array:
-        # Predict samples from Dataset
-        return self.forest_container_cpp.Predict(dataset.dataset_cpp)
+    def predict(self, dataset: Dataset, num_threads: int = 1, engine: str = "traversal") -> np.array:
+        # Predict samples from Dataset (num_threads <= 0 uses all available cores). engine is one of "traversal", 
+        # "quickscorer" (compiled once per forest and reused until it changes) or "memoized", which all give identical predictions
+        return self.forest_container_cpp.Predict(dataset.dataset_cpp, num_threads, _predict_engine_code(engine))
     
-    def predict_raw(self, dataset: Dataset) -> np.array:
-        # Predict raw leaf values for a specific forest (indexed by forest_num) from Dataset
-        return self.forest_container_cpp.PredictRaw(dataset.dataset_cpp)
+    def predict_raw(self, dataset: Dataset, num_threads: int = 1, engine: str = "traversal") -> np.array:
+        # Predict raw leaf values for every forest from Dataset (num_threads <= 0 uses all available cores, engine as in predict)
+        return self.forest_container_cpp.PredictRaw(dataset.dataset_cpp, num_threads, _predict_engine_code(engine))
     
     def predict_raw_single_forest(self, dataset: Dataset, forest_num: int) -> np.array:
         # Predict raw leaf values for a specific forest (indexed by forest_num) from Dataset
         return self.forest_container_cpp.PredictRawSingleForest(dataset.dataset_cpp, forest_num)
     
+    def predict_summary(self, dataset: Dataset, keep_indices: np.array = None, quantiles: np.array = np.array([0.025, 0.975]), num_threads: int = 1) -> tuple:
+        # Posterior mean, variance and quantiles of predictions from the forests indexed by keep_indices (all forests if None), 
+        # accumulated one forest at a time so that memory use does not grow with the number of forests
+        if keep_indices is None:
+            keep_indices = np.array([], dtype=np.intc)
+        sample_indices = np.asarray(keep_indices, dtype=np.intc)
+        quantile_probs = np.asarray(quantiles, dtype=np.float64)
+        return self.forest_container_cpp.PredictSummary(dataset.dataset_cpp, sample_indices, quantile_probs, num_threads)
+    
     def set_root_leaves(self, forest_num: int, leaf_value: Union[float, np.array]) -> None:
         # Predict raw leaf values for a specific forest (indexed by forest_num) from Dataset
         if not isinstance(leaf_value, np.ndarray) and not isinstance(leaf_value, float):
@@ -4,20 +4,25 @@ Data preprocessing module, drawn largely from the sklearn preprocessing module,
 Copyright (c) 2007-2024 The scikit-learn developers.
 """
 from typing import Union, Optional, Any
-from sklearn.preprocessing import OneHotEncoder, OrdinalEncoder
 from sklearn.utils.validation import check_array, column_or_1d
+from stochtree_cpp import CategoryEncoderCpp
 import numpy as np
 import pandas as pd
 import warnings
 
 class CovariateTransformer:
     """Class that transforms covariates to a format that can be used to define tree splits
+
+    Parameters
+    ----------
+    num_threads : :obj:`int`, optional
+        Number of threads used to learn and apply the category dictionaries of categorical and string columns (values <= 0 use all available cores). Defaults to ``1``.
     """
 
-    def __init__(self) -> None:
+    def __init__(self, num_threads: int = 1) -> None:
         self._is_fitted = False
-        self._ordinal_encoders = []
-        self._onehot_encoders = []
+        self._num_threads = num_threads
+        self._category_encoder = CategoryEncoderCpp()
         self._ordinal_feature_index = []
         self._onehot_feature_index = []
         self._processed_feature_types = []
@@ -30,21 +35,36 @@ class CovariateTransformer:
         else:
             return False
     
+    def _category_labels(self, covariate: pd.Series) -> list:
+        return [str(category) for category in covariate.array.categories]
+    
     def _process_unordered_categorical(self, covariate: pd.Series) -> int:
-        num_onehot = len(self._onehot_encoders)
-        category_list = covariate.array.categories.to_list()
-        enc = OneHotEncoder(categories=[category_list], sparse_output=False)
-        enc.fit(pd.DataFrame(covariate))
-        self._onehot_encoders.append(enc)
-        return num_onehot
+        return self._category_encoder.AddFeature(2, str(covariate.name), self._category_labels(covariate))
+    
+    def _string_values(self, covariate: pd.Series) -> list:
+        # Missing values (pd.NA) are passed to C++ as None
+        return covariate.astype(object).where(covariate.notna(), None).tolist()
+    
+    def _process_string(self, covariate: pd.Series) -> int:
+        # Learn the (sorted) unique strings of the column in C++
+        return self._category_encoder.FitFeature(2, str(covariate.name), self._string_values(covariate), self._num_threads)
     
     def _process_ordered_categorical(self, covariate: pd.Series) -> int:
-        num_ord = len(self._ordinal_encoders)
-        category_list = covariate.array.categories.to_list()
-        enc = OrdinalEncoder(categories=[category_list])
-        enc.fit(pd.DataFrame(covariate))
-        self._ordinal_encoders.append(enc)
-        return num_ord
+        return self._category_encoder.AddFeature(1, str(covariate.name), self._category_labels(covariate))
+    
+    def _encode_categorical(self, covariate: pd.Series, feature_num: int) -> np.array:
+        # Map the categories of the (new) data to the fitted categories in C++ and check for categories unseen during fit
+        codes = np.ascontiguousarray(covariate.array.codes, dtype=np.int64)
+        covariate_encoded = self._category_encoder.EncodeCategorical(feature_num, codes, self._category_labels(covariate), self._num_threads)
+        if np.any(covariate_encoded == self._category_encoder.NumLevels(feature_num)):
+            raise ValueError("Found unknown categories in column {} during transform".format(covariate.name))
+        return covariate_encoded
+    
+    def _encode_string(self, covariate: pd.Series, feature_num: int) -> np.array:
+        covariate_encoded = self._category_encoder.EncodeStrings(feature_num, self._string_values(covariate), self._num_threads)
+        if np.any(covariate_encoded == self._category_encoder.NumLevels(feature_num)):
+            raise ValueError("Found unknown categories in column {} during transform".format(covariate.name))
+        return covariate_encoded
 
     def _fit_pandas(self, covariates: pd.DataFrame) -> None:
         self._num_original_features = covariates.shape[1]
@@ -62,7 +82,7 @@ class CovariateTransformer:
         categorical_types = covariates.apply(lambda x: isinstance(x.dtype, pd.CategoricalDtype))
         float_types = covariates.apply(lambda x: pd.api.types.is_float_dtype(x))
         integer_types = covariates.apply(lambda x: pd.api.types.is_integer_dtype(x))
-        string_types = covariates.apply(lambda x: pd.api.types.is_integer_dtype(x))
+        string_types = covariates.apply(lambda x: isinstance(x.dtype, pd.StringDtype))
         if np.any(datetime_types):
             # raise ValueError("DateTime columns are currently unsupported")
             datetime_cols = covariates.columns[datetime_types].to_list()
@@ -109,9 +129,9 @@ class CovariateTransformer:
                     self._processed_feature_types.extend(feature_ones)
             elif string_types.iloc[i]:
                 self._original_feature_types[i] = "string"
-                onehot_index = self._process_unordered_categorical(covariate)
+                onehot_index = self._process_string(covariate)
                 self._onehot_feature_index[i] = onehot_index
-                feature_ones = np.repeat(1, len(self._onehot_encoders[onehot_index].categories_[0])).tolist()
+                feature_ones = np.repeat(1, self._category_encoder.NumLevels(onehot_index)).tolist()
                 self._processed_feature_types.extend(feature_ones)
             elif bool_types.iloc[i]:
                 self._original_feature_types[i] = "boolean"
@@ -177,15 +197,19 @@ class CovariateTransformer:
             if self._original_feature_types[i] == "category" or self._original_feature_types[i] == "string":
                 if self._ordinal_feature_index[i] != -1:
                     ord_ind = self._ordinal_feature_index[i]
-                    covariate_transformed = self._ordinal_encoders[ord_ind].transform(pd.DataFrame(covariate))
-                    output_array[:,output_iter] = np.squeeze(covariate_transformed)
+                    output_array[:,output_iter] = self._encode_categorical(covariate, ord_ind)
                     output_iter += 1
                     self._original_feature_indices.append(i)
                 else:
                     onehot_ind = self._onehot_feature_index[i]
-                    covariate_transformed = self._onehot_encoders[onehot_ind].transform(pd.DataFrame(covariate))
-                    output_dim = covariate_transformed.shape[1]
-                    output_array[:,np.arange(output_iter, output_iter + output_dim)] = np.squeeze(covariate_transformed)
+                    if self._original_feature_types[i] == "string":
+                        covariate_encoded = self._encode_string(covariate, onehot_ind)
+                    else:
+                        covariate_encoded = self._encode_categorical(covariate, onehot_ind)
+                    # The last column of the C++ one-hot matrix flags unseen categories, which are rejected above
+                    output_dim = self._category_encoder.NumLevels(onehot_ind)
+                    covariate_transformed = self._category_encoder.OneHot(onehot_ind, covariate_encoded, self._num_threads)
+                    output_array[:,np.arange(output_iter, output_iter + output_dim)] = covariate_transformed[:,:output_dim]
                     output_iter += output_dim
                     self._original_feature_indices.extend([i for _ in range(output_dim)])
             
@@ -233,7 +257,7 @@ class CovariateTransformer:
         will be handled as follows:
         
         * ``category``: one-hot encoded if unordered, ordinal encoded if ordered
-        * ``string``: one-hot encoded
+        * ``string``: one-hot encoded, with the unique strings of the column (sorted bytewise) as categories
         * ``boolean``: passed through as binary integer, treated as ordered categorical by tree samplers
         * integer (i.e. ``Int8``, ``Int16``, etc...): passed through as double (**note**: if you have categorical data stored as integers, you should explicitly convert it to categorical in pandas, see this `user guide <https://pandas.pydata.org/pandas-docs/stable/user_guide/categorical.html>`_)
         * float (i.e. ``Float32``, ``Float64``): passed through as double
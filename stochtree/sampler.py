@@ -13,9 +13,11 @@ class RNG:
 
 
 class ForestSampler:
-    def __init__(self, dataset: Dataset, feature_types: np.array, num_trees: int, num_obs: int, alpha: float, beta: float, min_samples_leaf: int) -> None:
-        # Initialize a ForestDatasetCpp object
-        self.forest_sampler_cpp = ForestSamplerCpp(dataset.dataset_cpp, feature_types, num_trees, num_obs, alpha, beta, min_samples_leaf)
+    def __init__(self, dataset: Dataset, feature_types: np.array, num_trees: int, num_obs: int, alpha: float, beta: float, min_samples_leaf: int, cache_tree_predictions: bool = True) -> None:
+        # Initialize a ForestDatasetCpp object (trackers built with cache_tree_predictions = False 
+        # recompute each tree's predictions from its leaves and the current basis rather than storing 
+        # num_obs x num_trees doubles, so basis updates must first be propagated to the residual)
+        self.forest_sampler_cpp = ForestSamplerCpp(dataset.dataset_cpp, feature_types, num_trees, num_obs, alpha, beta, min_samples_leaf, cache_tree_predictions)
     
     def sample_one_iteration(self, forest_container: ForestContainer, dataset: Dataset, residual: Residual, rng: RNG, 
                              feature_types: np.array, cutpoint_grid_size: int, leaf_model_scale_input: np.array, 
@@ -29,6 +31,26 @@ class ForestSampler:
     
     def update_residual(self, dataset: Dataset, residual: Residual, forest_container: ForestContainer, requires_basis: bool, forest_num: int, add: bool) -> None:
         forest_container.forest_container_cpp.UpdateResidual(dataset.dataset_cpp, residual.residual_cpp, self.forest_sampler_cpp, requires_basis, forest_num, add)
+    
+    def add_test_set(self, dataset: Dataset) -> None:
+        """
+        Track the leaf nodes of a held-out dataset during sampling, so that its predictions are recorded 
+        after every call to ``sample_one_iteration`` (``dataset`` must persist while sampling continues)
+        """
+        self.forest_sampler_cpp.AddTestSet(dataset.dataset_cpp)
+    
+    def test_set_predictions(self) -> np.array:
+        """
+        Predictions for the dataset registered with ``add_test_set``, one column per sampling iteration run since it was added
+        """
+        return self.forest_sampler_cpp.GetTestSetPredictions()
+    
+    def set_num_threads(self, num_threads: int) -> None:
+        """
+        Set the number of threads used to partition the presorted covariates after each split of the grow-from-root 
+        (GFR) sampler (values <= 0 use all available cores). Sampled forests do not depend on the number of threads.
+        """
+        self.forest_sampler_cpp.SetNumThreads(int(num_threads))
 
 
 class GlobalVarianceModel:
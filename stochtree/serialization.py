@@ -4,6 +4,7 @@ import pandas as pd
 from scipy.linalg import lstsq
 from scipy.stats import gamma
 from .forest import ForestContainer
+from .preprocessing import CovariateTransformer
 from stochtree_cpp import JsonCpp
 
 class JSONSerializer:
@@ -25,6 +26,32 @@ class JSONSerializer:
         self.num_forests += 1
         self.forest_labels.append(forest_label)
     
+    def add_category_encoder(self, covariate_transformer) -> None:
+        """Adds the category dictionaries of a fitted ``CovariateTransformer`` to a json object, 
+        under the ``category_encoder`` field
+
+        :param covariate_transformer: Fitted covariate transformer
+        :type covariate_transformer: CovariateTransformer
+        """
+        self.json_cpp.AddCategoryEncoder(covariate_transformer._category_encoder)
+    
+    def add_covariate_transformer(self, covariate_transformer: CovariateTransformer) -> None:
+        """Adds a fitted ``CovariateTransformer`` to a json object: its category dictionaries under the ``category_encoder`` field 
+        and the column types needed to apply them under the ``covariate_transformer`` subfolder
+
+        :param covariate_transformer: Fitted covariate transformer
+        :type covariate_transformer: CovariateTransformer
+        """
+        if not covariate_transformer._check_is_fitted():
+            raise ValueError("covariate_transformer must be fit before it is added to a json object")
+        self.add_category_encoder(covariate_transformer)
+        # Index lists are written directly, since add_numeric_vector squeezes length-one arrays to scalars
+        self.add_scalar("num_original_features", covariate_transformer._num_original_features, "covariate_transformer")
+        self.add_string_vector("original_feature_types", list(covariate_transformer._original_feature_types), "covariate_transformer")
+        self.json_cpp.AddDoubleVectorSubfolder("covariate_transformer", "ordinal_feature_index", np.asarray(covariate_transformer._ordinal_feature_index, dtype=np.float64))
+        self.json_cpp.AddDoubleVectorSubfolder("covariate_transformer", "onehot_feature_index", np.asarray(covariate_transformer._onehot_feature_index, dtype=np.float64))
+        self.json_cpp.AddDoubleVectorSubfolder("covariate_transformer", "processed_feature_types", np.asarray(covariate_transformer._processed_feature_types, dtype=np.float64))
+    
     def add_scalar(self, field_name: str, field_value: float, subfolder_name: str = None) -> None:
         """Adds a scalar (numeric) value to a json object
 
@@ -181,3 +208,19 @@ class JSONSerializer:
         result = ForestContainer(0, 1, True)
         result.forest_container_cpp.LoadFromJson(self.json_cpp, forest_label)
         return result
+    
+    def get_covariate_transformer(self, num_threads: int = 1) -> CovariateTransformer:
+        """Restores a fitted ``CovariateTransformer`` added to a json object by ``add_covariate_transformer``
+
+        :param num_threads: Number of threads used by the restored transformer to encode categorical columns
+        :type num_threads: int, optional
+        """
+        result = CovariateTransformer(num_threads)
+        result._category_encoder.LoadFromJson(self.json_cpp)
+        result._num_original_features = int(self.get_scalar("num_original_features", "covariate_transformer"))
+        result._original_feature_types = self.get_string_vector("original_feature_types", "covariate_transformer")
+        result._ordinal_feature_index = [int(i) for i in self.get_numeric_vector("ordinal_feature_index", "covariate_transformer")]
+        result._onehot_feature_index = [int(i) for i in self.get_numeric_vector("onehot_feature_index", "covariate_transformer")]
+        result._processed_feature_types = [int(i) for i in self.get_numeric_vector("processed_feature_types", "covariate_transformer")]
+        result._is_fitted = True
+        return result
@@ -0,0 +1,52 @@
+/*!
+ * Copyright (c) 2024 stochtree authors
+ *
+ * Samples a forest from the medium test dataset and saves it as JSON, to be compiled by
+ * stochtree_add_compiled_model() for the compiled prediction test (see test_compiled_forest.cpp).
+ *
+ * Usage: codegen_sample_forest <model.json>
+ */
+#include <testutils.h>
+#include <stochtree/container.h>
+#include <stochtree/data.h>
+#include <stochtree/leaf_model.h>
+#include <stochtree/partition_tracker.h>
+#include <stochtree/tree_sampler.h>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "Usage: codegen_sample_forest <model.json>" << std::endl;
+    return 1;
+  }
+
+  // Load test data
+  StochTree::TestUtils::TestDataset test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  StochTree::data_size_t n = test_dataset.n;
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  std::vector<double> variable_weights(test_dataset.x_cols, 1./test_dataset.x_cols);
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  StochTree::ColumnVector residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+
+  // Sample a few constant-leaf forests by grow-from-root and MCMC
+  int num_trees = 10;
+  StochTree::ForestContainer forest_samples(num_trees, 1, true);
+  StochTree::ForestTracker tracker = StochTree::ForestTracker(dataset, feature_types, num_trees, n);
+  StochTree::TreePrior tree_prior = StochTree::TreePrior(0.95, 1.25, 1);
+  StochTree::GaussianConstantLeafModel leaf_model(1.);
+  std::mt19937 gen(1234);
+  StochTree::GFRForestSampler<StochTree::GaussianConstantLeafModel> gfr_sampler(n);
+  for (int i = 0; i < 2; i++) {
+    gfr_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1., feature_types);
+  }
+  StochTree::MCMCForestSampler<StochTree::GaussianConstantLeafModel> mcmc_sampler;
+  for (int i = 0; i < 3; i++) {
+    mcmc_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1.);
+  }
+
+  forest_samples.SaveToJsonFile(argv[1]);
+  return 0;
+}
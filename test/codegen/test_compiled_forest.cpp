@@ -0,0 +1,53 @@
+/*!
+ * Copyright (c) 2024 stochtree authors
+ *
+ * Compares a forest compiled by stochtree_add_compiled_model() against ForestContainer::PredictRaw
+ * on the forest it was generated from (STOCHTREE_CODEGEN_TEST_MODEL, written by sample_forest.cpp).
+ */
+#include <gtest/gtest.h>
+#include <testutils.h>
+#include <stochtree/container.h>
+#include <stochtree/data.h>
+#include <limits>
+#include <vector>
+
+// Exported by the compiled model library (see include/stochtree/codegen.h)
+extern "C" {
+void predict(const double* row, double* out);
+int stochtree_model_num_features(void);
+int stochtree_model_num_samples(void);
+int stochtree_model_output_dimension(void);
+}
+
+TEST(CompiledForest, MatchesPredictRaw) {
+  // Load the sampled forest and the data it was sampled from, with a missing value
+  StochTree::ForestContainer forest_samples(0, 1, true);
+  forest_samples.LoadFromJsonFile(STOCHTREE_CODEGEN_TEST_MODEL);
+  StochTree::TestUtils::TestDataset test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  test_dataset.covariates(3, 0) = std::numeric_limits<double>::quiet_NaN();
+  StochTree::data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, p, test_dataset.row_major);
+
+  int num_samples = forest_samples.NumSamples();
+  int output_dim = forest_samples.OutputDimension();
+  ASSERT_GT(num_samples, 0);
+  ASSERT_EQ(stochtree_model_num_samples(), num_samples);
+  ASSERT_EQ(stochtree_model_output_dimension(), output_dim);
+  ASSERT_LE(stochtree_model_num_features(), p);
+
+  // Compiled predictions of every row are bit-identical to PredictRaw
+  std::vector<double> expected = forest_samples.PredictRaw(dataset);
+  std::vector<double> row(p);
+  std::vector<double> result(num_samples * output_dim);
+  for (StochTree::data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) row[j] = test_dataset.covariates(i, j);
+    predict(row.data(), result.data());
+    for (int s = 0; s < num_samples; s++) {
+      for (int k = 0; k < output_dim; k++) {
+        ASSERT_EQ(expected[s*n*output_dim + i*output_dim + k], result[s*output_dim + k]);
+      }
+    }
+  }
+}
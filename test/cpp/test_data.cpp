@@ -7,7 +7,18 @@
 #include <testutils.h>
 #include <stochtree/log.h>
 #include <stochtree/random.h>
+#include <stochtree/arrow_dataset.h>
+#include <stochtree/binary_dataset.h>
+#include <stochtree/category_encoder.h>
+#include <stochtree/container.h>
 #include <stochtree/data.h>
+#include <stochtree/leaf_model.h>
+#include <stochtree/text_dataset.h>
+#include <stochtree/tree_sampler.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
 #include <iostream>
 #include <memory>
 
@@ -81,3 +92,763 @@ TEST(Data, ReadFromMediumDatasetRowMajor) {
   EXPECT_NEAR(0.4413101, average[4], 0.0001);
 }
 
+/*! \brief Run GFR and MCMC iterations of a univariate leaf regression forest sampler on `dataset` */
+static void SampleRegressionForest(StochTree::TestUtils::TestDataset& test_dataset, StochTree::ForestDataset& dataset, 
+                                   StochTree::ForestContainer& forest_samples, int num_mcmc = 10) {
+  StochTree::data_size_t n = test_dataset.n;
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  std::vector<double> variable_weights(test_dataset.x_cols, 1./test_dataset.x_cols);
+  StochTree::ColumnVector residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::ForestTracker tracker = StochTree::ForestTracker(dataset, feature_types, forest_samples.NumTrees(), n);
+  StochTree::TreePrior tree_prior = StochTree::TreePrior(0.95, 1.25, 1);
+  StochTree::GaussianUnivariateRegressionLeafModel leaf_model(1.);
+  std::mt19937 gen(1234);
+  StochTree::GFRForestSampler<StochTree::GaussianUnivariateRegressionLeafModel> gfr_sampler(n);
+  for (int i = 0; i < 2; i++) {
+    gfr_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1., feature_types);
+  }
+  StochTree::MCMCForestSampler<StochTree::GaussianUnivariateRegressionLeafModel> mcmc_sampler;
+  for (int i = 0; i < num_mcmc; i++) {
+    mcmc_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1.);
+  }
+}
+
+TEST(Data, BorrowedDataset) {
+  // Load (row-major) test data, with a column-major copy of the covariates and basis
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  Eigen::MatrixXd covariates_col_major = test_dataset.covariates;
+  Eigen::MatrixXd basis_col_major = test_dataset.omega;
+
+  // Datasets that copy or borrow their data
+  StochTree::ForestDataset owned = StochTree::ForestDataset();
+  owned.AddCovariates(test_dataset.covariates.data(), n, p, true);
+  owned.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  StochTree::ForestDataset borrowed_row_major = StochTree::ForestDataset();
+  borrowed_row_major.AddCovariates(test_dataset.covariates.data(), n, p, true, true);
+  borrowed_row_major.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true, true);
+  StochTree::ForestDataset borrowed_col_major = StochTree::ForestDataset();
+  borrowed_col_major.AddCovariates(covariates_col_major.data(), n, p, false, true);
+  borrowed_col_major.AddBasis(basis_col_major.data(), n, test_dataset.omega_cols, false, true);
+
+  // Borrowed datasets view the external buffers in place
+  ASSERT_EQ(borrowed_row_major.GetCovariates().data(), test_dataset.covariates.data());
+  ASSERT_EQ(borrowed_col_major.GetCovariates().data(), covariates_col_major.data());
+  for (data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(owned.CovariateValue(i, j), borrowed_row_major.CovariateValue(i, j));
+      ASSERT_EQ(owned.CovariateValue(i, j), borrowed_col_major.CovariateValue(i, j));
+    }
+  }
+
+  // Copying a dataset keeps borrowing the same buffer
+  StochTree::ForestDataset borrowed_copy = borrowed_row_major;
+  ASSERT_EQ(borrowed_copy.GetCovariates().data(), test_dataset.covariates.data());
+  ASSERT_EQ(borrowed_copy.CovariateValue(n - 1, p - 1), owned.CovariateValue(n - 1, p - 1));
+
+  // Sampling and prediction give identical results for owned and borrowed data
+  StochTree::ForestContainer owned_forests(5, 1, false);
+  StochTree::ForestContainer row_major_forests(5, 1, false);
+  StochTree::ForestContainer col_major_forests(5, 1, false);
+  SampleRegressionForest(test_dataset, owned, owned_forests);
+  SampleRegressionForest(test_dataset, borrowed_row_major, row_major_forests);
+  SampleRegressionForest(test_dataset, borrowed_col_major, col_major_forests);
+  std::vector<double> expected = owned_forests.Predict(owned);
+  for (auto engine : {StochTree::ForestPredictEngine::kTreeTraversal, StochTree::ForestPredictEngine::kStructureMemoized}) {
+    std::vector<double> row_major_preds = row_major_forests.Predict(borrowed_row_major, 1, engine);
+    std::vector<double> col_major_preds = col_major_forests.Predict(borrowed_col_major, 1, engine);
+    ASSERT_EQ(row_major_preds.size(), expected.size());
+    ASSERT_EQ(col_major_preds.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i], row_major_preds[i]);
+      ASSERT_EQ(expected[i], col_major_preds[i]);
+    }
+  }
+
+  // Updating a borrowed basis copies the new values instead of writing into the external buffer
+  double first_basis_value = test_dataset.omega(0, 0);
+  std::vector<double> new_basis(n * test_dataset.omega_cols, 2.0);
+  borrowed_row_major.UpdateBasis(new_basis.data(), n, test_dataset.omega_cols, true);
+  ASSERT_EQ(borrowed_row_major.BasisValue(0, 0), 2.0);
+  ASSERT_EQ(test_dataset.omega(0, 0), first_basis_value);
+}
+
+TEST(Data, BinnedCovariates) {
+  // Load test data
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+
+  // Exact binning: every unique value has its own bin, stored as a 1-byte code
+  StochTree::ForestDataset exact = StochTree::ForestDataset();
+  exact.AddCovariates(test_dataset.covariates.data(), n, p, true);
+  exact.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  exact.BinCovariates(256);
+  StochTree::BinnedColumnMatrix const& exact_bins = exact.GetBinnedCovariates();
+  ASSERT_TRUE(exact.HasBinnedCovariates());
+  ASSERT_EQ(exact_bins.BytesPerCode(), 1);
+  for (int j = 0; j < p; j++) {
+    ASSERT_TRUE(exact_bins.IsExact(j));
+    for (data_size_t i = 0; i < n; i++) {
+      ASSERT_EQ(exact_bins.UpperBound(j, exact_bins.BinCode(i, j)), exact.CovariateValue(i, j));
+    }
+  }
+
+  // Coarse binning: bins are ordered, and each code's upper bound is at least the covariate value
+  StochTree::ForestDataset coarse = StochTree::ForestDataset();
+  coarse.AddCovariates(test_dataset.covariates.data(), n, p, true);
+  coarse.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  coarse.BinCovariates(8);
+  StochTree::BinnedColumnMatrix const& coarse_bins = coarse.GetBinnedCovariates();
+  for (int j = 0; j < p; j++) {
+    ASSERT_FALSE(coarse_bins.IsExact(j));
+    ASSERT_LE(coarse_bins.NumBins(j), 8);
+    for (int b = 1; b < coarse_bins.NumBins(j); b++) {
+      ASSERT_LT(coarse_bins.UpperBound(j, b - 1), coarse_bins.UpperBound(j, b));
+    }
+    for (data_size_t i = 0; i < n; i++) {
+      int code = coarse_bins.BinCode(i, j);
+      ASSERT_LE(coarse.CovariateValue(i, j), coarse_bins.UpperBound(j, code));
+      if (code > 0) ASSERT_GT(coarse.CovariateValue(i, j), coarse_bins.UpperBound(j, code - 1));
+    }
+    // Thresholds at a bin boundary map to that bin, thresholds inside a bin cannot be resolved by codes
+    int bin;
+    ASSERT_TRUE(coarse_bins.SplitBin(j, coarse_bins.UpperBound(j, 2), bin));
+    ASSERT_EQ(bin, 2);
+    ASSERT_TRUE(coarse_bins.SplitBin(j, coarse_bins.UpperBound(j, coarse_bins.NumBins(j) - 1) + 1.0, bin));
+    ASSERT_EQ(bin, coarse_bins.NumBins(j) - 1);
+    ASSERT_FALSE(coarse_bins.SplitBin(j, (coarse_bins.UpperBound(j, 2) + coarse_bins.UpperBound(j, 3)) / 2., bin));
+  }
+
+  // Features with more than 256 bins use 2-byte codes
+  std::vector<double> wide_covariates(1000);
+  for (int i = 0; i < 1000; i++) wide_covariates[i] = static_cast<double>((i * 7919) % 1000);
+  StochTree::ForestDataset wide = StochTree::ForestDataset();
+  wide.AddCovariates(wide_covariates.data(), 1000, 1, false);
+  wide.BinCovariates(1000);
+  ASSERT_EQ(wide.GetBinnedCovariates().BytesPerCode(), 2);
+  ASSERT_EQ(wide.GetBinnedCovariates().NumBins(0), 1000);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(wide.GetBinnedCovariates().BinCode(i, 0), static_cast<std::uint16_t>(wide_covariates[i]));
+  }
+
+  // Grow-from-root with exactly binned covariates reproduces the unbinned samples
+  StochTree::ForestDataset unbinned = StochTree::ForestDataset();
+  unbinned.AddCovariates(test_dataset.covariates.data(), n, p, true);
+  unbinned.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  StochTree::ForestContainer unbinned_forests(10, 1, false);
+  StochTree::ForestContainer exact_forests(10, 1, false);
+  SampleRegressionForest(test_dataset, unbinned, unbinned_forests, 0);
+  SampleRegressionForest(test_dataset, exact, exact_forests, 0);
+  std::vector<double> expected = unbinned_forests.Predict(unbinned);
+  std::vector<double> exact_preds = exact_forests.Predict(exact);
+  ASSERT_EQ(exact_preds.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(expected[i], exact_preds[i]);
+  }
+
+  // Sampling with coarse bins only splits at bin boundaries
+  StochTree::ForestContainer coarse_forests(10, 1, false);
+  SampleRegressionForest(test_dataset, coarse, coarse_forests);
+  for (int s = 0; s < coarse_forests.NumSamples(); s++) {
+    StochTree::TreeEnsemble* ensemble = coarse_forests.GetEnsemble(s);
+    for (int t = 0; t < ensemble->NumTrees(); t++) {
+      StochTree::Tree* tree = ensemble->GetTree(t);
+      for (int node : tree->GetInternalNodes()) {
+        if (tree->NodeType(node) != StochTree::TreeNodeType::kNumericalSplitNode) continue;
+        int feature = tree->SplitIndex(node);
+        int bin;
+        ASSERT_TRUE(coarse_bins.SplitBin(feature, tree->Threshold(node), bin));
+        ASSERT_GE(bin, 0);
+        ASSERT_EQ(coarse_bins.UpperBound(feature, bin), tree->Threshold(node));
+      }
+    }
+  }
+
+  // Releasing the raw covariates keeps the bin codes, and reads each covariate as its bin's upper bound
+  StochTree::ForestDataset released = StochTree::ForestDataset();
+  released.AddCovariates(test_dataset.covariates.data(), n, p, true);
+  released.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  released.BinCovariates(8, 2, true);
+  ASSERT_TRUE(released.HasReleasedCovariates());
+  ASSERT_EQ(released.NumObservations(), n);
+  ASSERT_EQ(released.NumCovariates(), p);
+  StochTree::BinnedColumnMatrix const& released_bins = released.GetBinnedCovariates();
+  for (int j = 0; j < p; j++) {
+    ASSERT_EQ(released_bins.NumBins(j), coarse_bins.NumBins(j));
+    for (data_size_t i = 0; i < n; i++) {
+      ASSERT_EQ(released_bins.BinCode(i, j), coarse_bins.BinCode(i, j));
+      ASSERT_EQ(released.CovariateValue(i, j), coarse_bins.UpperBound(j, coarse_bins.BinCode(i, j)));
+    }
+  }
+
+  // Sampling and prediction with released covariates reproduce the binned samples
+  StochTree::ForestContainer released_forests(10, 1, false);
+  SampleRegressionForest(test_dataset, released, released_forests);
+  std::vector<double> coarse_preds = coarse_forests.Predict(coarse);
+  std::vector<double> released_preds = released_forests.Predict(released);
+  ASSERT_EQ(released_preds.size(), coarse_preds.size());
+  for (size_t i = 0; i < coarse_preds.size(); i++) {
+    ASSERT_EQ(coarse_preds[i], released_preds[i]);
+  }
+}
+
+TEST(Data, SinglePrecisionDataset) {
+  // Load test data, rounding the covariates and basis to single precision
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  int basis_dim = test_dataset.omega_cols;
+  std::vector<float> covariates_float(test_dataset.covariates.data(), test_dataset.covariates.data() + n * p);
+  std::vector<float> basis_float(test_dataset.omega.data(), test_dataset.omega.data() + n * basis_dim);
+  std::vector<double> covariates_rounded(covariates_float.begin(), covariates_float.end());
+  std::vector<double> basis_rounded(basis_float.begin(), basis_float.end());
+
+  // Single precision dataset, and a double precision dataset holding the same values
+  StochTree::ForestDataset single = StochTree::ForestDataset();
+  single.AddCovariates(covariates_float.data(), n, p, true, true);
+  single.AddBasis(basis_float.data(), n, basis_dim, true, true);
+  StochTree::ForestDataset rounded = StochTree::ForestDataset();
+  rounded.AddCovariates(covariates_rounded.data(), n, p, true);
+  rounded.AddBasis(basis_rounded.data(), n, basis_dim, true);
+  ASSERT_TRUE(single.HasSinglePrecisionCovariates());
+  ASSERT_TRUE(single.HasSinglePrecisionBasis());
+  ASSERT_FALSE(rounded.HasSinglePrecisionCovariates());
+  ASSERT_EQ(single.GetFloatCovariates().data(), covariates_float.data());
+  for (data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(single.CovariateValue(i, j), rounded.CovariateValue(i, j));
+    }
+    for (int j = 0; j < basis_dim; j++) {
+      ASSERT_EQ(single.BasisValue(i, j), rounded.BasisValue(i, j));
+    }
+  }
+
+  // Sampling and prediction widen single precision values exactly, so results are identical
+  StochTree::ForestContainer single_forests(5, 1, false);
+  StochTree::ForestContainer rounded_forests(5, 1, false);
+  SampleRegressionForest(test_dataset, single, single_forests);
+  SampleRegressionForest(test_dataset, rounded, rounded_forests);
+  std::vector<double> expected = rounded_forests.Predict(rounded);
+  for (auto engine : {StochTree::ForestPredictEngine::kTreeTraversal, StochTree::ForestPredictEngine::kQuickScorer, 
+                      StochTree::ForestPredictEngine::kStructureMemoized}) {
+    std::vector<double> single_preds = single_forests.Predict(single, 2, engine);
+    ASSERT_EQ(single_preds.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i], single_preds[i]);
+    }
+  }
+
+  // Binned single precision covariates match binned double precision covariates
+  single.BinCovariates(16);
+  rounded.BinCovariates(16);
+  for (int j = 0; j < p; j++) {
+    ASSERT_EQ(single.GetBinnedCovariates().NumBins(j), rounded.GetBinnedCovariates().NumBins(j));
+    for (data_size_t i = 0; i < n; i++) {
+      ASSERT_EQ(single.GetBinnedCovariates().BinCode(i, j), rounded.GetBinnedCovariates().BinCode(i, j));
+    }
+  }
+}
+
+TEST(Data, RowMajorCovariates) {
+  // Load test data and store it column-major, as the samplers expect
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, p, true);
+  dataset.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  StochTree::ForestContainer forest_samples(5, 1, false);
+  SampleRegressionForest(test_dataset, dataset, forest_samples);
+  std::vector<double> expected = forest_samples.Predict(dataset);
+  std::vector<double> expected_raw = forest_samples.PredictRaw(dataset);
+
+  // The row-major copy holds the same values, and training still reads the column-major covariates
+  ASSERT_FALSE(dataset.HasRowMajorCovariates());
+  dataset.AddRowMajorCovariates(2);
+  ASSERT_TRUE(dataset.HasRowMajorCovariates());
+  ASSERT_EQ(dataset.GetCovariates().innerStride(), 1);
+  dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+    ASSERT_EQ(covariates.outerStride(), 1);
+    for (data_size_t i = 0; i < n; i++) {
+      for (int j = 0; j < p; j++) {
+        ASSERT_EQ(covariates(i, j), dataset.CovariateValue(i, j));
+      }
+    }
+  });
+
+  // Every prediction engine gives identical results from the row-major copy (and from copies of the dataset)
+  StochTree::ForestDataset dataset_copy = dataset;
+  for (auto engine : {StochTree::ForestPredictEngine::kTreeTraversal, StochTree::ForestPredictEngine::kQuickScorer, 
+                      StochTree::ForestPredictEngine::kStructureMemoized}) {
+    std::vector<double> preds = forest_samples.Predict(dataset_copy, 2, engine);
+    ASSERT_EQ(preds.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i], preds[i]);
+    }
+  }
+  std::vector<double> preds_raw = forest_samples.PredictRaw(dataset);
+  ASSERT_EQ(preds_raw.size(), expected_raw.size());
+  for (size_t i = 0; i < expected_raw.size(); i++) {
+    ASSERT_EQ(expected_raw[i], preds_raw[i]);
+  }
+
+  // Borrowed row-major covariates are read in place, and replacing the covariates drops the copy
+  std::vector<float> covariates_float(test_dataset.covariates.data(), test_dataset.covariates.data() + n * p);
+  dataset.AddCovariates(covariates_float.data(), n, p, true, true);
+  ASSERT_FALSE(dataset.HasRowMajorCovariates());
+  dataset.AddRowMajorCovariates();
+  ASSERT_TRUE(dataset.HasRowMajorCovariates());
+  dataset.VisitDensePredictionCovariates([&](auto& covariates) {
+    ASSERT_EQ(static_cast<void const*>(covariates.data()), static_cast<void const*>(covariates_float.data()));
+  });
+}
+
+TEST(Data, SparseCovariates) {
+  // Load test data, zeroing covariates below 0.5 so that about half of the entries are zero
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  Eigen::MatrixXd covariates_zeroed = test_dataset.covariates;
+  std::vector<int> col_ptr(1, 0);
+  std::vector<int> row_index;
+  std::vector<double> values;
+  for (int j = 0; j < p; j++) {
+    for (data_size_t i = 0; i < n; i++) {
+      if (covariates_zeroed(i, j) < 0.5) {
+        covariates_zeroed(i, j) = 0.;
+      } else {
+        row_index.push_back(i);
+        values.push_back(covariates_zeroed(i, j));
+      }
+    }
+    col_ptr.push_back(static_cast<int>(values.size()));
+  }
+
+  // Sparse dataset, and a dense dataset holding the same values
+  StochTree::ForestDataset sparse = StochTree::ForestDataset();
+  sparse.AddSparseCovariates(col_ptr.data(), row_index.data(), values.data(), n, p);
+  sparse.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  StochTree::ForestDataset dense = StochTree::ForestDataset();
+  dense.AddCovariates(covariates_zeroed.data(), n, p, false);
+  dense.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  ASSERT_TRUE(sparse.HasSparseCovariates());
+  ASSERT_FALSE(dense.HasSparseCovariates());
+  ASSERT_EQ(sparse.GetSparseCovariates().NumNonZeros(), static_cast<data_size_t>(values.size()));
+  ASSERT_EQ(sparse.NumObservations(), n);
+  ASSERT_EQ(sparse.NumCovariates(), p);
+  for (data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(sparse.CovariateValue(i, j), dense.CovariateValue(i, j));
+    }
+  }
+
+  // Sparse features give the same cutpoints as dense ones, and sufficient statistics that only differ by rounding, so the sampled forests agree
+  StochTree::ForestContainer sparse_forests(5, 1, false);
+  StochTree::ForestContainer dense_forests(5, 1, false);
+  SampleRegressionForest(test_dataset, sparse, sparse_forests);
+  SampleRegressionForest(test_dataset, dense, dense_forests);
+  std::vector<double> expected = dense_forests.Predict(dense);
+  for (auto engine : {StochTree::ForestPredictEngine::kTreeTraversal, StochTree::ForestPredictEngine::kQuickScorer}) {
+    std::vector<double> sparse_preds = sparse_forests.Predict(sparse, 2, engine);
+    ASSERT_EQ(sparse_preds.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i], sparse_preds[i]);
+    }
+  }
+}
+
+TEST(Data, BinaryDatasetFile) {
+  // Load test data, with single precision covariates and variance weights
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  std::vector<float> covariates_float(test_dataset.covariates.data(), test_dataset.covariates.data() + n * p);
+  std::vector<double> weights(n, 1.);
+  for (data_size_t i = 0; i < n; i++) weights[i] += (i % 3) * 0.5;
+  std::vector<StochTree::FeatureType> feature_types(p, StochTree::FeatureType::kNumeric);
+  feature_types[p - 1] = StochTree::FeatureType::kOrderedCategorical;
+  StochTree::ForestDataset original = StochTree::ForestDataset();
+  original.AddCovariates(covariates_float.data(), n, p, true);
+  original.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, true);
+  original.AddVarianceWeights(weights.data(), n);
+
+  // Write the dataset with a presort index and map it back
+  std::string filename = ::testing::TempDir() + "stochtree_binary_dataset.bin";
+  StochTree::SaveBinaryDataset(original, feature_types, filename, true);
+  StochTree::ForestDataset loaded = StochTree::ForestDataset();
+  std::vector<StochTree::FeatureType> loaded_feature_types;
+  StochTree::LoadBinaryDataset(filename, loaded, loaded_feature_types);
+  std::remove(filename.c_str());
+  ASSERT_EQ(loaded_feature_types, feature_types);
+  ASSERT_TRUE(loaded.HasSinglePrecisionCovariates());
+  ASSERT_FALSE(loaded.HasSinglePrecisionBasis());
+  ASSERT_TRUE(loaded.HasVarWeights());
+  ASSERT_TRUE(loaded.HasPresortIndex());
+  ASSERT_EQ(loaded.NumObservations(), n);
+  ASSERT_EQ(loaded.NumCovariates(), p);
+  for (data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(original.CovariateValue(i, j), loaded.CovariateValue(i, j));
+    }
+    for (int j = 0; j < test_dataset.omega_cols; j++) {
+      ASSERT_EQ(original.BasisValue(i, j), loaded.BasisValue(i, j));
+    }
+    ASSERT_EQ(original.VarWeightValue(i), loaded.VarWeightValue(i));
+  }
+
+  // The stored presort index matches the sort computed by the tracker, so sampling is identical. 
+  // A copy of the loaded dataset keeps the mapped file alive after the original is gone.
+  StochTree::ForestDataset loaded_copy = loaded;
+  loaded = StochTree::ForestDataset();
+  StochTree::ForestContainer original_forests(5, 1, false);
+  StochTree::ForestContainer loaded_forests(5, 1, false);
+  SampleRegressionForest(test_dataset, original, original_forests);
+  SampleRegressionForest(test_dataset, loaded_copy, loaded_forests);
+  std::vector<double> expected = original_forests.Predict(original);
+  std::vector<double> loaded_preds = loaded_forests.Predict(loaded_copy);
+  ASSERT_EQ(loaded_preds.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(expected[i], loaded_preds[i]);
+  }
+}
+
+TEST(Data, TextDatasetLoader) {
+  // Write the test data to a CSV file with an outcome column, a labelled categorical column, 
+  // missing values and Windows line endings
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  std::vector<std::string> labels = {"red", "green", "blue"};
+  std::string filename = ::testing::TempDir() + "stochtree_text_dataset.csv";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file << "y";
+    for (int j = 0; j < p; j++) file << ",x" << j;
+    file << ", color\r\n";
+    char value[32];
+    for (data_size_t i = 0; i < n; i++) {
+      std::snprintf(value, sizeof(value), "%.17g", test_dataset.outcome(i));
+      file << value;
+      for (int j = 0; j < p; j++) {
+        std::snprintf(value, sizeof(value), "%.17g", test_dataset.covariates(i, j));
+        file << "," << ((i == 3 && j == 1) ? "NA" : value);
+      }
+      file << ", " << ((i == 5) ? "" : labels[(i * 7) % 3]) << "\r\n";
+    }
+  }
+
+  // Load with chunks much smaller than the file, with one and several threads
+  StochTree::TextDatasetConfig config;
+  config.outcome_column = 0;
+  config.chunk_bytes = 1000;
+  StochTree::TextDatasetLoader serial_loader(config);
+  StochTree::ForestDataset serial = StochTree::ForestDataset();
+  serial_loader.Load(filename, serial);
+  config.num_threads = 4;
+  StochTree::TextDatasetLoader parallel_loader(config);
+  StochTree::ForestDataset parallel = StochTree::ForestDataset();
+  parallel_loader.Load(filename, parallel);
+  std::remove(filename.c_str());
+
+  ASSERT_EQ(serial.NumObservations(), n);
+  ASSERT_EQ(serial.NumCovariates(), p + 1);
+  ASSERT_EQ(serial_loader.CovariateNames().front(), "x0");
+  ASSERT_EQ(serial_loader.CovariateNames().back(), "color");
+  for (int j = 0; j < p; j++) {
+    ASSERT_EQ(serial_loader.FeatureTypes()[j], StochTree::FeatureType::kNumeric);
+  }
+  ASSERT_EQ(serial_loader.FeatureTypes()[p], StochTree::FeatureType::kUnorderedCategorical);
+  ASSERT_EQ(serial_loader.CategoryLabels(p), labels);
+  ASSERT_EQ(parallel_loader.CategoryLabels(p), labels);
+  for (data_size_t i = 0; i < n; i++) {
+    ASSERT_EQ(serial_loader.Outcome()[i], test_dataset.outcome(i));
+    for (int j = 0; j < p; j++) {
+      if (i == 3 && j == 1) {
+        ASSERT_TRUE(std::isnan(serial.CovariateValue(i, j)));
+        ASSERT_TRUE(std::isnan(parallel.CovariateValue(i, j)));
+      } else {
+        ASSERT_EQ(serial.CovariateValue(i, j), test_dataset.covariates(i, j));
+        ASSERT_EQ(parallel.CovariateValue(i, j), test_dataset.covariates(i, j));
+      }
+    }
+    if (i == 5) {
+      ASSERT_TRUE(std::isnan(serial.CovariateValue(i, p)));
+    } else {
+      ASSERT_EQ(serial.CovariateValue(i, p), (i * 7) % 3);
+      ASSERT_EQ(parallel.CovariateValue(i, p), (i * 7) % 3);
+    }
+  }
+
+  // Malformed lines found by the parsing threads are reported once they have joined
+  std::string malformed_filename = ::testing::TempDir() + "stochtree_text_dataset_malformed.csv";
+  for (std::string bad_line : {"1,2", "1,abc,3"}) {
+    {
+      std::ofstream file(malformed_filename, std::ios::binary);
+      file << "y,x0,x1\n";
+      for (int i = 0; i < 3000; i++) file << (i == 2500 ? bad_line : "1,2,3") << "\n";
+    }
+    StochTree::TextDatasetConfig malformed_config;
+    malformed_config.outcome_column = 0;
+    malformed_config.feature_types = {StochTree::FeatureType::kNumeric, StochTree::FeatureType::kNumeric};
+    malformed_config.num_threads = 4;
+    StochTree::TextDatasetLoader malformed_loader(malformed_config);
+    StochTree::ForestDataset malformed = StochTree::ForestDataset();
+    ASSERT_THROW(malformed_loader.Load(malformed_filename, malformed), std::runtime_error);
+  }
+  std::remove(malformed_filename.c_str());
+}
+
+TEST(Data, StridedTypedCovariates) {
+  // Integer, byte and boolean matrices stored row-major inside wider buffers
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = 50;
+  int p = 3;
+  int buffer_cols = 5;
+  std::vector<std::int32_t> int_buffer(n * buffer_cols);
+  std::vector<std::uint8_t> byte_buffer(n * buffer_cols);
+  std::unique_ptr<bool[]> bool_buffer(new bool[n * buffer_cols]);
+  for (data_size_t i = 0; i < n * buffer_cols; i++) {
+    int_buffer[i] = static_cast<std::int32_t>(i) - 100;
+    byte_buffer[i] = static_cast<std::uint8_t>(i % 256);
+    bool_buffer[i] = (i % 3 == 0);
+  }
+
+  // View every other column of the wider buffers (row stride 5, column stride 2), and the rows in reverse order
+  StochTree::ForestDataset int_dataset = StochTree::ForestDataset();
+  int_dataset.AddCovariatesStrided(int_buffer.data(), n, p, buffer_cols, 2);
+  StochTree::ForestDataset byte_dataset = StochTree::ForestDataset();
+  byte_dataset.AddCovariatesStrided(byte_buffer.data(), n, p, buffer_cols, 2, true);
+  StochTree::ForestDataset reversed_dataset = StochTree::ForestDataset();
+  reversed_dataset.AddCovariatesStrided(bool_buffer.get() + (n - 1) * buffer_cols, n, p, -buffer_cols, 2);
+  reversed_dataset.AddBasisStrided(int_buffer.data(), n, 1, buffer_cols, 1);
+  ASSERT_FALSE(int_dataset.HasSinglePrecisionCovariates());
+  ASSERT_TRUE(byte_dataset.HasSinglePrecisionCovariates());
+  ASSERT_EQ(reversed_dataset.NumBasis(), 1);
+  for (data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(int_dataset.CovariateValue(i, j), static_cast<double>(int_buffer[i * buffer_cols + 2 * j]));
+      ASSERT_EQ(byte_dataset.CovariateValue(i, j), static_cast<double>(byte_buffer[i * buffer_cols + 2 * j]));
+      ASSERT_EQ(reversed_dataset.CovariateValue(i, j), bool_buffer[(n - 1 - i) * buffer_cols + 2 * j] ? 1.0 : 0.0);
+    }
+    ASSERT_EQ(reversed_dataset.BasisValue(i, 0), static_cast<double>(int_buffer[i * buffer_cols]));
+  }
+}
+
+TEST(Data, CategoryEncoder) {
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = 40000;
+  double missing = std::numeric_limits<double>::quiet_NaN();
+  std::vector<std::string> labels = {"red", "green", "blue"};
+  std::vector<std::string> string_storage(n);
+  std::vector<char const*> strings(n);
+  std::vector<double> integers(n);
+  for (data_size_t i = 0; i < n; i++) {
+    string_storage[i] = labels[i % 3];
+    strings[i] = (i % 7 == 0) ? nullptr : string_storage[i].c_str();
+    integers[i] = (i % 11 == 0) ? missing : static_cast<double>(10 * (i % 4) - 5);
+  }
+
+  // Levels are sorted, whatever the number of threads
+  StochTree::CategoryEncoder encoder;
+  int color = encoder.AddFeature(StochTree::FeatureType::kUnorderedCategorical, "color");
+  int size = encoder.AddFeature(StochTree::FeatureType::kOrderedCategorical, "size");
+  encoder.GetDictionary(color).FitStrings(strings.data(), n, 4);
+  encoder.GetDictionary(size).FitIntegers(integers.data(), n, 4);
+  ASSERT_EQ(encoder.GetDictionary(color).StringLevels(), std::vector<std::string>({"blue", "green", "red"}));
+  ASSERT_EQ(encoder.GetDictionary(size).IntegerLevels(), std::vector<std::int64_t>({-5, 5, 15, 25}));
+
+  // Non-integer values are rejected once the parallel fit has joined
+  std::vector<double> fractional(integers);
+  fractional[n - 3] = 2.5;
+  StochTree::CategoryDictionary fractional_dictionary;
+  ASSERT_THROW(fractional_dictionary.FitIntegers(fractional.data(), n, 4), std::runtime_error);
+
+  // Encode new data into the columns of a row-major matrix, with one and four threads
+  std::vector<char const*> new_strings = {"green", "purple", nullptr, "blue"};
+  std::vector<double> new_integers = {25., 7., -5., missing};
+  std::vector<double> serial_codes(8), parallel_codes(8);
+  encoder.GetDictionary(color).EncodeStrings(new_strings.data(), 4, serial_codes.data(), 2, 1);
+  encoder.GetDictionary(size).EncodeIntegers(new_integers.data(), 4, serial_codes.data() + 1, 2, 1);
+  encoder.GetDictionary(color).EncodeStrings(new_strings.data(), 4, parallel_codes.data(), 2, 4);
+  encoder.GetDictionary(size).EncodeIntegers(new_integers.data(), 4, parallel_codes.data() + 1, 2, 4);
+  std::vector<double> expected_codes = {1., 3., 3., 4., missing, 0., 0., missing};
+  for (int i = 0; i < 8; i++) {
+    if (std::isnan(expected_codes[i])) {
+      ASSERT_TRUE(std::isnan(serial_codes[i]));
+      ASSERT_TRUE(std::isnan(parallel_codes[i]));
+    } else {
+      ASSERT_EQ(serial_codes[i], expected_codes[i]);
+      ASSERT_EQ(parallel_codes[i], expected_codes[i]);
+    }
+  }
+
+  // One-hot encoding, with a last column for unseen levels
+  std::vector<double> color_codes = {1., 3., missing, 0.};
+  std::vector<double> one_hot(16, -1.);
+  encoder.GetDictionary(color).OneHot(color_codes.data(), 4, one_hot.data());
+  std::vector<double> expected_one_hot = {0., 0., 0., 1., 1., 0., 0., 0., 0., 0., 0., 0., 0., 1., 0., 0.};
+  ASSERT_EQ(one_hot, expected_one_hot);
+
+  // JSON round trip
+  StochTree::CategoryEncoder restored;
+  restored.from_json(nlohmann::json::parse(encoder.to_json().dump()));
+  ASSERT_EQ(restored.NumFeatures(), 2);
+  ASSERT_EQ(restored.GetFeatureName(color), "color");
+  ASSERT_EQ(restored.GetFeatureType(size), StochTree::FeatureType::kOrderedCategorical);
+  ASSERT_EQ(restored.GetDictionary(color).StringLevels(), encoder.GetDictionary(color).StringLevels());
+  ASSERT_FALSE(restored.GetDictionary(size).IsStringFeature());
+  ASSERT_EQ(restored.GetDictionary(size).Code(15.), 2.);
+  ASSERT_EQ(restored.GetDictionary(color).Code("red"), 2.);
+}
+
+namespace {
+
+/*! \brief Arrow column (or dictionary) built by hand, with the buffers it points to */
+struct TestArrowColumn {
+  ArrowSchema schema{};
+  ArrowArray array{};
+  std::vector<const void*> buffers;
+};
+
+void ReleaseTestArrowArray(ArrowArray* array) {
+  *static_cast<int*>(array->private_data) += 1;
+  array->release = nullptr;
+}
+
+/*! \brief Point `column` at `buffers`, with `length` values starting at `offset` */
+void InitTestArrowColumn(TestArrowColumn& column, const char* format, const char* name, std::vector<const void*> buffers,
+                         int64_t length, int64_t null_count = 0, int64_t offset = 0) {
+  column.buffers = buffers;
+  column.schema.format = format;
+  column.schema.name = name;
+  column.array.length = length;
+  column.array.null_count = null_count;
+  column.array.offset = offset;
+  column.array.n_buffers = static_cast<int64_t>(column.buffers.size());
+  column.array.buffers = column.buffers.data();
+}
+
+} // namespace
+
+TEST(Data, ArrowDatasetImporter) {
+  using data_size_t = StochTree::data_size_t;
+  data_size_t n = 6;
+  double missing = std::numeric_limits<double>::quiet_NaN();
+
+  // A double column with a null in row 2, an int32 column starting at offset 1, a boolean column, a dictionary-encoded
+  // column with a null in row 4 and an outcome column
+  std::vector<double> x_double = {1.5, 2., 3., 4., 5., 6.};
+  std::uint8_t x_double_validity = 0x3B;
+  std::vector<std::int32_t> x_int = {0, 10, -20, 30, 40, 50, 60};
+  std::uint8_t flag_bits = 0x25;
+  std::vector<std::int8_t> color_indices = {0, 1, 2, 1, 0, 2};
+  std::uint8_t color_validity = 0x2F;
+  std::vector<std::int32_t> color_offsets = {0, 3, 8, 12};
+  std::string color_characters = "redgreenblue";
+  std::vector<double> y = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6};
+  TestArrowColumn columns[5];
+  TestArrowColumn color_dictionary;
+  InitTestArrowColumn(columns[0], "g", "x_double", {&x_double_validity, x_double.data()}, n, 1);
+  InitTestArrowColumn(columns[1], "i", "x_int", {nullptr, x_int.data()}, n + 1, 0, 1);
+  InitTestArrowColumn(columns[2], "b", "flag", {nullptr, &flag_bits}, n);
+  InitTestArrowColumn(columns[3], "c", "color", {&color_validity, color_indices.data()}, n, 1);
+  InitTestArrowColumn(color_dictionary, "u", nullptr, {nullptr, color_offsets.data(), color_characters.data()}, 3);
+  columns[3].schema.dictionary = &color_dictionary.schema;
+  columns[3].array.dictionary = &color_dictionary.array;
+  InitTestArrowColumn(columns[4], "g", "y", {nullptr, y.data()}, n);
+
+  std::vector<ArrowSchema*> child_schemas;
+  std::vector<ArrowArray*> child_arrays;
+  for (auto& column : columns) {
+    child_schemas.push_back(&column.schema);
+    child_arrays.push_back(&column.array);
+  }
+  int release_count = 0;
+  const void* batch_buffers[1] = {nullptr};
+  ArrowSchema batch_schema{};
+  batch_schema.format = "+s";
+  batch_schema.n_children = 5;
+  batch_schema.children = child_schemas.data();
+  ArrowArray batch{};
+  batch.length = n;
+  batch.n_buffers = 1;
+  batch.buffers = batch_buffers;
+  batch.n_children = 5;
+  batch.children = child_arrays.data();
+  batch.release = ReleaseTestArrowArray;
+  batch.private_data = &release_count;
+
+  // Every covariate is converted, so the record batch is released by Import
+  StochTree::ArrowDatasetConfig config;
+  config.outcome_column = 4;
+  config.num_threads = 2;
+  StochTree::ArrowDatasetImporter importer(config);
+  StochTree::ForestDataset dataset;
+  importer.Import(&batch, &batch_schema, dataset);
+  ASSERT_EQ(batch.release, nullptr);
+  ASSERT_EQ(release_count, 1);
+  ASSERT_EQ(dataset.NumObservations(), n);
+  ASSERT_EQ(dataset.NumCovariates(), 4);
+  std::vector<StochTree::FeatureType> expected_types = {StochTree::FeatureType::kNumeric, StochTree::FeatureType::kNumeric,
+                                                        StochTree::FeatureType::kOrderedCategorical, StochTree::FeatureType::kUnorderedCategorical};
+  ASSERT_EQ(importer.FeatureTypes(), expected_types);
+  ASSERT_EQ(importer.CovariateNames(), std::vector<std::string>({"x_double", "x_int", "flag", "color"}));
+  ASSERT_EQ(importer.CategoryLabels(3), std::vector<std::string>({"red", "green", "blue"}));
+  ASSERT_EQ(importer.Outcome(), y);
+  std::vector<double> expected_flags = {1., 0., 1., 0., 0., 1.};
+  std::vector<double> expected_colors = {0., 1., 2., 1., missing, 2.};
+  for (data_size_t i = 0; i < n; i++) {
+    if (i == 2) {
+      ASSERT_TRUE(std::isnan(dataset.CovariateValue(i, 0)));
+    } else {
+      ASSERT_EQ(dataset.CovariateValue(i, 0), x_double[i]);
+    }
+    ASSERT_EQ(dataset.CovariateValue(i, 1), static_cast<double>(x_int[i + 1]));
+    ASSERT_EQ(dataset.CovariateValue(i, 2), expected_flags[i]);
+    if (i == 4) {
+      ASSERT_TRUE(std::isnan(dataset.CovariateValue(i, 3)));
+    } else {
+      ASSERT_EQ(dataset.CovariateValue(i, 3), expected_colors[i]);
+    }
+  }
+
+  // Two double columns laid out as one column-major matrix are borrowed, and released with the dataset
+  std::vector<double> matrix = {1., 2., 3., 4., 5., 6., 7., 8., 9., 10., 11., 12.};
+  TestArrowColumn matrix_columns[2];
+  InitTestArrowColumn(matrix_columns[0], "g", "a", {nullptr, matrix.data()}, n);
+  InitTestArrowColumn(matrix_columns[1], "g", "b", {nullptr, matrix.data() + n}, n);
+  ArrowSchema* matrix_schemas[2] = {&matrix_columns[0].schema, &matrix_columns[1].schema};
+  ArrowArray* matrix_arrays[2] = {&matrix_columns[0].array, &matrix_columns[1].array};
+  batch_schema.n_children = 2;
+  batch_schema.children = matrix_schemas;
+  batch.n_children = 2;
+  batch.children = matrix_arrays;
+  batch.release = ReleaseTestArrowArray;
+  release_count = 0;
+  {
+    StochTree::ArrowDatasetImporter matrix_importer((StochTree::ArrowDatasetConfig()));
+    StochTree::ForestDataset matrix_dataset;
+    matrix_importer.Import(&batch, &batch_schema, matrix_dataset);
+    ASSERT_EQ(release_count, 0);
+    matrix[7] = -8.;
+    ASSERT_EQ(matrix_dataset.CovariateValue(1, 1), -8.);
+    ASSERT_EQ(matrix_dataset.CovariateValue(5, 0), 6.);
+  }
+  ASSERT_EQ(release_count, 1);
+}
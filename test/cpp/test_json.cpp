@@ -66,6 +66,14 @@ TEST(Json, TreeUnivariateLeafCategoricalSplit) {
 
   // Check that trees are the same
   ASSERT_EQ(tree, tree_parsed);
+
+  // Check that the encoded category sets are rebuilt from the serialized category lists
+  for (double value : {1., 2., 3., 7., 8.}) {
+    ASSERT_EQ(tree.CategorySplitSet(0).Contains(value), tree_parsed.CategorySplitSet(0).Contains(value));
+    ASSERT_EQ(tree.CategorySplitSet(1).Contains(value), tree_parsed.CategorySplitSet(1).Contains(value));
+  }
+  ASSERT_TRUE(tree_parsed.CategorySplitSet(0).Contains(7.));
+  ASSERT_FALSE(tree_parsed.CategorySplitSet(1).Contains(7.));
 }
 
 TEST(Json, TreeMultivariateLeaf) {
@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
 #include <testutils.h>
+#include <stochtree/container.h>
 #include <stochtree/cutpoint_candidates.h>
 #include <stochtree/leaf_model.h>
 #include <stochtree/log.h>
 #include <stochtree/partition_tracker.h>
+#include <stochtree/tree_sampler.h>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -235,3 +238,281 @@ TEST(LeafUnivariateRegressionModel, CutpointThinning) {
     ASSERT_NEAR(log_cutpoint_evaluations[i], expected_split_evals[i], 0.01);
   }
 }
+
+/*! \brief Run GFR and MCMC iterations of a forest sampler, returning the test set predictions recorded by the tracker */
+template <typename LeafModel>
+static std::vector<double> SampleWithTestSet(StochTree::TestUtils::TestDataset& test_dataset, LeafModel& leaf_model, bool leaf_constant, 
+                                             StochTree::ForestDataset& test_set, StochTree::ForestContainer& forest_samples, 
+                                             bool cache_tree_predictions = true) {
+  StochTree::data_size_t n = test_dataset.n;
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  std::vector<double> variable_weights(test_dataset.x_cols, 1./test_dataset.x_cols);
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  if (!leaf_constant) dataset.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+  StochTree::ColumnVector residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::ForestTracker tracker = StochTree::ForestTracker(dataset.GetCovariates(), feature_types, forest_samples.NumTrees(), n, 
+                                                              nullptr, cache_tree_predictions);
+  tracker.AddTestSet(test_set);
+  StochTree::TreePrior tree_prior = StochTree::TreePrior(0.95, 1.25, 1);
+  std::mt19937 gen(1234);
+
+  StochTree::GFRForestSampler<LeafModel> gfr_sampler = StochTree::GFRForestSampler<LeafModel>(n);
+  for (int i = 0; i < 3; i++) {
+    gfr_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1., feature_types);
+  }
+  StochTree::MCMCForestSampler<LeafModel> mcmc_sampler = StochTree::MCMCForestSampler<LeafModel>();
+  for (int i = 0; i < 20; i++) {
+    mcmc_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1.);
+  }
+  EXPECT_EQ(tracker.NumTestSetPredictions(), forest_samples.NumSamples());
+
+  // Each leaf of the last forest holds exactly the held-out observations that the tree routes to it
+  StochTree::TreeEnsemble* ensemble = forest_samples.GetEnsemble(forest_samples.NumSamples() - 1);
+  StochTree::UnsortedNodeSampleTracker* test_tracker = tracker.GetTestNodeSampleTracker();
+  for (int j = 0; j < forest_samples.NumTrees(); j++) {
+    StochTree::Tree* tree = ensemble->GetTree(j);
+    StochTree::data_size_t num_routed = 0;
+    for (int leaf : tree->GetLeaves()) {
+      for (auto it = test_tracker->NodeBeginIterator(j, leaf); it != test_tracker->NodeEndIterator(j, leaf); it++) {
+        EXPECT_EQ(StochTree::EvaluateTree(*tree, test_set.GetCovariates(), *it), leaf);
+        num_routed++;
+      }
+    }
+    EXPECT_EQ(num_routed, test_set.NumObservations());
+  }
+  return tracker.GetTestSetPredictions();
+}
+
+TEST(ForestTracker, TestSetPredictions) {
+  // Load test data, and use a copy with missing values as the held-out set
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  StochTree::data_size_t n = test_dataset.n;
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> test_covariates = test_dataset.covariates;
+  for (int i = 0; i < n; i += 7) test_covariates(i, i % test_dataset.x_cols) = std::numeric_limits<double>::quiet_NaN();
+
+  // Constant leaf model
+  StochTree::ForestDataset test_set = StochTree::ForestDataset();
+  test_set.AddCovariates(test_covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  StochTree::ForestContainer constant_forests(5, 1, true);
+  StochTree::GaussianConstantLeafModel constant_model(1.);
+  std::vector<double> tracked = SampleWithTestSet(test_dataset, constant_model, true, test_set, constant_forests);
+  std::vector<double> expected = constant_forests.Predict(test_set);
+  ASSERT_EQ(tracked.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(tracked[i], expected[i]);
+  }
+
+  // Without cached tree predictions, the held-out predictions are summed from the leaves when they are recorded
+  StochTree::ForestContainer uncached_constant_forests(5, 1, true);
+  tracked = SampleWithTestSet(test_dataset, constant_model, true, test_set, uncached_constant_forests, false);
+  expected = uncached_constant_forests.Predict(test_set);
+  ASSERT_EQ(tracked.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(tracked[i], expected[i]);
+  }
+
+  // Univariate leaf regression model
+  StochTree::ForestDataset test_set_basis = StochTree::ForestDataset();
+  test_set_basis.AddCovariates(test_covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  test_set_basis.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+  StochTree::ForestContainer regression_forests(5, 1, false);
+  StochTree::GaussianUnivariateRegressionLeafModel regression_model(1.);
+  tracked = SampleWithTestSet(test_dataset, regression_model, false, test_set_basis, regression_forests);
+  expected = regression_forests.Predict(test_set_basis);
+  ASSERT_EQ(tracked.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(tracked[i], expected[i]);
+  }
+  StochTree::ForestContainer uncached_regression_forests(5, 1, false);
+  tracked = SampleWithTestSet(test_dataset, regression_model, false, test_set_basis, uncached_regression_forests, false);
+  expected = uncached_regression_forests.Predict(test_set_basis);
+  ASSERT_EQ(tracked.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(tracked[i], expected[i]);
+  }
+}
+
+template <typename LeafModel>
+static std::vector<double> SampleResidual(StochTree::TestUtils::TestDataset& test_dataset, LeafModel& leaf_model, bool leaf_constant, 
+                                          bool cache_tree_predictions, StochTree::ForestContainer& forest_samples) {
+  StochTree::data_size_t n = test_dataset.n;
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  std::vector<double> variable_weights(test_dataset.x_cols, 1./test_dataset.x_cols);
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  if (!leaf_constant) dataset.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+  StochTree::ColumnVector residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::ForestTracker tracker = StochTree::ForestTracker(dataset, feature_types, forest_samples.NumTrees(), n, cache_tree_predictions);
+  EXPECT_EQ(tracker.CachesTreePredictions(), cache_tree_predictions);
+  StochTree::TreePrior tree_prior = StochTree::TreePrior(0.95, 1.25, 1);
+  std::mt19937 gen(1234);
+
+  StochTree::GFRForestSampler<LeafModel> gfr_sampler = StochTree::GFRForestSampler<LeafModel>(n);
+  for (int i = 0; i < 3; i++) {
+    gfr_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1., feature_types);
+  }
+  StochTree::MCMCForestSampler<LeafModel> mcmc_sampler = StochTree::MCMCForestSampler<LeafModel>();
+  for (int i = 0; i < 20; i++) {
+    mcmc_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1.);
+  }
+  std::vector<double> output(n);
+  for (StochTree::data_size_t i = 0; i < n; i++) output[i] = residual.GetElement(i);
+  return output;
+}
+
+TEST(ForestTracker, UncachedTreePredictions) {
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+
+  // Constant leaf model: a tracker that recomputes tree predictions from leaf ids samples the same forests 
+  // (each run gets its own leaf model, as leaf models hold the state of their normal samplers)
+  StochTree::ForestContainer cached_forests(5, 1, true);
+  StochTree::ForestContainer uncached_forests(5, 1, true);
+  StochTree::GaussianConstantLeafModel cached_constant_model(1.);
+  StochTree::GaussianConstantLeafModel uncached_constant_model(1.);
+  std::vector<double> cached = SampleResidual(test_dataset, cached_constant_model, true, true, cached_forests);
+  std::vector<double> uncached = SampleResidual(test_dataset, uncached_constant_model, true, false, uncached_forests);
+  ASSERT_EQ(cached.size(), uncached.size());
+  for (size_t i = 0; i < cached.size(); i++) {
+    ASSERT_EQ(cached[i], uncached[i]);
+  }
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), test_dataset.n, test_dataset.x_cols, test_dataset.row_major);
+  std::vector<double> cached_preds = cached_forests.Predict(dataset);
+  std::vector<double> uncached_preds = uncached_forests.Predict(dataset);
+  ASSERT_EQ(cached_preds.size(), uncached_preds.size());
+  for (size_t i = 0; i < cached_preds.size(); i++) {
+    ASSERT_EQ(cached_preds[i], uncached_preds[i]);
+  }
+
+  // Univariate leaf regression model
+  StochTree::ForestContainer cached_regression_forests(5, 1, false);
+  StochTree::ForestContainer uncached_regression_forests(5, 1, false);
+  StochTree::GaussianUnivariateRegressionLeafModel cached_regression_model(1.);
+  StochTree::GaussianUnivariateRegressionLeafModel uncached_regression_model(1.);
+  cached = SampleResidual(test_dataset, cached_regression_model, false, true, cached_regression_forests);
+  uncached = SampleResidual(test_dataset, uncached_regression_model, false, false, uncached_regression_forests);
+  for (size_t i = 0; i < cached.size(); i++) {
+    ASSERT_EQ(cached[i], uncached[i]);
+  }
+  dataset.AddBasis(test_dataset.omega.data(), test_dataset.n, test_dataset.omega_cols, test_dataset.row_major);
+  cached_preds = cached_regression_forests.Predict(dataset);
+  uncached_preds = uncached_regression_forests.Predict(dataset);
+  for (size_t i = 0; i < cached_preds.size(); i++) {
+    ASSERT_EQ(cached_preds[i], uncached_preds[i]);
+  }
+}
+
+/*! 
+ * \brief Sample a univariate leaf regression forest, rescale its basis between sweeps (as BCF's adaptive coding does) 
+ *        and keep sampling, returning the final residual. If `sync_residual`, the forest is added back to the residual 
+ *        under the old basis and subtracted under the new one.
+ */
+static std::vector<double> SampleWithBasisUpdate(StochTree::TestUtils::TestDataset& test_dataset, bool cache_tree_predictions, bool sync_residual) {
+  StochTree::data_size_t n = test_dataset.n;
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  std::vector<double> variable_weights(test_dataset.x_cols, 1./test_dataset.x_cols);
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+  StochTree::ColumnVector residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::ForestContainer forest_samples(5, 1, false);
+  StochTree::ForestTracker tracker = StochTree::ForestTracker(dataset, feature_types, forest_samples.NumTrees(), n, cache_tree_predictions);
+  StochTree::TreePrior tree_prior = StochTree::TreePrior(0.95, 1.25, 1);
+  StochTree::GaussianUnivariateRegressionLeafModel leaf_model(1.);
+  std::mt19937 gen(1234);
+
+  StochTree::MCMCForestSampler<StochTree::GaussianUnivariateRegressionLeafModel> mcmc_sampler;
+  for (int i = 0; i < 10; i++) {
+    mcmc_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1.);
+  }
+  StochTree::TreeEnsemble* forest = forest_samples.GetEnsemble(forest_samples.NumSamples() - 1);
+  if (sync_residual) StochTree::UpdateResidualEntireForest(tracker, dataset, residual, forest, true, std::plus<double>());
+  std::vector<double> new_basis(test_dataset.omega.data(), test_dataset.omega.data() + n * test_dataset.omega_cols);
+  for (double& value : new_basis) value = 2. * value - 0.5;
+  dataset.UpdateBasis(new_basis.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+  if (sync_residual) StochTree::UpdateResidualEntireForest(tracker, dataset, residual, forest, true, std::minus<double>());
+  for (int i = 0; i < 10; i++) {
+    mcmc_sampler.SampleOneIter(tracker, forest_samples, leaf_model, dataset, residual, tree_prior, gen, variable_weights, 1.);
+  }
+  std::vector<double> output(n);
+  for (StochTree::data_size_t i = 0; i < n; i++) output[i] = residual.GetElement(i);
+  return output;
+}
+
+TEST(ForestTracker, UncachedTreePredictionsBasisUpdate) {
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+
+  // A basis update that is propagated to the residual leaves both modes identical
+  std::vector<double> cached = SampleWithBasisUpdate(test_dataset, true, true);
+  std::vector<double> uncached = SampleWithBasisUpdate(test_dataset, false, true);
+  ASSERT_EQ(cached.size(), uncached.size());
+  for (size_t i = 0; i < cached.size(); i++) {
+    ASSERT_EQ(cached[i], uncached[i]);
+  }
+
+  // If the residual still holds the forest's predictions under the old basis, a tracker that caches tree predictions 
+  // adds back those stale predictions before resampling a tree, while one that recomputes them uses the new basis
+  cached = SampleWithBasisUpdate(test_dataset, true, false);
+  uncached = SampleWithBasisUpdate(test_dataset, false, false);
+  bool any_different = false;
+  for (size_t i = 0; i < cached.size(); i++) {
+    if (cached[i] != uncached[i]) any_different = true;
+  }
+  ASSERT_TRUE(any_different);
+}
+
+TEST(ForestTracker, UpdateResidualEntireForest) {
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  StochTree::data_size_t n = test_dataset.n;
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  std::vector<double> variable_weights(test_dataset.x_cols, 1./test_dataset.x_cols);
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+  StochTree::TreePrior tree_prior = StochTree::TreePrior(0.95, 1.25, 1);
+  std::mt19937 gen(1234);
+
+  // Sample constant leaf and univariate leaf regression forests, leaving each tracker at the last sample
+  StochTree::ForestContainer constant_forests(5, 1, true);
+  StochTree::ForestContainer regression_forests(5, 1, false);
+  StochTree::ForestTracker constant_tracker = StochTree::ForestTracker(dataset, feature_types, 5, n);
+  StochTree::ForestTracker regression_tracker = StochTree::ForestTracker(dataset, feature_types, 5, n);
+  StochTree::GaussianConstantLeafModel constant_model(1.);
+  StochTree::GaussianUnivariateRegressionLeafModel regression_model(1.);
+  StochTree::ColumnVector constant_residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::ColumnVector regression_residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::GFRForestSampler<StochTree::GaussianConstantLeafModel> constant_sampler(n);
+  StochTree::GFRForestSampler<StochTree::GaussianUnivariateRegressionLeafModel> regression_sampler(n);
+  for (int i = 0; i < 2; i++) {
+    constant_sampler.SampleOneIter(constant_tracker, constant_forests, constant_model, dataset, constant_residual, tree_prior, gen, variable_weights, 1., feature_types);
+    regression_sampler.SampleOneIter(regression_tracker, regression_forests, regression_model, dataset, regression_residual, tree_prior, gen, variable_weights, 1., feature_types);
+  }
+
+  // Subtracting a constant leaf forest from the outcome in one call matches the outcome minus PredictRaw, 
+  // and the tracked predictions of each observation's trees sum to its prediction
+  int forest_num = constant_forests.NumSamples() - 1;
+  StochTree::ColumnVector residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::UpdateResidualEntireForest(constant_tracker, dataset, residual, constant_forests.GetEnsemble(forest_num), false, std::minus<double>());
+  std::vector<double> expected = constant_forests.PredictRawSingleForest(dataset, forest_num);
+  ASSERT_EQ(expected.size(), static_cast<size_t>(n));
+  for (StochTree::data_size_t i = 0; i < n; i++) {
+    ASSERT_EQ(residual.GetElement(i), test_dataset.outcome(i) - expected[i]);
+    double tree_sum = 0.;
+    for (int j = 0; j < constant_forests.NumTrees(); j++) tree_sum += constant_tracker.GetTreeSamplePrediction(i, j);
+    ASSERT_EQ(tree_sum, expected[i]);
+  }
+
+  // Leaf regression forests scale each tree's raw leaf value by the basis before it is subtracted
+  forest_num = regression_forests.NumSamples() - 1;
+  residual = StochTree::ColumnVector(test_dataset.outcome.data(), n);
+  StochTree::UpdateResidualEntireForest(regression_tracker, dataset, residual, regression_forests.GetEnsemble(forest_num), true, std::minus<double>());
+  expected = regression_forests.PredictRawSingleForest(dataset, forest_num);
+  for (StochTree::data_size_t i = 0; i < n; i++) {
+    ASSERT_NEAR(residual.GetElement(i), test_dataset.outcome(i) - expected[i] * test_dataset.omega(i, 0), 1e-12);
+  }
+}
@@ -3,12 +3,21 @@
  */
 #include <gtest/gtest.h>
 #include <testutils.h>
+#include <stochtree/codegen.h>
+#include <stochtree/compiled_forest.h>
+#include <stochtree/container.h>
 #include <stochtree/data.h>
 #include <stochtree/ensemble.h>
+#include <stochtree/predict_kernel.h>
+#include <stochtree/prediction_summary.h>
 #include <stochtree/tree.h>
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <random>
 
 /*! \brief Test forest prediction procedures for trees with constants in leaf nodes */
 TEST(Ensemble, PredictConstant) {
@@ -116,3 +125,510 @@ TEST(Ensemble, PredictMultivariateRegression) {
     ASSERT_NEAR(expected_pred[i], result[i], 0.01);
   }
 }
+
+/*! \brief Test that multithreaded forest container prediction matches single-threaded prediction */
+TEST(ForestContainer, PredictMultithreaded) {
+  // Load test data
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+
+  // Construct datasets
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), test_dataset.n, test_dataset.omega_cols, test_dataset.row_major);
+
+  // Create a container of several univariate regression forests with different split rules
+  int num_samples = 5;
+  int num_trees = 3;
+  int output_dim = 1;
+  bool is_leaf_constant = false;
+  StochTree::ForestContainer forest_samples(num_trees, output_dim, is_leaf_constant);
+  forest_samples.AddSamples(num_samples);
+  for (int i = 0; i < num_samples; i++) {
+    for (int j = 0; j < num_trees; j++) {
+      auto* tree = forest_samples.GetEnsemble(i)->GetTree(j);
+      int split_feature = (i + j) % test_dataset.x_cols;
+      double split_value = 0.2 + 0.1*((i + 2*j) % 7);
+      StochTree::TreeSplit root_split = StochTree::TreeSplit(split_value);
+      StochTree::TreeSplit left_split = StochTree::TreeSplit(0.5);
+      tree->ExpandNode(0, split_feature, root_split, -1.0 - i + j, 1.0 + i - j);
+      tree->ExpandNode(1, (split_feature + 1) % test_dataset.x_cols, left_split, 0.5*i, -0.5*j);
+    }
+  }
+
+  // Predictions must be identical regardless of the number of threads
+  std::vector<double> serial_pred = forest_samples.Predict(dataset, 1);
+  std::vector<double> serial_raw = forest_samples.PredictRaw(dataset);
+  ASSERT_EQ(serial_pred.size(), n*num_samples);
+  ASSERT_EQ(serial_raw.size(), n*output_dim*num_samples);
+  for (int num_threads : {2, 4, 0}) {
+    std::vector<double> parallel_pred = forest_samples.Predict(dataset, num_threads);
+    std::vector<double> parallel_raw = forest_samples.PredictRaw(dataset, num_threads);
+    for (int i = 0; i < serial_pred.size(); i++) {
+      ASSERT_EQ(serial_pred[i], parallel_pred[i]);
+    }
+    for (int i = 0; i < serial_raw.size(); i++) {
+      ASSERT_EQ(serial_raw[i], parallel_raw[i]);
+    }
+  }
+}
+
+/*! \brief Test that a compiled forest container reproduces the predictions of the forest container it was built from */
+TEST(CompiledForestContainer, PredictConstant) {
+  // Load test data and introduce a missing value
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  test_dataset.covariates(3, 0) = std::numeric_limits<double>::quiet_NaN();
+
+  // Construct datasets
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+
+  // Create a container of constant-leaf forests with numeric and categorical splits
+  int num_samples = 3;
+  int num_trees = 4;
+  StochTree::ForestContainer forest_samples(num_trees, 1, true);
+  forest_samples.AddSamples(num_samples);
+  std::vector<std::uint32_t> categories{0};
+  for (int i = 0; i < num_samples; i++) {
+    for (int j = 0; j < num_trees; j++) {
+      auto* tree = forest_samples.GetEnsemble(i)->GetTree(j);
+      tree->ExpandNode(0, j % test_dataset.x_cols, 0.3 + 0.1*i, -1.0 - j, 1.0 + j);
+      tree->ExpandNode(2, (j + 1) % test_dataset.x_cols, 0.6, 0.5*i, -0.5*j);
+      tree->ExpandNode(1, 4, categories, 2.0, -2.0);
+      if (j % 2 == 0) {
+        // Pruning leaves deleted nodes behind in the tree's node arrays
+        tree->ChangeToLeaf(2, 0.25*j);
+      }
+    }
+  }
+
+  // Deleted nodes are dropped when compiling
+  StochTree::CompiledForestContainer compiled_forest(forest_samples);
+  int64_t num_valid_nodes = 0;
+  for (int i = 0; i < num_samples; i++) {
+    for (int j = 0; j < num_trees; j++) {
+      num_valid_nodes += forest_samples.GetEnsemble(i)->GetTree(j)->NumValidNodes();
+    }
+  }
+  ASSERT_EQ(compiled_forest.NumNodes(), num_valid_nodes);
+  ASSERT_EQ(compiled_forest.NumSamples(), num_samples);
+
+  std::vector<double> expected_pred = forest_samples.Predict(dataset);
+  std::vector<double> expected_raw = forest_samples.PredictRaw(dataset);
+  std::vector<double> compiled_pred = compiled_forest.Predict(dataset, 2);
+  std::vector<double> compiled_raw = compiled_forest.PredictRaw(dataset);
+  ASSERT_EQ(expected_pred.size(), compiled_pred.size());
+  ASSERT_EQ(expected_raw.size(), compiled_raw.size());
+  for (int i = 0; i < expected_pred.size(); i++) {
+    ASSERT_EQ(expected_pred[i], compiled_pred[i]);
+    ASSERT_EQ(expected_raw[i], compiled_raw[i]);
+  }
+}
+
+/*! \brief Test compiled forest prediction for trees with a multivariate regression in leaf nodes */
+TEST(CompiledForestContainer, PredictMultivariateRegression) {
+  // Load test data
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadSmallDatasetMultivariateBasis();
+
+  // Construct datasets
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), test_dataset.n, test_dataset.omega_cols, test_dataset.row_major);
+
+  // Create a container of multivariate leaf regression forests
+  int num_samples = 2;
+  int num_trees = 2;
+  int output_dim = 2;
+  StochTree::ForestContainer forest_samples(num_trees, output_dim, false);
+  forest_samples.AddSamples(num_samples);
+  for (int i = 0; i < num_samples; i++) {
+    auto* tree = forest_samples.GetEnsemble(i)->GetTree(0);
+    tree->ExpandNode(0, 0, 0.5, std::vector<double>{-5, -2.5 + i}, std::vector<double>{5, 2.5});
+    tree = forest_samples.GetEnsemble(i)->GetTree(1);
+    tree->ExpandNode(0, 1, 0.5, std::vector<double>{-2.5, -1.25}, std::vector<double>{2.5 + i, 1.25});
+    tree->ExpandNode(1, 2, 0.25, std::vector<double>{1.0, -1.0}, std::vector<double>{-1.0, 1.0});
+  }
+
+  StochTree::CompiledForestContainer compiled_forest(forest_samples);
+  std::vector<double> expected_pred = forest_samples.Predict(dataset);
+  std::vector<double> expected_raw = forest_samples.PredictRaw(dataset);
+  std::vector<double> compiled_pred = compiled_forest.Predict(dataset);
+  std::vector<double> compiled_raw = compiled_forest.PredictRaw(dataset);
+  ASSERT_EQ(expected_pred.size(), compiled_pred.size());
+  ASSERT_EQ(expected_raw.size(), compiled_raw.size());
+  for (int i = 0; i < expected_pred.size(); i++) {
+    ASSERT_EQ(expected_pred[i], compiled_pred[i]);
+  }
+  for (int i = 0; i < expected_raw.size(); i++) {
+    ASSERT_EQ(expected_raw[i], compiled_raw[i]);
+  }
+  for (int i = 0; i < num_samples; i++) {
+    std::vector<double> expected_single = forest_samples.PredictRawSingleForest(dataset, i);
+    std::vector<double> compiled_single = compiled_forest.PredictRawSingleForest(dataset, i);
+    for (int j = 0; j < expected_single.size(); j++) {
+      ASSERT_EQ(expected_single[j], compiled_single[j]);
+    }
+  }
+}
+
+/*! \brief Test that every supported block traversal kernel agrees with row-by-row tree evaluation */
+TEST(PredictKernel, BlockTraversalMatchesScalar) {
+  // Load test data and introduce missing values
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  test_dataset.covariates(5, 1) = std::numeric_limits<double>::quiet_NaN();
+  test_dataset.covariates(17, 0) = std::numeric_limits<double>::quiet_NaN();
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  StochTree::DataMatrixMap& covariates = dataset.GetCovariates();
+
+  // Grow a tree of depth 4 with numeric splits and prune one subtree, leaving deleted nodes behind
+  StochTree::Tree tree;
+  tree.Init(1);
+  std::vector<int> frontier{0};
+  for (int depth = 0; depth < 4; depth++) {
+    std::vector<int> next_frontier;
+    for (int nid : frontier) {
+      int split_feature = (nid + depth) % test_dataset.x_cols;
+      tree.ExpandNode(nid, split_feature, 0.2 + 0.15*(nid % 5), -1.0*nid, 1.0*nid);
+      next_frontier.push_back(tree.LeftChild(nid));
+      next_frontier.push_back(tree.RightChild(nid));
+    }
+    frontier = next_frontier;
+  }
+  int prune_node = tree.LeftChild(tree.RightChild(tree.LeftChild(0)));
+  tree.ChangeToLeaf(prune_node, 0.5);
+
+  std::vector<std::int32_t> expected(n);
+  for (int i = 0; i < n; i++) {
+    expected[i] = StochTree::EvaluateTree(tree, covariates, i);
+  }
+  for (auto kernel : {StochTree::PredictKernel::kScalar, StochTree::PredictKernel::kAVX2, StochTree::PredictKernel::kAVX512}) {
+    if (!StochTree::PredictKernelSupported(kernel)) continue;
+    std::int32_t leaf_ids[StochTree::kPredictBlockRows];
+    for (int block_begin = 0; block_begin < n; block_begin += StochTree::kPredictBlockRows) {
+      int block_rows = std::min(StochTree::kPredictBlockRows, n - block_begin);
+      StochTree::EvaluateTreeBlock(tree, covariates, block_begin, block_rows, leaf_ids, kernel);
+      for (int r = 0; r < block_rows; r++) {
+        ASSERT_EQ(expected[block_begin + r], leaf_ids[r]);
+      }
+    }
+  }
+}
+
+/*! \brief Test that QuickScorer prediction matches tree traversal, including forests that must fall back to traversal */
+TEST(ForestContainer, PredictQuickScorer) {
+  // Load test data and introduce a missing value
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  test_dataset.covariates(7, 2) = std::numeric_limits<double>::quiet_NaN();
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), test_dataset.n, test_dataset.omega_cols, test_dataset.row_major);
+
+  // Grow trees of depth 3 with repeated split features and a pruned subtree
+  int num_samples = 3;
+  int num_trees = 5;
+  StochTree::ForestContainer forest_samples(num_trees, 1, false);
+  forest_samples.AddSamples(num_samples);
+  for (int i = 0; i < num_samples; i++) {
+    for (int j = 0; j < num_trees; j++) {
+      auto* tree = forest_samples.GetEnsemble(i)->GetTree(j);
+      std::vector<int> frontier{0};
+      for (int depth = 0; depth < 3; depth++) {
+        std::vector<int> next_frontier;
+        for (int nid : frontier) {
+          tree->ExpandNode(nid, (nid + i + j) % 3, 0.25 + 0.1*((nid + j) % 5), -0.5*nid + j, 0.5*nid - i);
+          next_frontier.push_back(tree->LeftChild(nid));
+          next_frontier.push_back(tree->RightChild(nid));
+        }
+        frontier = next_frontier;
+      }
+      tree->ChangeToLeaf(tree->RightChild(tree->RightChild(0)), 1.5);
+    }
+  }
+  // The last sample contains a categorical split, which QuickScorer does not support
+  std::vector<std::uint32_t> categories{0};
+  auto* tree = forest_samples.GetEnsemble(num_samples - 1)->GetTree(0);
+  tree->ExpandNode(tree->RightChild(tree->RightChild(0)), 4, categories, 2.0, -2.0);
+  ASSERT_TRUE(StochTree::QuickScorerEnsemble::Supports(*forest_samples.GetEnsemble(0)));
+  ASSERT_FALSE(StochTree::QuickScorerEnsemble::Supports(*forest_samples.GetEnsemble(num_samples - 1)));
+
+  std::vector<double> expected_pred = forest_samples.Predict(dataset);
+  std::vector<double> qs_pred = forest_samples.Predict(dataset, 2, StochTree::ForestPredictEngine::kQuickScorer);
+  std::vector<double> expected_raw = forest_samples.PredictRaw(dataset);
+  std::vector<double> qs_raw(expected_raw.size());
+  forest_samples.PredictRawInplace(dataset, qs_raw, 1, StochTree::ForestPredictEngine::kQuickScorer);
+  for (int i = 0; i < expected_pred.size(); i++) {
+    ASSERT_EQ(expected_pred[i], qs_pred[i]);
+  }
+  for (int i = 0; i < expected_raw.size(); i++) {
+    ASSERT_EQ(expected_raw[i], qs_raw[i]);
+  }
+
+  // Cached scorers are rebuilt for samples that are modified or added after a QuickScorer prediction
+  tree = forest_samples.GetEnsemble(0)->GetTree(1);
+  tree->SetLeaf(tree->GetLeaves()[0], 7.25);
+  forest_samples.GetEnsemble(1)->GetTree(0)->CollapseToLeaf(0, 0.5);
+  forest_samples.AddSamples(1);
+  forest_samples.CopyFromPreviousSample(num_samples, 0);
+  expected_pred = forest_samples.Predict(dataset);
+  qs_pred = forest_samples.Predict(dataset, 2, StochTree::ForestPredictEngine::kQuickScorer);
+  ASSERT_EQ(expected_pred.size(), qs_pred.size());
+  for (int i = 0; i < expected_pred.size(); i++) {
+    ASSERT_EQ(expected_pred[i], qs_pred[i]);
+  }
+}
+
+/*! \brief Test streaming posterior summaries of forest predictions against summaries of the full prediction matrix */
+TEST(ForestContainer, PredictSummary) {
+  // Load test data
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+
+  // Create many forest samples with random leaf values
+  int num_samples = 400;
+  int num_trees = 2;
+  StochTree::ForestContainer forest_samples(num_trees, 1, true);
+  forest_samples.AddSamples(num_samples);
+  std::mt19937 gen(1234);
+  std::normal_distribution<double> leaf_dist(0., 1.);
+  for (int i = 0; i < num_samples; i++) {
+    for (int j = 0; j < num_trees; j++) {
+      auto* tree = forest_samples.GetEnsemble(i)->GetTree(j);
+      tree->ExpandNode(0, j, 0.5, leaf_dist(gen), leaf_dist(gen));
+    }
+  }
+
+  // Summarize every other sample after a "burn-in" of 50 samples
+  std::vector<int> sample_indices;
+  for (int i = 50; i < num_samples; i += 2) sample_indices.push_back(i);
+  int num_kept = sample_indices.size();
+  std::vector<double> quantile_probs{0.1, 0.5, 0.9};
+  std::vector<double> mean_output, variance_output, quantile_output;
+  forest_samples.PredictSummary(dataset, sample_indices, quantile_probs, mean_output, variance_output, quantile_output, 2);
+  ASSERT_EQ(mean_output.size(), n);
+  ASSERT_EQ(variance_output.size(), n);
+  ASSERT_EQ(quantile_output.size(), n*quantile_probs.size());
+
+  std::vector<double> predictions = forest_samples.Predict(dataset);
+  for (int i = 0; i < n; i++) {
+    std::vector<double> row_pred(num_kept);
+    double mean = 0.;
+    for (int s = 0; s < num_kept; s++) {
+      row_pred[s] = predictions[sample_indices[s]*n + i];
+      mean += row_pred[s] / num_kept;
+    }
+    double variance = 0.;
+    for (int s = 0; s < num_kept; s++) {
+      variance += (row_pred[s] - mean) * (row_pred[s] - mean) / (num_kept - 1);
+    }
+    ASSERT_NEAR(mean_output[i], mean, 1e-10);
+    ASSERT_NEAR(variance_output[i], variance, 1e-10);
+
+    // Quantile estimates are approximate, so they are checked against the empirical CDF
+    std::sort(row_pred.begin(), row_pred.end());
+    for (int j = 0; j < quantile_probs.size(); j++) {
+      double estimate = quantile_output[j*n + i];
+      double empirical_prob = (std::upper_bound(row_pred.begin(), row_pred.end(), estimate) - row_pred.begin()) / static_cast<double>(num_kept);
+      ASSERT_NEAR(empirical_prob, quantile_probs[j], 0.06);
+    }
+  }
+
+  // Out-of-range sample indices are rejected
+  std::vector<int> bad_indices{num_samples};
+  ASSERT_THROW(forest_samples.PredictSummary(dataset, bad_indices, quantile_probs, mean_output, variance_output, quantile_output), std::runtime_error);
+}
+
+/*! \brief Test that P2 quantile estimates are exact order-statistic interpolations for up to five observations */
+TEST(P2QuantileEstimator, ExactForFewObservations) {
+  std::vector<double> draws{3., -1., 4., 1., 5.};
+  for (double prob : {0.1, 0.5, 0.9}) {
+    StochTree::P2QuantileEstimator estimator(prob);
+    EXPECT_TRUE(std::isnan(estimator.Quantile()));
+    for (size_t i = 0; i < draws.size(); i++) {
+      estimator.Add(draws[i]);
+      std::vector<double> sorted(draws.begin(), draws.begin() + i + 1);
+      std::sort(sorted.begin(), sorted.end());
+      double h = prob * i;
+      size_t lower = static_cast<size_t>(std::floor(h));
+      size_t upper = std::min(lower + 1, i);
+      ASSERT_DOUBLE_EQ(estimator.Quantile(), sorted[lower] + (h - lower) * (sorted[upper] - sorted[lower]));
+    }
+  }
+
+  // With five draws, the 10% and 90% quantiles lie between the two smallest and two largest draws
+  StochTree::P2QuantileEstimator lower_estimator(0.1);
+  StochTree::P2QuantileEstimator upper_estimator(0.9);
+  for (double draw : draws) {
+    lower_estimator.Add(draw);
+    upper_estimator.Add(draw);
+  }
+  ASSERT_DOUBLE_EQ(lower_estimator.Quantile(), -1. + 0.4 * (1. - (-1.)));
+  ASSERT_DOUBLE_EQ(upper_estimator.Quantile(), 4. + 0.6 * (5. - 4.));
+}
+
+/*! \brief Test the structure of C++ source generated from a forest container */
+TEST(ForestCodegen, GenerateSource) {
+  // Two single-tree forests with a numeric and a categorical split
+  int num_samples = 2;
+  StochTree::ForestContainer forest_samples(1, 1, true);
+  forest_samples.AddSamples(num_samples);
+  std::vector<std::uint32_t> categories{1, 3};
+  for (int i = 0; i < num_samples; i++) {
+    auto* tree = forest_samples.GetEnsemble(i)->GetTree(0);
+    tree->ExpandNode(0, 2, 0.5, -1.0 - i, 0.25);
+    tree->ExpandNode(2, 4, categories, 2.0, -2.0);
+  }
+
+  // Only the selected sample is written, with round-trip precision thresholds and leaf values
+  std::string source = StochTree::GenerateForestSource(forest_samples, std::vector<int>{1});
+  EXPECT_NE(source.find("STOCHTREE_MODEL_EXPORT void predict(const double* row, double* out)"), std::string::npos);
+  EXPECT_NE(source.find("stochtree_model_num_features(void) {return 5;}"), std::string::npos);
+  EXPECT_NE(source.find("stochtree_model_num_samples(void) {return 1;}"), std::string::npos);
+  EXPECT_NE(source.find("if (!(row[2] > 0.5)) {"), std::string::npos);
+  EXPECT_NE(source.find("if (std::isnan(row[4]) || CategoryMatch(row[4], {1u, 3u})) {"), std::string::npos);
+  EXPECT_NE(source.find("out[0] += -2;"), std::string::npos);
+  EXPECT_EQ(source.find("out[0] += -1;"), std::string::npos);
+  EXPECT_EQ(source.find("PredictSample1("), std::string::npos);
+
+  // An empty index vector writes every sample
+  source = StochTree::GenerateForestSource(forest_samples, std::vector<int>{});
+  EXPECT_NE(source.find("PredictSample1(row, out + 1);"), std::string::npos);
+  EXPECT_THROW(StochTree::GenerateForestSource(forest_samples, std::vector<int>{2}), std::runtime_error);
+}
+
+/*! \brief Test prediction directly from row-major buffers against prediction from a dataset */
+TEST(ForestContainer, PredictRowMajorBuffer) {
+  // Load test data and introduce a missing value
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadSmallDatasetMultivariateBasis();
+  test_dataset.covariates(2, 1) = std::numeric_limits<double>::quiet_NaN();
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), n, test_dataset.omega_cols, test_dataset.row_major);
+
+  // Constant-leaf forests with numeric and categorical splits
+  int num_samples = 2;
+  StochTree::ForestContainer constant_samples(2, 1, true);
+  constant_samples.AddSamples(num_samples);
+  std::vector<std::uint32_t> categories{0};
+  for (int i = 0; i < num_samples; i++) {
+    for (int j = 0; j < 2; j++) {
+      auto* tree = constant_samples.GetEnsemble(i)->GetTree(j);
+      tree->ExpandNode(0, j + 1, 0.4 + 0.1*i, -1.0 - j, 1.0 + i);
+      tree->ExpandNode(1, 4, categories, 0.5*j, -0.5*i);
+    }
+  }
+  std::vector<double> expected = constant_samples.Predict(dataset);
+  std::vector<double> expected_raw = constant_samples.PredictRaw(dataset);
+  std::vector<double> result(n*num_samples);
+  std::vector<double> result_raw(n*num_samples);
+  constant_samples.PredictInplace(test_dataset.covariates.data(), nullptr, n, test_dataset.x_cols, result.data());
+  constant_samples.PredictRawInplace(test_dataset.covariates.data(), n, test_dataset.x_cols, result_raw.data());
+  for (int i = 0; i < n*num_samples; i++) {
+    ASSERT_EQ(expected[i], result[i]);
+    ASSERT_EQ(expected_raw[i], result_raw[i]);
+  }
+
+  // A single row predicted on its own matches the corresponding batch prediction
+  double single_row[2];
+  constant_samples.PredictInplace(test_dataset.covariates.data() + 2*test_dataset.x_cols, nullptr, 1, test_dataset.x_cols, single_row);
+  ASSERT_EQ(single_row[0], expected[2]);
+  ASSERT_EQ(single_row[1], expected[n + 2]);
+
+  // Multivariate leaf regression forests
+  int output_dim = test_dataset.omega_cols;
+  StochTree::ForestContainer regression_samples(1, output_dim, false);
+  regression_samples.AddSamples(num_samples);
+  for (int i = 0; i < num_samples; i++) {
+    auto* tree = regression_samples.GetEnsemble(i)->GetTree(0);
+    tree->ExpandNode(0, 1, 0.5, std::vector<double>{-5, -2.5 + i}, std::vector<double>{5, 2.5});
+    tree->ExpandNode(2, 0, 0.25, std::vector<double>{1.0, -1.0}, std::vector<double>{-1.0, 1.0 + i});
+  }
+  expected = regression_samples.Predict(dataset);
+  expected_raw = regression_samples.PredictRaw(dataset);
+  result_raw.resize(n*num_samples*output_dim);
+  regression_samples.PredictInplace(test_dataset.covariates.data(), test_dataset.omega.data(), n, test_dataset.x_cols, result.data());
+  regression_samples.PredictRawInplace(test_dataset.covariates.data(), n, test_dataset.x_cols, result_raw.data());
+  for (int i = 0; i < n*num_samples; i++) {
+    ASSERT_EQ(expected[i], result[i]);
+  }
+  for (int i = 0; i < n*num_samples*output_dim; i++) {
+    ASSERT_EQ(expected_raw[i], result_raw[i]);
+  }
+}
+
+/*! \brief Test that structure-memoized prediction matches tree traversal on a chain of samples that mostly share tree structures */
+TEST(ForestContainer, PredictStructureMemoized) {
+  // Load test data and introduce a missing value
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  test_dataset.covariates(3, 1) = std::numeric_limits<double>::quiet_NaN();
+  int n = test_dataset.n;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, test_dataset.x_cols, test_dataset.row_major);
+  dataset.AddBasis(test_dataset.omega.data(), test_dataset.n, test_dataset.omega_cols, test_dataset.row_major);
+
+  // Mimic an MCMC chain: each sample copies the previous one, changes every leaf value and 
+  // occasionally grows or prunes a tree (so that a structure can reappear after a prune)
+  int num_samples = 8;
+  int num_trees = 4;
+  StochTree::ForestContainer forest_samples(num_trees, 1, false);
+  forest_samples.AddSamples(1);
+  std::vector<std::uint32_t> categories{0, 2};
+  for (int j = 0; j < num_trees; j++) {
+    auto* tree = forest_samples.GetEnsemble(0)->GetTree(j);
+    tree->ExpandNode(0, j % 3, 0.5, -1.0, 1.0);
+    tree->ExpandNode(tree->LeftChild(0), 4, categories, -0.5, 0.5);
+  }
+  for (int i = 1; i < num_samples; i++) {
+    forest_samples.AddSamples(1);
+    forest_samples.CopyFromPreviousSample(i, i - 1);
+    for (int j = 0; j < num_trees; j++) {
+      auto* tree = forest_samples.GetEnsemble(i)->GetTree(j);
+      int right = tree->RightChild(0);
+      if ((i + j) % 3 == 0) {
+        if (tree->IsLeaf(right)) tree->ExpandNode(right, 2, 0.3, 0.1*i, -0.1*j);
+        else tree->ChangeToLeaf(right, 0.2*j);
+      }
+      for (int leaf : tree->GetLeaves()) tree->SetLeaf(leaf, 0.01*(i + 1)*(leaf + j) - 0.5);
+    }
+  }
+
+  // Structure hashes ignore leaf values, and a prune restores the structure of an earlier sample
+  auto* tree_0 = forest_samples.GetEnsemble(0)->GetTree(0);
+  auto* tree_1 = forest_samples.GetEnsemble(1)->GetTree(0);
+  auto* tree_3 = forest_samples.GetEnsemble(3)->GetTree(0);
+  auto* tree_6 = forest_samples.GetEnsemble(6)->GetTree(0);
+  ASSERT_TRUE(tree_0->HasSameStructure(*tree_1));
+  ASSERT_EQ(tree_0->StructureHash(), tree_1->StructureHash());
+  ASSERT_FALSE(tree_0->HasSameStructure(*tree_3));
+  ASSERT_TRUE(tree_0->HasSameStructure(*tree_6));
+  ASSERT_EQ(tree_0->StructureHash(), tree_6->StructureHash());
+
+  std::vector<double> expected_pred = forest_samples.Predict(dataset);
+  std::vector<double> expected_raw = forest_samples.PredictRaw(dataset);
+  for (int num_threads : {1, 3}) {
+    std::vector<double> memo_pred = forest_samples.Predict(dataset, num_threads, StochTree::ForestPredictEngine::kStructureMemoized);
+    std::vector<double> memo_raw(expected_raw.size());
+    forest_samples.PredictRawInplace(dataset, memo_raw, num_threads, StochTree::ForestPredictEngine::kStructureMemoized);
+    for (int i = 0; i < expected_pred.size(); i++) {
+      ASSERT_EQ(expected_pred[i], memo_pred[i]);
+    }
+    for (int i = 0; i < expected_raw.size(); i++) {
+      ASSERT_EQ(expected_raw[i], memo_raw[i]);
+    }
+  }
+}
@@ -1,12 +1,18 @@
 #include <gtest/gtest.h>
 #include <testutils.h>
+#include <stochtree/cutpoint_candidates.h>
 #include <stochtree/data.h>
 #include <stochtree/log.h>
 #include <stochtree/meta.h>
+#include <stochtree/parallel.h>
 #include <stochtree/partition_tracker.h>
 #include <stochtree/tree.h>
+#include <atomic>
+#include <cmath>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <stdexcept>
 
 TEST(SortedNodeSampleTracker, BasicOperations) {
   // Load test data
@@ -98,3 +104,187 @@ TEST(SortedNodeSampleTracker, BasicOperations) {
   expected_result = {3,0,7,4,5};
   ASSERT_EQ(sorted_node_sampler_tracker.NodeIndices(4, 1), expected_result);
 }
+
+TEST(SortedNodeSampleTracker, ParallelPartition) {
+  // Simulate a dataset large enough for the features to be partitioned in parallel
+  StochTree::data_size_t n = 20000;
+  int p = 6;
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  std::vector<double> covariates(n * p);
+  for (StochTree::data_size_t i = 0; i < n; i++) {
+    for (int j = 0; j < p - 1; j++) covariates[i * p + j] = unif(gen);
+    covariates[i * p + p - 1] = std::floor(unif(gen) * 5);
+  }
+  std::vector<StochTree::FeatureType> feature_types(p, StochTree::FeatureType::kNumeric);
+  feature_types[p - 1] = StochTree::FeatureType::kUnorderedCategorical;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(covariates.data(), n, p, true);
+
+  // Partition the same nodes with one and with several threads
+  StochTree::FeaturePresortRootContainer presort_container(dataset.GetCovariates(), feature_types);
+  StochTree::SortedNodeSampleTracker serial_tracker(&presort_container, dataset.GetCovariates(), feature_types);
+  StochTree::SortedNodeSampleTracker parallel_tracker(&presort_container, dataset.GetCovariates(), feature_types);
+  StochTree::ThreadPool thread_pool(4);
+  parallel_tracker.SetThreadPool(&thread_pool);
+  StochTree::TreeSplit numeric_split = StochTree::TreeSplit(0.6);
+  std::vector<std::uint32_t> category_list{1, 3};
+  for (auto* tracker : {&serial_tracker, &parallel_tracker}) {
+    tracker->PartitionNode(dataset.GetCovariates(), 0, 0, numeric_split);
+    tracker->PartitionNode(dataset.GetCovariates(), 1, p - 1, category_list);
+    tracker->PartitionNode(dataset.GetCovariates(), 2, 2, 0.3);
+  }
+
+  // Every feature's sort indices are sifted identically
+  for (int node_id = 0; node_id < 7; node_id++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(serial_tracker.NodeBegin(node_id, j), parallel_tracker.NodeBegin(node_id, j));
+      ASSERT_EQ(serial_tracker.NodeEnd(node_id, j), parallel_tracker.NodeEnd(node_id, j));
+      ASSERT_EQ(serial_tracker.NodeIndices(node_id, j), parallel_tracker.NodeIndices(node_id, j));
+    }
+  }
+}
+
+TEST(ThreadPool, ReusedAcrossLoops) {
+  // The same workers run many loops, each of which visits every index exactly once
+  StochTree::ThreadPool thread_pool(4);
+  ASSERT_EQ(thread_pool.NumThreads(), 4);
+  std::vector<int> visits(1000, 0);
+  for (int rep = 0; rep < 200; rep++) {
+    thread_pool.ParallelFor(0, 1000, 7, [&](int64_t block_begin, int64_t block_end) {
+      for (int64_t i = block_begin; i < block_end; i++) visits[i]++;
+    });
+  }
+  for (int i = 0; i < 1000; i++) ASSERT_EQ(visits[i], 200);
+
+  // Exceptions thrown by a block reach the caller, and the pool remains usable
+  auto throwing_loop = [&]() {
+    thread_pool.ParallelFor(0, 100, 1, [&](int64_t block_begin, int64_t block_end) {
+      if (block_begin == 50) throw std::runtime_error("block failed");
+    });
+  };
+  ASSERT_THROW(throwing_loop(), std::runtime_error);
+  std::atomic<int64_t> total{0};
+  thread_pool.ParallelFor(0, 100, 1, [&](int64_t block_begin, int64_t block_end) {total += block_begin;});
+  ASSERT_EQ(total.load(), 4950);
+}
+
+TEST(SortedNodeSampleTracker, ResetToRoot) {
+  // Load test data
+  StochTree::TestUtils::TestDataset test_dataset;
+  test_dataset = StochTree::TestUtils::LoadMediumDatasetUnivariateBasis();
+  std::vector<StochTree::FeatureType> feature_types(test_dataset.x_cols, StochTree::FeatureType::kNumeric);
+  int n = test_dataset.n;
+  int p = test_dataset.x_cols;
+  StochTree::ForestDataset dataset = StochTree::ForestDataset();
+  dataset.AddCovariates(test_dataset.covariates.data(), n, p, test_dataset.row_major);
+  StochTree::FeaturePresortRootContainer presort_container(dataset.GetCovariates(), feature_types);
+  StochTree::SortedNodeSampleTracker tracker(&presort_container, dataset.GetCovariates(), feature_types);
+
+  // Grow a tree, then reset the tracker in place
+  StochTree::TreeSplit tree_split = StochTree::TreeSplit(0.5);
+  tracker.PartitionNode(dataset.GetCovariates(), 0, 0, tree_split);
+  tracker.PartitionNode(dataset.GetCovariates(), 2, 1, tree_split);
+  StochTree::data_size_t const* buffer = &*tracker.NodeBeginIterator(0, 0);
+  tracker.ResetToRoot(feature_types);
+  ASSERT_EQ(&*tracker.NodeBeginIterator(0, 0), buffer);
+
+  // The reset tracker matches a newly constructed one, before and after splitting again
+  StochTree::SortedNodeSampleTracker fresh_tracker(&presort_container, dataset.GetCovariates(), feature_types);
+  for (int j = 0; j < p; j++) {
+    ASSERT_EQ(tracker.NodeBegin(0, j), 0);
+    ASSERT_EQ(tracker.NodeEnd(0, j), n);
+    ASSERT_EQ(tracker.NodeIndices(0, j), fresh_tracker.NodeIndices(0, j));
+  }
+  tracker.PartitionNode(dataset.GetCovariates(), 0, 2, tree_split);
+  fresh_tracker.PartitionNode(dataset.GetCovariates(), 0, 2, tree_split);
+  for (int node_id = 0; node_id < 3; node_id++) {
+    for (int j = 0; j < p; j++) {
+      ASSERT_EQ(tracker.NodeBegin(node_id, j), fresh_tracker.NodeBegin(node_id, j));
+      ASSERT_EQ(tracker.NodeEnd(node_id, j), fresh_tracker.NodeEnd(node_id, j));
+      ASSERT_EQ(tracker.NodeIndices(node_id, j), fresh_tracker.NodeIndices(node_id, j));
+    }
+  }
+}
+
+TEST(SortedNodeSampleTracker, SparseMatchesDense) {
+  // Simulate features that are mostly zero, with negative and positive values, and categorical features with a zero category
+  StochTree::data_size_t n = 2000;
+  int p = 4;
+  std::mt19937 gen(4321);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  std::vector<double> covariates(n * p, 0.);
+  for (StochTree::data_size_t i = 0; i < n; i++) {
+    if (unif(gen) < 0.4) covariates[i * p] = std::round((unif(gen) - 0.5) * 20) / 10;
+    if (unif(gen) < 0.2) covariates[i * p + 1] = unif(gen);
+    covariates[i * p + 2] = (unif(gen) < 0.5) ? 0. : std::floor(unif(gen) * 4) + 1;
+    covariates[i * p + 3] = (unif(gen) < 0.5) ? 0. : std::floor(unif(gen) * 4) + 1;
+  }
+  std::vector<int> col_ptr(1, 0);
+  std::vector<int> row_index;
+  std::vector<double> values;
+  for (int j = 0; j < p; j++) {
+    for (StochTree::data_size_t i = 0; i < n; i++) {
+      if (covariates[i * p + j] != 0.) {
+        row_index.push_back(i);
+        values.push_back(covariates[i * p + j]);
+      }
+    }
+    col_ptr.push_back(static_cast<int>(values.size()));
+  }
+  Eigen::VectorXd residuals(n);
+  for (StochTree::data_size_t i = 0; i < n; i++) residuals(i) = unif(gen) + covariates[i * p + 3];
+  std::vector<StochTree::FeatureType> feature_types{StochTree::FeatureType::kNumeric, StochTree::FeatureType::kNumeric, 
+                                                    StochTree::FeatureType::kOrderedCategorical, StochTree::FeatureType::kUnorderedCategorical};
+  StochTree::ForestDataset dense = StochTree::ForestDataset();
+  dense.AddCovariates(covariates.data(), n, p, true);
+  StochTree::ForestDataset sparse = StochTree::ForestDataset();
+  sparse.AddSparseCovariates(col_ptr.data(), row_index.data(), values.data(), n, p);
+
+  // Sparse features sort only their nonzero entries, which expand to the dense sort order
+  StochTree::FeaturePresortRootContainer dense_presort(dense.GetCovariates(), feature_types);
+  StochTree::FeaturePresortRootContainer sparse_presort(sparse.GetSparseCovariates(), feature_types);
+  for (int j = 0; j < p; j++) {
+    ASSERT_TRUE(sparse_presort.GetFeaturePresort(j)->IsSparse());
+    ASSERT_EQ(sparse_presort.GetFeaturePresort(j)->GetSortIndices(), dense_presort.GetFeaturePresort(j)->GetSortIndices());
+  }
+
+  // Split both trackers identically, twice, resetting in between
+  StochTree::SortedNodeSampleTracker dense_tracker(&dense_presort, dense.GetCovariates(), feature_types);
+  StochTree::SortedNodeSampleTracker sparse_tracker(&sparse_presort, sparse.GetSparseCovariates(), feature_types);
+  ASSERT_FALSE(dense_tracker.IsSparse());
+  ASSERT_TRUE(sparse_tracker.IsSparse());
+  StochTree::TreeSplit zero_split = StochTree::TreeSplit(0.0);
+  std::vector<std::uint32_t> category_list{0, 2};
+  for (int rep = 0; rep < 2; rep++) {
+    dense_tracker.ResetToRoot(feature_types);
+    sparse_tracker.ResetToRoot(feature_types);
+    dense_tracker.PartitionNode(dense.GetCovariates(), 0, rep, zero_split);
+    sparse_tracker.PartitionNode(sparse.GetSparseCovariates(), 0, rep, zero_split);
+    dense_tracker.PartitionNode(dense.GetCovariates(), 1, 3, category_list);
+    sparse_tracker.PartitionNode(sparse.GetSparseCovariates(), 1, 3, category_list);
+    dense_tracker.PartitionNode(dense.GetCovariates(), 2, 1, 0.4);
+    sparse_tracker.PartitionNode(sparse.GetSparseCovariates(), 2, 1, 0.4);
+
+    // Leaves hold the same observations in the same sorted order, and the cutpoint grids agree
+    StochTree::CutpointGridContainer dense_grid(dense.GetCovariates(), residuals, 10);
+    StochTree::CutpointGridContainer sparse_grid(sparse.GetSparseCovariates(), residuals, 10);
+    for (int node_id = 3; node_id < 7; node_id++) {
+      for (int j = 0; j < p; j++) {
+        ASSERT_EQ(sparse_tracker.NodeBegin(node_id, j), dense_tracker.NodeBegin(node_id, j));
+        ASSERT_EQ(sparse_tracker.NodeEnd(node_id, j), dense_tracker.NodeEnd(node_id, j));
+        ASSERT_EQ(sparse_tracker.NodeIndices(node_id, j), dense_tracker.NodeIndices(node_id, j));
+        StochTree::data_size_t node_begin = dense_tracker.NodeBegin(node_id, j);
+        StochTree::data_size_t node_end = dense_tracker.NodeEnd(node_id, j);
+        dense_grid.CalculateStrides(dense.GetCovariates(), residuals, &dense_tracker, node_id, node_begin, node_end, j, feature_types);
+        sparse_grid.CalculateStrides(sparse.GetSparseCovariates(), residuals, &sparse_tracker, node_id, node_begin, node_end, j, feature_types);
+        ASSERT_EQ(sparse_grid.NumCutpoints(j), dense_grid.NumCutpoints(j));
+        for (int k = 0; k < dense_grid.NumCutpoints(j); k++) {
+          ASSERT_EQ(sparse_grid.BinStartIndex(k, j), dense_grid.BinStartIndex(k, j));
+          ASSERT_EQ(sparse_grid.BinLength(k, j), dense_grid.BinLength(k, j));
+          ASSERT_EQ(sparse_grid.CutpointValue(k, j), dense_grid.CutpointValue(k, j));
+        }
+      }
+    }
+  }
+}
@@ -8,6 +8,7 @@
 #include <stochtree/log.h>
 #include <stochtree/tree.h>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 TEST(Tree, UnivariateTreeConstruction) {
@@ -113,6 +114,38 @@ TEST(Tree, UnivariateTreeCategoricalSplitConstruction) {
   ASSERT_TRUE(tree.IsLeaf(2));
 }
 
+TEST(Tree, CategorySplitSet) {
+  // Small categories are encoded as a bitset and sparse large categories as a hash table
+  std::vector<std::uint32_t> small_categories{1,4,6,63,64};
+  std::vector<std::uint32_t> large_categories{3,1000000,4294967295u,77777,123456789};
+  StochTree::Tree tree;
+  tree.Init(1);
+  tree.ExpandNode(0, 0, small_categories, 0., 0.);
+  tree.ExpandNode(1, 1, large_categories, 0., 0.);
+  StochTree::TreeSplit split(large_categories);
+  std::vector<std::uint64_t> small_encoded, large_encoded;
+  StochTree::EncodeCategorySet(small_categories, small_encoded);
+  StochTree::EncodeCategorySet(large_categories, large_encoded);
+  ASSERT_EQ(small_encoded[0], StochTree::kCategoryBitset);
+  ASSERT_EQ(large_encoded[0], StochTree::kCategoryHashSet);
+
+  // Membership tests agree with a scan of the category list
+  std::vector<double> values{0., 1., 1.5, 3., 4., 6., 63., 64., 65., 128., 77777., 1000000., 123456789., 4294967295., -1., 1e20,
+                             std::numeric_limits<double>::quiet_NaN()};
+  for (double value : values) {
+    ASSERT_EQ(tree.CategorySplitSet(0).Contains(value), StochTree::SplitTrueCategorical(value, small_categories));
+    ASSERT_EQ(tree.CategorySplitSet(1).Contains(value), StochTree::SplitTrueCategorical(value, large_categories));
+    ASSERT_EQ(split.SplitTrue(value), StochTree::SplitTrueCategorical(value, large_categories));
+  }
+  ASSERT_FALSE(tree.CategorySplitSet(2).Contains(1.));
+
+  // Sets are carried over when a tree is copied
+  StochTree::Tree tree_copy;
+  tree_copy.CloneFromTree(&tree);
+  ASSERT_TRUE(tree_copy.CategorySplitSet(1).Contains(77777.));
+  ASSERT_FALSE(tree_copy.CategorySplitSet(1).Contains(77778.));
+}
+
 TEST(Tree, MultivariateTreeConstruction) {
   StochTree::Tree tree;
   int tree_dim = 2;
@@ -133,6 +166,9 @@ TEST(Tree, MultivariateTreeConstruction) {
   ASSERT_FALSE(tree.IsLeaf(0));
   ASSERT_TRUE(tree.IsLeaf(1));
   ASSERT_TRUE(tree.IsLeaf(2));
+  tree.SetLeafVector(2, std::vector<double>{1.5, -2.5});
+  ASSERT_EQ(tree.LeafValues(2)[0], tree.LeafValue(2, 0));
+  ASSERT_EQ(tree.LeafValues(2)[1], tree.LeafValue(2, 1));
 }
 
 TEST(Tree, MultivariateTreeCategoricalSplitConstruction) {
@@ -100,3 +100,36 @@ TEST(UnsortedNodeSampleTracker, BasicOperations) {
   ASSERT_FALSE(node_sample_tracker.IsValidNode(0, 3));
   ASSERT_FALSE(node_sample_tracker.IsValidNode(0, 4));
 }
+
+TEST(SampleNodeMapper, NodeIdWidth) {
+  // Node ids start out in 16 bits, stored tree by tree
+  int num_trees = 3;
+  StochTree::data_size_t n = 10;
+  StochTree::SampleNodeMapper sample_node_mapper = StochTree::SampleNodeMapper(num_trees, n);
+  ASSERT_FALSE(sample_node_mapper.HasWideNodeIds());
+  for (int j = 0; j < num_trees; j++) sample_node_mapper.AssignAllSamplesToRoot(j);
+  std::vector<StochTree::data_size_t> sample_ids{1, 4, 7};
+  sample_node_mapper.SetNodeIds(1, sample_ids.data(), sample_ids.size(), 5);
+  sample_node_mapper.SetNodeId(2, 2, StochTree::SampleNodeMapper::kMaxNarrowNodeId);
+  ASSERT_FALSE(sample_node_mapper.HasWideNodeIds());
+  sample_node_mapper.VisitTreeNodeIds(1, [&](auto* node_ids) {
+    for (StochTree::data_size_t i = 0; i < n; i++) {
+      ASSERT_EQ(node_ids[i], (i % 3 == 1) ? 5 : 0);
+    }
+  });
+
+  // Assigning a node id that does not fit in 16 bits widens every tree, keeping existing node ids
+  int wide_node_id = StochTree::SampleNodeMapper::kMaxNarrowNodeId + 2;
+  sample_node_mapper.SetNodeIds(0, sample_ids.data(), 2, wide_node_id);
+  ASSERT_TRUE(sample_node_mapper.HasWideNodeIds());
+  for (StochTree::data_size_t i = 0; i < n; i++) {
+    ASSERT_EQ(sample_node_mapper.GetNodeId(i, 0), (i == 1 || i == 4) ? wide_node_id : 0);
+    ASSERT_EQ(sample_node_mapper.GetNodeId(i, 1), (i % 3 == 1) ? 5 : 0);
+    ASSERT_EQ(sample_node_mapper.GetNodeId(i, 2), (i == 2) ? StochTree::SampleNodeMapper::kMaxNarrowNodeId : 0);
+  }
+
+  // Copies keep the node id width
+  StochTree::SampleNodeMapper copy(sample_node_mapper);
+  ASSERT_TRUE(copy.HasWideNodeIds());
+  ASSERT_EQ(copy.GetNodeId(4, 0), wide_node_id);
+}
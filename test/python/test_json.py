@@ -1,5 +1,6 @@
 import numpy as np
-from stochtree import BARTModel, JSONSerializer, ForestContainer, Dataset
+import pandas as pd
+from stochtree import BARTModel, JSONSerializer, ForestContainer, Dataset, CovariateTransformer
 
 class TestJson:
     def test_value(self):
@@ -68,4 +69,28 @@ class TestJson:
         # Check the predictions
         np.testing.assert_almost_equal(forest_preds_y_mcmc_cached, forest_preds_json_reload)
         np.testing.assert_almost_equal(forest_preds_y_mcmc_retrieved, forest_preds_json_reload)
-        
\ No newline at end of file
+
+        # Every prediction engine gives identical predictions
+        expected = forest_container.predict(forest_dataset)
+        for engine in ["quickscorer", "memoized"]:
+            np.testing.assert_array_equal(forest_container.predict(forest_dataset, engine=engine), expected)
+            np.testing.assert_array_equal(forest_container.predict_raw(forest_dataset, 2, engine), forest_container.predict_raw(forest_dataset))
+        
+
+    def test_covariate_transformer(self):
+        df = pd.DataFrame(
+            {"x1": [1.5, 2.7, 3.6, 4.4, 5.3, 6.1], 
+             "x2": pd.Categorical(["a", "b", "c", "a", "b", "c"], ordered=True, categories=["c", "b", "a"]), 
+             "x3": pd.Series(["red", "blue", "green", "blue", "red", "green"], dtype="string")}
+        )
+        cov_transformer = CovariateTransformer()
+        df_transformed = cov_transformer.fit_transform(df)
+
+        # Roundtrip to / from JSON
+        json_test = JSONSerializer()
+        json_test.add_covariate_transformer(cov_transformer)
+        cov_transformer_reload = json_test.get_covariate_transformer()
+
+        # Check that new data is encoded as the training data was
+        np.testing.assert_array_equal(df_transformed, cov_transformer_reload.transform(df))
+        assert cov_transformer_reload._processed_feature_types == cov_transformer._processed_feature_types
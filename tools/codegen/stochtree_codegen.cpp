@@ -0,0 +1,62 @@
+/*!
+ * Copyright (c) 2024 stochtree authors
+ *
+ * Command line tool that translates a serialized forest container into C++ source (see stochtree/codegen.h).
+ *
+ * Usage: stochtree_codegen <model.json> <output.cpp> [--forest <label>] [--samples <i,j,...>]
+ *
+ * <model.json> is either a forest container saved with `ForestContainer::SaveToJsonFile` or a model
+ * saved from R / Python, in which case `--forest` selects an entry of its "forests" object
+ * (default: forest_0). `--samples` restricts the output to a comma-separated list of (0-indexed) samples.
+ */
+#include <stochtree/codegen.h>
+#include <stochtree/container.h>
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: stochtree_codegen <model.json> <output.cpp> [--forest <label>] [--samples <i,j,...>]" << std::endl;
+    return 1;
+  }
+  std::string forest_label = "forest_0";
+  std::vector<int> sample_indices;
+  for (int i = 3; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--forest" && i + 1 < argc) {
+      forest_label = argv[++i];
+    } else if (arg == "--samples" && i + 1 < argc) {
+      std::stringstream samples(argv[++i]);
+      std::string sample;
+      while (std::getline(samples, sample, ',')) sample_indices.push_back(std::stoi(sample));
+    } else {
+      std::cerr << "Unrecognized argument: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  try {
+    std::ifstream model_file(argv[1]);
+    if (!model_file) {
+      std::cerr << "Could not open " << argv[1] << std::endl;
+      return 1;
+    }
+    nlohmann::json model_json = nlohmann::json::parse(model_file);
+    StochTree::ForestContainer forest_container(0, 1, true);
+    if (model_json.contains("forests")) {
+      forest_container.from_json(model_json.at("forests").at(forest_label));
+    } else {
+      forest_container.from_json(model_json);
+    }
+    StochTree::GenerateForestSourceFile(forest_container, sample_indices, argv[2]);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}